@@ -0,0 +1,205 @@
+#include <curl/curl.h>
+
+#include <exception>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include "src/async_transport.h"
+#include "src/types.h"
+
+using std::string;
+
+namespace libsubtle {
+
+struct CurlMultiTransport::Call {
+  CURL* curl;
+  curl_slist* headers;
+  string body;
+  ByteSink* response;
+  Done done;
+  // exceptions cannot cross curl, they are passed on once the call is over
+  std::exception_ptr error;
+};
+
+namespace {
+
+std::once_flag curl_initialized;
+
+}  // namespace
+
+size_t CurlMultiTransport::WriteResponse(char* data, size_t size, size_t count,
+                                         void* user) {
+  Call* call = static_cast<Call*>(user);
+  try {
+    call->response->Write(data, size * count);
+  } catch (...) {
+    call->error = std::current_exception();
+    return 0;
+  }
+  return size * count;
+}
+
+CurlMultiTransport::CurlMultiTransport(const CurlOptions& options)
+    : options_(options), handles_(0), stop_(false) {
+  std::call_once(curl_initialized, [] { curl_global_init(CURL_GLOBAL_ALL); });
+  multi_ = curl_multi_init();
+  if (!multi_) {
+    throw SubtleException("Cannot initialize curl.");
+  }
+  loop_ = std::thread(&CurlMultiTransport::Loop, this);
+}
+
+CurlMultiTransport::~CurlMultiTransport() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  curl_multi_wakeup(multi_);
+  loop_.join();
+  for (CURL* curl : idle_) {
+    curl_easy_cleanup(curl);
+  }
+  curl_multi_cleanup(multi_);
+}
+
+size_t CurlMultiTransport::handles() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return handles_;
+}
+
+void CurlMultiTransport::PostAsync(const string& url, const string& user_agent,
+                                   const string& body, ByteSink* response,
+                                   const Done& done) {
+  CURL* curl = NULL;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!idle_.empty()) {
+      curl = idle_.back();
+      idle_.pop_back();
+    }
+  }
+  if (!curl) {
+    curl = curl_easy_init();
+    if (!curl) {
+      throw SubtleException("Cannot initialize curl.");
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++handles_;
+  }
+
+  Call* call = new Call;
+  call->curl = curl;
+  call->headers = curl_slist_append(NULL, "Content-Type: text/xml");
+  call->body = body;
+  call->response = response;
+  call->done = done;
+  curl_easy_reset(curl);
+  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl, CURLOPT_USERAGENT, user_agent.c_str());
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, call->headers);
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDS, call->body.data());
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE,
+                   static_cast<long>(call->body.size()));
+  curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT,
+                   static_cast<long>(options_.connect_timeout_seconds));
+  curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT,
+                   static_cast<long>(options_.low_speed_limit));
+  curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME,
+                   static_cast<long>(options_.low_speed_time_seconds));
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteResponse);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, call);
+  curl_easy_setopt(curl, CURLOPT_PRIVATE, call);
+
+  // the multi handle belongs to the loop thread, which picks the call up
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.push_back(call);
+  }
+  curl_multi_wakeup(multi_);
+}
+
+void CurlMultiTransport::Loop() {
+  std::set<Call*> running;
+  for (;;) {
+    vector<Call*> added;
+    bool stop;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      added.swap(pending_);
+      stop = stop_;
+    }
+    for (Call* call : added) {
+      curl_multi_add_handle(multi_, call->curl);
+      running.insert(call);
+    }
+    if (stop) {
+      break;
+    }
+
+    int active = 0;
+    curl_multi_perform(multi_, &active);
+    int queued = 0;
+    while (CURLMsg* message = curl_multi_info_read(multi_, &queued)) {
+      if (message->msg != CURLMSG_DONE) {
+        continue;
+      }
+      // the message does not survive removing its handle
+      CURLcode code = message->data.result;
+      Call* call = NULL;
+      curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &call);
+      running.erase(call);
+      Complete(call, code);
+    }
+    curl_multi_poll(multi_, NULL, 0, 1000, NULL);
+  }
+
+  // handlers of the failed calls may post more, which fail in turn
+  for (;;) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (Call* call : pending_) {
+        curl_multi_add_handle(multi_, call->curl);
+        running.insert(call);
+      }
+      pending_.clear();
+    }
+    if (running.empty()) {
+      break;
+    }
+    Call* call = *running.begin();
+    running.erase(running.begin());
+    if (!call->error) {
+      call->error = std::make_exception_ptr(
+          SubtleException("XML-RPC call failed: transport closed"));
+    }
+    Complete(call, CURLE_OK);
+  }
+}
+
+void CurlMultiTransport::Complete(Call* call, CURLcode code) {
+  long http_status = 0;
+  curl_easy_getinfo(call->curl, CURLINFO_RESPONSE_CODE, &http_status);
+  curl_multi_remove_handle(multi_, call->curl);
+  curl_slist_free_all(call->headers);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_.push_back(call->curl);
+  }
+
+  std::exception_ptr error = call->error;
+  if (!error && code != CURLE_OK) {
+    error = std::make_exception_ptr(SubtleException(
+        string("XML-RPC call failed: ") + curl_easy_strerror(code)));
+  } else if (!error && http_status != 200) {
+    error = std::make_exception_ptr(SubtleException(
+        "XML-RPC call failed: HTTP status " + std::to_string(http_status)));
+  }
+  Done done = call->done;
+  delete call;
+  done(error);
+}
+
+}  // namespace libsubtle
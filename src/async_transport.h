@@ -0,0 +1,88 @@
+#ifndef SRC_ASYNC_TRANSPORT_H_
+#define SRC_ASYNC_TRANSPORT_H_
+
+#include <curl/curl.h>
+
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/byte_sink.h"
+#include "src/transport.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+/// Carries XML-RPC calls to the service without blocking the caller: a call
+/// is started, and a completion handler runs once the response is in.
+/// Implementations over other event loops, such as asio, let the calls
+/// complete on the loop of the application.
+class AsyncTransport {
+ public:
+  /// Runs once a call is over, with the error that ended it, if any. It
+  /// must not throw.
+  typedef std::function<void(std::exception_ptr error)> Done;
+
+  virtual ~AsyncTransport() {}
+
+  /// Start posting a call, streaming the response body into a sink as it
+  /// arrives. Errors are as for Transport::Post, but are passed to done
+  /// instead of thrown.
+  /// \param url endpoint of the service.
+  /// \param user_agent identifies the application to the service.
+  /// \param body XML of the call.
+  /// \param response receives the XML of the response; it is not finished,
+  ///        and must outlive the call.
+  /// \param done runs once the call is over, possibly on another thread.
+  virtual void PostAsync(const string& url, const string& user_agent,
+                         const string& body, ByteSink* response,
+                         const Done& done) = 0;
+};
+
+/// AsyncTransport over a libcurl multi handle, driven by a thread of its
+/// own. Any number of calls share the one thread, and the sinks and
+/// completion handlers run on it, so they should not block for long.
+/// Calls still running on destruction are failed.
+class CurlMultiTransport : public AsyncTransport {
+ public:
+  explicit CurlMultiTransport(const CurlOptions& options = CurlOptions());
+  ~CurlMultiTransport();
+
+  void PostAsync(const string& url, const string& user_agent,
+                 const string& body, ByteSink* response, const Done& done);
+
+  /// \return number of easy handles created, the most calls ever in flight.
+  size_t handles() const;
+
+ private:
+  CurlMultiTransport(const CurlMultiTransport&);
+  void operator=(const CurlMultiTransport&);
+
+  struct Call;
+
+  static size_t WriteResponse(char* data, size_t size, size_t count,
+                              void* user);
+  void Loop();
+  // removes a call from the multi handle and runs its handler
+  void Complete(Call* call, CURLcode code);
+
+  CURLM* multi_;
+  std::thread loop_;
+
+  const CurlOptions options_;
+  mutable std::mutex mutex_;
+  // calls posted and not yet added to the multi handle
+  vector<Call*> pending_;
+  vector<CURL*> idle_;
+  size_t handles_;
+  bool stop_;
+};
+
+}  // namespace libsubtle
+
+#endif  // SRC_ASYNC_TRANSPORT_H_
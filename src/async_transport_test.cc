@@ -0,0 +1,91 @@
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/async_transport.h"
+#include "src/mock_server.h"
+#include "src/types.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+// Response and outcome of a call, and a count of the calls still running.
+class PendingCalls {
+ public:
+  struct Call : public ByteSink {
+    void Write(const char* data, size_t size) { text.append(data, size); }
+    string text;
+    std::exception_ptr error;
+  };
+
+  Call* Start(AsyncTransport* transport, const string& url,
+              const string& body) {
+    calls_.emplace_back(new Call);
+    Call* call = calls_.back().get();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++running_;
+    }
+    transport->PostAsync(url, "test", body, call,
+                         [this, call](std::exception_ptr error) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      call->error = error;
+      if (--running_ == 0) {
+        done_.notify_all();
+      }
+    });
+    return call;
+  }
+
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return running_ == 0; });
+  }
+
+ private:
+  vector<std::unique_ptr<Call>> calls_;
+  std::mutex mutex_;
+  std::condition_variable done_;
+  int running_ = 0;
+};
+
+TEST(CurlMultiTransport, ManyCalls) {
+  const int kCalls = 500;
+  MockServer server([](const string& request) { return "<" + request + ">"; });
+  CurlMultiTransport transport;
+  PendingCalls pending;
+  vector<PendingCalls::Call*> calls;
+  for (int i = 0; i < kCalls; ++i) {
+    calls.push_back(pending.Start(&transport, server.url(),
+                                  std::to_string(i)));
+  }
+  pending.Wait();
+  for (int i = 0; i < kCalls; ++i) {
+    ASSERT_FALSE(calls[i]->error);
+    ASSERT_EQ("<" + std::to_string(i) + ">", calls[i]->text);
+  }
+  ASSERT_EQ(kCalls, server.requests());
+  // all calls were in flight at once on the one thread
+  ASSERT_GT(transport.handles(), 1u);
+}
+
+TEST(CurlMultiTransport, Unreachable) {
+  string url;
+  {
+    MockServer server([](const string& request) { return request; });
+    url = server.url();
+  }
+  CurlMultiTransport transport;
+  PendingCalls pending;
+  PendingCalls::Call* call = pending.Start(&transport, url, "call");
+  pending.Wait();
+  ASSERT_THROW(std::rethrow_exception(call->error), SubtleException);
+}
+
+}  // namespace libsubtle
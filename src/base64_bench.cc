@@ -0,0 +1,88 @@
+// Time per encoded and decoded subtitle payload.
+//
+// Compares the reference implementation in base64.h with the scalar and
+// vector kernels of base64_codec.h.
+
+#include <random>
+#include <string>
+
+#include "src/base64.h"
+#include "src/base64_codec.h"
+#include "src/bench.h"
+
+using std::string;
+
+namespace libsubtle {
+namespace {
+
+// a typical gzipped subtitle
+const size_t kPayloadSize = 48 * 1024;
+const int kIterations = 500;
+
+const char* kKernelNames[] = {"scalar", "ssse3", "avx2"};
+
+string MakePayload() {
+  std::mt19937 random(42);
+  string data(kPayloadSize, '\0');
+  for (char& c : data) {
+    c = static_cast<char>(random());
+  }
+  return data;
+}
+
+}  // namespace
+}  // namespace libsubtle
+
+int main() {
+  using libsubtle::bench::DoNotOptimize;
+  using libsubtle::bench::Measure;
+  using libsubtle::kIterations;
+
+  string data = libsubtle::MakePayload();
+  string text = base64_encode(
+      reinterpret_cast<const unsigned char*>(data.data()), data.size());
+  printf("%zu byte payload, %zu characters encoded\n", data.size(),
+         text.size());
+
+  {
+    Measure m("base64.h encode");
+    for (int i = 0; i < kIterations; ++i) {
+      DoNotOptimize(base64_encode(
+          reinterpret_cast<const unsigned char*>(data.data()), data.size()));
+    }
+    m.Report(kIterations);
+  }
+  {
+    Measure m("base64.h decode");
+    for (int i = 0; i < kIterations; ++i) {
+      DoNotOptimize(base64_decode(text));
+    }
+    m.Report(kIterations);
+  }
+
+  string encoded(libsubtle::Base64EncodedSize(data.size()), '\0');
+  string decoded(libsubtle::Base64DecodedSize(text.size()), '\0');
+  for (int kernel = libsubtle::BASE64_SCALAR;
+       kernel <= libsubtle::Base64BestKernel(); ++kernel) {
+    libsubtle::Base64Kernel k = static_cast<libsubtle::Base64Kernel>(kernel);
+    {
+      Measure m(string(libsubtle::kKernelNames[kernel]) + " encode");
+      for (int i = 0; i < kIterations; ++i) {
+        DoNotOptimize(libsubtle::Base64Encode(
+            reinterpret_cast<const unsigned char*>(data.data()), data.size(),
+            &encoded[0], k));
+      }
+      m.Report(kIterations);
+    }
+    {
+      Measure m(string(libsubtle::kKernelNames[kernel]) + " decode");
+      size_t size;
+      for (int i = 0; i < kIterations; ++i) {
+        DoNotOptimize(libsubtle::Base64Decode(
+            text.data(), text.size(),
+            reinterpret_cast<unsigned char*>(&decoded[0]), &size, k));
+      }
+      m.Report(kIterations);
+    }
+  }
+}
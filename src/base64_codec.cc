@@ -0,0 +1,464 @@
+#include <algorithm>
+#include <cctype>
+#include <cinttypes>
+#include <cstring>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SUBTLE_BASE64_X86 1
+#endif
+
+#include "src/base64_codec.h"
+#include "src/types.h"
+
+using std::string;
+
+namespace libsubtle {
+
+const size_t Base64DecodeSink::kPendingLimit;
+
+namespace {
+
+const char kAlphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+const uint8_t kInvalid = 0xff;
+const uint8_t kSpace = 0xfe;
+
+// Maps characters to their 6 bit values, or kInvalid/kSpace.
+struct DecodeTable {
+  uint8_t values[256];
+
+  DecodeTable() {
+    memset(values, kInvalid, sizeof(values));
+    for (int i = 0; i < 64; ++i) {
+      values[static_cast<uint8_t>(kAlphabet[i])] = i;
+    }
+    values[' '] = values['\t'] = values['\r'] = values['\n'] = kSpace;
+  }
+};
+
+const DecodeTable kDecode;
+
+void EncodeTriple(const uint8_t* in, char* out) {
+  uint32_t v = (in[0] << 16) | (in[1] << 8) | in[2];
+  out[0] = kAlphabet[v >> 18];
+  out[1] = kAlphabet[(v >> 12) & 0x3f];
+  out[2] = kAlphabet[(v >> 6) & 0x3f];
+  out[3] = kAlphabet[v & 0x3f];
+}
+
+// Scalar tail of the encoders, including padding.
+size_t EncodeScalar(const uint8_t* in, size_t size, char* out) {
+  char* o = out;
+  for (; size >= 3; size -= 3, in += 3, o += 4) {
+    EncodeTriple(in, o);
+  }
+  if (size) {
+    uint8_t last[3] = {in[0], size > 1 ? in[1] : uint8_t(0), 0};
+    EncodeTriple(last, o);
+    o[3] = '=';
+    if (size == 1) {
+      o[2] = '=';
+    }
+    o += 4;
+  }
+  return o - out;
+}
+
+// Decode whole quads of alphabet characters until anything else shows up.
+void DecodeQuads(const uint8_t** in, const uint8_t* end, uint8_t** out) {
+  const uint8_t* p = *in;
+  uint8_t* o = *out;
+  while (end - p >= 4) {
+    uint32_t a = kDecode.values[p[0]], b = kDecode.values[p[1]],
+             c = kDecode.values[p[2]], d = kDecode.values[p[3]];
+    if ((a | b | c | d) & 0x80) {
+      break;
+    }
+    uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+    o[0] = v >> 16;
+    o[1] = v >> 8;
+    o[2] = v;
+    p += 4;
+    o += 3;
+  }
+  *in = p;
+  *out = o;
+}
+
+#ifdef SUBTLE_BASE64_X86
+
+// The vector kernels follow Muła and Lemire, "Faster Base64 Encoding and
+// Decoding Using AVX2 Instructions": characters are validated and translated
+// with nibble indexed pshufb lookups, and packed with multiply-adds.
+
+__attribute__((target("ssse3")))
+__m128i EncodeLookup(__m128i indices) {
+  const __m128i shift = _mm_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  __m128i result = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+  __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+  result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+  return _mm_add_epi8(_mm_shuffle_epi8(shift, result), indices);
+}
+
+// Spreads 12 bytes into 16 six bit indices.
+__attribute__((target("ssse3")))
+__m128i EncodeSplit(__m128i in) {
+  in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7,
+                                          10, 9, 11, 10));
+  __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+  __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+  __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+  __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+  return _mm_or_si128(t1, t3);
+}
+
+__attribute__((target("ssse3")))
+size_t EncodeSsse3(const uint8_t* in, size_t size, char* out) {
+  char* o = out;
+  // loads 16 bytes for every 12 encoded
+  for (; size >= 16; size -= 12, in += 12, o += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(o),
+                     EncodeLookup(EncodeSplit(v)));
+  }
+  return (o - out) + EncodeScalar(in, size, o);
+}
+
+__attribute__((target("avx2")))
+size_t EncodeAvx2(const uint8_t* in, size_t size, char* out) {
+  const __m256i split = _mm256_setr_epi8(
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+  const __m256i shift = _mm256_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  char* o = out;
+  // loads 28 bytes for every 24 encoded, 12 into each lane
+  for (; size >= 28; size -= 24, in += 24, o += 32) {
+    __m256i v = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 12)), 1);
+    v = _mm256_shuffle_epi8(v, split);
+    __m256i t0 = _mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00));
+    __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    __m256i t2 = _mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0));
+    __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    __m256i indices = _mm256_or_si256(t1, t3);
+
+    __m256i result = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    result = _mm256_or_si256(result,
+                             _mm256_and_si256(less, _mm256_set1_epi8(13)));
+    result = _mm256_add_epi8(_mm256_shuffle_epi8(shift, result), indices);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(o), result);
+  }
+  return (o - out) + EncodeScalar(in, size, o);
+}
+
+// Decode whole 16 character blocks until one holds anything but the alphabet.
+// Stores 16 bytes for every 12 decoded, so enough input must remain to keep
+// the stores within the output buffer.
+__attribute__((target("ssse3")))
+void DecodeSsse3(const uint8_t** in, const uint8_t* end, uint8_t** out) {
+  const __m128i lut_lo = _mm_setr_epi8(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+  const __m128i lut_hi = _mm_setr_epi8(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m128i lut_roll = _mm_setr_epi8(
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i mask_2f = _mm_set1_epi8(0x2f);
+  const __m128i pack = _mm_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+  const uint8_t* p = *in;
+  uint8_t* o = *out;
+  for (; end - p >= 32; p += 16, o += 12) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(v, 4), mask_2f);
+    __m128i lo = _mm_shuffle_epi8(lut_lo, _mm_and_si128(v, mask_2f));
+    __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+    if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi),
+                                         _mm_setzero_si128()))) {
+      break;
+    }
+    __m128i eq_2f = _mm_cmpeq_epi8(v, mask_2f);
+    __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+    v = _mm_add_epi8(v, roll);
+    v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+    v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(o),
+                     _mm_shuffle_epi8(v, pack));
+  }
+  *in = p;
+  *out = o;
+}
+
+// As DecodeSsse3, 32 characters at a time.
+__attribute__((target("avx2")))
+void DecodeAvx2(const uint8_t** in, const uint8_t* end, uint8_t** out) {
+  const __m256i lut_lo = _mm256_setr_epi8(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+  const __m256i lut_hi = _mm256_setr_epi8(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m256i lut_roll = _mm256_setr_epi8(
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+  const __m256i pack = _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+
+  const uint8_t* p = *in;
+  uint8_t* o = *out;
+  for (; end - p >= 64; p += 32, o += 24) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(v, 4), mask_2f);
+    __m256i lo = _mm256_shuffle_epi8(lut_lo, _mm256_and_si256(v, mask_2f));
+    __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+    if (!_mm256_testz_si256(lo, hi)) {
+      break;
+    }
+    __m256i eq_2f = _mm256_cmpeq_epi8(v, mask_2f);
+    __m256i roll = _mm256_shuffle_epi8(lut_roll,
+                                       _mm256_add_epi8(eq_2f, hi_nibbles));
+    v = _mm256_add_epi8(v, roll);
+    v = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+    v = _mm256_madd_epi16(v, _mm256_set1_epi32(0x00011000));
+    v = _mm256_shuffle_epi8(v, pack);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(o),
+                        _mm256_permutevar8x32_epi32(v, lanes));
+  }
+  *in = p;
+  *out = o;
+}
+
+#endif  // SUBTLE_BASE64_X86
+
+Base64Kernel DetectKernel() {
+#ifdef SUBTLE_BASE64_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return BASE64_AVX2;
+  }
+  if (__builtin_cpu_supports("ssse3")) {
+    return BASE64_SSSE3;
+  }
+#endif
+  return BASE64_SCALAR;
+}
+
+}  // namespace
+
+Base64Kernel Base64BestKernel() {
+  static const Base64Kernel kernel = DetectKernel();
+  return kernel;
+}
+
+size_t Base64Encode(const unsigned char* in, size_t size, char* out,
+                    Base64Kernel kernel) {
+#ifdef SUBTLE_BASE64_X86
+  if (kernel == BASE64_AVX2) {
+    return EncodeAvx2(in, size, out);
+  }
+  if (kernel == BASE64_SSSE3) {
+    return EncodeSsse3(in, size, out);
+  }
+#endif
+  return EncodeScalar(in, size, out);
+}
+
+namespace {
+
+// Decodes in, or with consumed set only its whole quads, leaving the rest for
+// when more input arrives.
+bool Decode(const char* in, size_t size, unsigned char* out, size_t* out_size,
+            size_t* consumed, Base64Kernel kernel) {
+  const uint8_t* begin = reinterpret_cast<const uint8_t*>(in);
+  const uint8_t* p = begin;
+  const uint8_t* end = p + size;
+  uint8_t* o = out;
+  while (p != end) {
+#ifdef SUBTLE_BASE64_X86
+    if (kernel == BASE64_AVX2) {
+      DecodeAvx2(&p, end, &o);
+    } else if (kernel == BASE64_SSSE3) {
+      DecodeSsse3(&p, end, &o);
+    }
+#endif
+    DecodeQuads(&p, end, &o);
+
+    // the quad the fast paths stopped at, which may hold whitespace or be the
+    // padded last one
+    const uint8_t* quad_begin = p;
+    uint8_t quad[4];
+    int n = 0;
+    while (n < 4 && p != end) {
+      uint8_t c = *p++;
+      if (kDecode.values[c] != kSpace) {
+        quad[n++] = c;
+      }
+    }
+    if (n == 0) {
+      break;
+    }
+    if (n < 4) {
+      if (consumed) {
+        p = quad_begin;
+        break;
+      }
+      return false;
+    }
+    int chars = quad[3] != '=' ? 4 : quad[2] != '=' ? 3 : 2;
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) {
+      uint8_t value = i < chars ? kDecode.values[quad[i]] : 0;
+      if (value & 0x80) {
+        return false;
+      }
+      v = (v << 6) | value;
+    }
+    o[0] = v >> 16;
+    o[1] = v >> 8;
+    o[2] = v;
+    o += chars - 1;
+    if (chars < 4) {
+      // padding ends the input, and the bits it covers must be clear
+      if (v & (chars == 2 ? 0xffff : 0xff)) {
+        return false;
+      }
+      for (; p != end; ++p) {
+        if (kDecode.values[*p] != kSpace) {
+          return false;
+        }
+      }
+    }
+  }
+  *out_size = o - out;
+  if (consumed) {
+    *consumed = p - begin;
+  }
+  return true;
+}
+
+}  // namespace
+
+bool Base64Decode(const char* in, size_t size, unsigned char* out,
+                  size_t* out_size, Base64Kernel kernel) {
+  return Decode(in, size, out, out_size, NULL, kernel);
+}
+
+bool Base64DecodePrefix(const char* in, size_t size, unsigned char* out,
+                        size_t* out_size, size_t* consumed,
+                        Base64Kernel kernel) {
+  return Decode(in, size, out, out_size, consumed, kernel);
+}
+
+Base64DecodeSink::Base64DecodeSink(ByteSink* next)
+    : next_(next), ended_(false) {}
+
+void Base64DecodeSink::Write(const char* data, size_t size) {
+  if (!pending_.empty()) {
+    // complete the quad split by the previous piece
+    size_t taken = std::min(size, kPendingLimit);
+    pending_.append(data, taken);
+    size_t consumed = Decode(pending_.data(), pending_.size());
+    size_t left = pending_.size() - consumed;
+    if (left <= taken) {
+      // the rest of this piece is decoded below
+      pending_.clear();
+      data += taken - left;
+      size -= taken - left;
+    } else {
+      pending_.erase(0, consumed);
+      data += taken;
+      size -= taken;
+      if (pending_.size() > kPendingLimit) {
+        // only whitespace makes it grow
+        pending_.erase(std::remove_if(pending_.begin(), pending_.end(),
+                                      [](char c) {
+                                        return isspace(
+                                            static_cast<unsigned char>(c));
+                                      }),
+                       pending_.end());
+      }
+    }
+  }
+  size_t consumed = Decode(data, size);
+  pending_.append(data + consumed, size - consumed);
+}
+
+void Base64DecodeSink::Finish() {
+  for (char c : pending_) {
+    if (!isspace(static_cast<unsigned char>(c))) {
+      throw SubtleException("Invalid base64 data: truncated.");
+    }
+  }
+  pending_.clear();
+  next_->Finish();
+}
+
+size_t Base64DecodeSink::Decode(const char* data, size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+  decoded_.resize(Base64DecodedSize(size));
+  size_t decoded_size = 0;
+  size_t consumed = 0;
+  bool valid = Base64DecodePrefix(data, size, &decoded_[0], &decoded_size,
+                                  &consumed);
+  // nothing may follow the padding, not even in a later piece
+  if (!valid || (ended_ && decoded_size > 0)) {
+    throw SubtleException("Invalid base64 data.");
+  }
+  for (size_t i = consumed; i > 0; --i) {
+    char c = data[i - 1];
+    if (!isspace(static_cast<unsigned char>(c))) {
+      ended_ = ended_ || c == '=';
+      break;
+    }
+  }
+  if (decoded_size > 0) {
+    next_->Write(reinterpret_cast<const char*>(&decoded_[0]), decoded_size);
+  }
+  return consumed;
+}
+
+string Base64Encode(const string& data) {
+  string out(Base64EncodedSize(data.size()), '\0');
+  if (!data.empty()) {
+    Base64Encode(reinterpret_cast<const unsigned char*>(data.data()),
+                 data.size(), &out[0]);
+  }
+  return out;
+}
+
+string Base64Decode(const string& text) {
+  string out(Base64DecodedSize(text.size()), '\0');
+  size_t size = 0;
+  if (!text.empty() &&
+      !Base64Decode(text.data(), text.size(),
+                    reinterpret_cast<unsigned char*>(&out[0]), &size)) {
+    throw SubtleException("Invalid base64 data.");
+  }
+  out.resize(size);
+  return out;
+}
+
+}  // namespace libsubtle
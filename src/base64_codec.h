@@ -0,0 +1,100 @@
+#ifndef SRC_BASE64_CODEC_H_
+#define SRC_BASE64_CODEC_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "src/byte_sink.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+/// Implementations of the codec, from slowest to fastest.
+enum Base64Kernel {
+  BASE64_SCALAR,
+  BASE64_SSSE3,
+  BASE64_AVX2
+};
+
+/// \return the fastest kernel the CPU supports.
+Base64Kernel Base64BestKernel();
+
+/// \return number of characters encoding size bytes, padding included.
+inline size_t Base64EncodedSize(size_t size) {
+  return (size + 2) / 3 * 4;
+}
+
+/// \return upper bound on the number of bytes decoded from size characters.
+inline size_t Base64DecodedSize(size_t size) {
+  return (size + 3) / 4 * 3;
+}
+
+/// Encode bytes as padded base64.
+/// \param in bytes to encode.
+/// \param size number of bytes to encode.
+/// \param out buffer of at least Base64EncodedSize(size) characters.
+/// \param kernel implementation to use, for tests and benchmarks.
+/// \return number of characters written.
+size_t Base64Encode(const unsigned char* in, size_t size, char* out,
+                    Base64Kernel kernel = Base64BestKernel());
+
+/// Decode padded base64, ignoring whitespace between characters. Anything
+/// else outside the alphabet, misplaced or missing padding and stray bits in
+/// the last character are rejected.
+/// \param in characters to decode.
+/// \param size number of characters.
+/// \param out buffer of at least Base64DecodedSize(size) bytes.
+/// \param out_size out parameter with the number of bytes written.
+/// \param kernel implementation to use, for tests and benchmarks.
+/// \return whether the input was valid.
+bool Base64Decode(const char* in, size_t size, unsigned char* out,
+                  size_t* out_size, Base64Kernel kernel = Base64BestKernel());
+
+/// Decode the whole quads at the start of in, for input that arrives in
+/// pieces. Validates as Base64Decode, except that an incomplete quad at the
+/// end is left undecoded.
+/// \param consumed out parameter with the number of characters decoded; the
+///        rest must be passed again, followed by more input.
+/// \return whether the input was valid.
+bool Base64DecodePrefix(const char* in, size_t size, unsigned char* out,
+                        size_t* out_size, size_t* consumed,
+                        Base64Kernel kernel = Base64BestKernel());
+
+/// Decodes base64 text written to it in pieces of any size, passing the bytes
+/// on as each piece is decoded. Throws SubtleException on invalid input.
+class Base64DecodeSink : public ByteSink {
+ public:
+  /// \param next sink receiving the decoded stream.
+  explicit Base64DecodeSink(ByteSink* next);
+
+  void Write(const char* data, size_t size);
+
+  /// Throws SubtleException when the text ends inside a quad.
+  void Finish();
+
+ private:
+  static const size_t kPendingLimit = 64;
+
+  // \return number of characters decoded and passed on.
+  size_t Decode(const char* data, size_t size);
+
+  ByteSink* next_;
+  // characters of a quad split between pieces
+  string pending_;
+  vector<unsigned char> decoded_;
+  // padding was seen, only whitespace may follow
+  bool ended_;
+};
+
+/// \return data encoded as base64.
+string Base64Encode(const string& data);
+
+/// \return text decoded from base64. Throws SubtleException on invalid input.
+string Base64Decode(const string& text);
+
+}  // namespace libsubtle
+
+#endif  // SRC_BASE64_CODEC_H_
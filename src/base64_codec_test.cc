@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/base64_codec.h"
+#include "src/types.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+vector<Base64Kernel> SupportedKernels() {
+  vector<Base64Kernel> kernels;
+  for (int kernel = BASE64_SCALAR; kernel <= Base64BestKernel(); ++kernel) {
+    kernels.push_back(static_cast<Base64Kernel>(kernel));
+  }
+  return kernels;
+}
+
+string Encode(const string& data, Base64Kernel kernel) {
+  string out(Base64EncodedSize(data.size()), '\0');
+  out.resize(Base64Encode(reinterpret_cast<const unsigned char*>(data.data()),
+                          data.size(), &out[0], kernel));
+  return out;
+}
+
+bool Decode(const string& text, Base64Kernel kernel, string* data) {
+  data->assign(Base64DecodedSize(text.size()) + 1, '\0');
+  size_t size = 0;
+  bool valid = Base64Decode(text.data(), text.size(),
+                            reinterpret_cast<unsigned char*>(&(*data)[0]),
+                            &size, kernel);
+  data->resize(size);
+  return valid;
+}
+
+TEST(Base64, Rfc4648) {
+  const char* vectors[][2] = {
+    {"", ""}, {"f", "Zg=="}, {"fo", "Zm8="}, {"foo", "Zm9v"},
+    {"foob", "Zm9vYg=="}, {"fooba", "Zm9vYmE="}, {"foobar", "Zm9vYmFy"}
+  };
+  for (auto& v : vectors) {
+    ASSERT_EQ(v[1], Base64Encode(v[0]));
+    ASSERT_EQ(v[0], Base64Decode(v[1]));
+  }
+}
+
+TEST(Base64, RoundTrip) {
+  std::mt19937 random(42);
+  for (Base64Kernel kernel : SupportedKernels()) {
+    for (size_t size = 0; size < 300; ++size) {
+      string data(size, '\0');
+      for (char& c : data) {
+        c = static_cast<char>(random());
+      }
+      string text = Encode(data, kernel);
+      ASSERT_EQ(Encode(data, BASE64_SCALAR), text) << kernel << " " << size;
+      string decoded;
+      ASSERT_TRUE(Decode(text, kernel, &decoded)) << kernel << " " << size;
+      ASSERT_EQ(data, decoded) << kernel << " " << size;
+    }
+  }
+}
+
+TEST(Base64, Whitespace) {
+  string data(1000, 'x');
+  string text = Base64Encode(data);
+  string wrapped;
+  for (size_t i = 0; i < text.size(); i += 76) {
+    wrapped += text.substr(i, 76) + "\r\n";
+  }
+  for (Base64Kernel kernel : SupportedKernels()) {
+    string decoded;
+    ASSERT_TRUE(Decode(wrapped, kernel, &decoded));
+    ASSERT_EQ(data, decoded);
+  }
+}
+
+TEST(Base64, Invalid) {
+  const char* invalid[] = {
+    "Zg", "Zg=", "Z===", "Zh==", "Zm9=", "Zg==Zg==", "Zg==x", "Zm9v!", "Zm-v"
+  };
+  for (Base64Kernel kernel : SupportedKernels()) {
+    string decoded;
+    for (const char* text : invalid) {
+      ASSERT_FALSE(Decode(text, kernel, &decoded)) << text;
+    }
+    // every byte outside the alphabet, at every offset of a vector block
+    string text = Base64Encode(string(96, 'x'));
+    for (int c = 0; c < 256; ++c) {
+      if (isalnum(c) || c == '+' || c == '/' || isspace(c)) {
+        continue;
+      }
+      for (size_t i = 0; i < 64; ++i) {
+        string bad = text;
+        bad[i] = static_cast<char>(c);
+        ASSERT_FALSE(Decode(bad, kernel, &decoded)) << kernel << " " << c;
+      }
+    }
+  }
+  ASSERT_THROW(Base64Decode("Zm9v!"), SubtleException);
+}
+
+class DecodedSink : public ByteSink {
+ public:
+  void Write(const char* data, size_t size) { text_.append(data, size); }
+  string text_;
+};
+
+TEST(Base64, Sink) {
+  std::mt19937 random(7);
+  string data(5000, '\0');
+  for (char& c : data) {
+    c = static_cast<char>(random());
+  }
+  string text = Base64Encode(data);
+  string wrapped;
+  for (size_t i = 0; i < text.size(); i += 76) {
+    wrapped += text.substr(i, 76) + "\n";
+  }
+  for (const string& input : {text, wrapped}) {
+    for (size_t piece : {1, 2, 3, 5, 64, 1000, 100000}) {
+      DecodedSink sink;
+      Base64DecodeSink decoder(&sink);
+      for (size_t i = 0; i < input.size(); i += piece) {
+        decoder.Write(input.data() + i, std::min(piece, input.size() - i));
+      }
+      decoder.Finish();
+      ASSERT_EQ(data, sink.text_) << piece;
+    }
+  }
+
+  DecodedSink sink;
+  Base64DecodeSink truncated(&sink);
+  truncated.Write("Zm9vYm", 6);
+  ASSERT_THROW(truncated.Finish(), SubtleException);
+  Base64DecodeSink trailing(&sink);
+  trailing.Write("Zg==", 4);
+  ASSERT_THROW(trailing.Write("Zm9v", 4), SubtleException);
+}
+
+}  // namespace libsubtle
@@ -0,0 +1,77 @@
+#ifndef SRC_BENCH_H_
+#define SRC_BENCH_H_
+
+// Minimal benchmark helpers. Include from exactly one translation unit of a
+// benchmark executable, or of the tests: it replaces the global operator new
+// to count allocations.
+
+#include <sys/resource.h>
+
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+namespace libsubtle {
+namespace bench {
+
+/// Number of calls to operator new so far.
+static std::atomic<uint64_t> g_allocations(0);
+
+/// Measures wall time and allocations of a benchmark run.
+class Measure {
+ public:
+  explicit Measure(const std::string& name)
+      : name_(name),
+        allocations_(g_allocations),
+        start_(std::chrono::steady_clock::now()) {}
+
+  /// Print the averages per operation.
+  /// \param ops number of operations the run did.
+  void Report(uint64_t ops) const {
+    std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start_;
+    printf("%-40s %12.1f ns/op %10.1f allocs/op\n", name_.c_str(),
+           elapsed.count() / ops,
+           static_cast<double>(g_allocations - allocations_) / ops);
+  }
+
+ private:
+  std::string name_;
+  uint64_t allocations_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+/// \return peak resident set size of the process so far, in kilobytes.
+inline long PeakRssKb() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+/// Keep the compiler from optimizing away a result.
+template <typename T>
+void DoNotOptimize(const T& value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+}  // namespace bench
+}  // namespace libsubtle
+
+void* operator new(size_t size) {
+  libsubtle::bench::g_allocations.fetch_add(1, std::memory_order_relaxed);
+  void* p = malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+#endif  // SRC_BENCH_H_
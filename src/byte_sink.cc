@@ -0,0 +1,77 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "src/byte_sink.h"
+#include "src/types.h"
+
+using std::string;
+
+namespace libsubtle {
+
+const size_t FileSink::kDefaultBufferSize;
+
+FileSink::FileSink(const string& path, size_t buffer_size)
+    : path_(path),
+      fd_(open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)),
+      buffer_(buffer_size ? buffer_size : 1),
+      used_(0) {
+  if (fd_ < 0) {
+    throw SubtleException("Cannot create " + path + ": " + strerror(errno));
+  }
+}
+
+FileSink::~FileSink() {
+  if (fd_ >= 0) {
+    close(fd_);
+    remove(path_.c_str());
+  }
+}
+
+void FileSink::Write(const char* data, size_t size) {
+  if (used_ + size > buffer_.size()) {
+    Flush(&buffer_[0], used_);
+    used_ = 0;
+    // large pieces bypass the buffer
+    if (size >= buffer_.size()) {
+      Flush(data, size);
+      return;
+    }
+  }
+  memcpy(&buffer_[0] + used_, data, size);
+  used_ += size;
+}
+
+void FileSink::Finish() {
+  if (fd_ < 0) {
+    return;
+  }
+  Flush(&buffer_[0], used_);
+  used_ = 0;
+  int fd = fd_;
+  fd_ = -1;
+  if (close(fd) != 0) {
+    remove(path_.c_str());
+    throw SubtleException("Cannot write " + path_ + ": " + strerror(errno));
+  }
+}
+
+void FileSink::Flush(const char* data, size_t size) {
+  while (size > 0) {
+    ssize_t written = write(fd_, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw SubtleException("Cannot write " + path_ + ": " + strerror(errno));
+    }
+    data += written;
+    size -= written;
+  }
+}
+
+}  // namespace libsubtle
@@ -0,0 +1,60 @@
+#ifndef SRC_BYTE_SINK_H_
+#define SRC_BYTE_SINK_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+/// Consumer of a byte stream delivered in pieces. Sinks are chained into
+/// pipelines, each stage transforming the stream and writing it to the next,
+/// so only a bounded piece of the stream is held in memory at any time.
+class ByteSink {
+ public:
+  virtual ~ByteSink() {}
+
+  /// Consume the next piece of the stream.
+  virtual void Write(const char* data, size_t size) = 0;
+
+  /// Signal the end of the stream.
+  virtual void Finish() {}
+};
+
+/// Writes a stream to a file through a fixed size buffer. A file that was
+/// not finished is removed, so failed transfers leave nothing behind.
+class FileSink : public ByteSink {
+ public:
+  static const size_t kDefaultBufferSize = 64 * 1024;
+
+  /// Throws SubtleException if the file cannot be created.
+  /// \param path file to create or truncate.
+  /// \param buffer_size bytes collected before each write to the file.
+  explicit FileSink(const string& path,
+                    size_t buffer_size = kDefaultBufferSize);
+  ~FileSink();
+
+  /// Throws SubtleException on write errors.
+  void Write(const char* data, size_t size);
+
+  /// Flush and close the file. Throws SubtleException on write errors.
+  void Finish();
+
+ private:
+  FileSink(const FileSink&);
+  void operator=(const FileSink&);
+
+  void Flush(const char* data, size_t size);
+
+  string path_;
+  int fd_;
+  vector<char> buffer_;
+  size_t used_;
+};
+
+}  // namespace libsubtle
+
+#endif  // SRC_BYTE_SINK_H_
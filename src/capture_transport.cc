@@ -0,0 +1,455 @@
+#include <zlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "src/capture_transport.h"
+#include "src/types.h"
+#include "src/xmlrpc_stream.h"
+
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+namespace {
+
+// first bytes of a capture file, naming the format and its version
+const char kMagic[] = "subtle capture 1\n";
+const size_t kMagicSize = sizeof(kMagic) - 1;
+
+// Appends what is written to a string, before passing it on to another sink.
+class TeeSink : public ByteSink {
+ public:
+  TeeSink(ByteSink* sink, string* copy) : sink_(sink), copy_(copy) {}
+  void Write(const char* data, size_t size) {
+    copy_->append(data, size);
+    sink_->Write(data, size);
+  }
+
+ private:
+  ByteSink* sink_;
+  string* copy_;
+};
+
+void PutVarint(uint64_t value, string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+// \return false at the end of the file
+bool GetVarint(gzFile file, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    int byte = gzgetc(file);
+    if (byte < 0) {
+      return false;
+    }
+    *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool GetString(gzFile file, string* text) {
+  uint64_t size;
+  if (!GetVarint(file, &size)) {
+    return false;
+  }
+  text->resize(size);
+  // gzread takes at most an unsigned int at a time
+  for (size_t done = 0; done < size;) {
+    unsigned int piece = static_cast<unsigned int>(
+        std::min<uint64_t>(size - done, 1u << 30));
+    if (gzread(file, &(*text)[done], piece) != static_cast<int>(piece)) {
+      return false;
+    }
+    done += piece;
+  }
+  return true;
+}
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start).count();
+}
+
+// Method of a call, and the strings of the array it takes after the token:
+// the ids of DownloadSubtitles, or the hashes of CheckSubHash.
+class CallParser : public XmlRpcHandler {
+ public:
+  CallParser() : arrays_(0) {}
+  void OnMethodName(const string& name) { method_ = name; }
+  void OnArrayBegin() { ++arrays_; }
+  void OnArrayEnd() { --arrays_; }
+  void OnScalar(ScalarType type, const string& text) {
+    if (arrays_ == 1) {
+      keys_.push_back(text);
+    }
+  }
+
+  string method_;
+  vector<string> keys_;
+
+ private:
+  int arrays_;
+};
+
+struct Scalar {
+  string name;
+  ScalarType type;
+  string text;
+};
+
+// Status of a response, and the members of the structs in its data: one
+// per file for DownloadSubtitles, one holding every hash for CheckSubHash.
+class ResponseParser : public XmlRpcHandler {
+ public:
+  ResponseParser() : depth_(0), fault_(false) {}
+  void OnStructBegin() {
+    if (++depth_ == 2) {
+      structs_.push_back(vector<Scalar>());
+    }
+  }
+  void OnStructEnd() { --depth_; }
+  void OnMemberName(const string& name) { member_ = name; }
+  void OnScalar(ScalarType type, const string& text) {
+    if (depth_ == 1 && member_ == "status") {
+      status_ = text;
+    } else if (depth_ == 2) {
+      Scalar scalar = {member_, type, text};
+      structs_.back().push_back(scalar);
+    }
+  }
+  void OnFault() { fault_ = true; }
+  string StatusText() const { return fault_ ? "" : status_; }
+
+  vector<vector<Scalar>> structs_;
+
+ private:
+  int depth_;
+  bool fault_;
+  string member_;
+  string status_;
+};
+
+// \return false if the document is not XML-RPC
+bool Parse(const string& xml, XmlRpcHandler* handler) {
+  XmlRpcStreamParser parser(handler);
+  try {
+    parser.Feed(xml.data(), xml.size());
+    parser.Finish();
+  } catch (const SubtleException&) {
+    return false;
+  }
+  return true;
+}
+
+string Escape(const string& text) {
+  string escaped;
+  for (char c : text) {
+    if (c == '&') {
+      escaped += "&amp;";
+    } else if (c == '<') {
+      escaped += "&lt;";
+    } else if (c == '>') {
+      escaped += "&gt;";
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+string MemberXml(const Scalar& scalar) {
+  static const char* const kTypes[] = {"string", "int", "boolean", "double",
+                                       "dateTime.iso8601", "base64", "nil"};
+  string value = scalar.type == SCALAR_NIL ? "<nil/>" :
+      string("<") + kTypes[scalar.type] + ">" + Escape(scalar.text) + "</" +
+      kTypes[scalar.type] + ">";
+  return "<member><name>" + Escape(scalar.name) + "</name><value>" + value +
+      "</value></member>";
+}
+
+}  // namespace
+
+const size_t ReplayTransport::kChunkSize;
+
+string RedactCall(const string& request) {
+  if (request.find("<methodName>LogIn<") == string::npos) {
+    return request;
+  }
+  // parameters are the username, password, language and user agent
+  size_t password = request.find("<param>");
+  if (password != string::npos) {
+    password = request.find("<param>", password + 1);
+  }
+  size_t end = password == string::npos ? string::npos :
+      request.find("</param>", password);
+  if (end == string::npos) {
+    return request;
+  }
+  return request.substr(0, password) +
+      "<param><value><string></string></value>" + request.substr(end);
+}
+
+vector<CapturedCall> ReadCapture(const string& path) {
+  gzFile file = gzopen(path.c_str(), "rb");
+  if (!file) {
+    throw SubtleException("Cannot open capture " + path);
+  }
+  char magic[kMagicSize];
+  if (gzread(file, magic, kMagicSize) != static_cast<int>(kMagicSize) ||
+      !std::equal(magic, magic + kMagicSize, kMagic)) {
+    gzclose(file);
+    throw SubtleException(path + " is not a capture");
+  }
+  vector<CapturedCall> calls;
+  for (;;) {
+    CapturedCall call;
+    int failed = gzgetc(file);
+    uint64_t micros;
+    if (failed < 0 || !GetVarint(file, &micros) ||
+        !GetString(file, &call.request) || !GetString(file, &call.response)) {
+      break;
+    }
+    call.failed = failed != 0;
+    call.seconds = micros / 1e6;
+    calls.push_back(std::move(call));
+  }
+  gzclose(file);
+  return calls;
+}
+
+RecordingTransport::RecordingTransport(Transport* transport,
+                                       const string& path)
+    : transport_(transport), file_(gzopen(path.c_str(), "wb")), calls_(0) {
+  if (!file_ || gzwrite(file_, kMagic, kMagicSize) !=
+                    static_cast<int>(kMagicSize)) {
+    if (file_) {
+      gzclose(file_);
+    }
+    throw SubtleException("Cannot create capture " + path);
+  }
+}
+
+RecordingTransport::~RecordingTransport() {
+  gzclose(file_);
+}
+
+void RecordingTransport::Post(const string& url, const string& user_agent,
+                              const string& body, ByteSink* response) {
+  TransferStats stats = TransferStats();
+  Post(url, user_agent, body, response, &stats);
+}
+
+void RecordingTransport::Post(const string& url, const string& user_agent,
+                              const string& body, ByteSink* response,
+                              TransferStats* stats) {
+  CapturedCall call;
+  call.request = RedactCall(body);
+  call.failed = false;
+  TeeSink tee(response, &call.response);
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  try {
+    transport_->Post(url, user_agent, body, &tee, stats);
+  } catch (const std::exception& e) {
+    call.response = e.what();
+    call.failed = true;
+    call.seconds = SecondsSince(start);
+    Write(call);
+    throw;
+  }
+  call.seconds = SecondsSince(start);
+  Write(call);
+}
+
+size_t RecordingTransport::calls() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return calls_;
+}
+
+void RecordingTransport::Write(const CapturedCall& call) {
+  string record(1, call.failed ? 1 : 0);
+  PutVarint(static_cast<uint64_t>(call.seconds * 1e6), &record);
+  PutVarint(call.request.size(), &record);
+  record += call.request;
+  PutVarint(call.response.size(), &record);
+  record += call.response;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t done = 0; done < record.size();) {
+    unsigned int piece = static_cast<unsigned int>(
+        std::min<size_t>(record.size() - done, 1u << 30));
+    if (gzwrite(file_, record.data() + done, piece) !=
+        static_cast<int>(piece)) {
+      throw SubtleException("Cannot write capture");
+    }
+    done += piece;
+  }
+  ++calls_;
+}
+
+ReplayTransport::ReplayTransport(const string& path, double time_scale)
+    : time_scale_(time_scale), remaining_(0) {
+  for (CapturedCall& call : ReadCapture(path)) {
+    if (!AddToIndex(call)) {
+      calls_[call.request].push_back(std::move(call));
+    }
+    ++remaining_;
+  }
+}
+
+bool ReplayTransport::AddToIndex(const CapturedCall& call) {
+  CallParser request;
+  ResponseParser response;
+  if (call.failed || !Parse(call.request, &request) ||
+      (request.method_ != "DownloadSubtitles" &&
+       request.method_ != "CheckSubHash") ||
+      !Parse(call.response, &response) ||
+      response.StatusText() != "200 OK") {
+    return false;
+  }
+  bool downloads = request.method_ == "DownloadSubtitles";
+  // each item by its id or hash, with its XML
+  vector<pair<string, string>> items;
+  for (const vector<Scalar>& members : response.structs_) {
+    if (downloads) {
+      string id;
+      string xml = "<value><struct>";
+      for (const Scalar& member : members) {
+        if (member.name == "idsubtitlefile") {
+          id = member.text;
+        }
+        xml += MemberXml(member);
+      }
+      items.push_back(std::make_pair(id, xml + "</struct></value>"));
+    } else {
+      for (const Scalar& member : members) {
+        items.push_back(std::make_pair(member.name, MemberXml(member)));
+      }
+    }
+  }
+  if (items.empty()) {
+    return false;
+  }
+  Items* index = downloads ? &downloads_ : &sub_hashes_;
+  for (const auto& item : items) {
+    Item& indexed = (*index)[item.first];
+    indexed.xml = item.second;
+    indexed.seconds = call.seconds / items.size();
+    indexed.calls.push_back(unserved_.size());
+  }
+  unserved_.push_back(items.size());
+  return true;
+}
+
+bool ReplayTransport::Answer(const string& request, CapturedCall* call) {
+  CallParser parsed;
+  if (!Parse(request, &parsed) ||
+      (parsed.method_ != "DownloadSubtitles" &&
+       parsed.method_ != "CheckSubHash")) {
+    return false;
+  }
+  bool downloads = parsed.method_ == "DownloadSubtitles";
+  Items* index = downloads ? &downloads_ : &sub_hashes_;
+  string data;
+  double seconds = 0;
+  for (const string& key : parsed.keys_) {
+    auto item = index->find(key);
+    if (item == index->end()) {
+      throw SubtleException("No recorded response for " + key + " in call: " +
+                            request.substr(0, 200));
+    }
+    for (size_t number : item->second.calls) {
+      if (--unserved_[number] == 0) {
+        --remaining_;
+      }
+    }
+    item->second.calls.clear();
+    data += item->second.xml;
+    seconds += item->second.seconds;
+  }
+  call->request = request;
+  call->response =
+      "<?xml version=\"1.0\"?>\n<methodResponse><params><param><value>"
+      "<struct><member><name>status</name><value><string>200 OK</string>"
+      "</value></member><member><name>data</name><value>" +
+      (downloads ? "<array><data>" + data + "</data></array>"
+                 : "<struct>" + data + "</struct>") +
+      "</value></member><member><name>seconds</name><value><double>" +
+      std::to_string(seconds) + "</double></value></member></struct>"
+      "</value></param></params></methodResponse>";
+  call->failed = false;
+  call->seconds = seconds;
+  return true;
+}
+
+void ReplayTransport::Post(const string& url, const string& user_agent,
+                           const string& body, ByteSink* response) {
+  TransferStats stats = TransferStats();
+  Post(url, user_agent, body, response, &stats);
+}
+
+void ReplayTransport::Post(const string& url, const string& user_agent,
+                           const string& body, ByteSink* response,
+                           TransferStats* stats) {
+  *stats = TransferStats();
+  stats->request_bytes = body.size();
+  string request = RedactCall(body);
+  CapturedCall call;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto recorded = calls_.find(request);
+    if (recorded != calls_.end()) {
+      call = std::move(recorded->second.front());
+      recorded->second.pop_front();
+      if (recorded->second.empty()) {
+        calls_.erase(recorded);
+      }
+      --remaining_;
+    } else if (!Answer(request, &call)) {
+      throw SubtleException("No recorded response to call: " +
+                            request.substr(0, 200));
+    }
+  }
+
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  if (time_scale_ > 0) {
+    std::this_thread::sleep_for(
+        std::chrono::duration<double>(call.seconds * time_scale_));
+  }
+  stats->wait = SecondsSince(start);
+  if (call.failed) {
+    throw SubtleException(call.response);
+  }
+  start = std::chrono::steady_clock::now();
+  for (size_t done = 0; done < call.response.size(); done += kChunkSize) {
+    size_t size = std::min(kChunkSize, call.response.size() - done);
+    response->Write(call.response.data() + done, size);
+    stats->response_bytes += size;
+  }
+  stats->transfer = SecondsSince(start);
+}
+
+size_t ReplayTransport::remaining() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return remaining_;
+}
+
+}  // namespace libsubtle
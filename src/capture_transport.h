@@ -0,0 +1,161 @@
+#ifndef SRC_CAPTURE_TRANSPORT_H_
+#define SRC_CAPTURE_TRANSPORT_H_
+
+#include <zlib.h>
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "src/byte_sink.h"
+#include "src/transport.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+/// One call carried by a transport, as kept in a capture file.
+struct CapturedCall {
+  /// XML of the call.
+  string request;
+  /// XML of the response, or the error when the call failed.
+  string response;
+  bool failed;
+  /// Seconds the call took, from posting it to the end of the response.
+  double seconds;
+};
+
+/// Read every call of a capture file, in the order they finished. A call cut
+/// short by the end of the file, as left by a recording process that died,
+/// is dropped. Throws SubtleException when the file cannot be read or is not
+/// a capture.
+vector<CapturedCall> ReadCapture(const string& path);
+
+/// \return the XML of a call with the password of a LogIn call blanked, as
+///         it is kept in capture files; other calls are returned as they
+///         are.
+string RedactCall(const string& request);
+
+/// Transport recording the calls another one carries, with their responses
+/// and timing, to a capture file a ReplayTransport serves them back from:
+///
+///   CurlTransport curl;
+///   RecordingTransport recording(&curl, "scan.capture");
+///   XmlRpcImpl client(&recording);
+///
+/// The file is gzip compressed; each call is a length prefixed request,
+/// response, outcome and duration. Calls are written as they finish, so the
+/// file is complete up to the last call once the transport is destroyed.
+/// Requests are kept as RedactCall leaves them, without the password.
+class RecordingTransport : public Transport {
+ public:
+  /// \param transport carries the calls; not owned.
+  /// \param path of the capture file, replaced. Throws SubtleException when
+  ///             it cannot be created.
+  RecordingTransport(Transport* transport, const string& path);
+  ~RecordingTransport();
+
+  void Post(const string& url, const string& user_agent, const string& body,
+            ByteSink* response);
+  /// Reports what the recorded transport does.
+  void Post(const string& url, const string& user_agent, const string& body,
+            ByteSink* response, TransferStats* stats);
+
+  /// \return number of calls recorded.
+  size_t calls() const;
+
+ private:
+  RecordingTransport(const RecordingTransport&);
+  void operator=(const RecordingTransport&);
+
+  void Write(const CapturedCall& call);
+
+  Transport* transport_;
+  mutable std::mutex mutex_;
+  gzFile file_;
+  size_t calls_;
+};
+
+/// Transport answering calls from a capture file instead of the service, to
+/// rerun a recorded workload offline with the same inputs.
+///
+/// Each call is answered with the response recorded for the same request
+/// XML; a request made several times gets its responses in the order they
+/// were recorded, whichever thread asks. Failed calls fail again with their
+/// recorded error.
+///
+/// DownloadSubtitles and CheckSubHash are batched as files become ready, so
+/// their batches differ from run to run. Successful answers to them are
+/// also indexed by subtitle file id and by hash, and a batch not recorded as
+/// such is answered with the recorded data of each of its ids or hashes,
+/// taking their share of the time of the calls they were recorded in.
+///
+/// Calls that were not recorded, or that were made more often than
+/// recorded, throw SubtleException: the workload diverged, such as when a
+/// session token was taken from a cache or a subtitle store while recording
+/// but not while replaying.
+class ReplayTransport : public Transport {
+ public:
+  /// Largest piece of a response passed to the sink at once, as libcurl
+  /// would deliver it.
+  static const size_t kChunkSize = 16 * 1024;
+
+  /// \param path of the capture file. Throws SubtleException when it cannot
+  ///             be read.
+  /// \param time_scale multiplies the recorded duration of each call before
+  ///                   it is answered: 1 replays at the recorded timing, 0.1
+  ///                   ten times faster, and 0 answers at once.
+  explicit ReplayTransport(const string& path, double time_scale = 1);
+
+  void Post(const string& url, const string& user_agent, const string& body,
+            ByteSink* response);
+  /// Reports the scaled recorded duration as waiting, and the time the sink
+  /// takes as transfer.
+  void Post(const string& url, const string& user_agent, const string& body,
+            ByteSink* response, TransferStats* stats);
+
+  /// \return number of recorded calls not replayed yet. A successful
+  ///         DownloadSubtitles or CheckSubHash call counts as replayed once
+  ///         each of its ids or hashes has been asked for.
+  size_t remaining() const;
+
+ private:
+  ReplayTransport(const ReplayTransport&);
+  void operator=(const ReplayTransport&);
+
+  // recorded data of one subtitle file or hash
+  struct Item {
+    // XML of the item in the data of a response
+    string xml;
+    // share of the duration of the call it was recorded in
+    double seconds;
+    // recorded calls holding it, by index, until it is first asked for
+    vector<size_t> calls;
+  };
+  typedef std::map<string, Item> Items;
+
+  // Index a successful call of an indexed method.
+  // \return false if it is not one
+  bool AddToIndex(const CapturedCall& call);
+  // \return the call answering a request from the index, if it is of an
+  //         indexed method; lock held
+  bool Answer(const string& request, CapturedCall* call);
+
+  double time_scale_;
+  mutable std::mutex mutex_;
+  // recorded calls not replayed yet, by request
+  std::map<string, std::deque<CapturedCall>> calls_;
+  // DownloadSubtitles data by IDSubtitleFile, and CheckSubHash ids by hash
+  Items downloads_;
+  Items sub_hashes_;
+  // ids or hashes not asked for yet, by indexed call
+  vector<size_t> unserved_;
+  size_t remaining_;
+};
+
+}  // namespace libsubtle
+
+#endif  // SRC_CAPTURE_TRANSPORT_H_
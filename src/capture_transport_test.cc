@@ -0,0 +1,207 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/capture_transport.h"
+#include "src/mock_server.h"
+#include "src/mock_service_fixture.h"
+#include "src/rpc_impl.h"
+#include "src/transport.h"
+#include "src/types.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+class CaptureSink : public ByteSink {
+ public:
+  CaptureSink() : writes_(0) {}
+  void Write(const char* data, size_t size) {
+    text_.append(data, size);
+    ++writes_;
+  }
+  string text_;
+  int writes_;
+};
+
+string CapturePath(const string& name) {
+  return "/tmp/capture_test." + std::to_string(getpid()) + "." + name;
+}
+
+TEST(RecordingTransport, RecordAndReplay) {
+  string path = CapturePath("record");
+  string large(100 * 1024, 'x');
+  {
+    MockServer server([](const string& request, int* status) {
+      if (request == "fail") {
+        *status = 503;
+        return string();
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      return "<" + request + ">";
+    }, 0);
+    CurlTransport curl;
+    RecordingTransport recording(&curl, path);
+    CaptureSink first;
+    recording.Post(server.url(), "test", "call", &first);
+    ASSERT_EQ("<call>", first.text_);
+    CaptureSink failed;
+    ASSERT_THROW(recording.Post(server.url(), "test", "fail", &failed),
+                 SubtleException);
+    CaptureSink second;
+    TransferStats stats;
+    recording.Post(server.url(), "test", large, &second, &stats);
+    ASSERT_EQ(large.size() + 2, stats.response_bytes);
+    ASSERT_EQ(3u, recording.calls());
+  }
+
+  vector<CapturedCall> calls = ReadCapture(path);
+  ASSERT_EQ(3u, calls.size());
+  ASSERT_EQ("call", calls[0].request);
+  ASSERT_EQ("<call>", calls[0].response);
+  ASSERT_FALSE(calls[0].failed);
+  ASSERT_GE(calls[0].seconds, 0.02);
+  ASSERT_TRUE(calls[1].failed);
+  ASSERT_EQ("<" + large + ">", calls[2].response);
+
+  // the server is gone, the capture answers instead
+  ReplayTransport replay(path, 0);
+  ASSERT_EQ(3u, replay.remaining());
+  CaptureSink response;
+  TransferStats stats;
+  replay.Post("http://unused", "test", large, &response, &stats);
+  ASSERT_EQ("<" + large + ">", response.text_);
+  ASSERT_GT(response.writes_, 1);
+  ASSERT_EQ(large.size(), stats.request_bytes);
+  ASSERT_EQ(large.size() + 2, stats.response_bytes);
+  ASSERT_THROW(replay.Post("http://unused", "test", "fail", &response),
+               SubtleException);
+  // calls made more often than recorded, or never, have no answer
+  CaptureSink again;
+  replay.Post("http://unused", "test", "call", &again);
+  ASSERT_EQ("<call>", again.text_);
+  ASSERT_THROW(replay.Post("http://unused", "test", "call", &again),
+               SubtleException);
+  ASSERT_THROW(replay.Post("http://unused", "test", "other", &again),
+               SubtleException);
+  ASSERT_EQ(0u, replay.remaining());
+
+  // at the recorded timing calls take as long as they did
+  ReplayTransport timed(path, 1);
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  timed.Post("http://unused", "test", "call", &again);
+  ASSERT_GE(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(20));
+  remove(path.c_str());
+}
+
+TEST(RecordingTransport, BadFiles) {
+  CurlTransport curl;
+  ASSERT_THROW(RecordingTransport(&curl, "/nonexistent/capture"),
+               SubtleException);
+  ASSERT_THROW(ReadCapture("/nonexistent/capture"), SubtleException);
+
+  string path = CapturePath("bad");
+  FILE* file = fopen(path.c_str(), "w");
+  fputs("not a capture", file);
+  fclose(file);
+  ASSERT_THROW(ReplayTransport replay(path), SubtleException);
+  remove(path.c_str());
+}
+
+class ReplayService : public MockServiceFixture {};
+
+TEST_F(ReplayService, XmlRpcImpl) {
+  string path = CapturePath("client");
+  SearchRequest search("eng", "7d9cd5def91c9432", 735934464);
+  SearchResponse recorded;
+  {
+    CurlTransport curl;
+    RecordingTransport recording(&curl, path);
+    XmlRpcImpl client(&recording);
+    client.Init("OS Test User Agent", url());
+    string token = client.LogIn(LoginRequest()).token_;
+    recorded = client.SearchSubtitles(token, search);
+  }
+
+  ReplayTransport replay(path, 0);
+  XmlRpcImpl client(&replay);
+  client.Init("OS Test User Agent", url());
+  string token = client.LogIn(LoginRequest()).token_;
+  SearchResponse replayed = client.SearchSubtitles(token, search);
+  ASSERT_EQ(recorded.data_.size(), replayed.data_.size());
+  ASSERT_EQ(recorded.data_[0].SubHash_, replayed.data_[0].SubHash_);
+  ASSERT_EQ(0u, replay.remaining());
+  // the service saw the recorded calls only
+  ASSERT_EQ(1, service_.calls("SearchSubtitles"));
+  remove(path.c_str());
+}
+
+TEST_F(ReplayService, Batches) {
+  string path = CapturePath("batches");
+  LoginRequest login("user", "secret", "en");
+  vector<int> ids;
+  vector<string> hashes;
+  DownloadResponse first, second;
+  CheckSubHashResponse known;
+  {
+    CurlTransport curl;
+    RecordingTransport recording(&curl, path);
+    XmlRpcImpl client(&recording);
+    client.Init("OS Test User Agent", url());
+    string token = client.LogIn(login).token_;
+    SearchResponse found = client.SearchSubtitles(
+        token, SearchRequest("eng", "7d9cd5def91c9432", 735934464));
+    ASSERT_EQ(3u, found.data_.size());
+    for (const SubFile& file : found.data_) {
+      ids.push_back(atoi(file.IDSubtitleFile_.c_str()));
+      hashes.push_back(file.SubHash_);
+    }
+    first = client.DownloadSubtitles(
+        token, DownloadRequest(vector<int>(ids.begin(), ids.begin() + 2)));
+    second = client.DownloadSubtitles(
+        token, DownloadRequest(vector<int>(1, ids[2])));
+    known = client.CheckSubHash(token, CheckSubHashRequest(hashes));
+  }
+  for (const CapturedCall& call : ReadCapture(path)) {
+    ASSERT_EQ(string::npos, call.request.find("secret"));
+  }
+
+  // files and hashes are asked for in other batches than recorded
+  ReplayTransport replay(path, 0);
+  XmlRpcImpl client(&replay);
+  client.Init("OS Test User Agent", url());
+  string token = client.LogIn(login).token_;
+  client.SearchSubtitles(token,
+                         SearchRequest("eng", "7d9cd5def91c9432", 735934464));
+  vector<int> batch = {ids[2], ids[0]};
+  DownloadResponse replayed = client.DownloadSubtitles(token,
+                                                       DownloadRequest(batch));
+  ASSERT_EQ(2u, replayed.subtitles_.size());
+  ASSERT_EQ(second.subtitles_[0], replayed.subtitles_[0]);
+  ASSERT_EQ(first.subtitles_[0], replayed.subtitles_[1]);
+  ASSERT_EQ(2u, replay.remaining());
+  replayed = client.DownloadSubtitles(token,
+                                      DownloadRequest(vector<int>(1, ids[1])));
+  ASSERT_EQ(first.subtitles_[1], replayed.subtitles_[0]);
+  for (const string& hash : hashes) {
+    CheckSubHashResponse one = client.CheckSubHash(token,
+                                                   CheckSubHashRequest(hash));
+    ASSERT_EQ(known.sub_ids_[hash], one.sub_ids_[hash]);
+  }
+  ASSERT_EQ(0u, replay.remaining());
+  ASSERT_THROW(client.DownloadSubtitles(token,
+                                        DownloadRequest(vector<int>(1, 1))),
+               SubtleException);
+  remove(path.c_str());
+}
+
+}  // namespace libsubtle
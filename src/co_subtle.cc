@@ -0,0 +1,153 @@
+#include <xmlrpc-c/xml.hpp>
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/base64_codec.h"
+#include "src/byte_sink.h"
+#include "src/co_subtle.h"
+#include "src/compact_subfile.h"
+#include "src/inflater.h"
+#include "src/output_batch.h"
+#include "src/rpc_impl.h"
+#include "src/subtle.h"
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+CoXmlRpcClient::CoXmlRpcClient(AsyncTransport* transport)
+    : transport_(transport) {}
+
+Task<void> CoXmlRpcClient::CallStreaming(string method,
+                                         xmlrpc_c::paramList params,
+                                         XmlRpcHandler* handler) {
+  string call_xml;
+  xmlrpc_c::xml::generateCall(method, params, &call_xml);
+
+  XmlRpcStreamParser parser(handler);
+  XmlRpcParserSink response(&parser);
+  co_await Post(transport_, server_endpoint_, user_agent_, call_xml,
+                &response);
+  parser.Finish();
+}
+
+Task<SearchResponse> CoXmlRpcClient::SearchSubtitles(string token,
+                                                     SearchRequest req) {
+  vector<SubFile> found;
+  SearchResponse response = co_await SearchSubtitles(token, req,
+      [&found](SubFile&& sub) { found.push_back(std::move(sub)); });
+  response.data_.swap(found);
+  co_return response;
+}
+
+Task<SearchResponse> CoXmlRpcClient::SearchSubtitles(string token,
+    SearchRequest req, SearchResponseDecoder::Callback callback) {
+  SearchResponse response;
+  SearchResponseDecoder decoder(&response, callback);
+  co_await CallStreaming("SearchSubtitles", SearchSubtitlesParams(token, req),
+                         &decoder);
+  decoder.Finish();
+  co_return response;
+}
+
+Task<DownloadResponse> CoXmlRpcClient::DownloadSubtitles(string token,
+    DownloadRequest req, DownloadResponseDecoder::Open open) {
+  DownloadResponse response;
+  DownloadResponseDecoder decoder(&response, open);
+  co_await CallStreaming("DownloadSubtitles",
+                         DownloadSubtitlesParams(token, req), &decoder);
+  decoder.Finish();
+  co_return response;
+}
+
+CoSubtle::CoSubtle(CoXmlRpcClient* client, SessionManager* session,
+                   Scheduler* blocking)
+    : client_(client),
+      session_(session),
+      blocking_(blocking),
+      store_(SubtitleStore::DefaultRoot()) {
+  client_->Init(Subtle::kUserAgent, Subtle::kServerUrl);
+}
+
+Task<vector<SubFile>> CoSubtle::SearchSubtitles(string lng, string hash,
+                                                double size) {
+  SearchRequest req(lng, hash, size);
+  SearchResponse res = co_await Run<SearchResponse>(
+      [this, &req](const string& token) {
+    return client_->SearchSubtitles(token, req);
+  });
+  co_return res.data_;
+}
+
+Task<bool> CoSubtle::DownloadSubtitles(string lng, string hash, double size,
+                                       string dest) {
+  CompactSubFiles search(co_await SearchSubtitles(lng, hash, size));
+  if (search.empty()) {
+    co_return false;
+  }
+  const CompactSubFile& best_match = search[0];
+  string file_name = search.Text(best_match.sub_file_name);
+  string key = SubtitleStore::Key(best_match.id_subtitle_file,
+                                  best_match.sub_hash);
+
+  co_await ResumeOn(blocking_);
+  OutputBatch output;
+  string temp = output.Add(dest + kPathSeparator + file_name);
+  if (store_.Materialize(key, temp)) {
+    output.Commit();
+    cout << "Reused stored subtitle for " << file_name << endl;
+    co_return true;
+  }
+
+  // unlike Subtle, no lock is held while the file is fetched, since waiting
+  // for one would block the thread; writers of the same file, in this
+  // process or another, each write their own temporary file, and whichever
+  // commits last replaces the same bytes
+  string fetched = temp;
+  SubtitleStore::TempFiles leftover;
+  if (store_.enabled()) {
+    fetched = store_.TempPath(key);
+    leftover.Add(fetched);
+  }
+  DownloadRequest req(vector<int>(1, best_match.id_subtitle_file));
+  string id = std::to_string(best_match.id_subtitle_file);
+  DownloadResponse res;
+  {
+    FileSink file(fetched);
+    std::unique_ptr<ByteSink> inflate = DefaultInflater()->NewSink(&file);
+    Base64DecodeSink base64(inflate.get());
+    res = co_await Run<DownloadResponse>(
+        [this, &req, &id, &base64](const string& token) {
+      return client_->DownloadSubtitles(token, req,
+                                        [&id, &base64](const string& sub_id) {
+        return sub_id == id ? static_cast<ByteSink*>(&base64) : NULL;
+      });
+    });
+  }
+  // the service may answer without the file, leaving it empty
+  bool received = false;
+  for (const auto& subtitle : res.subtitles_) {
+    received = received || subtitle.first == id;
+  }
+  if (!received) {
+    co_return false;
+  }
+
+  co_await ResumeOn(blocking_);
+  if (store_.enabled()) {
+    store_.Commit(key, fetched);
+    store_.Materialize(key, temp);
+  }
+  output.Commit();
+  cout << "Downloaded subtitle to " << file_name << endl;
+  co_return true;
+}
+
+}  // namespace libsubtle
@@ -0,0 +1,118 @@
+#ifndef SRC_CO_SUBTLE_H_
+#define SRC_CO_SUBTLE_H_
+
+#include <xmlrpc-c/base.hpp>
+
+#include <string>
+#include <vector>
+
+#include "src/async_transport.h"
+#include "src/scheduler.h"
+#include "src/session.h"
+#include "src/subfile.h"
+#include "src/subtitle_store.h"
+#include "src/task.h"
+#include "src/types.h"
+#include "src/xmlrpc_stream.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+/// Client of the service for coroutines: each call is a Task that posts the
+/// call on an AsyncTransport and resumes its awaiter once the response is
+/// in, so a few threads can keep any number of calls in flight. Responses
+/// are decoded as they arrive, as by XmlRpcImpl.
+class CoXmlRpcClient {
+ public:
+  /// \param transport carries the calls; not owned.
+  explicit CoXmlRpcClient(AsyncTransport* transport);
+
+  void Init(const string& user_agent, const string& server_endpoint) {
+    user_agent_ = user_agent;
+    server_endpoint_ = server_endpoint;
+  }
+
+  /// Find subtitles.
+  /// \param token Service authentication token.
+  /// \param req specification of action.
+  /// \return response with the subtitles found.
+  Task<SearchResponse> SearchSubtitles(string token, SearchRequest req);
+  /// Find subtitles, handing each one to a callback as soon as it is decoded.
+  /// \return response with the status of the call.
+  Task<SearchResponse> SearchSubtitles(
+      string token, SearchRequest req,
+      SearchResponseDecoder::Callback callback);
+  /// Download subtitles, streaming the data of each one into a sink while the
+  /// response arrives.
+  /// \param open chooses the sink for the base64 data of each subtitle.
+  /// \return response with the status of the call, and the ids of the
+  ///         subtitles received paired with empty data.
+  Task<DownloadResponse> DownloadSubtitles(string token, DownloadRequest req,
+                                           DownloadResponseDecoder::Open open);
+
+ private:
+  CoXmlRpcClient(const CoXmlRpcClient&);
+  void operator=(const CoXmlRpcClient&);
+
+  /// Call a method and feed the response XML to the handler as it arrives.
+  Task<void> CallStreaming(string method, xmlrpc_c::paramList params,
+                           XmlRpcHandler* handler);
+
+  AsyncTransport* transport_;
+  string user_agent_;
+  string server_endpoint_;
+};
+
+/// Coroutine counterpart of Subtle, for applications running their own
+/// event loop: co_await subtle.DownloadSubtitles(...) searches and downloads
+/// without holding a thread while the service answers.
+///
+/// Coroutines resume on the thread completing their calls. File work that
+/// may block, such as syncing, is moved to a Scheduler when one is given.
+class CoSubtle {
+ public:
+  /// \param client carries the calls; not owned.
+  /// \param session provides the session token, and may be shared with a
+  ///        Subtle; not owned. It still logs in with a blocking call, once.
+  /// \param blocking runs the file work; NULL runs it where the coroutine
+  ///        resumed.
+  CoSubtle(CoXmlRpcClient* client, SessionManager* session,
+           Scheduler* blocking = NULL);
+
+  /// \return subtitles for a video, best first.
+  Task<vector<SubFile>> SearchSubtitles(string lng, string hash, double size);
+
+  /// Download the best subtitle for a video into a folder, reusing it from
+  /// the local store when it was fetched before.
+  /// \return whether a subtitle was written.
+  Task<bool> DownloadSubtitles(string lng, string hash, double size,
+                               string dest);
+
+ private:
+  CoSubtle(const CoSubtle&);
+  void operator=(const CoSubtle&);
+
+  /// Run a call with the session token, retrying once with a new one if the
+  /// service no longer accepts it, as SessionManager::Run does.
+  template <typename Response, typename Call>
+  Task<Response> Run(Call call) {
+    string token = session_->Token();
+    Response response = co_await call(token);
+    if (SessionManager::IsSessionError(response.GetStatus())) {
+      session_->Invalidate(token);
+      response = co_await call(session_->Token());
+    }
+    co_return response;
+  }
+
+  CoXmlRpcClient* client_;
+  SessionManager* session_;
+  Scheduler* blocking_;
+  SubtitleStore store_;
+};
+
+}  // namespace libsubtle
+
+#endif  // SRC_CO_SUBTLE_H_
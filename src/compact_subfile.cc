@@ -0,0 +1,369 @@
+#include <strings.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/compact_subfile.h"
+#include "src/schema.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+namespace {
+
+const char* kFormatNames[] = {
+  "", "srt", "sub", "smi", "ssa", "ass", "txt", "mpl", "vtt"
+};
+
+uint64_t ParseUint(const string& text) {
+  return strtoull(text.c_str(), NULL, 10);
+}
+
+float ParseFloat(const string& text) {
+  return strtof(text.c_str(), NULL);
+}
+
+int HexDigit(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+// Parse a hex string of up to 16 digits, 0 if it is not one.
+uint64_t ParseHex64(const string& text) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < text.size() && i < 16; ++i) {
+    int digit = HexDigit(text[i]);
+    if (digit < 0) {
+      return 0;
+    }
+    value = (value << 4) | digit;
+  }
+  return value;
+}
+
+// Parse a 32 digit md5 hex string, zeroes if it is not one.
+void ParseMd5(const string& text, uint8_t* digest) {
+  memset(digest, 0, 16);
+  if (text.size() != 32) {
+    return;
+  }
+  for (size_t i = 0; i < 16; ++i) {
+    int high = HexDigit(text[2 * i]);
+    int low = HexDigit(text[2 * i + 1]);
+    if (high < 0 || low < 0) {
+      memset(digest, 0, 16);
+      return;
+    }
+    digest[i] = static_cast<uint8_t>(high << 4 | low);
+  }
+}
+
+// Parse "YYYY-MM-DD HH:MM:SS" as UTC, 0 if it is not a date.
+uint32_t ParseDate(const string& text) {
+  struct tm date;
+  memset(&date, 0, sizeof(date));
+  if (sscanf(text.c_str(), "%d-%d-%d %d:%d:%d", &date.tm_year, &date.tm_mon,
+             &date.tm_mday, &date.tm_hour, &date.tm_min,
+             &date.tm_sec) != 6) {
+    return 0;
+  }
+  date.tm_year -= 1900;
+  date.tm_mon -= 1;
+  time_t seconds = timegm(&date);
+  return seconds < 0 ? 0 : static_cast<uint32_t>(seconds);
+}
+
+}  // namespace
+
+SubtitleFormat ParseFormat(const string& format) {
+  for (size_t i = 1; i < sizeof(kFormatNames) / sizeof(kFormatNames[0]);
+       ++i) {
+    if (strcasecmp(format.c_str(), kFormatNames[i]) == 0) {
+      return static_cast<SubtitleFormat>(i);
+    }
+  }
+  return FORMAT_UNKNOWN;
+}
+
+const char* FormatName(SubtitleFormat format) {
+  return kFormatNames[format];
+}
+
+LanguageCode PackLanguage(const string& code) {
+  if (code.size() != 3) {
+    return 0;
+  }
+  LanguageCode packed = 0;
+  for (size_t i = 0; i < 3; ++i) {
+    char c = code[i] | 0x20;
+    if (c < 'a' || c > 'z') {
+      return 0;
+    }
+    packed = static_cast<LanguageCode>(packed << 5 | (c - 'a' + 1));
+  }
+  return packed;
+}
+
+string UnpackLanguage(LanguageCode code) {
+  if (code == 0) {
+    return "";
+  }
+  string unpacked(3, ' ');
+  for (int i = 2; i >= 0; --i) {
+    unpacked[i] = static_cast<char>('a' + (code & 0x1f) - 1);
+    code >>= 5;
+  }
+  return unpacked;
+}
+
+CompactSubFiles::CompactSubFiles(const vector<SubFile>& files)
+    : shared_count_(0) {
+  files_.reserve(files.size());
+  for (const auto& file : files) {
+    Add(file);
+  }
+}
+
+TextRef CompactSubFiles::Store(const char* data, size_t size) {
+  TextRef ref = {static_cast<uint32_t>(text_.size()),
+                 static_cast<uint32_t>(size)};
+  text_.append(data, size);
+  return ref;
+}
+
+TextRef CompactSubFiles::StoreShared(const char* data, size_t size) {
+  if (size == 0) {
+    TextRef empty = {0, 0};
+    return empty;
+  }
+  if (2 * (shared_count_ + 1) > shared_.size()) {
+    vector<Shared> old(std::max<size_t>(64, 2 * shared_.size()));
+    old.swap(shared_);
+    for (const Shared& entry : old) {
+      if (entry.ref.size != 0) {
+        size_t slot = entry.hash & (shared_.size() - 1);
+        while (shared_[slot].ref.size != 0) {
+          slot = (slot + 1) & (shared_.size() - 1);
+        }
+        shared_[slot] = entry;
+      }
+    }
+  }
+  size_t hash = schema::Hash(data, size);
+  size_t slot = hash & (shared_.size() - 1);
+  while (shared_[slot].ref.size != 0) {
+    const Shared& entry = shared_[slot];
+    if (entry.hash == hash) {
+      if (entry.ref.size == size &&
+          text_.compare(entry.ref.offset, size, data, size) == 0) {
+        return entry.ref;
+      }
+      // collision, keep the first one shared
+      return Store(data, size);
+    }
+    slot = (slot + 1) & (shared_.size() - 1);
+  }
+  shared_[slot].hash = hash;
+  shared_[slot].ref = Store(data, size);
+  ++shared_count_;
+  return shared_[slot].ref;
+}
+
+LinkRef CompactSubFiles::StoreLink(const string& link) {
+  size_t split = link.rfind('/');
+  split = split == string::npos ? 0 : split + 1;
+  LinkRef ref = {StoreShared(link.data(), split),
+                 Store(link.data() + split, link.size() - split)};
+  return ref;
+}
+
+void CompactSubFiles::Add(const SubFile& file) {
+  CompactSubFile c;
+  c.movie_hash = ParseHex64(file.MovieHash_);
+  c.movie_byte_size = ParseUint(file.MovieByteSize_);
+  c.id_sub_movie_file = ParseUint(file.IDSubMovieFile_);
+  c.id_subtitle_file = ParseUint(file.IDSubtitleFile_);
+  c.id_subtitle = ParseUint(file.IDSubtitle_);
+  c.id_movie = ParseUint(file.IDMovie_);
+  c.id_movie_imdb = ParseUint(file.IDMovieImdb_);
+  c.user_id = ParseUint(file.UserID_);
+  c.movie_time_ms = ParseUint(file.MovieTimeMS_);
+  c.sub_size = ParseUint(file.SubSize_);
+  c.sub_downloads_cnt = ParseUint(file.SubDownloadsCnt_);
+  c.sub_add_date = ParseDate(file.SubAddDate_);
+  c.sub_rating = ParseFloat(file.SubRating_);
+  c.movie_imdb_rating = ParseFloat(file.MovieImdbRating_);
+  c.sub_bad = ParseUint(file.SubBad_);
+  c.movie_year = ParseUint(file.MovieYear_);
+  c.sub_language_id = PackLanguage(file.SubLanguageID_);
+  c.sub_format = ParseFormat(file.SubFormat_);
+  c.sub_actual_cd = ParseUint(file.SubActualCD_);
+  c.sub_sum_cd = ParseUint(file.SubSumCD_);
+  const string& iso639 = file.ISO639_;
+  c.iso639[0] = iso639.size() > 0 ? iso639[0] : '\0';
+  c.iso639[1] = iso639.size() > 1 ? iso639[1] : '\0';
+  ParseMd5(file.SubHash_, c.sub_hash);
+
+  c.sub_file_name = Store(file.SubFileName_);
+  c.sub_author_comment = StoreShared(file.SubAuthorComment_);
+  c.movie_release_name = StoreShared(file.MovieReleaseName_);
+  c.movie_name = StoreShared(file.MovieName_);
+  c.movie_name_eng = StoreShared(file.MovieNameEng_);
+  c.user_nick_name = StoreShared(file.UserNickName_);
+  c.language_name = StoreShared(file.LanguageName_);
+  c.sub_download_link = StoreLink(file.SubDownloadLink_);
+  c.zip_download_link = StoreLink(file.ZipDownloadLink_);
+
+  files_.push_back(c);
+}
+
+// Parsers storing the text of a field into the last record, for Set.
+struct CompactSubFiles::Fields {
+  template <typename Int, Int CompactSubFile::*member>
+  static void Uint(CompactSubFiles* set, const string& text) {
+    set->files_.back().*member = static_cast<Int>(ParseUint(text));
+  }
+
+  template <float CompactSubFile::*member>
+  static void Float(CompactSubFiles* set, const string& text) {
+    set->files_.back().*member = ParseFloat(text);
+  }
+
+  template <TextRef CompactSubFile::*member>
+  static void Text(CompactSubFiles* set, const string& text) {
+    set->files_.back().*member = set->Store(text);
+  }
+
+  template <TextRef CompactSubFile::*member>
+  static void SharedText(CompactSubFiles* set, const string& text) {
+    set->files_.back().*member = set->StoreShared(text);
+  }
+
+  template <LinkRef CompactSubFile::*member>
+  static void Link(CompactSubFiles* set, const string& text) {
+    set->files_.back().*member = set->StoreLink(text);
+  }
+
+  static void MovieHash(CompactSubFiles* set, const string& text) {
+    set->files_.back().movie_hash = ParseHex64(text);
+  }
+
+  static void SubAddDate(CompactSubFiles* set, const string& text) {
+    set->files_.back().sub_add_date = ParseDate(text);
+  }
+
+  static void SubLanguageID(CompactSubFiles* set, const string& text) {
+    set->files_.back().sub_language_id = PackLanguage(text);
+  }
+
+  static void SubFormat(CompactSubFiles* set, const string& text) {
+    set->files_.back().sub_format = ParseFormat(text);
+  }
+
+  static void SubHash(CompactSubFiles* set, const string& text) {
+    ParseMd5(text, set->files_.back().sub_hash);
+  }
+
+  static void ISO639(CompactSubFiles* set, const string& text) {
+    char* iso639 = set->files_.back().iso639;
+    iso639[0] = text.size() > 0 ? text[0] : '\0';
+    iso639[1] = text.size() > 1 ? text[1] : '\0';
+  }
+
+  static const schema::Table<CompactSubFiles, 127>& Table();
+};
+
+#define SUBTLE_COMPACT_UINT(name, type, member) \
+  SUBTLE_FIELD_PARSER(CompactSubFiles, name, \
+      (&Fields::Uint<type, &CompactSubFile::member>))
+
+const schema::Table<CompactSubFiles, 127>&
+CompactSubFiles::Fields::Table() {
+  static constexpr schema::Field<CompactSubFiles> kSchema[] = {
+    SUBTLE_COMPACT_UINT("IDSubMovieFile", uint32_t, id_sub_movie_file),
+    SUBTLE_FIELD_PARSER(CompactSubFiles, "MovieHash", &Fields::MovieHash),
+    SUBTLE_COMPACT_UINT("MovieByteSize", uint64_t, movie_byte_size),
+    SUBTLE_COMPACT_UINT("MovieTimeMS", uint32_t, movie_time_ms),
+    SUBTLE_COMPACT_UINT("IDSubtitleFile", uint32_t, id_subtitle_file),
+    SUBTLE_FIELD_PARSER(CompactSubFiles, "SubFileName",
+        &Fields::Text<&CompactSubFile::sub_file_name>),
+    SUBTLE_COMPACT_UINT("SubActualCD", uint8_t, sub_actual_cd),
+    SUBTLE_COMPACT_UINT("SubSize", uint32_t, sub_size),
+    SUBTLE_FIELD_PARSER(CompactSubFiles, "SubHash", &Fields::SubHash),
+    SUBTLE_COMPACT_UINT("IDSubtitle", uint32_t, id_subtitle),
+    SUBTLE_COMPACT_UINT("UserID", uint32_t, user_id),
+    SUBTLE_FIELD_PARSER(CompactSubFiles, "SubLanguageID",
+        &Fields::SubLanguageID),
+    SUBTLE_FIELD_PARSER(CompactSubFiles, "SubFormat", &Fields::SubFormat),
+    SUBTLE_COMPACT_UINT("SubSumCD", uint8_t, sub_sum_cd),
+    SUBTLE_FIELD_PARSER(CompactSubFiles, "SubAuthorComment",
+        &Fields::SharedText<&CompactSubFile::sub_author_comment>),
+    SUBTLE_FIELD_PARSER(CompactSubFiles, "SubAddDate", &Fields::SubAddDate),
+    SUBTLE_COMPACT_UINT("SubBad", uint16_t, sub_bad),
+    SUBTLE_FIELD_PARSER(CompactSubFiles, "SubRating",
+        &Fields::Float<&CompactSubFile::sub_rating>),
+    SUBTLE_COMPACT_UINT("SubDownloadsCnt", uint32_t, sub_downloads_cnt),
+    SUBTLE_FIELD_PARSER(CompactSubFiles, "MovieReleaseName",
+        &Fields::SharedText<&CompactSubFile::movie_release_name>),
+    SUBTLE_COMPACT_UINT("IDMovie", uint32_t, id_movie),
+    SUBTLE_COMPACT_UINT("IDMovieImdb", uint32_t, id_movie_imdb),
+    SUBTLE_FIELD_PARSER(CompactSubFiles, "MovieName",
+        &Fields::SharedText<&CompactSubFile::movie_name>),
+    SUBTLE_FIELD_PARSER(CompactSubFiles, "MovieNameEng",
+        &Fields::SharedText<&CompactSubFile::movie_name_eng>),
+    SUBTLE_COMPACT_UINT("MovieYear", uint16_t, movie_year),
+    SUBTLE_FIELD_PARSER(CompactSubFiles, "MovieImdbRating",
+        &Fields::Float<&CompactSubFile::movie_imdb_rating>),
+    SUBTLE_FIELD_PARSER(CompactSubFiles, "UserNickName",
+        &Fields::SharedText<&CompactSubFile::user_nick_name>),
+    SUBTLE_FIELD_PARSER(CompactSubFiles, "ISO639", &Fields::ISO639),
+    SUBTLE_FIELD_PARSER(CompactSubFiles, "LanguageName",
+        &Fields::SharedText<&CompactSubFile::language_name>),
+    SUBTLE_FIELD_PARSER(CompactSubFiles, "SubDownloadLink",
+        &Fields::Link<&CompactSubFile::sub_download_link>),
+    SUBTLE_FIELD_PARSER(CompactSubFiles, "ZipDownloadLink",
+        &Fields::Link<&CompactSubFile::zip_download_link>)
+  };
+  SUBTLE_CHECK_SCHEMA(kSchema, 127);
+  static const schema::Table<CompactSubFiles, 127> table(kSchema);
+  return table;
+}
+
+#undef SUBTLE_COMPACT_UINT
+
+void CompactSubFiles::Begin() {
+  CompactSubFile c;
+  memset(&c, 0, sizeof(c));
+  files_.push_back(c);
+}
+
+bool CompactSubFiles::Set(const string& field, const string& text) {
+  return Fields::Table().Decode(this, field, text);
+}
+
+void CompactSubFiles::Clear() {
+  files_.clear();
+  text_.clear();
+  std::fill(shared_.begin(), shared_.end(), Shared());
+  shared_count_ = 0;
+}
+
+size_t CompactSubFiles::MemoryUsage() const {
+  return sizeof(*this) + files_.capacity() * sizeof(CompactSubFile) +
+         text_.capacity() + shared_.capacity() * sizeof(Shared);
+}
+
+}  // namespace libsubtle
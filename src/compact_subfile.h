@@ -0,0 +1,185 @@
+#ifndef SRC_COMPACT_SUBFILE_H_
+#define SRC_COMPACT_SUBFILE_H_
+
+#include <cinttypes>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "src/subfile.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+/// Subtitle file formats.
+enum SubtitleFormat {
+  FORMAT_UNKNOWN,
+  FORMAT_SRT,
+  FORMAT_SUB,
+  FORMAT_SMI,
+  FORMAT_SSA,
+  FORMAT_ASS,
+  FORMAT_TXT,
+  FORMAT_MPL,
+  FORMAT_VTT
+};
+
+/// \return format for an extension as the service reports it, e.g. "srt".
+SubtitleFormat ParseFormat(const string& format);
+/// \return extension for the format; "" when unknown.
+const char* FormatName(SubtitleFormat format);
+
+/// ISO 639-2 language code packed into 15 bits, five per letter, so codes
+/// compare and sort as integers. 0 when unknown.
+typedef uint16_t LanguageCode;
+
+/// \return packed code for a three letter code such as "eng".
+LanguageCode PackLanguage(const string& code);
+/// \return three letter code for a packed one.
+string UnpackLanguage(LanguageCode code);
+
+/// Reference to text stored in the CompactSubFiles owning a record.
+struct TextRef {
+  uint32_t offset;
+  uint32_t size;
+};
+
+/// Link split at its last '/'. Links share long prefixes, which are stored
+/// once per set.
+struct LinkRef {
+  TextRef prefix;
+  TextRef name;
+};
+
+/// SubFile with numbers parsed and text moved out of line.
+///
+/// Records are plain values a fraction of the size of a SubFile, so a result
+/// set can be sorted and filtered without touching any string. Text fields
+/// are resolved through the CompactSubFiles the record belongs to.
+struct CompactSubFile {
+  uint64_t movie_hash;
+  uint64_t movie_byte_size;
+  uint32_t id_sub_movie_file;
+  uint32_t id_subtitle_file;
+  uint32_t id_subtitle;
+  uint32_t id_movie;
+  uint32_t id_movie_imdb;
+  uint32_t user_id;
+  uint32_t movie_time_ms;
+  uint32_t sub_size;
+  uint32_t sub_downloads_cnt;
+  /// Seconds since the epoch, UTC.
+  uint32_t sub_add_date;
+  float sub_rating;
+  float movie_imdb_rating;
+  uint16_t sub_bad;
+  uint16_t movie_year;
+  LanguageCode sub_language_id;
+  uint8_t sub_format;
+  uint8_t sub_actual_cd;
+  uint8_t sub_sum_cd;
+  char iso639[2];
+  uint8_t sub_hash[16];
+
+  TextRef sub_file_name;
+  TextRef sub_author_comment;
+  TextRef movie_release_name;
+  TextRef movie_name;
+  TextRef movie_name_eng;
+  TextRef user_nick_name;
+  TextRef language_name;
+  LinkRef sub_download_link;
+  LinkRef zip_download_link;
+
+  SubtitleFormat Format() const {
+    return static_cast<SubtitleFormat>(sub_format);
+  }
+};
+
+/// A set of search results in compact form, owning the text of its records.
+///
+/// All of the text of a set lives in one buffer, and the records in another,
+/// so a whole response is freed at once. A set reused with Clear keeps both,
+/// and decoding response after response into it stops allocating once they
+/// have grown to fit the largest.
+class CompactSubFiles {
+ public:
+  typedef vector<CompactSubFile>::iterator iterator;
+  typedef vector<CompactSubFile>::const_iterator const_iterator;
+
+  CompactSubFiles() : shared_count_(0) {}
+  explicit CompactSubFiles(const vector<SubFile>& files);
+
+  /// Parse a SubFile and append it to the set.
+  void Add(const SubFile& file);
+
+  /// Append an empty record, to be filled one field at a time with Set.
+  void Begin();
+  /// Parse a field of the last record from its text, without going through
+  /// a SubFile. There must be a record.
+  /// \param field name of the field as the service sends it.
+  /// \return false if the field is not known.
+  bool Set(const string& field, const string& text);
+
+  /// Remove all records and their text, keeping the memory for reuse.
+  void Clear();
+
+  /// \return text a record refers to.
+  string Text(TextRef ref) const { return text_.substr(ref.offset, ref.size); }
+  /// \return link a record refers to.
+  string Text(LinkRef ref) const { return Text(ref.prefix) + Text(ref.name); }
+  /// \return text a record refers to, without copying it.
+  const char* Data(TextRef ref) const { return text_.data() + ref.offset; }
+
+  size_t size() const { return files_.size(); }
+  bool empty() const { return files_.empty(); }
+  const CompactSubFile& operator[](size_t i) const { return files_[i]; }
+
+  // records can be reordered or removed in place, e.g. with std::sort
+  iterator begin() { return files_.begin(); }
+  iterator end() { return files_.end(); }
+  const_iterator begin() const { return files_.begin(); }
+  const_iterator end() const { return files_.end(); }
+  iterator erase(iterator first, iterator last) {
+    return files_.erase(first, last);
+  }
+
+  /// \return approximate heap and inline bytes used by the set.
+  size_t MemoryUsage() const;
+
+ private:
+  /// Append text to the set.
+  TextRef Store(const char* data, size_t size);
+  TextRef Store(const string& text) { return Store(text.data(), text.size()); }
+  /// Like Store, but text repeated across records is stored once.
+  TextRef StoreShared(const char* data, size_t size);
+  TextRef StoreShared(const string& text) {
+    return StoreShared(text.data(), text.size());
+  }
+  /// Store a link with its prefix shared.
+  LinkRef StoreLink(const string& link);
+
+  /// Parsers of the fields Set knows.
+  struct Fields;
+
+  // slot of the table of shared text; empty text is never in it, so a slot
+  // with an empty ref is free
+  struct Shared {
+    size_t hash;
+    TextRef ref;
+  };
+
+  vector<CompactSubFile> files_;
+  string text_;
+  // open addressing table from the hash of shared text to where it is
+  // stored, kept at most half full; unlike a node based map it is cleared
+  // without freeing anything
+  vector<Shared> shared_;
+  size_t shared_count_;
+};
+
+}  // namespace libsubtle
+
+#endif  // SRC_COMPACT_SUBFILE_H_
@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/compact_subfile.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+SubFile MakeSubFile(int i) {
+  SubFile sub;
+  sub.IDSubtitleFile_ = std::to_string(1951894257 + i);
+  sub.MovieHash_ = "7d9cd5def91c9432";
+  sub.MovieByteSize_ = "735934464";
+  sub.SubHash_ = "d4f3b0e0dba2ed84fd5da2f5a6e2f6d1";
+  sub.SubRating_ = std::to_string(i % 10) + ".5";
+  sub.SubDownloadsCnt_ = std::to_string(i * 7);
+  sub.SubBad_ = "0";
+  sub.SubAddDate_ = "2009-06-25 19:30:40";
+  sub.SubLanguageID_ = "eng";
+  sub.ISO639_ = "en";
+  sub.LanguageName_ = "English";
+  sub.SubFormat_ = "srt";
+  sub.SubFileName_ = "Movie.Name.2009.720p.BluRay.x264-GROUP." +
+      std::to_string(i) + ".srt";
+  sub.MovieReleaseName_ = "Movie.Name.2009.720p.BluRay.x264-GROUP";
+  sub.MovieName_ = "Movie Name";
+  sub.UserNickName_ = "uploader";
+  sub.SubDownloadLink_ = "http://dl.opensubtitles.org/en/download/filead/" +
+      sub.IDSubtitleFile_ + ".gz";
+  return sub;
+}
+
+TEST(CompactSubFile, Parse) {
+  CompactSubFiles files;
+  files.Add(MakeSubFile(3));
+  const CompactSubFile& sub = files[0];
+
+  ASSERT_EQ(1951894260u, sub.id_subtitle_file);
+  ASSERT_EQ(0x7d9cd5def91c9432ull, sub.movie_hash);
+  ASSERT_EQ(735934464u, sub.movie_byte_size);
+  ASSERT_EQ(0xd4, sub.sub_hash[0]);
+  ASSERT_EQ(0xd1, sub.sub_hash[15]);
+  ASSERT_FLOAT_EQ(3.5, sub.sub_rating);
+  ASSERT_EQ(21u, sub.sub_downloads_cnt);
+  ASSERT_EQ(1245958240u, sub.sub_add_date);
+  ASSERT_EQ(FORMAT_SRT, sub.Format());
+  ASSERT_EQ("eng", UnpackLanguage(sub.sub_language_id));
+  ASSERT_EQ(PackLanguage("eng"), sub.sub_language_id);
+  ASSERT_EQ("Movie.Name.2009.720p.BluRay.x264-GROUP.3.srt",
+            files.Text(sub.sub_file_name));
+  ASSERT_EQ("English", files.Text(sub.language_name));
+  ASSERT_EQ("http://dl.opensubtitles.org/en/download/filead/1951894260.gz",
+            files.Text(sub.sub_download_link));
+  ASSERT_EQ("1951894260.gz", files.Text(sub.sub_download_link.name));
+}
+
+TEST(CompactSubFile, Invalid) {
+  SubFile sub;
+  sub.SubLanguageID_ = "e1g";
+  sub.MovieHash_ = "not a hash";
+  sub.SubFormat_ = "doc";
+  CompactSubFiles files;
+  files.Add(sub);
+
+  ASSERT_EQ(0, files[0].sub_language_id);
+  ASSERT_EQ(0u, files[0].movie_hash);
+  ASSERT_EQ(FORMAT_UNKNOWN, files[0].Format());
+  ASSERT_EQ("", files.Text(files[0].sub_file_name));
+}
+
+TEST(CompactSubFile, SortAndShrink) {
+  vector<SubFile> subs;
+  size_t sub_file_bytes = 0;
+  for (int i = 0; i < 10000; ++i) {
+    subs.push_back(MakeSubFile(i));
+    sub_file_bytes += sizeof(SubFile) + subs.back().SubFileName_.capacity() +
+        subs.back().MovieReleaseName_.capacity() +
+        subs.back().SubDownloadLink_.capacity();
+  }
+  CompactSubFiles files(subs);
+  ASSERT_EQ(10000, files.size());
+  ASSERT_LT(files.MemoryUsage() * 3, sub_file_bytes);
+
+  std::sort(files.begin(), files.end(),
+            [](const CompactSubFile& a, const CompactSubFile& b) {
+              return a.sub_rating > b.sub_rating ||
+                  (a.sub_rating == b.sub_rating &&
+                   a.sub_downloads_cnt > b.sub_downloads_cnt);
+            });
+  ASSERT_FLOAT_EQ(9.5, files[0].sub_rating);
+  ASSERT_EQ(9999u * 7, files[0].sub_downloads_cnt);
+}
+
+}  // namespace libsubtle
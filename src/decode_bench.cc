@@ -0,0 +1,229 @@
+// Allocations and time per decoded SearchSubtitles response.
+//
+// Compares the by-value StructDict helpers rpc_impl.cc used to have, the
+// StructView accessors and the streaming decoder, on the same synthetic
+// response. A sustained batch then decodes response after response into
+// CompactSubFiles, through SubFiles as Subtle does and straight into one
+// reused set, reporting the growth of the peak RSS as well.
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "src/bench.h"
+#include "src/compact_subfile.h"
+#include "src/struct_view.h"
+#include "src/types.h"
+#include "src/xmlrpc_stream.h"
+
+using std::map;
+using std::string;
+using std::vector;
+
+using xmlrpc_c::value;
+using xmlrpc_c::value_array;
+using xmlrpc_c::value_double;
+using xmlrpc_c::value_string;
+using xmlrpc_c::value_struct;
+
+namespace libsubtle {
+namespace {
+
+const int kResults = 100;
+const int kIterations = 200;
+const int kBatch = 2000;
+
+const char* kFields[] = {
+  "IDSubMovieFile", "MovieHash", "MovieByteSize", "MovieTimeMS",
+  "IDSubtitleFile", "SubFileName", "SubActualCD", "SubSize", "SubHash",
+  "IDSubtitle", "UserID", "SubLanguageID", "SubFormat", "SubSumCD",
+  "SubAuthorComment", "SubAddDate", "SubBad", "SubRating", "SubDownloadsCnt",
+  "MovieReleaseName", "IDMovie", "IDMovieImdb", "MovieName", "MovieNameEng",
+  "MovieYear", "MovieImdbRating", "UserNickName", "ISO639", "LanguageName",
+  "SubDownloadLink", "ZipDownloadLink"
+};
+
+string FieldValue(int result, const char* field) {
+  return string(field) + " value of result " + std::to_string(result);
+}
+
+value MakeTree() {
+  vector<value> data;
+  for (int r = 0; r < kResults; ++r) {
+    map<string, value> sub;
+    for (const char* field : kFields) {
+      sub[field] = value_string(FieldValue(r, field));
+    }
+    data.push_back(value_struct(sub));
+  }
+  map<string, value> top;
+  top["status"] = value_string("200 OK");
+  top["seconds"] = value_double(0.1);
+  top["data"] = value_array(data);
+  return value_struct(top);
+}
+
+string MakeXml() {
+  string xml = "<?xml version=\"1.0\"?><methodResponse><params><param>"
+      "<value><struct><member><name>status</name><value><string>200 OK"
+      "</string></value></member><member><name>data</name><value><array>"
+      "<data>";
+  for (int r = 0; r < kResults; ++r) {
+    xml += "<value><struct>";
+    for (const char* field : kFields) {
+      xml += "<member><name>" + string(field) + "</name><value><string>" +
+          FieldValue(r, field) + "</string></value></member>";
+    }
+    xml += "</struct></value>";
+  }
+  xml += "</data></array></value></member><member><name>seconds</name>"
+      "<value><double>0.1</double></value></member></struct></value></param>"
+      "</params></methodResponse>";
+  return xml;
+}
+
+// The helpers as they were before StructView.
+namespace legacy {
+
+typedef map<string, value> StructDict;
+
+string ds(value v) {
+  return static_cast<string>(value_string(v));
+}
+
+string s(StructDict v, string k) {
+  if (v.find(k) != v.end()) {
+    return ds(v[k]);
+  } else {
+    return "";
+  }
+}
+
+double d(StructDict v, string k) {
+  return static_cast<double>(value_double(v[k]));
+}
+
+StructDict v(value val) {
+  return static_cast<StructDict>(value_struct(val));
+}
+
+SearchResponse Decode(const value& result) {
+  SearchResponse response;
+  StructDict values = v(result);
+  response.SetStatus(s(values, "status"), d(values, "seconds"));
+  value data_field = values["data"];
+  vector<value> const data(value_array(data_field).vectorValueValue());
+  for (vector<value>::const_iterator it = data.begin(); it != data.end();
+       ++it) {
+    map<string, string> members;
+    StructDict values = v(*it);
+    for (StructDict::const_iterator iter = values.begin();
+         iter != values.end(); ++iter) {
+      members[iter->first] = ds(value_string(iter->second));
+    }
+    response.data_.push_back(SubFile(members));
+  }
+  return response;
+}
+
+}  // namespace legacy
+
+SearchResponse DecodeView(const value& result) {
+  SearchResponse response;
+  StructView values(result);
+  response.SetStatus(values.String("status"), values.Double("seconds"));
+  for (const value& entry : values.Array("data")) {
+    StructView sub(entry);
+    SubFile file;
+    for (const auto& member : sub) {
+      file.Set(member.first, AsString(member.second));
+    }
+    response.data_.push_back(file);
+  }
+  return response;
+}
+
+SearchResponse DecodeStream(const string& xml) {
+  SearchResponse response;
+  vector<SubFile> data;
+  SearchResponseDecoder decoder(&response, [&data](SubFile&& sub) {
+    data.push_back(std::move(sub));
+  });
+  XmlRpcStreamParser parser(&decoder);
+  parser.Feed(xml.data(), xml.size());
+  parser.Finish();
+  decoder.Finish();
+  response.data_.swap(data);
+  return response;
+}
+
+void DecodeCompact(const string& xml, CompactSubFiles* results) {
+  SearchResponse response;
+  results->Clear();
+  SearchResponseDecoder decoder(&response, results);
+  XmlRpcStreamParser parser(&decoder);
+  parser.Feed(xml.data(), xml.size());
+  parser.Finish();
+  decoder.Finish();
+}
+
+}  // namespace
+}  // namespace libsubtle
+
+int main() {
+  using libsubtle::CompactSubFiles;
+  using libsubtle::bench::DoNotOptimize;
+  using libsubtle::bench::Measure;
+  using libsubtle::bench::PeakRssKb;
+
+  value tree = libsubtle::MakeTree();
+  string xml = libsubtle::MakeXml();
+  printf("%d results of %zu fields per response\n", libsubtle::kResults,
+         sizeof(libsubtle::kFields) / sizeof(libsubtle::kFields[0]));
+
+  // first, while the peak RSS is still that of the inputs
+  printf("batch of %d responses:\n", libsubtle::kBatch);
+  {
+    long rss = PeakRssKb();
+    Measure m("compact decoder, one reused set");
+    CompactSubFiles results;
+    for (int i = 0; i < libsubtle::kBatch; ++i) {
+      libsubtle::DecodeCompact(xml, &results);
+      DoNotOptimize(results);
+    }
+    m.Report(libsubtle::kBatch);
+    printf("%-40s %12ld kB peak RSS growth\n", "", PeakRssKb() - rss);
+  }
+  {
+    long rss = PeakRssKb();
+    Measure m("streaming decoder, then CompactSubFiles");
+    for (int i = 0; i < libsubtle::kBatch; ++i) {
+      CompactSubFiles results(libsubtle::DecodeStream(xml).data_);
+      DoNotOptimize(results);
+    }
+    m.Report(libsubtle::kBatch);
+    printf("%-40s %12ld kB peak RSS growth\n", "", PeakRssKb() - rss);
+  }
+
+  {
+    Measure m("by-value StructDict helpers");
+    for (int i = 0; i < libsubtle::kIterations; ++i) {
+      DoNotOptimize(libsubtle::legacy::Decode(tree));
+    }
+    m.Report(libsubtle::kIterations);
+  }
+  {
+    Measure m("StructView accessors");
+    for (int i = 0; i < libsubtle::kIterations; ++i) {
+      DoNotOptimize(libsubtle::DecodeView(tree));
+    }
+    m.Report(libsubtle::kIterations);
+  }
+  {
+    Measure m("streaming decoder");
+    for (int i = 0; i < libsubtle::kIterations; ++i) {
+      DoNotOptimize(libsubtle::DecodeStream(xml));
+    }
+    m.Report(libsubtle::kIterations);
+  }
+}
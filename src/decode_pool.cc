@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "src/base64_codec.h"
+#include "src/decode_pool.h"
+#include "src/metrics.h"
+#include "src/trace.h"
+#include "src/types.h"
+
+using std::string;
+
+namespace libsubtle {
+
+namespace {
+
+const size_t kMaxDefaultThreads = 4;
+
+// Collects a streamed payload and submits it once complete.
+class JobSink : public ByteSink {
+ public:
+  JobSink(DecodePool* pool, const string& destination,
+          const DecodePool::Done& done)
+      : pool_(pool), destination_(destination), done_(done) {}
+
+  void Write(const char* data, size_t size) { payload_.append(data, size); }
+  void Finish() { pool_->Submit(std::move(payload_), destination_, done_); }
+
+ private:
+  DecodePool* pool_;
+  string destination_;
+  DecodePool::Done done_;
+  string payload_;
+};
+
+}  // namespace
+
+DecodePool::DecodePool(size_t threads, size_t queue_limit,
+                       const Inflater* inflater)
+    : inflater_(inflater ? inflater : DefaultInflater()),
+      running_(0),
+      written_(0),
+      stop_(false) {
+  if (threads == 0) {
+    threads = std::max<size_t>(1, std::min<size_t>(
+        std::thread::hardware_concurrency(), kMaxDefaultThreads));
+  }
+  queue_limit_ = queue_limit ? queue_limit : 2 * threads;
+  for (size_t i = 0; i < threads; ++i) {
+    workers_.push_back(std::thread(&DecodePool::Work, this));
+  }
+}
+
+DecodePool::~DecodePool() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this] { return queue_.empty() && running_ == 0; });
+    stop_ = true;
+  }
+  not_empty_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+void DecodePool::Submit(string payload, const string& destination,
+                        const Done& done) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  not_full_.wait(lock, [this] { return queue_.size() < queue_limit_; });
+  Job job;
+  job.payload.swap(payload);
+  job.destination = destination;
+  job.done = done;
+  queue_.push_back(std::move(job));
+  metrics::Library().decode_queue->Add(1);
+  lock.unlock();
+  not_empty_.notify_one();
+}
+
+std::unique_ptr<ByteSink> DecodePool::NewJobSink(const string& destination,
+                                                 const Done& done) {
+  return std::unique_ptr<ByteSink>(new JobSink(this, destination, done));
+}
+
+size_t DecodePool::Wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_.wait(lock, [this] { return queue_.empty() && running_ == 0; });
+  size_t written = written_;
+  written_ = 0;
+  string error;
+  error.swap(error_);
+  if (!error.empty()) {
+    throw SubtleException(error);
+  }
+  return written;
+}
+
+void DecodePool::Work() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    not_empty_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+    if (queue_.empty()) {
+      return;
+    }
+    Job job = std::move(queue_.front());
+    queue_.pop_front();
+    metrics::Library().decode_queue->Add(-1);
+    ++running_;
+    lock.unlock();
+    not_full_.notify_one();
+
+    string error;
+    try {
+      Process(job);
+    } catch (const std::exception& e) {
+      error = job.destination + ": " + e.what();
+    }
+
+    lock.lock();
+    --running_;
+    if (error.empty()) {
+      ++written_;
+    } else if (error_.empty()) {
+      error_ = error;
+    }
+    if (queue_.empty() && running_ == 0) {
+      idle_.notify_all();
+    }
+  }
+}
+
+void DecodePool::Process(const Job& job) {
+  SUBTLE_TRACE_SPAN("download", "DecodeSubtitle");
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  FileSink file(job.destination);
+  std::unique_ptr<ByteSink> inflate = inflater_->NewSink(&file);
+  Base64DecodeSink base64(inflate.get());
+  base64.Write(job.payload.data(), job.payload.size());
+  base64.Finish();
+  const metrics::LibraryMetrics& library = metrics::Library();
+  library.decode_bytes->Add(job.payload.size());
+  library.decode_seconds->Observe(std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count());
+  if (job.done) {
+    job.done();
+  }
+}
+
+}  // namespace libsubtle
@@ -0,0 +1,94 @@
+#ifndef SRC_DECODE_POOL_H_
+#define SRC_DECODE_POOL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/byte_sink.h"
+#include "src/inflater.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+/// Decodes, inflates and writes downloaded subtitles on a small pool of
+/// threads, so the thread receiving a batched response can go on reading
+/// while earlier subtitles are processed.
+///
+/// The queue of waiting jobs is bounded: when the workers fall behind,
+/// Submit blocks, which in turn stops reading the response and lets the
+/// connection apply backpressure to the server.
+class DecodePool {
+ public:
+  /// \param threads number of workers; 0 picks one per core, up to 4.
+  /// \param queue_limit jobs waiting before Submit blocks; 0 picks twice
+  ///        the number of workers.
+  /// \param inflater decompression backend; NULL picks DefaultInflater.
+  explicit DecodePool(size_t threads = 0, size_t queue_limit = 0,
+                      const Inflater* inflater = NULL);
+  /// Finishes the queued jobs, then stops the workers.
+  ~DecodePool();
+
+  /// Runs on the worker once the file of a job is written, to move it into
+  /// place. Exceptions it throws fail the job.
+  typedef std::function<void()> Done;
+
+  /// Queue a subtitle, blocking while the queue is full.
+  /// \param payload base64 encoded, gzip compressed subtitle.
+  /// \param destination file to write the subtitle to.
+  /// \param done called after the file is written, if set.
+  void Submit(string payload, const string& destination,
+              const Done& done = Done());
+
+  /// \return a sink collecting the base64 payload of a subtitle streamed out
+  ///         of a response, which is submitted when the sink is finished.
+  std::unique_ptr<ByteSink> NewJobSink(const string& destination,
+                                       const Done& done = Done());
+
+  /// Wait until every job submitted so far is done.
+  /// Throws SubtleException naming the first job that failed.
+  /// \return number of subtitles written since the last call.
+  size_t Wait();
+
+  size_t threads() const { return workers_.size(); }
+
+ private:
+  DecodePool(const DecodePool&);
+  void operator=(const DecodePool&);
+
+  struct Job {
+    string payload;
+    string destination;
+    Done done;
+  };
+
+  void Work();
+  void Process(const Job& job);
+
+  const Inflater* inflater_;
+  size_t queue_limit_;
+
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::condition_variable idle_;
+  std::deque<Job> queue_;
+  // jobs taken by workers and not done yet
+  size_t running_;
+  size_t written_;
+  string error_;
+  bool stop_;
+  vector<std::thread> workers_;
+};
+
+}  // namespace libsubtle
+
+#endif  // SRC_DECODE_POOL_H_
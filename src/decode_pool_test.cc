@@ -0,0 +1,132 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "src/base64_codec.h"
+#include "src/decode_pool.h"
+#include "src/gzip_test_util.h"
+#include "src/types.h"
+
+using std::string;
+
+namespace libsubtle {
+
+class DecodePoolTest : public ::testing::Test {
+ protected:
+  void SetUp() {
+    char dir[] = "/tmp/decode_pool_XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != NULL);
+    dir_ = dir;
+  }
+
+  void TearDown() {
+    ASSERT_EQ(0, system(("rm -rf " + dir_).c_str()));
+  }
+
+  string Read(const string& path) {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    std::ostringstream text;
+    text << in.rdbuf();
+    return text.str();
+  }
+
+  string dir_;
+};
+
+// Passes the payload through unchanged once released.
+class GatedInflater : public Inflater {
+ public:
+  GatedInflater() : entered_(false), open_(false) {}
+
+  const char* Name() const { return "gated"; }
+
+  void Inflate(const char* data, size_t size, string* out) const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    entered_ = true;
+    cv_.notify_all();
+    cv_.wait(lock, [this] { return open_; });
+    out->append(data, size);
+  }
+
+  void WaitEntered() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return entered_; });
+  }
+
+  void Open() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    open_ = true;
+    cv_.notify_all();
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  mutable std::condition_variable cv_;
+  mutable bool entered_;
+  bool open_;
+};
+
+TEST_F(DecodePoolTest, Writes) {
+  DecodePool pool(3);
+  for (int i = 0; i < 20; ++i) {
+    string text = "subtitle " + std::to_string(i) + "\n";
+    pool.Submit(Base64Encode(Gzip(text)), dir_ + "/" + std::to_string(i));
+  }
+  std::unique_ptr<ByteSink> sink = pool.NewJobSink(dir_ + "/streamed");
+  string payload = Base64Encode(Gzip("streamed\n"));
+  sink->Write(payload.data(), 5);
+  sink->Write(payload.data() + 5, payload.size() - 5);
+  sink->Finish();
+
+  ASSERT_EQ(21u, pool.Wait());
+  for (int i = 0; i < 20; ++i) {
+    ASSERT_EQ("subtitle " + std::to_string(i) + "\n",
+              Read(dir_ + "/" + std::to_string(i)));
+  }
+  ASSERT_EQ("streamed\n", Read(dir_ + "/streamed"));
+}
+
+TEST_F(DecodePoolTest, ReportsFailure) {
+  DecodePool pool(2);
+  pool.Submit(Base64Encode(Gzip("good")), dir_ + "/good");
+  pool.Submit("not base64!", dir_ + "/bad");
+  ASSERT_THROW(pool.Wait(), SubtleException);
+  ASSERT_EQ("good", Read(dir_ + "/good"));
+  ASSERT_NE(0, access((dir_ + "/bad").c_str(), F_OK));
+
+  pool.Submit(Base64Encode(Gzip("again")), dir_ + "/again");
+  ASSERT_EQ(1u, pool.Wait());
+}
+
+TEST_F(DecodePoolTest, Backpressure) {
+  GatedInflater inflater;
+  DecodePool pool(1, 1, &inflater);
+  std::atomic<int> submitted(0);
+  std::thread producer([&] {
+    for (int i = 0; i < 3; ++i) {
+      pool.Submit(Base64Encode("x"), dir_ + "/" + std::to_string(i));
+      ++submitted;
+    }
+  });
+
+  // one job is held by the worker and one waits, so the third blocks
+  inflater.WaitEntered();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_EQ(2, submitted.load());
+
+  inflater.Open();
+  producer.join();
+  ASSERT_EQ(3u, pool.Wait());
+  ASSERT_EQ("x", Read(dir_ + "/2"));
+}
+
+}  // namespace libsubtle
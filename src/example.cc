@@ -1,24 +1,134 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <vector>
 #include "boost/filesystem.hpp"
 #include "boost/regex.hpp"
 
+#include "src/capture_transport.h"
+#include "src/metrics.h"
 #include "src/rpc_impl.h"
+#include "src/rpc_stats.h"
 #include "src/subtle.h"
+#include "src/trace.h"
 
 using namespace boost::filesystem;
 
 int main(int argc, char** argv) {
-  libsubtle::XmlRpcImpl client;
-  libsubtle::Subtle s(&client);
+  // SUBTLE_RECORD=scan.capture records the calls of the run to the file, and
+  // SUBTLE_REPLAY=scan.capture answers them from it instead of the service,
+  // taking SUBTLE_REPLAY_SCALE times as long as recorded (1 by default)
+  libsubtle::CurlTransport curl;
+  std::unique_ptr<libsubtle::Transport> capture;
+  if (const char* record_path = getenv("SUBTLE_RECORD")) {
+    capture.reset(new libsubtle::RecordingTransport(&curl, record_path));
+  } else if (const char* replay_path = getenv("SUBTLE_REPLAY")) {
+    const char* scale = getenv("SUBTLE_REPLAY_SCALE");
+    capture.reset(new libsubtle::ReplayTransport(replay_path,
+                                                 scale ? atof(scale) : 1));
+  }
+  libsubtle::SessionOptions session_options;
+  if (capture) {
+    // the same calls must be made when replaying: no cached session token,
+    // keepalives or stored subtitles unless asked for
+    session_options.cache_path = "-";
+    session_options.keepalive = false;
+    setenv("SUBTLE_STORE", "-", 0);
+  }
+  libsubtle::XmlRpcImpl client(capture ? capture.get() : &curl);
+  // SUBTLE_RPC_STATS=1 prints the cost of the calls per method at exit
+  libsubtle::RpcStats stats;
+  if (getenv("SUBTLE_RPC_STATS")) {
+    client.SetObserver(&stats);
+  }
+  // SUBTLE_METRICS=subtle.prom keeps metrics in the file for the textfile
+  // collector of node_exporter, rewritten every 15 s and at exit
+  libsubtle::RpcMetrics rpc_metrics(
+      libsubtle::metrics::Registry::Default(),
+      getenv("SUBTLE_RPC_STATS") ? &stats : NULL);
+  std::unique_ptr<libsubtle::metrics::TextfileWriter> metrics_writer;
+  if (const char* metrics_path = getenv("SUBTLE_METRICS")) {
+    client.SetObserver(&rpc_metrics);
+    metrics_writer.reset(new libsubtle::metrics::TextfileWriter(
+        libsubtle::metrics::Registry::Default(), metrics_path,
+        std::chrono::seconds(15)));
+  }
+  libsubtle::Subtle s(&client, session_options);
+  // SUBTLE_TRACE=trace.json writes a Chrome trace of the run to the file
+  const char* trace_path = getenv("SUBTLE_TRACE");
+  if (trace_path) {
+    libsubtle::trace::Start();
+  }
 
   path current_dir(".");
   boost::regex pattern(".*mkv|.*avi|.*mp4");
-  for (recursive_directory_iterator iter(current_dir), end;
-      iter != end;
-      ++iter) {
-    std::string name = iter->path().string();
-    std::string dest = absolute(iter->path().parent_path()).string();
-    if (regex_match(name, pattern))
-      s.DownloadSubtitles(argv[1], name, dest);
+  boost::regex subtitle_pattern(".*srt|.*sub|.*ssa|.*ass|.*smi");
+  std::map<std::string, std::vector<path>> videos;  // by directory
+  std::vector<std::string> subtitles;
+  {
+    SUBTLE_TRACE_SPAN("crawl", "FindVideos");
+    for (recursive_directory_iterator iter(current_dir), end;
+        iter != end;
+        ++iter) {
+      std::string name = iter->path().string();
+      std::string dest = absolute(iter->path().parent_path()).string();
+      if (regex_match(name, pattern))
+        videos[dest].push_back(iter->path());
+      else if (regex_match(name, subtitle_pattern))
+        subtitles.push_back(name);
+    }
+  }
+
+  // on rescans, videos with a subtitle the service already knows in a
+  // language asked for are skipped: one named after the video, or any in a
+  // folder holding a single video
+  std::set<std::string> languages;
+  std::stringstream language_list(argv[1]);
+  for (std::string language; getline(language_list, language, ',');)
+    languages.insert(language);
+  std::map<std::string, std::string> sub_dirs;
+  std::vector<std::string> beside_videos;
+  for (const auto& sub : s.CheckLocalSubtitles(subtitles)) {
+    std::string dir = absolute(path(sub.first).parent_path()).string();
+    if (videos.count(dir)) {
+      sub_dirs[sub.first] = dir;
+      beside_videos.push_back(sub.first);
+    }
+  }
+  // names of those subtitles, by directory
+  std::map<std::string, std::set<std::string>> covering;
+  for (const auto& sub : s.DetectLocalLanguages(beside_videos)) {
+    if (languages.count("all") || languages.count(sub.second))
+      covering[sub_dirs[sub.first]].insert(
+          path(sub.first).filename().string());
+  }
+  std::vector<std::string> pending;
+  for (const auto& dir : videos) {
+    auto names = covering.find(dir.first);
+    for (const path& video : dir.second) {
+      bool covered = false;
+      if (names != covering.end()) {
+        covered = dir.second.size() == 1 ||
+            libsubtle::Subtle::HasSubtitleNamedAfter(
+                names->second, video.filename().string());
+      }
+      if (!covered)
+        pending.push_back(video.string());
+    }
+  }
+  // hashing, searching and downloading overlap across videos
+  s.DownloadForVideos(argv[1], pending);
+
+  if (getenv("SUBTLE_RPC_STATS")) {
+    stats.Print(std::cerr);
+  }
+  if (trace_path) {
+    std::ofstream trace(trace_path);
+    libsubtle::trace::WriteChromeTrace(trace);
   }
 }
@@ -0,0 +1,98 @@
+#include <zlib.h>
+
+#include <sstream>
+#include <string>
+
+#include "src/gunzip.h"
+#include "src/types.h"
+
+using std::string;
+
+namespace libsubtle {
+
+namespace {
+
+// Adapts an ostream to the end of a pipeline.
+class StreamSink : public ByteSink {
+ public:
+  explicit StreamSink(std::ostream* out) : out_(out) {}
+  void Write(const char* data, size_t size) { out_->write(data, size); }
+
+ private:
+  std::ostream* out_;
+};
+
+}  // namespace
+
+const size_t GunzipSink::kDefaultChunkSize;
+
+GunzipSink::GunzipSink(ByteSink* next, size_t chunk_size)
+    : next_(next), chunk_(chunk_size ? chunk_size : 1), member_end_(false) {
+  stream_.zalloc = Z_NULL;
+  stream_.zfree = Z_NULL;
+  stream_.opaque = Z_NULL;
+  stream_.next_in = Z_NULL;
+  stream_.avail_in = 0;
+  // 32 detects gzip and zlib headers
+  if (inflateInit2(&stream_, 32 + MAX_WBITS) != Z_OK) {
+    throw SubtleException("Cannot initialize zlib.");
+  }
+}
+
+GunzipSink::~GunzipSink() {
+  inflateEnd(&stream_);
+}
+
+void GunzipSink::Write(const char* data, size_t size) {
+  stream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+  stream_.avail_in = static_cast<uInt>(size);
+  // keep going while there is input, or while zlib may hold back output for
+  // lack of room
+  do {
+    if (member_end_) {
+      if (stream_.avail_in == 0) {
+        break;
+      }
+      // next gzip member
+      inflateReset(&stream_);
+      member_end_ = false;
+    }
+    stream_.next_out = reinterpret_cast<Bytef*>(&chunk_[0]);
+    stream_.avail_out = static_cast<uInt>(chunk_.size());
+    int status = inflate(&stream_, Z_NO_FLUSH);
+    if (status == Z_BUF_ERROR) {
+      // nothing left to do until more input arrives
+      break;
+    }
+    if (status != Z_OK && status != Z_STREAM_END) {
+      throw SubtleException(string("Corrupt compressed data: ") +
+                            (stream_.msg ? stream_.msg : "unknown error"));
+    }
+    if (stream_.avail_out < chunk_.size()) {
+      next_->Write(&chunk_[0], chunk_.size() - stream_.avail_out);
+    }
+    member_end_ = status == Z_STREAM_END;
+  } while (stream_.avail_in > 0 || stream_.avail_out == 0);
+}
+
+void GunzipSink::Finish() {
+  if (!member_end_) {
+    throw SubtleException("Corrupt compressed data: truncated");
+  }
+  next_->Finish();
+}
+
+void Gunzip(const char* data, size_t size, std::ostream* out) {
+  StreamSink sink(out);
+  GunzipSink gunzip(&sink);
+  gunzip.Write(data, size);
+  gunzip.Finish();
+}
+
+string Gunzip(const string& data) {
+  std::ostringstream out;
+  Gunzip(data.data(), data.size(), &out);
+  return out.str();
+}
+
+}  // namespace libsubtle
@@ -0,0 +1,60 @@
+#ifndef SRC_GUNZIP_H_
+#define SRC_GUNZIP_H_
+
+#include <zlib.h>
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "src/byte_sink.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+/// Inflates a gzip or zlib compressed stream written to it in pieces, passing
+/// the output on in chunks of bounded size. Concatenated gzip members are
+/// inflated one after another.
+class GunzipSink : public ByteSink {
+ public:
+  static const size_t kDefaultChunkSize = 64 * 1024;
+
+  /// \param next sink receiving the inflated stream.
+  /// \param chunk_size largest piece written to next at once.
+  explicit GunzipSink(ByteSink* next, size_t chunk_size = kDefaultChunkSize);
+  ~GunzipSink();
+
+  /// Throws SubtleException on corrupt input.
+  void Write(const char* data, size_t size);
+
+  /// Throws SubtleException when the stream is truncated, finishes next
+  /// otherwise.
+  void Finish();
+
+ private:
+  GunzipSink(const GunzipSink&);
+  void operator=(const GunzipSink&);
+
+  ByteSink* next_;
+  z_stream stream_;
+  vector<char> chunk_;
+  // a member ended and nothing followed yet
+  bool member_end_;
+};
+
+/// Inflate gzip or zlib compressed data held in memory, without going through
+/// a temporary file. Throws SubtleException on corrupt or truncated input.
+/// \param data compressed bytes.
+/// \param size number of compressed bytes.
+/// \param out stream receiving the inflated bytes.
+void Gunzip(const char* data, size_t size, std::ostream* out);
+
+/// \return data inflated into a string.
+string Gunzip(const string& data);
+
+}  // namespace libsubtle
+
+#endif  // SRC_GUNZIP_H_
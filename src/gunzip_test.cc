@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "src/gunzip.h"
+#include "src/gzip_test_util.h"
+#include "src/types.h"
+
+using std::string;
+
+namespace libsubtle {
+
+TEST(Gunzip, Inflate) {
+  string text;
+  for (int i = 0; i < 20000; ++i) {
+    text += std::to_string(i) + "\n00:00:01,000 --> 00:00:02,000\nHello\n\n";
+  }
+  ASSERT_EQ(text, Gunzip(Gzip(text)));
+  ASSERT_EQ("", Gunzip(Gzip("")));
+}
+
+TEST(Gunzip, Concatenated) {
+  ASSERT_EQ("firstsecond", Gunzip(Gzip("first") + Gzip("second")));
+}
+
+TEST(Gunzip, Corrupt) {
+  string compressed = Gzip("1\n00:00:01,000 --> 00:00:02,000\nHello\n");
+  ASSERT_THROW(Gunzip(compressed.substr(0, compressed.size() / 2)),
+               SubtleException);
+  ASSERT_THROW(Gunzip("not compressed at all"), SubtleException);
+  ASSERT_THROW(Gunzip(""), SubtleException);
+}
+
+// Collects a stream, remembering the largest piece written.
+class StringSink : public ByteSink {
+ public:
+  StringSink() : largest_(0), finished_(false) {}
+  void Write(const char* data, size_t size) {
+    text_.append(data, size);
+    largest_ = std::max(largest_, size);
+  }
+  void Finish() { finished_ = true; }
+
+  string text_;
+  size_t largest_;
+  bool finished_;
+};
+
+TEST(Gunzip, Chunked) {
+  string text;
+  for (int i = 0; i < 50000; ++i) {
+    text += std::to_string(i) + "\n00:00:01,000 --> 00:00:02,000\nHello\n\n";
+  }
+  string compressed = Gzip(text) + Gzip("tail");
+  for (size_t piece : {1, 7, 4096, 1 << 20}) {
+    StringSink sink;
+    GunzipSink gunzip(&sink, 1000);
+    for (size_t i = 0; i < compressed.size(); i += piece) {
+      gunzip.Write(compressed.data() + i,
+                   std::min(piece, compressed.size() - i));
+    }
+    ASSERT_FALSE(sink.finished_);
+    gunzip.Finish();
+    ASSERT_TRUE(sink.finished_);
+    ASSERT_EQ(text + "tail", sink.text_);
+    ASSERT_GE(1000u, sink.largest_);
+  }
+}
+
+}  // namespace libsubtle
@@ -0,0 +1,32 @@
+#ifndef SRC_GZIP_TEST_UTIL_H_
+#define SRC_GZIP_TEST_UTIL_H_
+
+#include <zlib.h>
+
+#include <string>
+
+using std::string;
+
+namespace libsubtle {
+
+/// Compress text into one gzip member, as the service sends subtitles. For
+/// tests, benchmarks and the mock service.
+/// \param level zlib compression level.
+inline string Gzip(const string& text, int level = Z_BEST_COMPRESSION) {
+  z_stream stream = z_stream();
+  deflateInit2(&stream, level, Z_DEFLATED, 16 + MAX_WBITS, 8,
+               Z_DEFAULT_STRATEGY);
+  string out(deflateBound(&stream, text.size()) + 32, '\0');
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(text.data()));
+  stream.avail_in = text.size();
+  stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+  stream.avail_out = out.size();
+  deflate(&stream, Z_FINISH);
+  out.resize(stream.total_out);
+  deflateEnd(&stream);
+  return out;
+}
+
+}  // namespace libsubtle
+
+#endif  // SRC_GZIP_TEST_UTIL_H_
@@ -43,40 +43,56 @@ namespace GZSTREAM_NAMESPACE {
 // ----------------------------------------------------------------------------
 
 class gzstreambuf : public std::streambuf {
-private:
-    static const int bufferSize = 47+256;    // size of data buff
-    // totals 512 bytes under g++ for igzstream at the end.
+public:
+    // Large buffers keep gzread/gzwrite calls, and the virtual calls of the
+    // stream around them, rare.
+    static const int defaultBufferSize = 128 * 1024;
+    static const int minBufferSize     = 4 + 256;
 
+private:
     gzFile           file;               // file handle for compressed file
-    char             buffer[bufferSize]; // data buffer
+    char*            buffer;             // data buffer, 4 bytes putback area
+    int              bufferSize;         // size of data buff
     char             opened;             // open/close state of stream
     int              mode;               // I/O mode
 
+    gzstreambuf( const gzstreambuf&);
+    void operator=( const gzstreambuf&);
+
     int flush_buffer();
 public:
-    gzstreambuf() : opened(0) {
-        setp( buffer, buffer + (bufferSize-1));
-        setg( buffer + 4,     // beginning of putback area
-              buffer + 4,     // read position
-              buffer + 4);    // end position      
+    explicit gzstreambuf( int buffer_size = defaultBufferSize)
+        : buffer( 0), bufferSize( 0), opened(0) {
+        set_buffer_size( buffer_size);
         // ASSERT: both input & output capabilities will not be used together
     }
     int is_open() { return opened; }
+    // Resizes the buffer; only while the stream is closed.
+    bool set_buffer_size( int buffer_size);
+    int buffer_size() const { return bufferSize; }
     gzstreambuf* open( const char* name, int open_mode);
     gzstreambuf* close();
-    ~gzstreambuf() { close(); }
-    
+    ~gzstreambuf() { close(); delete[] buffer; }
+
+    // Inflates the rest of the file straight into out, in buffer sized
+    // pieces. Returns the number of bytes copied, or -1 on errors.
+    std::streamsize copy_to( std::streambuf* out);
+
     virtual int     overflow( int c = EOF);
     virtual int     underflow();
     virtual int     sync();
+    virtual std::streamsize xsgetn( char* s, std::streamsize n);
+    virtual std::streamsize xsputn( const char* s, std::streamsize n);
 };
 
 class gzstreambase : virtual public std::ios {
 protected:
     gzstreambuf buf;
 public:
-    gzstreambase() { init(&buf); }
-    gzstreambase( const char* name, int open_mode);
+    explicit gzstreambase( int buffer_size = gzstreambuf::defaultBufferSize)
+        : buf( buffer_size) { init(&buf); }
+    gzstreambase( const char* name, int open_mode,
+                  int buffer_size = gzstreambuf::defaultBufferSize);
     ~gzstreambase();
     void open( const char* name, int open_mode);
     void close();
@@ -91,20 +107,34 @@ public:
 
 class igzstream : public gzstreambase, public std::istream {
 public:
-    igzstream() : std::istream( &buf) {} 
-    igzstream( const char* name, int open_mode = std::ios::in)
-        : gzstreambase( name, open_mode), std::istream( &buf) {}  
+    explicit igzstream( int buffer_size = gzstreambuf::defaultBufferSize)
+        : gzstreambase( buffer_size), std::istream( &buf) {}
+    igzstream( const char* name, int open_mode = std::ios::in,
+               int buffer_size = gzstreambuf::defaultBufferSize)
+        : gzstreambase( name, open_mode, buffer_size), std::istream( &buf) {}
     gzstreambuf* rdbuf() { return gzstreambase::rdbuf(); }
     void open( const char* name, int open_mode = std::ios::in) {
         gzstreambase::open( name, open_mode);
     }
+    // Copies the rest of the decompressed stream into out at zlib speed,
+    // rather than character by character. Sets failbit on errors.
+    std::streamsize copy_to( std::ostream& out) {
+        std::streamsize n = buf.copy_to( out.rdbuf());
+        if ( n < 0) {
+            setstate( std::ios::failbit);
+            out.setstate( std::ios::badbit);
+        }
+        return n;
+    }
 };
 
 class ogzstream : public gzstreambase, public std::ostream {
 public:
-    ogzstream() : std::ostream( &buf) {}
-    ogzstream( const char* name, int mode = std::ios::out)
-        : gzstreambase( name, mode), std::ostream( &buf) {}  
+    explicit ogzstream( int buffer_size = gzstreambuf::defaultBufferSize)
+        : gzstreambase( buffer_size), std::ostream( &buf) {}
+    ogzstream( const char* name, int mode = std::ios::out,
+               int buffer_size = gzstreambuf::defaultBufferSize)
+        : gzstreambase( name, mode, buffer_size), std::ostream( &buf) {}
     gzstreambuf* rdbuf() { return gzstreambase::rdbuf(); }
     void open( const char* name, int open_mode = std::ios::out) {
         gzstreambase::open( name, open_mode);
@@ -0,0 +1,77 @@
+#include <unistd.h>
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "src/gzstream.h"
+
+using std::string;
+
+namespace libsubtle {
+
+class GzStreamTest : public ::testing::Test {
+ protected:
+  void SetUp() {
+    char path[] = "/tmp/subtle_gzstream_XXXXXX";
+    close(mkstemp(path));
+    path_ = path;
+    for (int i = 0; i < 40000; ++i) {
+      text_ += std::to_string(i) + "\n00:00:01,000 --> 00:00:02,000\nHi\n\n";
+    }
+  }
+  void TearDown() {
+    remove(path_.c_str());
+  }
+
+  void WriteText(int buffer_size) {
+    ogzstream out(path_.c_str(), std::ios::out, buffer_size);
+    // small and large writes
+    out << text_.substr(0, 100);
+    out.write(text_.data() + 100, text_.size() - 100);
+    out.close();
+    ASSERT_TRUE(out.good());
+  }
+
+  string path_;
+  string text_;
+};
+
+TEST_F(GzStreamTest, BufferSizes) {
+  for (int buffer_size : {1, 303, 4096, gzstreambuf::defaultBufferSize}) {
+    WriteText(buffer_size);
+    igzstream in(path_.c_str(), std::ios::in, buffer_size);
+    ASSERT_LE(gzstreambuf::minBufferSize, in.rdbuf()->buffer_size());
+
+    // a character, then a bulk read, then the rest through getline
+    char first;
+    ASSERT_TRUE(in.get(first).good());
+    string bulk(text_.size() / 2, '\0');
+    ASSERT_TRUE(in.read(&bulk[0], bulk.size()).good());
+    string rest;
+    std::getline(in, rest, '\0');
+    ASSERT_EQ(text_, first + bulk + rest) << buffer_size;
+  }
+}
+
+TEST_F(GzStreamTest, PutbackAfterBulkRead) {
+  WriteText(gzstreambuf::defaultBufferSize);
+  igzstream in(path_.c_str(), std::ios::in, 512);
+  string bulk(4096, '\0');
+  ASSERT_TRUE(in.read(&bulk[0], bulk.size()).good());
+  ASSERT_TRUE(in.unget().good());
+  ASSERT_EQ(text_[4095], in.get());
+}
+
+TEST_F(GzStreamTest, CopyTo) {
+  WriteText(gzstreambuf::defaultBufferSize);
+  igzstream in(path_.c_str());
+  char first;
+  ASSERT_TRUE(in.get(first).good());
+  std::ostringstream out;
+  ASSERT_EQ(static_cast<std::streamsize>(text_.size() - 1), in.copy_to(out));
+  ASSERT_EQ(text_.substr(1), out.str());
+}
+
+}  // namespace libsubtle
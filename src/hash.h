@@ -10,6 +10,9 @@
 #include <sstream>
 #include <string>
 
+#include "src/metrics.h"
+#include "src/trace.h"
+
 typedef uint64_t MpcHash;
 using std::ifstream;
 using std::ios;
@@ -17,6 +20,8 @@ using std::ios;
 class Hasher {
  public:
   MpcHash ComputeHash(ifstream& f) const {
+    SUBTLE_TRACE_SPAN("hash", "ComputeHash");
+    libsubtle::metrics::Library().files_hashed->Add();
     MpcHash hash, fsize;
 
     f.seekg(0, ios::end);
@@ -0,0 +1,91 @@
+// Time per inflated subtitle payload, for each decompression backend built
+// in.
+//
+// Payloads are small gzip members like the ones DownloadSubtitles returns,
+// inflated whole and through the streaming sinks.
+
+#include <string>
+#include <vector>
+
+#include "src/bench.h"
+#include "src/byte_sink.h"
+#include "src/gzip_test_util.h"
+#include "src/inflater.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+namespace {
+
+const int kPayloads = 200;
+const int kIterations = 20;
+
+string MakeSubtitle(int seed) {
+  string text;
+  for (int i = 0; i < 600; ++i) {
+    text += std::to_string(i + 1) + "\n00:" + std::to_string(10 + i % 50) +
+        ":01,000 --> 00:00:02,000\nLine " + std::to_string(i * seed % 997) +
+        " of the subtitle\n\n";
+  }
+  return text;
+}
+
+class NullSink : public ByteSink {
+ public:
+  void Write(const char* data, size_t size) { bench::DoNotOptimize(data); }
+};
+
+}  // namespace
+}  // namespace libsubtle
+
+int main() {
+  using libsubtle::bench::DoNotOptimize;
+  using libsubtle::bench::Measure;
+  using libsubtle::kIterations;
+  using libsubtle::kPayloads;
+
+  vector<string> payloads;
+  size_t compressed = 0;
+  for (int i = 0; i < kPayloads; ++i) {
+    payloads.push_back(libsubtle::Gzip(libsubtle::MakeSubtitle(i + 1)));
+    compressed += payloads.back().size();
+  }
+  printf("%d payloads, %zu compressed bytes on average\n", kPayloads,
+         compressed / kPayloads);
+
+  const libsubtle::InflaterBackend backends[] = {
+    libsubtle::INFLATER_ZLIB, libsubtle::INFLATER_ZLIB_NG,
+    libsubtle::INFLATER_LIBDEFLATE
+  };
+  for (libsubtle::InflaterBackend backend : backends) {
+    const libsubtle::Inflater* inflater = libsubtle::GetInflater(backend);
+    if (!inflater) {
+      continue;
+    }
+    {
+      Measure m(string(inflater->Name()) + " whole payload");
+      string out;
+      for (int i = 0; i < kIterations; ++i) {
+        for (const string& payload : payloads) {
+          out.clear();
+          inflater->Inflate(payload.data(), payload.size(), &out);
+          DoNotOptimize(out);
+        }
+      }
+      m.Report(kIterations * kPayloads);
+    }
+    {
+      Measure m(string(inflater->Name()) + " streaming sink");
+      libsubtle::NullSink null;
+      for (int i = 0; i < kIterations; ++i) {
+        for (const string& payload : payloads) {
+          std::unique_ptr<libsubtle::ByteSink> sink = inflater->NewSink(&null);
+          sink->Write(payload.data(), payload.size());
+          sink->Finish();
+        }
+      }
+      m.Report(kIterations * kPayloads);
+    }
+  }
+}
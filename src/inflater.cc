@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include "libsubtle_config.h"
+#include "src/gunzip.h"
+#include "src/inflater.h"
+#include "src/types.h"
+
+using std::string;
+
+namespace libsubtle {
+
+// defined by the optional backends' own translation units
+#ifdef SUBTLE_HAVE_ZLIB_NG
+const Inflater* ZlibNgBackend();
+#endif
+#ifdef SUBTLE_HAVE_LIBDEFLATE
+const Inflater* LibdeflateBackend();
+#endif
+
+namespace {
+
+// Appends a stream to a string.
+class AppendSink : public ByteSink {
+ public:
+  explicit AppendSink(string* out) : out_(out) {}
+  void Write(const char* data, size_t size) { out_->append(data, size); }
+
+ private:
+  string* out_;
+};
+
+// Collects a compressed payload for inflaters that need all of it at once.
+class WholePayloadSink : public ByteSink {
+ public:
+  WholePayloadSink(const Inflater* inflater, ByteSink* next)
+      : inflater_(inflater), next_(next) {}
+
+  void Write(const char* data, size_t size) {
+    compressed_.append(data, size);
+  }
+
+  void Finish() {
+    string inflated;
+    inflater_->Inflate(compressed_.data(), compressed_.size(), &inflated);
+    string().swap(compressed_);
+    // pass the output on in pieces, as the incremental inflaters do
+    const size_t chunk = GunzipSink::kDefaultChunkSize;
+    for (size_t i = 0; i < inflated.size(); i += chunk) {
+      next_->Write(inflated.data() + i, std::min(chunk, inflated.size() - i));
+    }
+    next_->Finish();
+  }
+
+ private:
+  const Inflater* inflater_;
+  ByteSink* next_;
+  string compressed_;
+};
+
+class ZlibInflater : public Inflater {
+ public:
+  const char* Name() const { return "zlib"; }
+
+  void Inflate(const char* data, size_t size, string* out) const {
+    AppendSink sink(out);
+    GunzipSink gunzip(&sink);
+    gunzip.Write(data, size);
+    gunzip.Finish();
+  }
+
+  std::unique_ptr<ByteSink> NewSink(ByteSink* next) const {
+    return std::unique_ptr<ByteSink>(new GunzipSink(next));
+  }
+};
+
+const ZlibInflater kZlib;
+
+// -1 until chosen, then an InflaterBackend
+std::atomic<int> default_backend(-1);
+
+InflaterBackend FastestBackend() {
+#if defined(SUBTLE_HAVE_LIBDEFLATE)
+  return INFLATER_LIBDEFLATE;
+#elif defined(SUBTLE_HAVE_ZLIB_NG)
+  return INFLATER_ZLIB_NG;
+#else
+  return INFLATER_ZLIB;
+#endif
+}
+
+}  // namespace
+
+std::unique_ptr<ByteSink> Inflater::NewSink(ByteSink* next) const {
+  return std::unique_ptr<ByteSink>(new WholePayloadSink(this, next));
+}
+
+bool ParseInflaterBackend(const string& name, InflaterBackend* backend) {
+  if (name == "zlib") {
+    *backend = INFLATER_ZLIB;
+  } else if (name == "zlib-ng") {
+    *backend = INFLATER_ZLIB_NG;
+  } else if (name == "libdeflate") {
+    *backend = INFLATER_LIBDEFLATE;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const Inflater* GetInflater(InflaterBackend backend) {
+  switch (backend) {
+    case INFLATER_ZLIB:
+      return &kZlib;
+#ifdef SUBTLE_HAVE_ZLIB_NG
+    case INFLATER_ZLIB_NG:
+      return ZlibNgBackend();
+#endif
+#ifdef SUBTLE_HAVE_LIBDEFLATE
+    case INFLATER_LIBDEFLATE:
+      return LibdeflateBackend();
+#endif
+    default:
+      return NULL;
+  }
+}
+
+const Inflater* DefaultInflater() {
+  int backend = default_backend.load(std::memory_order_relaxed);
+  if (backend < 0) {
+    InflaterBackend chosen = FastestBackend();
+    const char* name = getenv("SUBTLE_INFLATER");
+    InflaterBackend configured;
+    if (name && ParseInflaterBackend(name, &configured) &&
+        GetInflater(configured)) {
+      chosen = configured;
+    }
+    backend = chosen;
+    default_backend.store(backend, std::memory_order_relaxed);
+  }
+  return GetInflater(static_cast<InflaterBackend>(backend));
+}
+
+bool SetDefaultInflater(InflaterBackend backend) {
+  if (!GetInflater(backend)) {
+    return false;
+  }
+  default_backend.store(backend, std::memory_order_relaxed);
+  return true;
+}
+
+}  // namespace libsubtle
@@ -0,0 +1,66 @@
+#ifndef SRC_INFLATER_H_
+#define SRC_INFLATER_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "src/byte_sink.h"
+
+using std::string;
+
+namespace libsubtle {
+
+/// Most bytes a payload may inflate to when a backend inflates it whole in
+/// memory; larger payloads throw SubtleException rather than allocate.
+const size_t kMaxSubtitleSize = 64 * 1024 * 1024;
+
+/// Libraries subtitle payloads can be inflated with. Which ones are
+/// available is decided when building, see the SUBTLE_WITH_* CMake options.
+enum InflaterBackend {
+  INFLATER_ZLIB,
+  INFLATER_ZLIB_NG,
+  INFLATER_LIBDEFLATE
+};
+
+/// Decompresses gzip payloads, which may hold several members one after
+/// another. Implementations are thread-safe.
+class Inflater {
+ public:
+  virtual ~Inflater() {}
+
+  /// \return name of the backend, as accepted by ParseInflaterBackend.
+  virtual const char* Name() const = 0;
+
+  /// Inflate a whole payload held in memory.
+  /// Throws SubtleException on corrupt or truncated input.
+  /// \param data compressed bytes.
+  /// \param size number of compressed bytes.
+  /// \param out receives the inflated bytes, appended.
+  virtual void Inflate(const char* data, size_t size, string* out) const = 0;
+
+  /// \return a sink inflating the payload written to it into next. Backends
+  ///         without incremental decompression collect the compressed
+  ///         payload and inflate it when the sink is finished.
+  virtual std::unique_ptr<ByteSink> NewSink(ByteSink* next) const;
+};
+
+/// \return the backend with the given name: "zlib", "zlib-ng" or
+///         "libdeflate"; false if the name is not known.
+bool ParseInflaterBackend(const string& name, InflaterBackend* backend);
+
+/// \return the inflater of a backend, or NULL if it was not built in.
+const Inflater* GetInflater(InflaterBackend backend);
+
+/// \return the inflater used for downloads: the one set with
+///         SetDefaultInflater, else the one named by the SUBTLE_INFLATER
+///         environment variable, else the fastest one built in.
+const Inflater* DefaultInflater();
+
+/// Choose the inflater used for downloads.
+/// \return false if the backend was not built in.
+bool SetDefaultInflater(InflaterBackend backend);
+
+}  // namespace libsubtle
+
+#endif  // SRC_INFLATER_H_
@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/gzip_test_util.h"
+#include "src/inflater.h"
+#include "src/types.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+vector<const Inflater*> BuiltInInflaters() {
+  vector<const Inflater*> inflaters;
+  for (InflaterBackend backend :
+       {INFLATER_ZLIB, INFLATER_ZLIB_NG, INFLATER_LIBDEFLATE}) {
+    if (GetInflater(backend)) {
+      inflaters.push_back(GetInflater(backend));
+    }
+  }
+  return inflaters;
+}
+
+class CollectSink : public ByteSink {
+ public:
+  CollectSink() : finished_(false) {}
+  void Write(const char* data, size_t size) { text_.append(data, size); }
+  void Finish() { finished_ = true; }
+
+  string text_;
+  bool finished_;
+};
+
+TEST(Inflater, Backends) {
+  string text;
+  for (int i = 0; i < 30000; ++i) {
+    text += std::to_string(i) + "\n00:00:01,000 --> 00:00:02,000\nHello\n\n";
+  }
+  string payload = Gzip(text) + Gzip("and more");
+
+  ASSERT_NE(static_cast<const Inflater*>(NULL), GetInflater(INFLATER_ZLIB));
+  for (const Inflater* inflater : BuiltInInflaters()) {
+    string out = "kept ";
+    inflater->Inflate(payload.data(), payload.size(), &out);
+    ASSERT_EQ("kept " + text + "and more", out) << inflater->Name();
+
+    CollectSink collect;
+    std::unique_ptr<ByteSink> sink = inflater->NewSink(&collect);
+    for (size_t i = 0; i < payload.size(); i += 1000) {
+      sink->Write(payload.data() + i, std::min<size_t>(1000,
+                                                       payload.size() - i));
+    }
+    sink->Finish();
+    ASSERT_TRUE(collect.finished_);
+    ASSERT_EQ(text + "and more", collect.text_) << inflater->Name();
+
+    string truncated = payload.substr(0, payload.size() / 2);
+    ASSERT_THROW(inflater->Inflate(truncated.data(), truncated.size(), &out),
+                 SubtleException) << inflater->Name();
+  }
+}
+
+TEST(Inflater, SizeLimit) {
+  const Inflater* libdeflate = GetInflater(INFLATER_LIBDEFLATE);
+  if (!libdeflate) {
+    return;
+  }
+  string out;
+  string bomb = Gzip(string(kMaxSubtitleSize + 1, '\0'));
+  ASSERT_THROW(libdeflate->Inflate(bomb.data(), bomb.size(), &out),
+               SubtleException);
+  ASSERT_TRUE(out.empty());
+
+  // a trailer claiming 4 GiB is not taken at its word
+  string forged = Gzip("Hello");
+  forged.replace(forged.size() - 4, 4, 4, '\xff');
+  ASSERT_THROW(libdeflate->Inflate(forged.data(), forged.size(), &out),
+               SubtleException);
+  ASSERT_LT(out.capacity(), 2 * kMaxSubtitleSize);
+}
+
+TEST(Inflater, Configuration) {
+  InflaterBackend backend;
+  ASSERT_TRUE(ParseInflaterBackend("libdeflate", &backend));
+  ASSERT_EQ(INFLATER_LIBDEFLATE, backend);
+  ASSERT_FALSE(ParseInflaterBackend("lzma", &backend));
+
+  ASSERT_TRUE(SetDefaultInflater(INFLATER_ZLIB));
+  ASSERT_STREQ("zlib", DefaultInflater()->Name());
+  for (InflaterBackend other : {INFLATER_ZLIB_NG, INFLATER_LIBDEFLATE}) {
+    ASSERT_EQ(GetInflater(other) != NULL, SetDefaultInflater(other));
+  }
+}
+
+}  // namespace libsubtle
@@ -0,0 +1,106 @@
+#include <zlib-ng.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "src/inflater.h"
+#include "src/types.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+namespace {
+
+const size_t kChunkSize = 64 * 1024;
+
+// GunzipSink on top of zlib-ng's native API.
+class ZlibNgSink : public ByteSink {
+ public:
+  explicit ZlibNgSink(ByteSink* next)
+      : next_(next), chunk_(kChunkSize), member_end_(false) {
+    stream_ = zng_stream();
+    // 32 detects gzip and zlib headers
+    if (zng_inflateInit2(&stream_, 32 + MAX_WBITS) != Z_OK) {
+      throw SubtleException("Cannot initialize zlib-ng.");
+    }
+  }
+  ~ZlibNgSink() { zng_inflateEnd(&stream_); }
+
+  void Write(const char* data, size_t size) {
+    stream_.next_in = reinterpret_cast<const uint8_t*>(data);
+    stream_.avail_in = static_cast<uint32_t>(size);
+    do {
+      if (member_end_) {
+        if (stream_.avail_in == 0) {
+          break;
+        }
+        zng_inflateReset(&stream_);
+        member_end_ = false;
+      }
+      stream_.next_out = reinterpret_cast<uint8_t*>(&chunk_[0]);
+      stream_.avail_out = static_cast<uint32_t>(chunk_.size());
+      int status = zng_inflate(&stream_, Z_NO_FLUSH);
+      if (status == Z_BUF_ERROR) {
+        break;
+      }
+      if (status != Z_OK && status != Z_STREAM_END) {
+        throw SubtleException(string("Corrupt compressed data: ") +
+                              (stream_.msg ? stream_.msg : "unknown error"));
+      }
+      if (stream_.avail_out < chunk_.size()) {
+        next_->Write(&chunk_[0], chunk_.size() - stream_.avail_out);
+      }
+      member_end_ = status == Z_STREAM_END;
+    } while (stream_.avail_in > 0 || stream_.avail_out == 0);
+  }
+
+  void Finish() {
+    if (!member_end_) {
+      throw SubtleException("Corrupt compressed data: truncated");
+    }
+    next_->Finish();
+  }
+
+ private:
+  ByteSink* next_;
+  zng_stream stream_;
+  vector<char> chunk_;
+  bool member_end_;
+};
+
+class AppendSink : public ByteSink {
+ public:
+  explicit AppendSink(string* out) : out_(out) {}
+  void Write(const char* data, size_t size) { out_->append(data, size); }
+
+ private:
+  string* out_;
+};
+
+class ZlibNgInflater : public Inflater {
+ public:
+  const char* Name() const { return "zlib-ng"; }
+
+  void Inflate(const char* data, size_t size, string* out) const {
+    AppendSink sink(out);
+    ZlibNgSink inflate(&sink);
+    inflate.Write(data, size);
+    inflate.Finish();
+  }
+
+  std::unique_ptr<ByteSink> NewSink(ByteSink* next) const {
+    return std::unique_ptr<ByteSink>(new ZlibNgSink(next));
+  }
+};
+
+}  // namespace
+
+const Inflater* ZlibNgBackend() {
+  static const ZlibNgInflater inflater;
+  return &inflater;
+}
+
+}  // namespace libsubtle
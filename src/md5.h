@@ -1,27 +1,50 @@
 #ifndef SRC_MD5_H_
 #define SRC_MD5_H_
 
-#include <openssl/md5.h>
-
+#include <cinttypes>
+#include <cstddef>
 #include <string>
 
 using std::string;
 
 namespace libsubtle {
 
-string md5(const string& data) const {
-  unsigned char digest[MD5_DIGEST_LENGTH];
+/// Streaming MD5 (RFC 1321), the hash the service identifies subtitle files
+/// by (SubHash).
+class Md5 {
+ public:
+  static const size_t kDigestSize = 16;
+
+  Md5();
+
+  /// Hash the next piece of the input.
+  void Update(const void* data, size_t size);
+
+  /// Finish the hash and start over.
+  /// \param digest receives the kDigestSize bytes of the hash.
+  void Final(uint8_t* digest);
+
+  /// Finish the hash and start over.
+  /// \return the hash as 32 lower case hex digits.
+  string HexDigest();
 
-  MD5((unsigned char*)&data.c_str(), data.lengt(), (unsigned char*)&digest);
+ private:
+  void Reset();
+  void Transform(const uint8_t* block);
 
-  char mdString[33];
+  uint32_t state_[4];
+  // bytes hashed so far
+  uint64_t length_;
+  uint8_t buffer_[64];
+};
 
-  for (int i = 0; i < 16; i++)
-    snprintf(&mdString[i*2], sizeof(&mdString[i*2]), "%02x",
-        (unsigned int)digest[i]);
+/// \return MD5 of data as lower case hex.
+string Md5Hex(const string& data);
 
-  return mdString;
-}
+/// Hash a file in one pass, without holding it in memory.
+/// \param hex out parameter with the MD5 as lower case hex.
+/// \return false if the file cannot be read.
+bool Md5File(const string& path, string* hex);
 
 }  // namespace libsubtle
 
@@ -0,0 +1,53 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "src/md5.h"
+
+using std::string;
+
+namespace libsubtle {
+
+TEST(Md5, Rfc1321) {
+  ASSERT_EQ("d41d8cd98f00b204e9800998ecf8427e", Md5Hex(""));
+  ASSERT_EQ("0cc175b9c0f1b6a831c399e269772661", Md5Hex("a"));
+  ASSERT_EQ("900150983cd24fb0d6963f7d28e17f72", Md5Hex("abc"));
+  ASSERT_EQ("f96b697d7cb7938d525a2f31aaf161d0", Md5Hex("message digest"));
+  ASSERT_EQ("c3fcd3d76192e4007dfb496cca67e13b",
+            Md5Hex("abcdefghijklmnopqrstuvwxyz"));
+  ASSERT_EQ("57edf4a22be3c955ac49da2e2107b67a",
+            Md5Hex("1234567890123456789012345678901234567890"
+                   "1234567890123456789012345678901234567890"));
+}
+
+TEST(Md5, Streaming) {
+  string data;
+  for (int i = 0; i < 10000; ++i) {
+    data += std::to_string(i * 7919);
+  }
+  string whole = Md5Hex(data);
+  for (size_t piece : {1, 3, 63, 64, 65, 1000}) {
+    Md5 md5;
+    for (size_t i = 0; i < data.size(); i += piece) {
+      md5.Update(data.data() + i, std::min(piece, data.size() - i));
+    }
+    ASSERT_EQ(whole, md5.HexDigest()) << piece;
+  }
+
+  char path[] = "/tmp/md5_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(static_cast<ssize_t>(data.size()),
+            write(fd, data.data(), data.size()));
+  close(fd);
+  string hex;
+  ASSERT_TRUE(Md5File(path, &hex));
+  ASSERT_EQ(whole, hex);
+  unlink(path);
+  ASSERT_FALSE(Md5File(path, &hex));
+}
+
+}  // namespace libsubtle
@@ -0,0 +1,294 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "src/metrics.h"
+#include "src/types.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+namespace metrics {
+
+namespace {
+
+string Number(double value) {
+  char text[32];
+  snprintf(text, sizeof(text), "%.9g", value);
+  return text;
+}
+
+// \return the name and labels of one sample, e.g. name{a="b",le="1"}.
+string Sample(const string& name, const string& labels,
+              const string& extra = "") {
+  if (labels.empty() && extra.empty()) {
+    return name;
+  }
+  return name + "{" + labels + (labels.empty() || extra.empty() ? "" : ",") +
+      extra + "}";
+}
+
+// Help text may not hold line breaks or unescaped backslashes.
+string EscapeHelp(const string& help) {
+  string escaped;
+  for (char c : help) {
+    if (c == '\\') {
+      escaped += "\\\\";
+    } else if (c == '\n') {
+      escaped += "\\n";
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+}  // namespace
+
+Histogram::Histogram(const vector<double>& bounds)
+    : bounds_(bounds),
+      counts_(new std::atomic<uint64_t>[bounds.size() + 1]),
+      count_(0),
+      sum_(0) {
+  std::sort(bounds_.begin(), bounds_.end());
+  for (size_t i = 0; i <= bounds_.size(); ++i) {
+    counts_[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+void Histogram::Observe(double value) {
+  size_t bucket = std::lower_bound(bounds_.begin(), bounds_.end(), value) -
+      bounds_.begin();
+  counts_[bucket].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  double sum = sum_.load(std::memory_order_relaxed);
+  while (!sum_.compare_exchange_weak(sum, sum + value,
+                                     std::memory_order_relaxed)) {
+  }
+}
+
+vector<double> LatencyBounds() {
+  return {0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+}
+
+string Labels(std::initializer_list<std::pair<string, string>> labels) {
+  string text;
+  for (const std::pair<string, string>& label : labels) {
+    if (!text.empty()) {
+      text += ',';
+    }
+    text += label.first + "=\"";
+    for (char c : label.second) {
+      if (c == '\\' || c == '"') {
+        text += '\\';
+        text += c;
+      } else if (c == '\n') {
+        text += "\\n";
+      } else {
+        text += c;
+      }
+    }
+    text += '"';
+  }
+  return text;
+}
+
+Registry* Registry::Default() {
+  // never destroyed, as threads may update metrics after static destructors
+  // ran
+  static Registry* registry = new Registry;
+  return registry;
+}
+
+Registry::Family* Registry::GetFamily(const string& name, const string& help,
+                                      const string& type) {
+  std::map<string, Family>::iterator found = families_.find(name);
+  if (found == families_.end()) {
+    Family& family = families_[name];
+    family.help = help;
+    family.type = type;
+    return &family;
+  }
+  if (found->second.type != type) {
+    throw SubtleException("Metric " + name + " is a " + found->second.type +
+                          ", not a " + type);
+  }
+  return &found->second;
+}
+
+Counter* Registry::GetCounter(const string& name, const string& help,
+                              const string& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::unique_ptr<Counter>& counter =
+      GetFamily(name, help, "counter")->counters[labels];
+  if (!counter) {
+    counter.reset(new Counter);
+  }
+  return counter.get();
+}
+
+Gauge* Registry::GetGauge(const string& name, const string& help,
+                          const string& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::unique_ptr<Gauge>& gauge =
+      GetFamily(name, help, "gauge")->gauges[labels];
+  if (!gauge) {
+    gauge.reset(new Gauge);
+  }
+  return gauge.get();
+}
+
+Histogram* Registry::GetHistogram(const string& name, const string& help,
+                                  const vector<double>& bounds,
+                                  const string& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::unique_ptr<Histogram>& histogram =
+      GetFamily(name, help, "histogram")->histograms[labels];
+  if (!histogram) {
+    histogram.reset(new Histogram(bounds));
+  }
+  return histogram.get();
+}
+
+void Registry::Write(std::ostream& out) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const std::pair<const string, Family>& entry : families_) {
+    const string& name = entry.first;
+    const Family& family = entry.second;
+    out << "# HELP " << name << " " << EscapeHelp(family.help) << "\n"
+        << "# TYPE " << name << " " << family.type << "\n";
+    for (const auto& counter : family.counters) {
+      out << Sample(name, counter.first) << " " << counter.second->value()
+          << "\n";
+    }
+    for (const auto& gauge : family.gauges) {
+      out << Sample(name, gauge.first) << " " << gauge.second->value()
+          << "\n";
+    }
+    for (const auto& histogram_entry : family.histograms) {
+      const string& labels = histogram_entry.first;
+      const Histogram& histogram = *histogram_entry.second;
+      // buckets count the values at or below their bound, cumulatively
+      uint64_t cumulative = 0;
+      for (size_t i = 0; i < histogram.bounds().size(); ++i) {
+        cumulative += histogram.bucket(i);
+        out << Sample(name + "_bucket", labels,
+                      "le=\"" + Number(histogram.bounds()[i]) + "\"")
+            << " " << cumulative << "\n";
+      }
+      cumulative += histogram.bucket(histogram.bounds().size());
+      out << Sample(name + "_bucket", labels, "le=\"+Inf\"") << " "
+          << cumulative << "\n"
+          << Sample(name + "_sum", labels) << " " << Number(histogram.sum())
+          << "\n"
+          << Sample(name + "_count", labels) << " " << cumulative << "\n";
+    }
+  }
+}
+
+void Registry::WriteTextfile(const string& path) const {
+  size_t slash = path.rfind('/');
+  size_t name = slash == string::npos ? 0 : slash + 1;
+  // hidden and without the .prom extension, so the collector skips it; in
+  // the same directory so the rename cannot cross filesystems
+  string temp = path.substr(0, name) + "." + path.substr(name) + ".tmp." +
+      std::to_string(getpid());
+  {
+    std::ofstream out(temp.c_str());
+    Write(out);
+    out.close();
+    if (!out) {
+      int error = errno;
+      remove(temp.c_str());
+      throw SubtleException("Cannot write " + temp + ": " + strerror(error));
+    }
+  }
+  if (rename(temp.c_str(), path.c_str()) != 0) {
+    int error = errno;
+    remove(temp.c_str());
+    throw SubtleException("Cannot write " + path + ": " + strerror(error));
+  }
+}
+
+const LibraryMetrics& Library() {
+  static const LibraryMetrics library = [] {
+    Registry* registry = Registry::Default();
+    const char* queue_help = "Items waiting in a queue.";
+    LibraryMetrics metrics;
+    metrics.files_scanned = registry->GetCounter(
+        "subtle_files_scanned_total", "Video and subtitle files looked at.");
+    metrics.files_hashed = registry->GetCounter(
+        "subtle_files_hashed_total", "Files hashed.");
+    metrics.store_hits = registry->GetCounter(
+        "subtle_store_lookups_total", "Lookups in the subtitle store.",
+        Labels({{"result", "hit"}}));
+    metrics.store_misses = registry->GetCounter(
+        "subtle_store_lookups_total", "Lookups in the subtitle store.",
+        Labels({{"result", "miss"}}));
+    metrics.download_bytes = registry->GetCounter(
+        "subtle_download_bytes_total", "Base64 subtitle data received.");
+    metrics.decode_bytes = registry->GetCounter(
+        "subtle_decode_bytes_total", "Base64 subtitle data decoded.");
+    metrics.decode_seconds = registry->GetHistogram(
+        "subtle_decode_seconds", "Time taken to decode one subtitle.",
+        {0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1});
+    metrics.hash_queue = registry->GetGauge(
+        "subtle_queue_depth", queue_help, Labels({{"queue", "hash"}}));
+    metrics.search_queue = registry->GetGauge(
+        "subtle_queue_depth", queue_help, Labels({{"queue", "search"}}));
+    metrics.download_queue = registry->GetGauge(
+        "subtle_queue_depth", queue_help, Labels({{"queue", "download"}}));
+    metrics.decode_queue = registry->GetGauge(
+        "subtle_queue_depth", queue_help, Labels({{"queue", "decode"}}));
+    return metrics;
+  }();
+  return library;
+}
+
+TextfileWriter::TextfileWriter(const Registry* registry, const string& path,
+                               std::chrono::milliseconds interval)
+    : registry_(registry),
+      path_(path),
+      interval_(interval),
+      stop_(false),
+      thread_(&TextfileWriter::Run, this) {}
+
+TextfileWriter::~TextfileWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  stop_signal_.notify_all();
+  thread_.join();
+  WriteOnce();
+}
+
+void TextfileWriter::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stop_signal_.wait_for(lock, interval_, [this] { return stop_; })) {
+    lock.unlock();
+    WriteOnce();
+    lock.lock();
+  }
+}
+
+void TextfileWriter::WriteOnce() {
+  try {
+    registry_->WriteTextfile(path_);
+  } catch (const SubtleException&) {
+  }
+}
+
+}  // namespace metrics
+}  // namespace libsubtle
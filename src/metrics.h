@@ -0,0 +1,202 @@
+#ifndef SRC_METRICS_H_
+#define SRC_METRICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <condition_variable>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+namespace metrics {
+
+/// Count that only goes up. Updates are relaxed atomic additions, cheap
+/// enough for hot paths.
+class Counter {
+ public:
+  Counter() : value_(0) {}
+  void Add(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+  uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  Counter(const Counter&);
+  void operator=(const Counter&);
+
+  std::atomic<uint64_t> value_;
+};
+
+/// Value that goes up and down, such as the length of a queue.
+class Gauge {
+ public:
+  Gauge() : value_(0) {}
+  void Add(int64_t n) { value_.fetch_add(n, std::memory_order_relaxed); }
+  void Set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+  int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  Gauge(const Gauge&);
+  void operator=(const Gauge&);
+
+  std::atomic<int64_t> value_;
+};
+
+/// Distribution of values over fixed buckets, as in a Prometheus histogram.
+class Histogram {
+ public:
+  /// \param bounds upper bounds of the buckets, ascending; values above the
+  ///        last one count in a bucket of their own.
+  explicit Histogram(const vector<double>& bounds);
+
+  void Observe(double value);
+
+  const vector<double>& bounds() const { return bounds_; }
+  /// \return values observed in bucket i, the one above the last bound
+  ///         included, not those of the buckets below.
+  uint64_t bucket(size_t i) const {
+    return counts_[i].load(std::memory_order_relaxed);
+  }
+  uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+  double sum() const { return sum_.load(std::memory_order_relaxed); }
+
+ private:
+  Histogram(const Histogram&);
+  void operator=(const Histogram&);
+
+  vector<double> bounds_;
+  std::unique_ptr<std::atomic<uint64_t>[]> counts_;
+  std::atomic<uint64_t> count_;
+  std::atomic<double> sum_;
+};
+
+/// \return bounds for latencies in seconds, from 5 ms to 10 s.
+vector<double> LatencyBounds();
+
+/// \return labels in the exposition format, e.g. method="LogIn",status="200".
+string Labels(std::initializer_list<std::pair<string, string>> labels);
+
+/// Named metrics, written out in the Prometheus text exposition format.
+///
+/// Metrics are created on first use and live as long as the registry. The
+/// lookups lock the registry; hot paths look their metrics up once and keep
+/// the pointers.
+class Registry {
+ public:
+  Registry() {}
+
+  /// \return the registry the library keeps its own metrics in.
+  static Registry* Default();
+
+  /// \param name of the metric, e.g. "subtle_files_hashed_total".
+  /// \param help one line describing it, from the first lookup of the name.
+  /// \param labels telling apart metrics of one name, as made by Labels.
+  /// \return the counter; throws SubtleException if the name is taken by
+  ///         another type of metric.
+  Counter* GetCounter(const string& name, const string& help,
+                      const string& labels = "");
+  /// As GetCounter, for a gauge.
+  Gauge* GetGauge(const string& name, const string& help,
+                  const string& labels = "");
+  /// As GetCounter, for a histogram.
+  /// \param bounds of the buckets, for the first lookup of the name with
+  ///        the labels.
+  Histogram* GetHistogram(const string& name, const string& help,
+                          const vector<double>& bounds,
+                          const string& labels = "");
+
+  /// Write every metric in the text exposition format.
+  void Write(std::ostream& out) const;
+
+  /// Write every metric to a file for the textfile collector of
+  /// node_exporter. The file is written under a temporary name and renamed
+  /// over the old one, so the collector never reads half of it. Throws
+  /// SubtleException when the file cannot be written.
+  void WriteTextfile(const string& path) const;
+
+ private:
+  Registry(const Registry&);
+  void operator=(const Registry&);
+
+  // metrics of one name, by labels; only the maps of its type are used
+  struct Family {
+    string help;
+    string type;
+    std::map<string, std::unique_ptr<Counter>> counters;
+    std::map<string, std::unique_ptr<Gauge>> gauges;
+    std::map<string, std::unique_ptr<Histogram>> histograms;
+  };
+
+  Family* GetFamily(const string& name, const string& help,
+                    const string& type);
+
+  mutable std::mutex mutex_;
+  std::map<string, Family> families_;
+};
+
+/// Metrics the library itself keeps up to date, in Registry::Default().
+struct LibraryMetrics {
+  /// Video and subtitle files looked at.
+  Counter* files_scanned;
+  /// Files hashed, for searching or for checking subtitles.
+  Counter* files_hashed;
+  /// Subtitles found in, or missing from, the local SubtitleStore.
+  Counter* store_hits;
+  Counter* store_misses;
+  /// Base64 subtitle data received.
+  Counter* download_bytes;
+  /// Base64 subtitle data decoded to disk by DecodePool, and how long each
+  /// subtitle took.
+  Counter* decode_bytes;
+  Histogram* decode_seconds;
+  /// Items waiting in the queues of DownloadForVideos and DecodePool.
+  Gauge* hash_queue;
+  Gauge* search_queue;
+  Gauge* download_queue;
+  Gauge* decode_queue;
+};
+
+/// \return the metrics of the library.
+const LibraryMetrics& Library();
+
+/// Writes a registry to a textfile periodically from a thread of its own,
+/// and once more when destroyed, for processes that keep running.
+class TextfileWriter {
+ public:
+  /// \param registry to write; not owned.
+  /// \param path of the file, see Registry::WriteTextfile.
+  /// \param interval between writes.
+  TextfileWriter(const Registry* registry, const string& path,
+                 std::chrono::milliseconds interval);
+  ~TextfileWriter();
+
+ private:
+  TextfileWriter(const TextfileWriter&);
+  void operator=(const TextfileWriter&);
+
+  void Run();
+  // a failed write is retried on the next round
+  void WriteOnce();
+
+  const Registry* registry_;
+  string path_;
+  std::chrono::milliseconds interval_;
+  std::mutex mutex_;
+  std::condition_variable stop_signal_;
+  bool stop_;
+  std::thread thread_;
+};
+
+}  // namespace metrics
+}  // namespace libsubtle
+
+#endif  // SRC_METRICS_H_
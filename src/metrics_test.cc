@@ -0,0 +1,131 @@
+#include <unistd.h>
+
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/metrics.h"
+#include "src/rpc_stats.h"
+#include "src/types.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+string WriteMetrics(const metrics::Registry& registry) {
+  std::ostringstream out;
+  registry.Write(out);
+  return out.str();
+}
+
+TEST(Metrics, Write) {
+  metrics::Registry registry;
+  metrics::Counter* hits = registry.GetCounter(
+      "test_lookups_total", "Lookups.", metrics::Labels({{"result", "hit"}}));
+  ASSERT_EQ(hits, registry.GetCounter("test_lookups_total", "Lookups.",
+                                      metrics::Labels({{"result", "hit"}})));
+  hits->Add(3);
+  registry.GetGauge("test_depth", "Depth.")->Set(-2);
+  metrics::Histogram* latency = registry.GetHistogram(
+      "test_seconds", "Latency.", {0.1, 1},
+      metrics::Labels({{"method", "a\"b"}}));
+  latency->Observe(0.05);
+  latency->Observe(0.1);
+  latency->Observe(5);
+  ASSERT_THROW(registry.GetGauge("test_lookups_total", "Lookups."),
+               SubtleException);
+
+  string text = WriteMetrics(registry);
+  ASSERT_NE(string::npos, text.find(
+      "# HELP test_lookups_total Lookups.\n"
+      "# TYPE test_lookups_total counter\n"
+      "test_lookups_total{result=\"hit\"} 3\n"));
+  ASSERT_NE(string::npos, text.find("test_depth -2\n"));
+  ASSERT_NE(string::npos, text.find(
+      "# TYPE test_seconds histogram\n"
+      "test_seconds_bucket{method=\"a\\\"b\",le=\"0.1\"} 2\n"
+      "test_seconds_bucket{method=\"a\\\"b\",le=\"1\"} 2\n"
+      "test_seconds_bucket{method=\"a\\\"b\",le=\"+Inf\"} 3\n"
+      "test_seconds_sum{method=\"a\\\"b\"} 5.15\n"
+      "test_seconds_count{method=\"a\\\"b\"} 3\n"));
+}
+
+TEST(Metrics, Threads) {
+  metrics::Registry registry;
+  metrics::Counter* counter = registry.GetCounter("test_total", "Test.");
+  metrics::Histogram* histogram =
+      registry.GetHistogram("test_seconds", "Test.", {1});
+  vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.push_back(std::thread([counter, histogram] {
+      for (int i = 0; i < 10000; ++i) {
+        counter->Add();
+        histogram->Observe(0.5);
+      }
+    }));
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(40000u, counter->value());
+  ASSERT_EQ(40000u, histogram->count());
+  ASSERT_DOUBLE_EQ(20000, histogram->sum());
+}
+
+TEST(Metrics, Textfile) {
+  metrics::Registry registry;
+  registry.GetCounter("test_total", "Test.")->Add();
+  string path = "/tmp/metrics_test." + std::to_string(getpid()) + ".prom";
+  {
+    metrics::TextfileWriter writer(&registry, path,
+                                   std::chrono::milliseconds(10));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    registry.GetCounter("test_total", "Test.")->Add();
+  }
+  std::ifstream file(path.c_str());
+  std::stringstream text;
+  text << file.rdbuf();
+  ASSERT_EQ(WriteMetrics(registry), text.str());
+  ASSERT_NE(string::npos, text.str().find("test_total 2\n"));
+  remove(path.c_str());
+
+  ASSERT_THROW(registry.WriteTextfile("/nonexistent/test.prom"),
+               SubtleException);
+}
+
+TEST(RpcMetrics, Calls) {
+  metrics::Registry registry;
+  RpcStats stats;
+  RpcMetrics rpc_metrics(&registry, &stats);
+  RpcCallStats call;
+  call.method = "LogIn";
+  call.status = 200;
+  call.failed = false;
+  call.transfer = TransferStats();
+  call.transfer.request_bytes = 100;
+  call.transfer.response_bytes = 400;
+  call.parse = 0;
+  call.total = 0.02;
+  rpc_metrics.OnCall(call);
+  call.status = 0;
+  call.failed = true;
+  rpc_metrics.OnCall(call);
+
+  string text = WriteMetrics(registry);
+  ASSERT_NE(string::npos, text.find(
+      "subtle_rpc_calls_total{method=\"LogIn\",status=\"200\"} 1\n"));
+  ASSERT_NE(string::npos, text.find(
+      "subtle_rpc_calls_total{method=\"LogIn\",status=\"error\"} 1\n"));
+  ASSERT_NE(string::npos, text.find(
+      "subtle_rpc_duration_seconds_bucket{method=\"LogIn\",le=\"0.025\"} 2\n"));
+  ASSERT_NE(string::npos, text.find(
+      "subtle_rpc_response_bytes_total{method=\"LogIn\"} 800\n"));
+  ASSERT_EQ(2u, stats.Snapshot()["LogIn"].calls);
+}
+
+}  // namespace libsubtle
@@ -0,0 +1,92 @@
+// Serves a MockOpenSubtitles on loopback until interrupted, to run the
+// library, the example or rpc_bench against offline:
+//
+//   mock_opensubtitles --port=8080 --latency_ms=50 --error_rate=0.01
+//
+// Prints the URL to point clients at, and the calls answered on exit.
+
+#include <signal.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "src/mock_server.h"
+#include "src/mock_service.h"
+#include "src/types.h"
+
+using std::string;
+
+namespace {
+
+void Usage(const char* program) {
+  fprintf(stderr,
+          "usage: %s [--port=N] [--latency_ms=N] [--jitter_ms=N]\n"
+          "    [--error_rate=F] [--fault_rate=F] [--max_calls_per_second=N]\n"
+          "    [--results=N] [--cues=N] [--seed=N]\n", program);
+  exit(2);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  libsubtle::MockServiceOptions options;
+  int port = 0;
+  for (int i = 1; i < argc; ++i) {
+    const char* value = strchr(argv[i], '=');
+    if (strncmp(argv[i], "--", 2) || !value) {
+      Usage(argv[0]);
+    }
+    string flag(argv[i] + 2, value - argv[i] - 2);
+    ++value;
+    if (flag == "port") {
+      port = atoi(value);
+    } else if (flag == "latency_ms") {
+      options.latency = std::chrono::milliseconds(atoi(value));
+    } else if (flag == "jitter_ms") {
+      options.jitter = std::chrono::milliseconds(atoi(value));
+    } else if (flag == "error_rate") {
+      options.error_rate = atof(value);
+    } else if (flag == "fault_rate") {
+      options.fault_rate = atof(value);
+    } else if (flag == "max_calls_per_second") {
+      options.max_calls_per_second = atoi(value);
+    } else if (flag == "results") {
+      options.results_per_search = atoi(value);
+    } else if (flag == "cues") {
+      options.subtitle_cues = atoi(value);
+    } else if (flag == "seed") {
+      options.seed = strtoul(value, NULL, 10);
+    } else {
+      Usage(argv[0]);
+    }
+  }
+
+  // the server threads inherit the mask, so only sigwait sees the signals
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+  libsubtle::MockOpenSubtitles service(options);
+  try {
+    libsubtle::MockServer server(
+        [&service](const string& request, int* status) {
+          return service.Respond(request, status);
+        }, port);
+    printf("%s\n", server.url().c_str());
+    fflush(stdout);
+
+    int signal;
+    sigwait(&signals, &signal);
+    fprintf(stderr, "answered %d requests on %d connections\n",
+            server.requests(), server.connections());
+  } catch (const libsubtle::SubtleException& e) {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,212 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "src/mock_server.h"
+#include "src/types.h"
+
+using std::string;
+
+namespace libsubtle {
+
+namespace {
+
+bool SendAll(int fd, const string& data) {
+  for (size_t sent = 0; sent < data.size();) {
+    ssize_t size = send(fd, data.data() + sent, data.size() - sent,
+                        MSG_NOSIGNAL);
+    if (size < 0 && errno == EINTR) {
+      continue;
+    }
+    if (size <= 0) {
+      return false;
+    }
+    sent += size;
+  }
+  return true;
+}
+
+// \return value of a header, matched case-insensitively, or "".
+string Header(const string& headers, const string& name) {
+  for (size_t line = 0; line < headers.size();) {
+    size_t end = headers.find("\r\n", line);
+    if (end == string::npos) {
+      end = headers.size();
+    }
+    size_t colon = headers.find(':', line);
+    if (colon < end && colon - line == name.size() &&
+        strncasecmp(headers.c_str() + line, name.c_str(), name.size()) == 0) {
+      size_t value = headers.find_first_not_of(' ', colon + 1);
+      return headers.substr(value, end - value);
+    }
+    line = end + 2;
+  }
+  return "";
+}
+
+const char* StatusText(int status) {
+  switch (status) {
+    case 200:
+      return "OK";
+    case 429:
+      return "Too Many Requests";
+    case 503:
+      return "Service Unavailable";
+    default:
+      return "Error";
+  }
+}
+
+}  // namespace
+
+MockServer::MockServer(const Handler& handler)
+    : handler_([handler](const string& request, int* status) {
+        return handler(request);
+      }),
+      listen_fd_(-1),
+      port_(0),
+      requests_(0),
+      connections_(0),
+      stop_(false) {
+  Listen(0);
+}
+
+MockServer::MockServer(const HttpHandler& handler, int port)
+    : handler_(handler),
+      listen_fd_(-1),
+      port_(0),
+      requests_(0),
+      connections_(0),
+      stop_(false) {
+  Listen(port);
+}
+
+void MockServer::Listen(int port) {
+  listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  sockaddr_in address = sockaddr_in();
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  socklen_t size = sizeof(address);
+  // a fixed port can be taken again right after a restart
+  int reuse = 1;
+  if (listen_fd_ < 0 ||
+      setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse,
+                 sizeof(reuse)) != 0 ||
+      bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), size) != 0 ||
+      listen(listen_fd_, 128) != 0 ||
+      getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&address),
+                  &size) != 0) {
+    int error = errno;
+    if (listen_fd_ >= 0) {
+      close(listen_fd_);
+    }
+    throw SubtleException(string("Cannot listen: ") + strerror(error));
+  }
+  port_ = ntohs(address.sin_port);
+  acceptor_ = std::thread(&MockServer::Accept, this);
+}
+
+MockServer::~MockServer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+    for (int fd : client_fds_) {
+      shutdown(fd, SHUT_RDWR);
+    }
+  }
+  shutdown(listen_fd_, SHUT_RDWR);
+  acceptor_.join();
+  close(listen_fd_);
+  // no more clients are added once the acceptor is gone
+  for (std::thread& client : clients_) {
+    client.join();
+  }
+}
+
+string MockServer::url() const {
+  return "http://127.0.0.1:" + std::to_string(port_) + "/xml-rpc";
+}
+
+void MockServer::Accept() {
+  for (;;) {
+    int fd = accept4(listen_fd_, NULL, NULL, SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stop_) {
+      close(fd);
+      return;
+    }
+    for (std::thread::id id : finished_) {
+      auto client = std::find_if(clients_.begin(), clients_.end(),
+                                 [id](const std::thread& thread) {
+        return thread.get_id() == id;
+      });
+      // it holds no lock past announcing it is done, so this is short
+      client->join();
+      clients_.erase(client);
+    }
+    finished_.clear();
+    ++connections_;
+    client_fds_.push_back(fd);
+    clients_.push_back(std::thread(&MockServer::Serve, this, fd));
+  }
+}
+
+void MockServer::Serve(int fd) {
+  Respond(fd);
+  std::lock_guard<std::mutex> lock(mutex_);
+  client_fds_.erase(std::find(client_fds_.begin(), client_fds_.end(), fd));
+  close(fd);
+  finished_.push_back(std::this_thread::get_id());
+}
+
+void MockServer::Respond(int fd) {
+  string buffer;
+  char chunk[16 * 1024];
+  for (;;) {
+    size_t header_end;
+    while ((header_end = buffer.find("\r\n\r\n")) == string::npos) {
+      ssize_t size = recv(fd, chunk, sizeof(chunk), 0);
+      if (size <= 0) {
+        return;
+      }
+      buffer.append(chunk, size);
+    }
+    string headers = buffer.substr(0, header_end + 2);
+    size_t length = strtoul(Header(headers, "Content-Length").c_str(), NULL,
+                            10);
+    size_t body_start = header_end + 4;
+    while (buffer.size() < body_start + length) {
+      ssize_t size = recv(fd, chunk, sizeof(chunk), 0);
+      if (size <= 0) {
+        return;
+      }
+      buffer.append(chunk, size);
+    }
+    int status = 200;
+    string body = handler_(buffer.substr(body_start, length), &status);
+    buffer.erase(0, body_start + length);
+    ++requests_;
+    if (!SendAll(fd, "HTTP/1.1 " + std::to_string(status) + " " +
+                     StatusText(status) + "\r\nContent-Type: text/xml\r\n"
+                     "Content-Length: " + std::to_string(body.size()) +
+                     "\r\n\r\n" + body)) {
+      return;
+    }
+  }
+}
+
+}  // namespace libsubtle
@@ -0,0 +1,71 @@
+#ifndef SRC_MOCK_SERVER_H_
+#define SRC_MOCK_SERVER_H_
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+/// Minimal HTTP/1.1 server on the loopback interface, standing in for the
+/// service in tests. Serves each connection on its own thread and keeps
+/// connections alive between requests; threads of closed connections are
+/// joined as new ones are accepted.
+class MockServer {
+ public:
+  /// \return body of the response to a request body.
+  typedef std::function<string(const string& request)> Handler;
+  /// As Handler, also choosing the HTTP status of the response.
+  /// \param status is 200 unless the handler sets another.
+  typedef std::function<string(const string& request, int* status)>
+      HttpHandler;
+
+  /// Listens on an ephemeral port. Throws SubtleException on failure.
+  explicit MockServer(const Handler& handler);
+  /// \param port to listen on; 0 for an ephemeral one.
+  MockServer(const HttpHandler& handler, int port);
+  /// Closes all connections.
+  ~MockServer();
+
+  /// \return URL to post calls to.
+  string url() const;
+
+  /// \return number of requests answered.
+  int requests() const { return requests_; }
+  /// \return number of connections accepted.
+  int connections() const { return connections_; }
+
+ private:
+  MockServer(const MockServer&);
+  void operator=(const MockServer&);
+
+  void Listen(int port);
+  void Accept();
+  void Serve(int fd);
+  // answers requests until the connection is closed
+  void Respond(int fd);
+
+  HttpHandler handler_;
+  int listen_fd_;
+  int port_;
+  std::atomic<int> requests_;
+  std::atomic<int> connections_;
+
+  std::mutex mutex_;
+  bool stop_;
+  vector<int> client_fds_;
+  vector<std::thread> clients_;
+  // threads of closed connections, joined by the next Accept
+  vector<std::thread::id> finished_;
+  std::thread acceptor_;
+};
+
+}  // namespace libsubtle
+
+#endif  // SRC_MOCK_SERVER_H_
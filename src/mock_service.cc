@@ -0,0 +1,727 @@
+#include <zlib.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/base64_codec.h"
+#include "src/gzip_test_util.h"
+#include "src/md5.h"
+#include "src/mock_service.h"
+#include "src/schema.h"
+#include "src/types.h"
+#include "src/xmlrpc_stream.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+namespace mock_detail {
+
+// A parameter of a call: the text of a scalar, or the items of an array or
+// of a struct.
+struct Value {
+  Value() : is_struct(false) {}
+
+  // \return item i, or an empty value if there are fewer.
+  const Value& operator[](size_t i) const {
+    static const Value kNone;
+    return i < items.size() ? items[i] : kNone;
+  }
+
+  // \return the member of a struct with a name, or an empty value.
+  const Value& Member(const string& name) const {
+    for (size_t i = 0; i < names.size(); ++i) {
+      if (names[i] == name) {
+        return items[i];
+      }
+    }
+    // past the last item, the empty value
+    return (*this)[items.size()];
+  }
+
+  string text;
+  bool is_struct;
+  vector<Value> items;
+  // names of the items of a struct
+  vector<string> names;
+};
+
+}  // namespace mock_detail
+
+using mock_detail::Value;
+
+namespace {
+
+// Collects the method name and parameters of a call, the parameters as the
+// items of one array.
+class CallReader : public XmlRpcHandler {
+ public:
+  explicit CallReader(Value* params) : stack_(1, params) {}
+
+  void OnMethodName(const string& name) { method_ = name; }
+  void OnStructBegin() {
+    stack_.push_back(Add());
+    stack_.back()->is_struct = true;
+  }
+  void OnStructEnd() { Pop(); }
+  void OnArrayBegin() { stack_.push_back(Add()); }
+  void OnArrayEnd() { Pop(); }
+  void OnMemberName(const string& name) { name_ = name; }
+  void OnScalar(ScalarType type, const string& text) { Add()->text = text; }
+
+  const string& method() const { return method_; }
+
+ private:
+  Value* Add() {
+    Value* parent = stack_.back();
+    if (parent->is_struct) {
+      parent->names.push_back(name_);
+    }
+    parent->items.push_back(Value());
+    return &parent->items.back();
+  }
+
+  void Pop() {
+    if (stack_.size() > 1) {
+      stack_.pop_back();
+    }
+  }
+
+  // values open, innermost last
+  vector<Value*> stack_;
+  string method_;
+  string name_;
+};
+
+// Building blocks of responses, each returning XML.
+
+string Escape(const string& text) {
+  string escaped;
+  escaped.reserve(text.size());
+  for (char c : text) {
+    if (c == '&') {
+      escaped += "&amp;";
+    } else if (c == '<') {
+      escaped += "&lt;";
+    } else if (c == '>') {
+      escaped += "&gt;";
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+string String(const string& text) {
+  return "<value><string>" + Escape(text) + "</string></value>";
+}
+
+string Int(int value) {
+  return "<value><int>" + std::to_string(value) + "</int></value>";
+}
+
+string Double(double value) {
+  char text[32];
+  snprintf(text, sizeof(text), "%.4f", value);
+  return string("<value><double>") + text + "</double></value>";
+}
+
+string Boolean(bool value) {
+  return string("<value><boolean>") + (value ? "1" : "0") +
+      "</boolean></value>";
+}
+
+string Member(const string& name, const string& value) {
+  return "<member><name>" + Escape(name) + "</name>" + value + "</member>";
+}
+
+string Struct(const string& members) {
+  return "<value><struct>" + members + "</struct></value>";
+}
+
+string Array(const string& values) {
+  return "<value><array><data>" + values + "</data></array></value>";
+}
+
+string Response(const string& value) {
+  return "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<methodResponse>"
+      "<params><param>" + value + "</param></params></methodResponse>\n";
+}
+
+string Fault(int code, const string& message) {
+  return "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<methodResponse>"
+      "<fault>" + Struct(Member("faultCode", Int(code)) +
+                         Member("faultString", String(message))) +
+      "</fault></methodResponse>\n";
+}
+
+// \return the usual struct of a response: a status, further members, and
+//         the time the service says it took.
+string Answer(const string& status, const string& members = "") {
+  return Response(Struct(Member("status", String(status)) + members +
+                         Member("seconds", Double(0.005))));
+}
+
+struct Language {
+  const char* id;
+  const char* name;
+  const char* iso639;
+};
+
+const Language kLanguages[] = {
+  {"eng", "English", "en"},
+  {"hrv", "Croatian", "hr"},
+  {"fre", "French", "fr"},
+  {"ger", "German", "de"},
+  {"spa", "Spanish", "es"},
+  {"ita", "Italian", "it"},
+  {"por", "Portuguese", "pt"},
+  {"dut", "Dutch", "nl"},
+  {"pol", "Polish", "pl"},
+  {"rus", "Russian", "ru"},
+  {"swe", "Swedish", "sv"},
+  {"cze", "Czech", "cs"}
+};
+
+const Language* FindLanguage(const string& id) {
+  for (const Language& language : kLanguages) {
+    if (id == language.id) {
+      return &language;
+    }
+  }
+  return NULL;
+}
+
+uint32_t HashOf(const string& text) {
+  return schema::Hash(text.data(), text.size());
+}
+
+// Movies are made up from whatever identifies them.
+int MovieId(const string& key) {
+  return HashOf(key) % 900000 + 100000;
+}
+
+string MovieName(int movie) {
+  return "Mock Movie " + std::to_string(movie);
+}
+
+// generated subtitle files kept before they are dropped and made again
+const size_t kMaxGenerated = 4096;
+
+}  // namespace
+
+MockOpenSubtitles::MockOpenSubtitles(const MockServiceOptions& options)
+    : options_(options),
+      random_(options.seed),
+      window_(std::chrono::steady_clock::now()),
+      window_calls_(0),
+      next_session_(0),
+      next_movie_(1000000) {}
+
+const std::map<string, MockOpenSubtitles::Method>&
+MockOpenSubtitles::Methods() {
+  static const std::map<string, Method> methods = {
+    {"LogIn", &MockOpenSubtitles::LogIn},
+    {"LogOut", &MockOpenSubtitles::LogOut},
+    {"NoOperation", &MockOpenSubtitles::NoOperation},
+    {"SearchSubtitles", &MockOpenSubtitles::SearchSubtitles},
+    {"SearchToMail", &MockOpenSubtitles::SearchToMail},
+    {"DownloadSubtitles", &MockOpenSubtitles::DownloadSubtitles},
+    {"ServerInfo", &MockOpenSubtitles::ServerInfo},
+    {"ReportWrongMovieHash", &MockOpenSubtitles::ReportWrongMovieHash},
+    {"SubtitlesVote", &MockOpenSubtitles::SubtitlesVote},
+    {"AddComment", &MockOpenSubtitles::AddComment},
+    {"CheckMovieHash", &MockOpenSubtitles::CheckMovieHash},
+    {"CheckSubHash", &MockOpenSubtitles::CheckSubHash},
+    {"GetSubLanguages", &MockOpenSubtitles::GetSubLanguages},
+    {"DetectLanguage", &MockOpenSubtitles::DetectLanguage},
+    {"GetAvailableTranslations",
+     &MockOpenSubtitles::GetAvailableTranslations},
+    {"GetTranslation", &MockOpenSubtitles::GetTranslation},
+    {"AutoUpdate", &MockOpenSubtitles::AutoUpdate},
+    {"SearchMoviesOnIMDB", &MockOpenSubtitles::SearchMoviesOnIMDB},
+    {"GetIMDBMovieDetails", &MockOpenSubtitles::GetIMDBMovieDetails},
+    {"InsertMovie", &MockOpenSubtitles::InsertMovie}
+  };
+  return methods;
+}
+
+string MockOpenSubtitles::Respond(const string& request, int* http_status) {
+  *http_status = 200;
+  if (Throttled()) {
+    *http_status = 429;
+    return "Too many requests\n";
+  }
+  Value params;
+  CallReader reader(&params);
+  XmlRpcStreamParser parser(&reader);
+  try {
+    parser.Feed(request.data(), request.size());
+    parser.Finish();
+  } catch (const SubtleException& e) {
+    return Fault(-32700, e.what());
+  }
+
+  string canned;
+  bool fault;
+  bool error;
+  std::chrono::microseconds delay = options_.latency;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++calls_[reader.method()];
+    std::map<string, string>::const_iterator found =
+        canned_.find(reader.method());
+    if (found != canned_.end()) {
+      canned = found->second;
+    }
+    // drawn for every call, so a seed repeats the same run
+    std::uniform_real_distribution<double> chance(0, 1);
+    fault = chance(random_) < options_.fault_rate;
+    error = chance(random_) < options_.error_rate;
+    std::chrono::microseconds jitter = options_.jitter;
+    if (jitter.count() > 0) {
+      delay += std::chrono::microseconds(
+          std::uniform_int_distribution<int64_t>(0, jitter.count())(random_));
+    }
+  }
+  if (delay.count() > 0) {
+    std::this_thread::sleep_for(delay);
+  }
+
+  if (!canned.empty()) {
+    return canned;
+  }
+  if (fault) {
+    return Fault(-32500, "Mock fault");
+  }
+  if (error) {
+    return Answer("503 Service Unavailable");
+  }
+  std::map<string, Method>::const_iterator method =
+      Methods().find(reader.method());
+  if (method == Methods().end()) {
+    return Fault(-32601, "Unknown method " + reader.method());
+  }
+  return (this->*method->second)(params);
+}
+
+void MockOpenSubtitles::SetResponse(const string& method, const string& xml) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  canned_[method] = xml;
+}
+
+void MockOpenSubtitles::ExpireSessions() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  sessions_.clear();
+}
+
+int MockOpenSubtitles::calls(const string& method) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<string, int>::const_iterator found = calls_.find(method);
+  return found == calls_.end() ? 0 : found->second;
+}
+
+string MockOpenSubtitles::SubtitleText(int id) const {
+  string text;
+  char cue[128];
+  for (int i = 1; i <= options_.subtitle_cues; ++i) {
+    int start = 3 * i;
+    int end = start + 2;
+    snprintf(cue, sizeof(cue),
+             "%d\n%02d:%02d:%02d,000 --> %02d:%02d:%02d,500\n"
+             "Line %d of subtitle %d\n\n",
+             i, start / 3600, start / 60 % 60, start % 60, end / 3600,
+             end / 60 % 60, end % 60, i, id);
+    text += cue;
+  }
+  return text;
+}
+
+bool MockOpenSubtitles::Throttled() {
+  if (options_.max_calls_per_second <= 0) {
+    return false;
+  }
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (now - window_ >= std::chrono::seconds(1)) {
+    window_ = now;
+    window_calls_ = 0;
+  }
+  return ++window_calls_ > options_.max_calls_per_second;
+}
+
+bool MockOpenSubtitles::Session(const Value& params, bool* user) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<string, bool>::const_iterator session =
+      sessions_.find(params[0].text);
+  if (session == sessions_.end()) {
+    return false;
+  }
+  *user = session->second;
+  return true;
+}
+
+std::shared_ptr<const MockOpenSubtitles::Subtitle> MockOpenSubtitles::Generate(
+    int id) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = subtitles_.find(id);
+    if (found != subtitles_.end()) {
+      return found->second;
+    }
+  }
+  // made unlocked, a few may be made twice
+  string text = SubtitleText(id);
+  std::shared_ptr<Subtitle> subtitle(new Subtitle);
+  subtitle->hash = Md5Hex(text);
+  subtitle->size = text.size();
+  subtitle->data = Base64Encode(Gzip(text, Z_DEFAULT_COMPRESSION));
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (subtitles_.size() >= kMaxGenerated) {
+    subtitles_.clear();
+  }
+  subtitles_[id] = subtitle;
+  sub_ids_[subtitle->hash] = id;
+  return subtitle;
+}
+
+string MockOpenSubtitles::LogIn(const Value& params) {
+  const string& username = params[0].text;
+  const string& password = params[1].text;
+  if (username.empty() != password.empty()) {
+    return Answer("401 Unauthorized");
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  string token = "mock" + std::to_string(++next_session_);
+  sessions_[token] = !username.empty();
+  return Answer("200 OK", Member("token", String(token)));
+}
+
+string MockOpenSubtitles::LogOut(const Value& params) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!sessions_.erase(params[0].text)) {
+    return Answer("406 No session");
+  }
+  return Answer("200 OK");
+}
+
+string MockOpenSubtitles::NoOperation(const Value& params) {
+  bool user;
+  return Answer(Session(params, &user) ? "200 OK" : "406 No session");
+}
+
+string MockOpenSubtitles::SearchSubtitles(const Value& params) {
+  bool user;
+  if (!Session(params, &user)) {
+    return Answer("406 No session");
+  }
+  string found;
+  for (const Value& query : params[1].items) {
+    const string& imdb_id = query.Member("imdbid").text;
+    const string& movie_hash = query.Member("moviehash").text;
+    string key = imdb_id.empty() ? movie_hash : "imdb" + imdb_id;
+    int movie = MovieId(key);
+    string imdb = imdb_id.empty() ? std::to_string(movie) : imdb_id;
+    char size[32];
+    snprintf(size, sizeof(size), "%.0f",
+             strtod(query.Member("moviebytesize").text.c_str(), NULL));
+    string languages = query.Member("sublanguageid").text;
+    if (languages.empty() || languages == "all") {
+      languages = "eng";
+    }
+    for (size_t begin = 0, end; begin <= languages.size(); begin = end + 1) {
+      end = languages.find(',', begin);
+      if (end == string::npos) {
+        end = languages.size();
+      }
+      const Language* language =
+          FindLanguage(languages.substr(begin, end - begin));
+      if (!language) {
+        continue;
+      }
+      for (int i = 0; i < options_.results_per_search; ++i) {
+        string file_key = key + "/" + language->id + "/" + std::to_string(i);
+        int id = HashOf(file_key) % 2000000000 + 1;
+        std::shared_ptr<const Subtitle> subtitle = Generate(id);
+        string id_text = std::to_string(id);
+        string name = MovieName(movie);
+        found += Struct(
+            Member("IDSubMovieFile", String(std::to_string(movie * 10))) +
+            Member("MovieHash", String(movie_hash)) +
+            Member("MovieByteSize", String(size)) +
+            Member("MovieTimeMS", String("0")) +
+            Member("IDSubtitleFile", String(id_text)) +
+            Member("SubFileName", String(name + "." + language->iso639 + "." +
+                                         std::to_string(i + 1) + ".srt")) +
+            Member("SubActualCD", String("1")) +
+            Member("SubSize", String(std::to_string(subtitle->size))) +
+            Member("SubHash", String(subtitle->hash)) +
+            Member("IDSubtitle", String(id_text)) +
+            Member("UserID", String("0")) +
+            Member("SubLanguageID", String(language->id)) +
+            Member("SubFormat", String("srt")) +
+            Member("SubSumCD", String("1")) +
+            Member("SubAuthorComment", String("")) +
+            Member("SubAddDate", String("2010-01-01 00:00:00")) +
+            Member("SubBad", String("0")) +
+            Member("SubRating", String("0.0")) +
+            Member("SubDownloadsCnt", String(std::to_string(100 - i))) +
+            Member("MovieReleaseName", String(name)) +
+            Member("IDMovie", String(std::to_string(movie))) +
+            Member("IDMovieImdb", String(imdb)) +
+            Member("MovieName", String(name)) +
+            Member("MovieNameEng", String("")) +
+            Member("MovieYear", String("2000")) +
+            Member("MovieImdbRating", String("7.0")) +
+            Member("UserNickName", String("")) +
+            Member("ISO639", String(language->iso639)) +
+            Member("LanguageName", String(language->name)) +
+            Member("SubDownloadLink", String(
+                "http://dl.opensubtitles.org/en/download/filead/" + id_text +
+                ".gz")) +
+            Member("ZipDownloadLink", String(
+                "http://dl.opensubtitles.org/en/download/subad/" + id_text)));
+      }
+    }
+  }
+  // the service sends false rather than an empty array
+  return Answer("200 OK", Member("data", found.empty() ? Boolean(false)
+                                                       : Array(found)));
+}
+
+string MockOpenSubtitles::SearchToMail(const Value& params) {
+  bool user;
+  if (!Session(params, &user)) {
+    return Answer("406 No session");
+  }
+  return Answer(user ? "200 OK" : "401 Unauthorized");
+}
+
+string MockOpenSubtitles::DownloadSubtitles(const Value& params) {
+  bool user;
+  if (!Session(params, &user)) {
+    return Answer("406 No session");
+  }
+  string files;
+  for (const Value& item : params[1].items) {
+    int id = atoi(item.text.c_str());
+    if (id > 0) {
+      files += Struct(Member("idsubtitlefile", String(std::to_string(id))) +
+                      Member("data", String(Generate(id)->data)));
+    }
+  }
+  return Answer("200 OK", Member("data", Array(files)));
+}
+
+string MockOpenSubtitles::ServerInfo(const Value& params) {
+  string updates;
+  for (const Language& language : kLanguages) {
+    updates += Member(language.id, String("2010-01-01 00:00:00"));
+  }
+  int sessions;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sessions = sessions_.size();
+  }
+  return Answer("200 OK",
+      Member("xmlrpc_version", String("mock")) +
+      Member("xmlrpc_url", String("http://api.opensubtitles.org/xml-rpc")) +
+      Member("application", String("libsubtle mock")) +
+      Member("contact", String("")) +
+      Member("website_url", String("http://www.opensubtitles.org")) +
+      Member("users_online_total", String(std::to_string(sessions))) +
+      Member("users_online_program", String(std::to_string(sessions))) +
+      Member("users_loggedin", String(std::to_string(sessions))) +
+      Member("users_max_alltime", String(std::to_string(sessions))) +
+      Member("users_registered", String("0")) +
+      Member("subs_downloads", String("0")) +
+      Member("subs_subtitle_files", String("0")) +
+      Member("movies_total", String("0")) +
+      Member("movies_aka", String("0")) +
+      Member("total_subtitles_languages",
+             String(std::to_string(sizeof(kLanguages) /
+                                   sizeof(kLanguages[0])))) +
+      Member("last_update_strings", Struct(updates)));
+}
+
+string MockOpenSubtitles::ReportWrongMovieHash(const Value& params) {
+  bool user;
+  return Answer(Session(params, &user) ? "200 OK" : "406 No session");
+}
+
+string MockOpenSubtitles::SubtitlesVote(const Value& params) {
+  bool user;
+  if (!Session(params, &user)) {
+    return Answer("406 No session");
+  }
+  if (!user) {
+    return Answer("401 Unauthorized");
+  }
+  const string& id = params[1].Member("idsubtitle").text;
+  if (atoi(id.c_str()) <= 0) {
+    return Answer("408 Invalid parameters");
+  }
+  return Answer("200 OK", Member("data", Struct(
+      Member("SubRating", String(params[1].Member("score").text + ".0")) +
+      Member("SubSumVotes", String("1")) +
+      Member("IDSubtitle", String(id)))));
+}
+
+string MockOpenSubtitles::AddComment(const Value& params) {
+  bool user;
+  if (!Session(params, &user)) {
+    return Answer("406 No session");
+  }
+  return Answer(user ? "200 OK" : "401 Unauthorized");
+}
+
+string MockOpenSubtitles::CheckMovieHash(const Value& params) {
+  bool user;
+  if (!Session(params, &user)) {
+    return Answer("406 No session");
+  }
+  string movies;
+  for (const Value& hash : params[1].items) {
+    int movie = MovieId(hash.text);
+    movies += Member(hash.text, Struct(
+        Member("MovieHash", String(hash.text)) +
+        Member("MovieImdbID", String(std::to_string(movie))) +
+        Member("MovieName", String(MovieName(movie))) +
+        Member("MovieYear", String("2000"))));
+  }
+  return Answer("200 OK", Member("data", Struct(movies)));
+}
+
+string MockOpenSubtitles::CheckSubHash(const Value& params) {
+  bool user;
+  if (!Session(params, &user)) {
+    return Answer("406 No session");
+  }
+  string ids;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const Value& hash : params[1].items) {
+    std::map<string, int>::const_iterator found = sub_ids_.find(hash.text);
+    // as the service, a string id for known hashes and int 0 for others
+    ids += Member(hash.text, found == sub_ids_.end()
+                                 ? Int(0)
+                                 : String(std::to_string(found->second)));
+  }
+  return Answer("200 OK", Member("data", Struct(ids)));
+}
+
+string MockOpenSubtitles::GetSubLanguages(const Value& params) {
+  string languages;
+  for (const Language& language : kLanguages) {
+    languages += Struct(Member("SubLanguageID", String(language.id)) +
+                        Member("LanguageName", String(language.name)) +
+                        Member("ISO639", String(language.iso639)));
+  }
+  return Answer("200 OK", Member("data", Array(languages)));
+}
+
+string MockOpenSubtitles::DetectLanguage(const Value& params) {
+  bool user;
+  if (!Session(params, &user)) {
+    return Answer("406 No session");
+  }
+  string detected;
+  for (const Value& text : params[1].items) {
+    detected += Member(Md5Hex(text.text), String("eng"));
+  }
+  return Answer("200 OK", Member("data", Struct(detected)));
+}
+
+string MockOpenSubtitles::GetAvailableTranslations(const Value& params) {
+  bool user;
+  if (!Session(params, &user)) {
+    return Answer("406 No session");
+  }
+  string translations;
+  for (const Language& language : kLanguages) {
+    translations += Member(language.iso639, Struct(
+        Member("LastCreated", String("2010-01-01 00:00:00")) +
+        Member("StringsNo", String("100"))));
+  }
+  return Answer("200 OK", Member("data", Struct(translations)));
+}
+
+string MockOpenSubtitles::GetTranslation(const Value& params) {
+  bool user;
+  if (!Session(params, &user)) {
+    return Answer("406 No session");
+  }
+  // only compiled catalogs are served
+  if (params[2].text != "mo") {
+    return Answer("408 Invalid parameters");
+  }
+  return Answer("200 OK", Member("data", String(Base64Encode(
+      "msgid \"Search\"\nmsgstr \"Search\"\n"))));
+}
+
+string MockOpenSubtitles::AutoUpdate(const Value& params) {
+  return Answer("200 OK",
+      Member("version", String("1.0")) +
+      Member("url_windows", String("http://www.opensubtitles.org/windows")) +
+      Member("url_linux", String("http://www.opensubtitles.org/linux")) +
+      Member("comments", String("Mock release of " + params[0].text)));
+}
+
+string MockOpenSubtitles::SearchMoviesOnIMDB(const Value& params) {
+  bool user;
+  if (!Session(params, &user)) {
+    return Answer("406 No session");
+  }
+  string movies;
+  for (int part = 1; part <= 3; ++part) {
+    string title = params[1].text + " " + std::to_string(part);
+    movies += Struct(Member("id", String(std::to_string(MovieId(title)))) +
+                     Member("title", String(title + " (2000)")));
+  }
+  return Answer("200 OK", Member("data", Array(movies)));
+}
+
+string MockOpenSubtitles::GetIMDBMovieDetails(const Value& params) {
+  bool user;
+  if (!Session(params, &user)) {
+    return Answer("406 No session");
+  }
+  const string& id = params[1].text;
+  string name = MovieName(MovieId("imdb" + id));
+  return Answer("200 OK", Member("data", Struct(
+      Member("id", String(id)) +
+      Member("title", String(name)) +
+      Member("year", String("2000")) +
+      Member("cover", String("")) +
+      Member("duration", String("120 min")) +
+      Member("tagline", String("A movie made up for tests.")) +
+      Member("plot", String("Nothing happens.")) +
+      Member("cast", Struct(Member("0000001", String("Jane Doe")))) +
+      Member("directors", Struct(Member("0000002", String("John Doe")))) +
+      Member("writers", Struct(Member("0000003", String("Jim Doe")))) +
+      Member("genres", Array(String("Drama"))) +
+      Member("countries", Array(String("Nowhere"))) +
+      Member("languages", Array(String("English"))))));
+}
+
+string MockOpenSubtitles::InsertMovie(const Value& params) {
+  bool user;
+  if (!Session(params, &user)) {
+    return Answer("406 No session");
+  }
+  if (!user) {
+    return Answer("401 Unauthorized");
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  return Answer("200 OK", Member("id", String(std::to_string(++next_movie_))));
+}
+
+}  // namespace libsubtle
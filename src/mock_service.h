@@ -0,0 +1,153 @@
+#ifndef SRC_MOCK_SERVICE_H_
+#define SRC_MOCK_SERVICE_H_
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+
+using std::string;
+
+namespace libsubtle {
+
+namespace mock_detail {
+// parameters of a call, defined in mock_service.cc
+struct Value;
+}  // namespace mock_detail
+
+/// Behavior of a MockOpenSubtitles.
+struct MockServiceOptions {
+  /// Time taken to answer each call, plus a random part up to jitter.
+  std::chrono::milliseconds latency;
+  std::chrono::milliseconds jitter;
+  /// Fraction of calls answered with "503 Service Unavailable".
+  double error_rate;
+  /// Fraction of calls answered with an XML-RPC fault.
+  double fault_rate;
+  /// Calls answered per second; the rest get HTTP 429, as the service
+  /// throttles clients. 0 for no limit.
+  int max_calls_per_second;
+  /// Subtitles found per movie and language searched.
+  int results_per_search;
+  /// Cues in each subtitle file served, about 60 bytes each.
+  int subtitle_cues;
+  /// Seed of the random latency and failures, so runs can be repeated.
+  unsigned seed;
+
+  MockServiceOptions()
+      : latency(0),
+        jitter(0),
+        error_rate(0),
+        fault_rate(0),
+        max_calls_per_second(0),
+        results_per_search(3),
+        subtitle_cues(400),
+        seed(1) {}
+};
+
+/// Stands in for the OpenSubtitles XML-RPC service, answering every method
+/// XmlRpcImpl calls with generated data; serve it with a MockServer:
+///
+///   MockOpenSubtitles service;
+///   MockServer server([&service](const string& request, int* status) {
+///     return service.Respond(request, status);
+///   }, 0);
+///   client.Init(user_agent, server.url());
+///
+/// Any movie hash or IMDb id finds results_per_search subtitles per known
+/// language. Subtitle files have contents generated from their id, so
+/// downloads, sub hashes and CheckSubHash agree with each other. Logging in
+/// with any user name and password gives a session of a user, with empty
+/// ones an anonymous session; methods for users only answer anonymous
+/// sessions with "401 Unauthorized".
+///
+/// Calls may come from many threads at once.
+class MockOpenSubtitles {
+ public:
+  explicit MockOpenSubtitles(
+      const MockServiceOptions& options = MockServiceOptions());
+
+  /// Answer a call, after the configured latency.
+  /// \param request XML of the call.
+  /// \param http_status set to the HTTP status of the answer.
+  /// \return XML of the response.
+  string Respond(const string& request, int* http_status);
+
+  /// Answer every call of a method with canned XML instead.
+  void SetResponse(const string& method, const string& xml);
+
+  /// Drop every session, as the service does once they expire.
+  void ExpireSessions();
+
+  /// \return calls of a method answered so far, throttled ones excluded.
+  int calls(const string& method) const;
+
+  /// \return contents of the subtitle file with an id, uncompressed.
+  string SubtitleText(int id) const;
+
+ private:
+  MockOpenSubtitles(const MockOpenSubtitles&);
+  void operator=(const MockOpenSubtitles&);
+
+  // a subtitle file as served: its MD5 and gzipped base64 contents
+  struct Subtitle {
+    string hash;
+    size_t size;
+    string data;
+  };
+  typedef string (MockOpenSubtitles::*Method)(
+      const mock_detail::Value& params);
+
+  static const std::map<string, Method>& Methods();
+
+  bool Throttled();
+  // \return whether the first parameter is a valid token, and sets user to
+  //         whether it belongs to a user
+  bool Session(const mock_detail::Value& params, bool* user);
+  std::shared_ptr<const Subtitle> Generate(int id);
+
+  string LogIn(const mock_detail::Value& params);
+  string LogOut(const mock_detail::Value& params);
+  string NoOperation(const mock_detail::Value& params);
+  string SearchSubtitles(const mock_detail::Value& params);
+  string SearchToMail(const mock_detail::Value& params);
+  string DownloadSubtitles(const mock_detail::Value& params);
+  string ServerInfo(const mock_detail::Value& params);
+  string ReportWrongMovieHash(const mock_detail::Value& params);
+  string SubtitlesVote(const mock_detail::Value& params);
+  string AddComment(const mock_detail::Value& params);
+  string CheckMovieHash(const mock_detail::Value& params);
+  string CheckSubHash(const mock_detail::Value& params);
+  string GetSubLanguages(const mock_detail::Value& params);
+  string DetectLanguage(const mock_detail::Value& params);
+  string GetAvailableTranslations(const mock_detail::Value& params);
+  string GetTranslation(const mock_detail::Value& params);
+  string AutoUpdate(const mock_detail::Value& params);
+  string SearchMoviesOnIMDB(const mock_detail::Value& params);
+  string GetIMDBMovieDetails(const mock_detail::Value& params);
+  string InsertMovie(const mock_detail::Value& params);
+
+  MockServiceOptions options_;
+
+  mutable std::mutex mutex_;
+  std::mt19937 random_;
+  // calls answered in the current second of throttling
+  std::chrono::steady_clock::time_point window_;
+  int window_calls_;
+  std::map<string, int> calls_;
+  std::map<string, string> canned_;
+  // valid tokens, and whether they belong to a user
+  std::map<string, bool> sessions_;
+  int next_session_;
+  int next_movie_;
+  // generated files; dropped once there are many, then made again
+  std::map<int, std::shared_ptr<const Subtitle>> subtitles_;
+  // ids of the sub hashes handed out
+  std::map<string, int> sub_ids_;
+};
+
+}  // namespace libsubtle
+
+#endif  // SRC_MOCK_SERVICE_H_
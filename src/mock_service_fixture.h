@@ -0,0 +1,42 @@
+#ifndef SRC_MOCK_SERVICE_FIXTURE_H_
+#define SRC_MOCK_SERVICE_FIXTURE_H_
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "src/mock_server.h"
+#include "src/mock_service.h"
+
+using std::string;
+
+namespace libsubtle {
+
+/// Test fixture serving a MockOpenSubtitles on loopback, so tests of the
+/// client run offline. Point clients at url():
+///
+///   class XmlRpc : public MockServiceFixture {};
+///
+///   TEST_F(XmlRpc, LogIn) {
+///     XmlRpcImpl client;
+///     client.Init("test", url());
+///     ...
+///   }
+class MockServiceFixture : public testing::Test {
+ protected:
+  explicit MockServiceFixture(
+      const MockServiceOptions& options = MockServiceOptions())
+      : service_(options),
+        server_([this](const string& request, int* status) {
+          return service_.Respond(request, status);
+        }, 0) {}
+
+  /// \return URL the mock service answers calls on.
+  string url() const { return server_.url(); }
+
+  MockOpenSubtitles service_;
+  MockServer server_;
+};
+
+}  // namespace libsubtle
+
+#endif  // SRC_MOCK_SERVICE_FIXTURE_H_
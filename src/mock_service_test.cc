@@ -0,0 +1,159 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/base64_codec.h"
+#include "src/gunzip.h"
+#include "src/md5.h"
+#include "src/mock_server.h"
+#include "src/mock_service.h"
+#include "src/mock_service_fixture.h"
+#include "src/rpc_impl.h"
+#include "src/session.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+class MockService : public MockServiceFixture {};
+
+TEST_F(MockService, SearchDownloadCheck) {
+  XmlRpcImpl client;
+  client.Init("libsubtle test", url());
+  string token = client.LogIn(LoginRequest()).token_;
+  ASSERT_NE("", token);
+
+  SearchResponse found = client.SearchSubtitles(
+      token, SearchRequest("eng,hrv", "7d9cd5def91c9432", 735934464));
+  ASSERT_EQ(OK, found.GetStatus());
+  ASSERT_EQ(6u, found.data_.size());
+  const SubFile& first = found.data_[0];
+  ASSERT_EQ("7d9cd5def91c9432", first.MovieHash_);
+  ASSERT_EQ("735934464", first.MovieByteSize_);
+  // the same query finds the same files
+  ASSERT_EQ(first.IDSubtitleFile_,
+            client.SearchSubtitles(token, SearchRequest(
+                "eng", "7d9cd5def91c9432", 735934464)).data_[0]
+                .IDSubtitleFile_);
+
+  int id = atoi(first.IDSubtitleFile_.c_str());
+  DownloadResponse downloaded =
+      client.DownloadSubtitles(token, DownloadRequest(vector<int>(1, id)));
+  ASSERT_EQ(OK, downloaded.GetStatus());
+  ASSERT_EQ(1u, downloaded.subtitles_.size());
+  string text = Gunzip(Base64Decode(downloaded.subtitles_[0].second));
+  ASSERT_EQ(service_.SubtitleText(id), text);
+  ASSERT_EQ(first.SubHash_, Md5Hex(text));
+
+  CheckSubHashResponse checked = client.CheckSubHash(
+      token, CheckSubHashRequest(vector<string>{first.SubHash_, "wrong"}));
+  ASSERT_EQ(first.IDSubtitleFile_, checked.sub_ids_[first.SubHash_]);
+  ASSERT_EQ("0", checked.sub_ids_["wrong"]);
+
+  ASSERT_EQ(0u, client.SearchSubtitles(token, SearchRequest(
+      "wrong lang", "7d9cd5def91c9432", 735934464)).data_.size());
+  ASSERT_EQ(NO_SESSION, client.NoOperation("expired").GetStatus());
+  ASSERT_EQ(3, service_.calls("SearchSubtitles"));
+}
+
+TEST_F(MockService, Sessions) {
+  XmlRpcImpl client;
+  client.Init("libsubtle test", url());
+  SessionOptions options;
+  options.cache_path = "-";
+  options.keepalive = false;
+  SessionManager session(&client, options);
+  auto noop = [&client](const string& token) {
+    return client.NoOperation(token);
+  };
+  ASSERT_EQ(OK, session.Run(noop).GetStatus());
+  service_.ExpireSessions();
+  ASSERT_EQ(OK, session.Run(noop).GetStatus());
+  ASSERT_EQ(2, service_.calls("LogIn"));
+
+  service_.SetResponse("ServerInfo",
+      "<?xml version=\"1.0\"?><methodResponse><params><param><value>"
+      "<struct><member><name>xmlrpc_version</name><value><string>canned"
+      "</string></value></member></struct></value></param></params>"
+      "</methodResponse>");
+  ASSERT_EQ("canned", client.ServerInfo().xmlrpc_version_);
+}
+
+TEST(MockServiceOptions, Failures) {
+  MockServiceOptions options;
+  options.error_rate = 1;
+  options.latency = std::chrono::milliseconds(20);
+  MockOpenSubtitles service(options);
+  MockServer server([&service](const string& request, int* status) {
+    return service.Respond(request, status);
+  }, 0);
+  XmlRpcImpl client;
+  client.Init("libsubtle test", server.url());
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  ASSERT_EQ(UNAVAILABLE, client.NoOperation("token").GetStatus());
+  ASSERT_GE(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(20));
+
+  options = MockServiceOptions();
+  options.fault_rate = 1;
+  MockOpenSubtitles faulty(options);
+  MockServer faulty_server([&faulty](const string& request, int* status) {
+    return faulty.Respond(request, status);
+  }, 0);
+  client.Init("libsubtle test", faulty_server.url());
+  ASSERT_THROW(client.NoOperation("token"), SubtleException);
+}
+
+TEST(MockServiceOptions, Throttling) {
+  MockServiceOptions options;
+  options.max_calls_per_second = 5;
+  MockOpenSubtitles service(options);
+  MockServer server([&service](const string& request, int* status) {
+    return service.Respond(request, status);
+  }, 0);
+  XmlRpcImpl client;
+  client.Init("libsubtle test", server.url());
+  int throttled = 0;
+  for (int i = 0; i < 20; ++i) {
+    try {
+      client.ServerInfo();
+    } catch (const SubtleException&) {
+      ++throttled;
+    }
+  }
+  // at most 5 a second pass, even if the calls straddle two seconds
+  ASSERT_GE(throttled, 10);
+  ASSERT_EQ(20 - throttled, service.calls("ServerInfo"));
+}
+
+TEST_F(MockService, ManyThreads) {
+  const int kThreads = 8;
+  const int kCalls = 200;
+  XmlRpcImpl client;
+  client.Init("libsubtle test", url());
+  string token = client.LogIn(LoginRequest()).token_;
+  vector<std::thread> threads;
+  std::atomic<int> failures(0);
+  for (int t = 0; t < kThreads; ++t) {
+    threads.push_back(std::thread([&, t] {
+      for (int i = 0; i < kCalls; ++i) {
+        SearchResponse found = client.SearchSubtitles(token, SearchRequest(
+            "eng", std::to_string(t * kCalls + i), 1000000));
+        failures += found.GetStatus() != OK || found.data_.size() != 3;
+      }
+    }));
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(0, failures.load());
+  ASSERT_EQ(kThreads * kCalls, service_.calls("SearchSubtitles"));
+}
+
+}  // namespace libsubtle
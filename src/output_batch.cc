@@ -0,0 +1,134 @@
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "src/output_batch.h"
+#include "src/trace.h"
+#include "src/types.h"
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+namespace {
+
+string Directory(const string& path) {
+  size_t slash = path.rfind('/');
+  if (slash == string::npos) {
+    return ".";
+  }
+  return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+// \return 0, or the errno of the failure.
+int SyncPath(const string& path, bool whole_filesystem) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return errno;
+  }
+  int result;
+#ifdef __linux__
+  result = whole_filesystem ? syncfs(fd) : fdatasync(fd);
+#else
+  result = whole_filesystem ? (sync(), 0) : fsync(fd);
+#endif
+  int error = result == 0 ? 0 : errno;
+  close(fd);
+  return error;
+}
+
+}  // namespace
+
+const size_t OutputBatch::kSyncfsThreshold;
+
+OutputBatch::OutputBatch(bool durable) : durable_(durable), counter_(0) {}
+
+OutputBatch::~OutputBatch() {
+  for (const File& file : files_) {
+    remove(file.temp.c_str());
+  }
+}
+
+string OutputBatch::Add(const string& dest) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t slash = dest.rfind('/');
+  size_t name = slash == string::npos ? 0 : slash + 1;
+  File file;
+  // hidden, and in the same directory so the rename cannot cross filesystems
+  file.temp = dest.substr(0, name) + "." + dest.substr(name) + ".part." +
+      std::to_string(getpid()) + "." + std::to_string(counter_++);
+  file.dest = dest;
+  files_.push_back(file);
+  return file.temp;
+}
+
+size_t OutputBatch::Commit() {
+  SUBTLE_TRACE_SPAN("write", "OutputBatch::Commit");
+  vector<File> files;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    files.swap(files_);
+  }
+
+  // files that were written, by directory
+  map<string, vector<const File*>> directories;
+  for (const File& file : files) {
+    if (access(file.temp.c_str(), F_OK) == 0) {
+      directories[Directory(file.dest)].push_back(&file);
+    }
+  }
+
+  string error;
+  size_t moved = 0;
+  for (const auto& directory : directories) {
+    if (durable_) {
+      // one syncfs flushes the whole filesystem, cheaper than many
+      // fdatasync round trips on network filesystems
+      bool whole = directory.second.size() >= kSyncfsThreshold;
+      int failed = whole ? SyncPath(directory.first, true) : 0;
+      for (size_t i = 0; !whole && !failed && i < directory.second.size();
+           ++i) {
+        failed = SyncPath(directory.second[i]->temp, false);
+      }
+      if (failed) {
+        for (const File* file : directory.second) {
+          remove(file->temp.c_str());
+        }
+        if (error.empty()) {
+          error = "Cannot sync " + directory.first + ": " + strerror(failed);
+        }
+        continue;
+      }
+    }
+    for (const File* file : directory.second) {
+      if (rename(file->temp.c_str(), file->dest.c_str()) == 0) {
+        ++moved;
+      } else {
+        if (error.empty()) {
+          error = "Cannot write " + file->dest + ": " + strerror(errno);
+        }
+        remove(file->temp.c_str());
+      }
+    }
+    if (durable_) {
+      int failed = SyncPath(directory.first, false);
+      if (failed && error.empty()) {
+        error = "Cannot sync " + directory.first + ": " + strerror(failed);
+      }
+    }
+  }
+  if (!error.empty()) {
+    throw SubtleException(error);
+  }
+  return moved;
+}
+
+}  // namespace libsubtle
@@ -0,0 +1,64 @@
+#ifndef SRC_OUTPUT_BATCH_H_
+#define SRC_OUTPUT_BATCH_H_
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+/// Writes a batch of files so that none is ever seen partially written.
+///
+/// Each file is written under a hidden temporary name in its destination
+/// directory, then renamed over the destination on Commit. Durability is
+/// paid once per batch rather than per file: the data is synced with
+/// fdatasync, or with a single syncfs for directories receiving many files,
+/// before any rename, and each directory is synced once after them.
+///
+/// Add may be called from several threads.
+class OutputBatch {
+ public:
+  /// Directories receiving at least this many files are synced with syncfs.
+  static const size_t kSyncfsThreshold = 16;
+
+  /// \param durable sync data and directories on Commit; without it files
+  ///        are still replaced atomically, but may be lost on a crash.
+  explicit OutputBatch(bool durable = true);
+  /// Removes the temporary files of a batch that was not committed.
+  ~OutputBatch();
+
+  /// \param dest file to create or replace.
+  /// \return temporary path to write the new content of dest to.
+  string Add(const string& dest);
+
+  /// Make the files added since the last Commit durable and move them into
+  /// place. Files whose temporary path was never written are skipped, and
+  /// their destinations left as they were.
+  /// Throws SubtleException if a file cannot be synced or renamed, after
+  /// moving all the others.
+  /// \return number of files moved into place.
+  size_t Commit();
+
+ private:
+  OutputBatch(const OutputBatch&);
+  void operator=(const OutputBatch&);
+
+  struct File {
+    string temp;
+    string dest;
+  };
+
+  bool durable_;
+  std::mutex mutex_;
+  vector<File> files_;
+  // makes temporary names unique within the process
+  size_t counter_;
+};
+
+}  // namespace libsubtle
+
+#endif  // SRC_OUTPUT_BATCH_H_
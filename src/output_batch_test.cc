@@ -0,0 +1,106 @@
+#include <dirent.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "src/output_batch.h"
+#include "src/types.h"
+
+using std::string;
+
+namespace libsubtle {
+
+class OutputBatchTest : public ::testing::Test {
+ protected:
+  void SetUp() {
+    char dir[] = "/tmp/output_batch_XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != NULL);
+    dir_ = dir;
+  }
+
+  void TearDown() {
+    ASSERT_EQ(0, system(("rm -rf " + dir_).c_str()));
+  }
+
+  static string Read(const string& path) {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    std::ostringstream text;
+    text << in.rdbuf();
+    return text.str();
+  }
+
+  static void Write(const string& path, const string& text) {
+    std::ofstream out(path.c_str(), std::ios::binary);
+    out << text;
+  }
+
+  // \return number of entries in the directory, . and .. excluded.
+  size_t Entries() {
+    DIR* dir = opendir(dir_.c_str());
+    size_t entries = 0;
+    while (dirent* entry = readdir(dir)) {
+      entries += string(entry->d_name) != "." && string(entry->d_name) != "..";
+    }
+    closedir(dir);
+    return entries;
+  }
+
+  string dir_;
+};
+
+TEST_F(OutputBatchTest, Commit) {
+  Write(dir_ + "/a.srt", "old");
+  OutputBatch batch;
+  string temp = batch.Add(dir_ + "/a.srt");
+  ASSERT_EQ(dir_ + "/.a.srt.part.", temp.substr(0, dir_.size() + 13));
+  Write(temp, "new");
+  Write(batch.Add(dir_ + "/b.srt"), "b");
+  batch.Add(dir_ + "/never_written.srt");
+  ASSERT_EQ("old", Read(dir_ + "/a.srt"));
+
+  ASSERT_EQ(2u, batch.Commit());
+  ASSERT_EQ("new", Read(dir_ + "/a.srt"));
+  ASSERT_EQ("b", Read(dir_ + "/b.srt"));
+  ASSERT_EQ(2u, Entries());
+  ASSERT_EQ(0u, batch.Commit());
+}
+
+TEST_F(OutputBatchTest, Abandoned) {
+  Write(dir_ + "/a.srt", "old");
+  {
+    OutputBatch batch;
+    Write(batch.Add(dir_ + "/a.srt"), "partial");
+  }
+  ASSERT_EQ("old", Read(dir_ + "/a.srt"));
+  ASSERT_EQ(1u, Entries());
+}
+
+TEST_F(OutputBatchTest, ManyFiles) {
+  for (bool durable : {true, false}) {
+    OutputBatch batch(durable);
+    for (size_t i = 0; i < OutputBatch::kSyncfsThreshold * 2; ++i) {
+      Write(batch.Add(dir_ + "/" + std::to_string(i)), std::to_string(i));
+    }
+    ASSERT_EQ(OutputBatch::kSyncfsThreshold * 2, batch.Commit());
+    ASSERT_EQ("7", Read(dir_ + "/7"));
+  }
+  ASSERT_EQ(OutputBatch::kSyncfsThreshold * 2, Entries());
+}
+
+TEST_F(OutputBatchTest, Failure) {
+  OutputBatch batch;
+  Write(batch.Add(dir_ + "/a.srt"), "a");
+  // a file cannot replace a directory
+  ASSERT_EQ(0, mkdir((dir_ + "/b.srt").c_str(), 0755));
+  Write(batch.Add(dir_ + "/b.srt"), "b");
+  ASSERT_THROW(batch.Commit(), SubtleException);
+  ASSERT_EQ("a", Read(dir_ + "/a.srt"));
+  ASSERT_EQ(2u, Entries());
+}
+
+}  // namespace libsubtle
@@ -0,0 +1,256 @@
+#ifndef SRC_PIPELINE_H_
+#define SRC_PIPELINE_H_
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "src/metrics.h"
+#include "src/scheduler.h"
+
+using std::vector;
+
+namespace libsubtle {
+
+/// Receiving end of a pipeline stage.
+template <typename T>
+class PipeInput {
+ public:
+  virtual ~PipeInput() {}
+
+  /// Queue an item. Outside the scheduler's workers, blocks while the input
+  /// is full; workers never block, stages feeding the input wait for space
+  /// with WhenSpace before they start a task instead.
+  virtual void Push(T item) = 0;
+
+  /// Signal that no more items will be pushed.
+  virtual void Close() = 0;
+
+  /// Arrange for resume to be called once the input is no longer full.
+  /// \return false if it is not full, and resume will not be called.
+  virtual bool WhenSpace(std::function<void()> resume) = 0;
+};
+
+/// Configuration of a Stage.
+struct StageOptions {
+  /// Tasks of the stage running at once, bounding its use of a resource.
+  size_t parallelism;
+  /// Items queued before the input counts as full.
+  size_t capacity;
+  /// Items handed to each task. Smaller batches are only formed once the
+  /// input is closed, or once linger has passed since the batch was started.
+  size_t batch_size;
+  /// Longest wait for a batch to fill up; zero waits until the input closes.
+  std::chrono::milliseconds linger;
+  /// Kept at the number of items queued; not owned, NULL for none.
+  metrics::Gauge* depth;
+
+  StageOptions()
+      : parallelism(1), capacity(64), batch_size(1), linger(0), depth(NULL) {}
+};
+
+/// A step of a pipeline: processes the items pushed into it in batches on
+/// a Scheduler, pushing its results into the next stage.
+///
+/// Each stage runs at most options.parallelism tasks at once and starts no
+/// task while the next stage is full, so every stage runs as fast as the
+/// slowest one downstream, and a pipeline of stages using different
+/// resources keeps all of them busy at once.
+///
+/// Stages must outlive the tasks they run: close the first one and Wait for
+/// the last one before destroying any.
+template <typename In, typename Out>
+class Stage : public PipeInput<In> {
+ public:
+  /// Processes a batch, pushing results into next. Exceptions drop the batch
+  /// and are rethrown from Wait.
+  typedef std::function<void(vector<In>* batch, PipeInput<Out>* next)>
+      Process;
+
+  /// \param next input the results go to; NULL for the last stage.
+  Stage(Scheduler* scheduler, const Process& process, PipeInput<Out>* next,
+        const StageOptions& options = StageOptions())
+      : scheduler_(scheduler),
+        process_(process),
+        next_(next),
+        options_(options),
+        running_(0),
+        closed_(false),
+        finished_(false),
+        blocked_(false),
+        timer_(false),
+        lingered_(false) {
+    options_.parallelism = std::max<size_t>(options_.parallelism, 1);
+    options_.capacity = std::max<size_t>(options_.capacity, 1);
+    options_.batch_size = std::max<size_t>(options_.batch_size, 1);
+  }
+
+  ~Stage() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return running_ == 0 && !timer_; });
+  }
+
+  void Push(In item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!scheduler_->OnWorker()) {
+      space_.wait(lock, [this] { return queue_.size() < options_.capacity; });
+    }
+    queue_.push_back(std::move(item));
+    if (options_.depth) {
+      options_.depth->Add(1);
+    }
+    Resume(&lock);
+  }
+
+  void Close() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    closed_ = true;
+    Resume(&lock);
+  }
+
+  bool WhenSpace(std::function<void()> resume) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (queue_.size() < options_.capacity) {
+      return false;
+    }
+    waiters_.push_back(std::move(resume));
+    return true;
+  }
+
+  /// Block until the input is closed and every item processed, then rethrow
+  /// the first exception of a task, if any.
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return finished_; });
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+  }
+
+ private:
+  Stage(const Stage&);
+  void operator=(const Stage&);
+
+  // Start the tasks that can run, then, with the lock released, tell the
+  // stages waiting for space and close the next stage if this one is done.
+  // Callbacks run unlocked since they lock the stages upstream.
+  void Resume(std::unique_lock<std::mutex>* lock) {
+    bool had_room = queue_.size() < options_.capacity;
+    Start();
+    vector<std::function<void()>> waiters;
+    if (queue_.size() < options_.capacity) {
+      if (!had_room) {
+        space_.notify_all();
+      }
+      waiters.swap(waiters_);
+    }
+    PipeInput<Out>* close = NULL;
+    if (running_ == 0 && !timer_) {
+      if (closed_ && !finished_ && queue_.empty()) {
+        finished_ = true;
+        close = next_;
+      }
+      done_.notify_all();
+    }
+    lock->unlock();
+    for (std::function<void()>& waiter : waiters) {
+      waiter();
+    }
+    if (close) {
+      close->Close();
+    }
+  }
+
+  void Start() {
+    while (running_ < options_.parallelism && !queue_.empty() && !blocked_) {
+      if (queue_.size() < options_.batch_size && !closed_ && !lingered_) {
+        Linger();
+        return;
+      }
+      if (next_ && next_->WhenSpace([this] { Unblock(); })) {
+        blocked_ = true;
+        return;
+      }
+      lingered_ = false;
+      size_t size = std::min(queue_.size(), options_.batch_size);
+      std::shared_ptr<vector<In>> batch(new vector<In>());
+      batch->reserve(size);
+      for (size_t i = 0; i < size; ++i) {
+        batch->push_back(std::move(queue_.front()));
+        queue_.pop_front();
+      }
+      if (options_.depth) {
+        options_.depth->Add(-static_cast<int64_t>(size));
+      }
+      ++running_;
+      scheduler_->Post([this, batch] { Run(batch.get()); });
+    }
+  }
+
+  void Linger() {
+    if (options_.linger.count() == 0 || timer_) {
+      return;
+    }
+    timer_ = true;
+    scheduler_->PostAfter(options_.linger, [this] {
+      std::unique_lock<std::mutex> lock(mutex_);
+      timer_ = false;
+      lingered_ = true;
+      Resume(&lock);
+    });
+  }
+
+  void Unblock() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    blocked_ = false;
+    Resume(&lock);
+  }
+
+  void Run(vector<In>* batch) {
+    std::exception_ptr error;
+    try {
+      process_(batch, next_);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (error && !error_) {
+      error_ = error;
+    }
+    --running_;
+    Resume(&lock);
+  }
+
+  Scheduler* scheduler_;
+  Process process_;
+  PipeInput<Out>* next_;
+  StageOptions options_;
+
+  std::mutex mutex_;
+  std::condition_variable space_;
+  std::condition_variable done_;
+  std::deque<In> queue_;
+  vector<std::function<void()>> waiters_;
+  size_t running_;
+  bool closed_;
+  bool finished_;
+  // waiting for space in the next stage
+  bool blocked_;
+  // a linger timer is pending
+  bool timer_;
+  // the linger time passed, a partial batch may start
+  bool lingered_;
+  std::exception_ptr error_;
+};
+
+}  // namespace libsubtle
+
+#endif  // SRC_PIPELINE_H_
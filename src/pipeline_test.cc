@@ -0,0 +1,152 @@
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/pipeline.h"
+#include "src/types.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+// Tracks how many tasks run at once.
+class Gauge {
+ public:
+  Gauge() : current_(0), peak_(0) {}
+
+  void Enter() {
+    int now = ++current_;
+    int peak = peak_;
+    while (now > peak && !peak_.compare_exchange_weak(peak, now)) {}
+  }
+  void Leave() { --current_; }
+  int peak() const { return peak_; }
+
+ private:
+  std::atomic<int> current_;
+  std::atomic<int> peak_;
+};
+
+TEST(Pipeline, Stages) {
+  Scheduler scheduler(8);
+  std::mutex mutex;
+  vector<vector<string>> batches;
+  Gauge slow_gauge;
+
+  StageOptions collect_options;
+  collect_options.batch_size = 10;
+  Stage<string, int> collect(&scheduler,
+      [&](vector<string>* batch, PipeInput<int>*) {
+        std::lock_guard<std::mutex> lock(mutex);
+        batches.push_back(*batch);
+      }, NULL, collect_options);
+
+  StageOptions slow_options;
+  slow_options.parallelism = 3;
+  slow_options.capacity = 4;
+  Stage<int, string> slow(&scheduler,
+      [&](vector<int>* batch, PipeInput<string>* next) {
+        slow_gauge.Enter();
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        slow_gauge.Leave();
+        next->Push(std::to_string((*batch)[0]));
+      }, &collect, slow_options);
+
+  StageOptions fan_options;
+  fan_options.parallelism = 4;
+  Stage<int, int> fan(&scheduler,
+      [](vector<int>* batch, PipeInput<int>* next) {
+        next->Push((*batch)[0] * 2);
+        next->Push((*batch)[0] * 2 + 1);
+      }, &slow, fan_options);
+
+  for (int i = 0; i < 50; ++i) {
+    fan.Push(i);
+  }
+  fan.Close();
+  collect.Wait();
+
+  ASSERT_EQ(3, slow_gauge.peak());
+  size_t items = 0;
+  for (const vector<string>& batch : batches) {
+    ASSERT_LE(batch.size(), 10u);
+    items += batch.size();
+  }
+  ASSERT_EQ(100u, items);
+  ASSERT_EQ(10u, batches.size());
+}
+
+TEST(Pipeline, Linger) {
+  Scheduler scheduler(2);
+  std::atomic<size_t> first_batch(0);
+  StageOptions options;
+  options.batch_size = 100;
+  options.linger = std::chrono::milliseconds(20);
+  Stage<int, int> stage(&scheduler,
+      [&](vector<int>* batch, PipeInput<int>*) {
+        size_t none = 0;
+        first_batch.compare_exchange_strong(none, batch->size());
+      }, NULL, options);
+  stage.Push(1);
+  stage.Push(2);
+  // the partial batch starts without the input being closed
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  ASSERT_EQ(2u, first_batch.load());
+  stage.Close();
+  stage.Wait();
+}
+
+TEST(Pipeline, Backpressure) {
+  Scheduler scheduler(2);
+  std::atomic<bool> open(false);
+  StageOptions options;
+  options.capacity = 2;
+  Stage<int, int> stage(&scheduler,
+      [&](vector<int>*, PipeInput<int>*) {
+        while (!open) {
+          std::this_thread::yield();
+        }
+      }, NULL, options);
+  std::atomic<int> pushed(0);
+  std::thread producer([&] {
+    for (int i = 0; i < 5; ++i) {
+      stage.Push(i);
+      ++pushed;
+    }
+  });
+  // one item is being processed and two are queued
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_EQ(3, pushed.load());
+  open = true;
+  producer.join();
+  stage.Close();
+  stage.Wait();
+}
+
+TEST(Pipeline, Error) {
+  Scheduler scheduler(2);
+  std::atomic<int> done(0);
+  Stage<int, int> last(&scheduler,
+      [&](vector<int>*, PipeInput<int>*) { ++done; }, NULL);
+  Stage<int, int> first(&scheduler,
+      [](vector<int>* batch, PipeInput<int>* next) {
+        if ((*batch)[0] == 3) {
+          throw SubtleException("three");
+        }
+        next->Push((*batch)[0]);
+      }, &last);
+  for (int i = 0; i < 6; ++i) {
+    first.Push(i);
+  }
+  first.Close();
+  last.Wait();
+  ASSERT_THROW(first.Wait(), SubtleException);
+  ASSERT_EQ(5, done.load());
+}
+
+}  // namespace libsubtle
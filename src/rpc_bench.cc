@@ -0,0 +1,126 @@
+// Calls per second XmlRpcImpl makes end to end, over loopback HTTP.
+//
+// Threads share one client and each searches for a movie, then downloads its
+// first subtitle, until the time is up. Calls go to a MockOpenSubtitles in
+// the process unless --url points at a running mock_opensubtitles:
+//
+//   rpc_bench --threads=16 --seconds=10 --latency_ms=5
+//
+// Prints the rate and the cost of the calls per method.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/mock_server.h"
+#include "src/mock_service.h"
+#include "src/rpc_impl.h"
+#include "src/rpc_stats.h"
+
+using std::string;
+using std::vector;
+
+namespace {
+
+void Usage(const char* program) {
+  fprintf(stderr,
+          "usage: %s [--threads=N] [--seconds=N] [--url=URL]\n"
+          "    [--latency_ms=N] [--results=N] [--cues=N]\n", program);
+  exit(2);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  libsubtle::MockServiceOptions options;
+  int threads = 8;
+  int seconds = 5;
+  string url;
+  for (int i = 1; i < argc; ++i) {
+    const char* value = strchr(argv[i], '=');
+    if (strncmp(argv[i], "--", 2) || !value) {
+      Usage(argv[0]);
+    }
+    string flag(argv[i] + 2, value - argv[i] - 2);
+    ++value;
+    if (flag == "threads") {
+      threads = atoi(value);
+    } else if (flag == "seconds") {
+      seconds = atoi(value);
+    } else if (flag == "url") {
+      url = value;
+    } else if (flag == "latency_ms") {
+      options.latency = std::chrono::milliseconds(atoi(value));
+    } else if (flag == "results") {
+      options.results_per_search = atoi(value);
+    } else if (flag == "cues") {
+      options.subtitle_cues = atoi(value);
+    } else {
+      Usage(argv[0]);
+    }
+  }
+
+  libsubtle::MockOpenSubtitles service(options);
+  std::unique_ptr<libsubtle::MockServer> server;
+  if (url.empty()) {
+    server.reset(new libsubtle::MockServer(
+        [&service](const string& request, int* status) {
+          return service.Respond(request, status);
+        }, 0));
+    url = server->url();
+  }
+
+  libsubtle::XmlRpcImpl client;
+  client.Init("rpc_bench", url);
+  libsubtle::RpcStats stats;
+  client.SetObserver(&stats);
+  string token = client.LogIn(libsubtle::LoginRequest()).token_;
+
+  std::atomic<bool> done(false);
+  std::atomic<uint64_t> calls(0);
+  std::atomic<uint64_t> failures(0);
+  vector<std::thread> workers;
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  for (int t = 0; t < threads; ++t) {
+    workers.push_back(std::thread([&, t] {
+      for (uint64_t i = 0; !done; ++i) {
+        try {
+          libsubtle::SearchResponse found = client.SearchSubtitles(
+              token, libsubtle::SearchRequest(
+                  "eng", std::to_string(t) + "-" + std::to_string(i),
+                  1000000));
+          ++calls;
+          if (found.data_.empty()) {
+            continue;
+          }
+          client.DownloadSubtitles(token, libsubtle::DownloadRequest(
+              vector<int>(1, atoi(found.data_[0].IDSubtitleFile_.c_str()))));
+          ++calls;
+        } catch (const libsubtle::SubtleException&) {
+          ++failures;
+        }
+      }
+    }));
+  }
+  std::this_thread::sleep_for(std::chrono::seconds(seconds));
+  done = true;
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  printf("%d threads: %.0f calls/s, %llu failed\n", threads,
+         calls / elapsed.count(),
+         static_cast<unsigned long long>(failures.load()));
+  stats.Print(std::cout);
+  return 0;
+}
@@ -1,8 +1,18 @@
 #include <src/rpc_impl.h>
+#include <src/rpc_stats.h>
+#include <src/trace.h>
 #include <src/types.h>
 #include <src/subfile.h>
+#include <src/schema.h>
+#include <src/struct_view.h>
+
+#include <xmlrpc-c/xml.hpp>
 
 #include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <initializer_list>
 #include <iostream>
 #include <map>
 #include <string>
@@ -23,71 +33,252 @@ using xmlrpc_c::value_struct;
 
 namespace libsubtle {
 
-typedef map<string, value> StructDict;
-
-string ds(value v) {
-    return static_cast<string>(value_string(v));
+namespace {
+
+// Field tables for the responses decoded from structs; slot counts are the
+// smallest ones the field names hash into without collisions.
+constexpr schema::Field<ServerInfoResponse> kServerInfoSchema[] = {
+  SUBTLE_FIELD(ServerInfoResponse, "xmlrpc_version", xmlrpc_version_),
+  SUBTLE_FIELD(ServerInfoResponse, "xmlrpc_url", xmlrpc_url_),
+  SUBTLE_FIELD(ServerInfoResponse, "application", application_),
+  SUBTLE_FIELD(ServerInfoResponse, "contact", contact_),
+  SUBTLE_FIELD(ServerInfoResponse, "website_url", website_url_),
+  SUBTLE_FIELD(ServerInfoResponse, "users_online_total", users_online_total_),
+  SUBTLE_FIELD(ServerInfoResponse, "users_online_program",
+               users_online_program_),
+  SUBTLE_FIELD(ServerInfoResponse, "users_loggedin", users_loggedin_),
+  SUBTLE_FIELD(ServerInfoResponse, "users_max_alltime", users_max_alltime_),
+  SUBTLE_FIELD(ServerInfoResponse, "users_registered", users_registered_),
+  SUBTLE_FIELD(ServerInfoResponse, "subs_downloads", subs_downloads_),
+  SUBTLE_FIELD(ServerInfoResponse, "subs_subtitle_files",
+               subs_subtitle_files_),
+  SUBTLE_FIELD(ServerInfoResponse, "movies_total", movies_total_),
+  SUBTLE_FIELD(ServerInfoResponse, "movies_aka", movies_aka_),
+  SUBTLE_FIELD(ServerInfoResponse, "total_subtitles_languages",
+               total_subtitles_languages_)
+};
+SUBTLE_CHECK_SCHEMA(kServerInfoSchema, 32);
+
+constexpr schema::Field<MovieInfo> kMovieInfoSchema[] = {
+  SUBTLE_FIELD(MovieInfo, "MovieHash", MovieHash),
+  SUBTLE_FIELD(MovieInfo, "MovieImdbID", MovieImdbID),
+  SUBTLE_FIELD(MovieInfo, "MovieName", MovieName),
+  SUBTLE_FIELD(MovieInfo, "MovieYear", MovieYear)
+};
+SUBTLE_CHECK_SCHEMA(kMovieInfoSchema, 8);
+
+constexpr schema::Field<LangInfo> kLangInfoSchema[] = {
+  SUBTLE_FIELD(LangInfo, "SubLanguageID", SubLanguageID),
+  SUBTLE_FIELD(LangInfo, "LanguageName", LanguageName),
+  SUBTLE_FIELD(LangInfo, "ISO639", ISO639)
+};
+SUBTLE_CHECK_SCHEMA(kLangInfoSchema, 7);
+
+constexpr schema::Field<TranslationInfo> kTranslationInfoSchema[] = {
+  SUBTLE_FIELD(TranslationInfo, "LastCreated", LastCreated),
+  SUBTLE_FIELD(TranslationInfo, "StringsNo", StringsNo)
+};
+SUBTLE_CHECK_SCHEMA(kTranslationInfoSchema, 2);
+
+constexpr schema::Field<ImdbEntry> kImdbEntrySchema[] = {
+  SUBTLE_FIELD(ImdbEntry, "id", id),
+  SUBTLE_FIELD(ImdbEntry, "title", title)
+};
+SUBTLE_CHECK_SCHEMA(kImdbEntrySchema, 2);
+
+constexpr schema::Field<GetImdbMovieDetailsResponse> kImdbDetailsSchema[] = {
+  SUBTLE_FIELD(GetImdbMovieDetailsResponse, "id", id_),
+  SUBTLE_FIELD(GetImdbMovieDetailsResponse, "title", title_),
+  SUBTLE_FIELD(GetImdbMovieDetailsResponse, "year", year_),
+  SUBTLE_FIELD(GetImdbMovieDetailsResponse, "cover", cover_),
+  SUBTLE_FIELD(GetImdbMovieDetailsResponse, "awards", awards_),
+  SUBTLE_FIELD(GetImdbMovieDetailsResponse, "duration", duration_),
+  SUBTLE_FIELD(GetImdbMovieDetailsResponse, "tagline", tagline_),
+  SUBTLE_FIELD(GetImdbMovieDetailsResponse, "plot", plot_),
+  SUBTLE_FIELD(GetImdbMovieDetailsResponse, "goofs", goofs_),
+  SUBTLE_FIELD(GetImdbMovieDetailsResponse, "trivia", trivia_),
+  SUBTLE_FIELD(GetImdbMovieDetailsResponse, "request_from", request_from_)
+};
+SUBTLE_CHECK_SCHEMA(kImdbDetailsSchema, 35);
+
+constexpr schema::Field<AutoUpdateResponse> kAutoUpdateSchema[] = {
+  SUBTLE_FIELD(AutoUpdateResponse, "version", version_),
+  SUBTLE_FIELD(AutoUpdateResponse, "url_windows", url_windows_),
+  SUBTLE_FIELD(AutoUpdateResponse, "url_linux", url_linux_),
+  SUBTLE_FIELD(AutoUpdateResponse, "comments", comments_)
+};
+SUBTLE_CHECK_SCHEMA(kAutoUpdateSchema, 14);
+
+template <typename T, size_t Slots, size_t N>
+const schema::Table<T, Slots>& TableOf(const schema::Field<T> (&fields)[N]) {
+  static const schema::Table<T, Slots> table(fields);
+  return table;
 }
-string s(StructDict v, string k) {
-  if (v.find(k) != v.end()) {
-    return ds(v[k]);
-  } else {
-    return "";
+
+}  // namespace
+
+XmlRpcImpl::XmlRpcImpl()
+    : own_transport_(new CurlTransport()), transport_(own_transport_.get()) {}
+
+XmlRpcImpl::XmlRpcImpl(Transport* transport) : transport_(transport) {}
+
+XmlRpcImpl::~XmlRpcImpl() {}
+
+namespace {
+
+// Parameters of a call taking only strings.
+xmlrpc_c::paramList StringParams(std::initializer_list<string> strings) {
+  xmlrpc_c::paramList params;
+  for (const string& text : strings) {
+    params.add(value_string(text));
   }
+  return params;
 }
 
-int64_t i(StructDict v, string k) {
-  return static_cast<int64_t>(value_int(v[k]));
-}
+class StringSink : public ByteSink {
+ public:
+  explicit StringSink(string* text) : text_(text) {}
+  void Write(const char* data, size_t size) { text_->append(data, size); }
 
-double d(StructDict v, string k) {
-  return static_cast<double>(value_double(v[k]));
-}
+ private:
+  string* text_;
+};
 
-StructDict v(value val) {
-  return static_cast<StructDict>(value_struct(val));
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start).count();
 }
 
-bool CheckResponse(StructDict values) {
-  return s(values, "status").compare("200 OK") == 0;
-}
+// Adds the time another sink takes to a sum.
+class TimedSink : public ByteSink {
+ public:
+  TimedSink(ByteSink* sink, double* seconds)
+      : sink_(sink), seconds_(seconds) {}
+  void Write(const char* data, size_t size) {
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    sink_->Write(data, size);
+    *seconds_ += SecondsSince(start);
+  }
 
-void ToStrMap(StructDict value_dict, string field, map<string,
-    string>* target) {
-  if (value_dict.find(field) != value_dict.end()) {
-    StructDict dict = v(value_dict[field]);
-    for (StructDict::const_iterator iter = dict.begin();
-        iter != dict.end(); ++iter) {
-      (*target)[iter->first] = ds(iter->second);
+ private:
+  ByteSink* sink_;
+  double* seconds_;
+};
+
+// Measures a call for the observer of a client, if it has one, and reports
+// it once out of scope; the call counts as failed unless Done was called.
+// Without an observer nothing is measured.
+class CallMeter {
+ public:
+  CallMeter(RpcObserver* observer, const string& method)
+      : observer_(observer), start_(std::chrono::steady_clock::now()) {
+    if (observer_) {
+      stats_.method = method;
+      stats_.status = 0;
+      stats_.failed = true;
+      stats_.transfer = TransferStats();
+      stats_.parse = 0;
     }
   }
-}
 
-void ToStrVector(StructDict value_dict, string field, vector<string>* target) {
-  if (value_dict.find(field) != value_dict.end()) {
-    value data_field = value_dict[field];
-    vector<value> const data(
-        value_array(data_field).vectorValueValue());
-    for (const auto& entry : data) {
-      target->push_back(ds(entry));
+  ~CallMeter() {
+    if (observer_) {
+      stats_.total = SecondsSince(start_);
+      observer_->OnCall(stats_);
+    }
+  }
+
+  bool enabled() const { return observer_ != NULL; }
+  double* parse() { return &stats_.parse; }
+
+  void Post(Transport* transport, const string& url,
+            const string& user_agent, const string& body,
+            ByteSink* response) {
+    if (observer_) {
+      transport->Post(url, user_agent, body, response, &stats_.transfer);
+    } else {
+      transport->Post(url, user_agent, body, response);
     }
   }
+
+  /// The response was decoded and reported a status, such as "200 OK".
+  void Done(const string& status) {
+    stats_.failed = false;
+    stats_.status = atoi(status.c_str());
+  }
+
+ private:
+  RpcObserver* observer_;
+  std::chrono::steady_clock::time_point start_;
+  RpcCallStats stats_;
+};
+
+}  // namespace
+
+void XmlRpcImpl::Call(const char* method, const xmlrpc_c::paramList& params,
+                      value* result) {
+  SUBTLE_TRACE_SPAN("rpc", method);
+  CallMeter meter(observer_, method);
+  string call_xml;
+  xmlrpc_c::xml::generateCall(method, params, &call_xml);
+  string response_xml;
+  StringSink response(&response_xml);
+  meter.Post(transport_, server_endpoint_, user_agent_, call_xml, &response);
+
+  std::chrono::steady_clock::time_point parse_start =
+      std::chrono::steady_clock::now();
+  xmlrpc_c::rpcOutcome outcome;
+  xmlrpc_c::xml::parseResponse(response_xml, &outcome);
+  if (!outcome.succeeded()) {
+    throw SubtleException(string("XML-RPC call ") + method + " failed: " +
+                          outcome.getFault().getDescription());
+  }
+  *result = outcome.getResult();
+  if (meter.enabled()) {
+    *meter.parse() += SecondsSince(parse_start);
+    meter.Done(result->type() == value::TYPE_STRUCT
+                   ? StructView(*result).String("status") : "");
+  }
 }
 
-XmlRpcImpl::~XmlRpcImpl() {
+void XmlRpcImpl::CallStreaming(const char* method,
+                               const xmlrpc_c::paramList& params,
+                               XmlRpcHandler* handler) {
+  SUBTLE_TRACE_SPAN("rpc", method);
+  CallMeter meter(observer_, method);
+  string call_xml;
+  xmlrpc_c::xml::generateCall(method, params, &call_xml);
+
+  XmlRpcStreamParser parser(handler);
+  XmlRpcParserSink response(&parser);
+  TimedSink timed(&response, meter.parse());
+  meter.Post(transport_, server_endpoint_, user_agent_, call_xml,
+             meter.enabled() ? static_cast<ByteSink*>(&timed) : &response);
+  std::chrono::steady_clock::time_point parse_start =
+      std::chrono::steady_clock::now();
+  parser.Finish();
+  if (meter.enabled()) {
+    *meter.parse() += SecondsSince(parse_start);
+    // faults leave no status, the caller throws once it finishes decoding
+    string status = handler->StatusText();
+    if (!status.empty()) {
+      meter.Done(status);
+    }
+  }
 }
 
-extern "C" LoginResponse XmlRpcImpl::LogIn(LoginRequest* request) {
+extern "C" LoginResponse XmlRpcImpl::LogIn(const LoginRequest& request) {
   value result;
-  client_.call(server_endpoint_, "LogIn", "ssss", &result,
-               request->username_.c_str(), request->password_.c_str(),
-               request->lang_.c_str(), user_agent_.c_str());
+  Call("LogIn", StringParams({request.username_, request.password_,
+                              request.lang_, user_agent_}),
+       &result);
 
-  StructDict values = v(result);
+  StructView values(result);
   LoginResponse response;
-  response.SetStatus(s(values, "status"), d(values, "seconds"));
-  if (CheckResponse(values)) {
-    response.token_ = s(values, "token");
+  response.SetStatus(values.String("status"), values.Double("seconds"));
+  if (values.Ok()) {
+    response.token_ = values.String("token");
   }
 
   return response;
@@ -96,95 +287,105 @@ extern "C" LoginResponse XmlRpcImpl::LogIn(LoginRequest* request) {
 extern "C" LogOutResponse XmlRpcImpl::LogOut(const string& token) {
   LogOutResponse response;
   value result;
-  client_.call(server_endpoint_, "LogOut", "s", &result, token.c_str());
-  StructDict values = v(result);
-  response.SetStatus(s(values, "status"), d(values, "seconds"));
+  Call("LogOut", StringParams({token}), &result);
+  StructView values(result);
+  response.SetStatus(values.String("status"), values.Double("seconds"));
   return response;
 }
 
 extern "C" NoOperationResponse XmlRpcImpl::NoOperation(const string& token) {
   NoOperationResponse response;
   value result;
-  client_.call(server_endpoint_, "NoOperation", "s", &result, token.c_str());
-  StructDict values = v(result);
-  response.SetStatus(s(values, "status"), d(values, "seconds"));
+  Call("NoOperation", StringParams({token}), &result);
+  StructView values(result);
+  response.SetStatus(values.String("status"), values.Double("seconds"));
   return response;
 }
 
-extern "C" SearchResponse XmlRpcImpl::SearchSubtitles(const string& token,
-                                                      SearchRequest* request) {
-  SearchResponse response;
+extern "C" SearchResponse XmlRpcImpl::SearchSubtitles(
+    const string& token, const SearchRequest& request) {
+  vector<SubFile> ret;
+  SearchResponse response = SearchSubtitles(token, request,
+      [&ret](SubFile&& sub) { ret.push_back(std::move(sub)); });
+  response.data_.swap(ret);
+
+  return response;
+}
+
+xmlrpc_c::paramList SearchSubtitlesParams(const string& token,
+                                          const SearchRequest& request) {
   xmlrpc_c::paramList param_list;
   param_list.add(value_string(token));
   map<string, value> req_map;
 
   // imdb or hash search?
-  if (request->imdb_id_.compare("")) {
-    req_map.insert(make_pair("imdbid", value_string(request->imdb_id_)));
+  if (request.imdb_id_.compare("")) {
+    req_map.insert(make_pair("imdbid", value_string(request.imdb_id_)));
   } else {
-    req_map.insert(make_pair("moviehash", value_string(request->movie_hash_)));
+    req_map.insert(make_pair("moviehash", value_string(request.movie_hash_)));
     req_map.insert(make_pair("moviebytesize",
-                             value_double(request->movie_byte_size_)));
+                             value_double(request.movie_byte_size_)));
   }
   req_map.insert(make_pair("sublanguageid",
-                            value_string(request->sub_language_id_)));
+                            value_string(request.sub_language_id_)));
 
   value_struct const request_value(req_map);
   vector<value> params;
   params.push_back(request_value);
   value_array params_array(params);
   param_list.add(params_array);
+  return param_list;
+}
 
-  value result;
-  client_.call(server_endpoint_, "SearchSubtitles", param_list, &result);
-  StructDict values = v(result);
-  response.SetStatus(s(values, "status"), d(values, "seconds"));
-
-  // False is returned when there's no results
-  if (response.GetStatus() != OK ||
-      values["data"].type() == value::TYPE_BOOLEAN) {
-    return response;
-  }
-
-  vector<SubFile> ret;
-  value data_field = values["data"];
+xmlrpc_c::paramList DownloadSubtitlesParams(const string& token,
+                                            const DownloadRequest& request) {
+  xmlrpc_c::paramList param_list;
+  vector<value> movie_data(request.movies_.size());
+  std::transform(request.movies_.begin(), request.movies_.end(),
+                 movie_data.begin(), [](int id){return value_int(id);});
 
-  // parse results
-  vector<value> const data(
-      value_array(data_field).vectorValueValue());
+  param_list.add(value_string(token));
+  param_list.add(value_array(movie_data));
+  return param_list;
+}
 
-  for (vector<value>::const_iterator it =  data.begin();
-        it != data.end(); ++it) {
-    map<string, string> members;
-    StructDict values = v(*it);
-
-    for (StructDict::const_iterator iter = values.begin();
-        iter != values.end(); ++iter) {
-      try {
-        members[iter->first] = ds(value_string(iter->second));
-      } catch(...) {
-        // ignore non-strings from the response
-      }
-    }
+SearchResponse XmlRpcImpl::SearchSubtitles(const string& token,
+    const SearchRequest& request,
+    const SearchResponseDecoder::Callback& callback) {
+  SearchResponse response;
+  xmlrpc_c::paramList param_list = SearchSubtitlesParams(token, request);
 
-      ret.push_back(SubFile(members));
-    }
+  // results are handed out as they are parsed, no value tree is built.
+  // False is sent instead of the array when there's no results, which the
+  // decoder simply skips.
+  SearchResponseDecoder decoder(&response, callback);
+  CallStreaming("SearchSubtitles", param_list, &decoder);
+  decoder.Finish();
 
-  response.data_.swap(ret);
+  return response;
+}
 
+SearchResponse XmlRpcImpl::SearchSubtitles(const string& token,
+                                           const SearchRequest& request,
+                                           CompactSubFiles* results) {
+  SearchResponse response;
+  SearchResponseDecoder decoder(&response, results);
+  CallStreaming("SearchSubtitles", SearchSubtitlesParams(token, request),
+                &decoder);
+  decoder.Finish();
   return response;
 }
 
 extern "C" SearchMailResponse XmlRpcImpl::SearchMailSubtitles(
           const string& token,
-          SearchMailRequest* request) {
+          const SearchMailRequest& request) {
     SearchMailResponse response;
     xmlrpc_c::paramList param_list;
 
     // fill in language array
     vector<value> lang_array;
-    for (vector<string>::const_iterator it = request->languages_.begin();
-        it != request->languages_.end(); ++it) {
+    for (vector<string>::const_iterator it = request.languages_.begin();
+        it != request.languages_.end(); ++it) {
       lang_array.push_back(value_string(*it));
     }
     value_array lang_list(lang_array);
@@ -192,8 +393,8 @@ extern "C" SearchMailResponse XmlRpcImpl::SearchMailSubtitles(
     // fill in movie data
     vector<value> movie_array;
     vector<pair<string, double> >::const_iterator it;
-    for (it = request->movies_.begin(); it != request->movies_.end(); ++it) {
-      StructDict d;
+    for (it = request.movies_.begin(); it != request.movies_.end(); ++it) {
+      map<string, value> d;
       d["moviehash"] = value_string(it->first);
       d["moviesize"] = value_double(it->second);
       movie_array.push_back(value_struct(d));
@@ -205,45 +406,33 @@ extern "C" SearchMailResponse XmlRpcImpl::SearchMailSubtitles(
     param_list.add(movie_list);
 
     value result;
-    client_.call(server_endpoint_, "SearchToMail", param_list, &result);
-    StructDict values = v(result);
+    Call("SearchToMail", param_list, &result);
+    StructView values(result);
 
-    response.SetStatus(s(values, "status"), d(values, "seconds"));
+    response.SetStatus(values.String("status"), values.Double("seconds"));
 
     return response;
 }
 
 extern "C" DownloadResponse XmlRpcImpl::DownloadSubtitles(
             const string& token,
-            DownloadRequest* request) {
+            const DownloadRequest& request) {
     DownloadResponse response;
-    xmlrpc_c::paramList param_list;
-
-    // fill in movie data
-    vector<value> movie_data(request->movies_.size());
-    std::transform(request->movies_.begin(), request->movies_.end(),
-                   movie_data.begin(), [](int id){return value_int(id);});
-    value_array movie_list(movie_data);
-
-    param_list.add(value_string(token));
-    param_list.add(movie_list);
-
     value result;
-    client_.call(server_endpoint_, "DownloadSubtitles", param_list, &result);
-    StructDict values = v(result);
+    Call("DownloadSubtitles", DownloadSubtitlesParams(token, request),
+         &result);
+    StructView values(result);
 
-    response.SetStatus(s(values, "status"), d(values, "seconds"));
+    response.SetStatus(values.String("status"), values.Double("seconds"));
 
     if (response.GetStatus() == OK) {
-      value data_field = values["data"];
-      vector<value> const data(
-          value_array(data_field).vectorValueValue());
+      vector<value> const data(values.Array("data"));
       for (vector<value>::const_iterator it =  data.begin();
            it != data.end(); ++it) {
-        StructDict subtitles = v(*it);
+        StructView subtitles(*it);
 
-        string sub_id = s(subtitles, "idsubtitlefile");
-        string sub_base64 = s(subtitles, "data");
+        string sub_id = subtitles.String("idsubtitlefile");
+        string sub_base64 = subtitles.String("data");
 
         response.subtitles_.push_back(make_pair(sub_id, sub_base64));
       }
@@ -252,52 +441,48 @@ extern "C" DownloadResponse XmlRpcImpl::DownloadSubtitles(
     return response;
 }
 
+extern "C" DownloadResponse XmlRpcImpl::DownloadSubtitles(
+            const string& token,
+            const DownloadRequest& request,
+            const DownloadResponseDecoder::Open& open) {
+    DownloadResponse response;
+    DownloadResponseDecoder decoder(&response, open);
+    CallStreaming("DownloadSubtitles", DownloadSubtitlesParams(token, request),
+                  &decoder);
+    decoder.Finish();
+
+    return response;
+}
+
 extern "C" ServerInfoResponse XmlRpcImpl::ServerInfo() {
   value result;
-  client_.call(server_endpoint_, "ServerInfo", &result);
-  StructDict values = v(result);
+  Call("ServerInfo", xmlrpc_c::paramList(), &result);
+  StructView values(result);
 
   ServerInfoResponse response;
-  response.xmlrpc_version_ = s(values, "xmlrpc_version");
-  response.xmlrpc_url_ = s(values, "xmlrpc_url");
-  response.application_ = s(values, "application");
-  response.contact_ = s(values, "contact");
-  response.website_url_ = s(values, "website_url");
-  response.users_online_total_ = i(values, "users_online_total");
-  response.users_online_program_ = i(values, "users_online_program");
-  response.users_loggedin_ = i(values, "users_loggedin");
-  response.users_max_alltime_ = s(values, "users_max_alltime");
-  response.users_registered_ = s(values, "users_registered");
-  response.subs_downloads_ = s(values, "subs_downloads");
-  response.subs_subtitle_files_ = s(values, "subs_subtitle_files");
-  response.movies_total_ = s(values, "movies_total");
-  response.movies_aka_ = s(values, "movies_aka");
-  response.total_subtitles_languages_ = s(values, "total_subtitles_languages");
-
-  StructDict langs = v(values["last_update_strings"]);
-
-  for (StructDict::const_iterator iter = langs.begin();
-       iter != langs.end(); ++iter) {
-    response.last_update_strings_[iter->first] = ds(iter->second);
-  }
+  Decode(values, TableOf<ServerInfoResponse, 32>(kServerInfoSchema),
+         &response);
+  values.StringMap("last_update_strings", &response.last_update_strings_);
 
   return response;
 }
 
 extern "C" ReportWrongMovieHashResponse XmlRpcImpl::ReportWrongMovieHash(
-        const string& token, ReportWrongMovieHashRequest* request) {
+        const string& token, const ReportWrongMovieHashRequest& request) {
   value result;
-  client_.call(server_endpoint_, "ReportWrongMovieHash", "si", &result,
-               token.c_str(), request->id_sub_movie_file_);
-  StructDict values = v(result);
+  xmlrpc_c::paramList param_list;
+  param_list.add(value_string(token));
+  param_list.add(value_int(static_cast<int>(request.id_sub_movie_file_)));
+  Call("ReportWrongMovieHash", param_list, &result);
+  StructView values(result);
   ReportWrongMovieHashResponse response;
-  response.SetStatus(s(values, "status"), d(values, "seconds"));
+  response.SetStatus(values.String("status"), values.Double("seconds"));
 
   return response;
 }
 
 extern "C" SubtitlesVoteResponse XmlRpcImpl::SubtitlesVote(
-         const string& token, SubtitlesVoteRequest* req) {
+         const string& token, const SubtitlesVoteRequest& req) {
   value result;
   SubtitlesVoteResponse response;
 
@@ -305,89 +490,88 @@ extern "C" SubtitlesVoteResponse XmlRpcImpl::SubtitlesVote(
   param_list.add(value_string(token));
   map<string, value> req_map;
   req_map.insert(make_pair("idsubtitle", value_int(
-            req->id_subtitle_)));
+            req.id_subtitle_)));
   req_map.insert(make_pair("score", value_int(
-            req->score_)));
+            req.score_)));
   value_struct const request_value(req_map);
   param_list.add(request_value);
 
-  client_.call(server_endpoint_, "SubtitlesVote", param_list, &result);
-  StructDict values = v(result);
-  response.SetStatus(s(values, "status"), d(values, "seconds"));
+  Call("SubtitlesVote", param_list, &result);
+  StructView values(result);
+  response.SetStatus(values.String("status"), values.Double("seconds"));
 
   return response;
 }
 
 AddCommentResponse XmlRpcImpl::AddComment(const string& token,
-                                          AddCommentRequest* req) {
+                                          const AddCommentRequest& req) {
   value result;
   AddCommentResponse response;
 
   xmlrpc_c::paramList param_list;
   param_list.add(value_string(token));
   map<string, value> req_map;
-  req_map.insert(make_pair("idsubtitle", value_int(req->id_subtitle_)));
-  req_map.insert(make_pair("comment", value_string(req->comment_)));
-  req_map.insert(make_pair("badsubtitle", value_int(req->bad_subtitle_)));
+  req_map.insert(make_pair("idsubtitle", value_int(req.id_subtitle_)));
+  req_map.insert(make_pair("comment", value_string(req.comment_)));
+  req_map.insert(make_pair("badsubtitle", value_int(req.bad_subtitle_)));
   value_struct const request_value(req_map);
   param_list.add(request_value);
 
-  client_.call(server_endpoint_, "AddComment", param_list, &result);
-  StructDict values = v(result);
-  response.SetStatus(s(values, "status"), d(values, "seconds"));
+  Call("AddComment", param_list, &result);
+  StructView values(result);
+  response.SetStatus(values.String("status"), values.Double("seconds"));
 
   return response;
 }
 
-CheckMovieHashResponse XmlRpcImpl::CheckMovieHash(const string& token,
-                                                  CheckMovieHashRequest* req) {
+CheckMovieHashResponse XmlRpcImpl::CheckMovieHash(
+    const string& token, const CheckMovieHashRequest& req) {
   CheckMovieHashResponse response;
   xmlrpc_c::paramList param_list;
   param_list.add(value_string(token));
 
   vector<value> movie_hashes;
-  for (const auto& hash : req->movie_hashes_) {
+  for (const auto& hash : req.movie_hashes_) {
     movie_hashes.push_back(value_string(hash));
   }
   param_list.add(value_array(movie_hashes));
 
   value result;
-  client_.call(server_endpoint_, "CheckMovieHash", param_list, &result);
-  StructDict values = v(result);
-  response.SetStatus(s(values, "status"), d(values, "seconds"));
+  Call("CheckMovieHash", param_list, &result);
+  StructView values(result);
+  response.SetStatus(values.String("status"), values.Double("seconds"));
 
-  StructDict data_field = v(values["data"]);
-  for (StructDict::const_iterator iter = data_field.begin();
+  StructView data_field = values.Struct("data");
+  for (StructView::const_iterator iter = data_field.begin();
        iter != data_field.end(); ++iter) {
-    StructDict info_field = v(iter->second);
-
-    response.movie_infos_.insert(make_pair(iter->first, MovieInfo(
-        s(info_field, "MovieHash"), s(info_field, "MovieImdbID"),
-        s(info_field, "MovieName"), s(info_field, "MovieYear"))));
+    MovieInfo info;
+    Decode(StructView(iter->second), TableOf<MovieInfo, 8>(kMovieInfoSchema),
+           &info);
+    response.movie_infos_.insert(make_pair(iter->first, info));
   }
 
   return response;
 }
 
 CheckSubHashResponse XmlRpcImpl::CheckSubHash(const string& token,
-                                              CheckSubHashRequest* req) {
+                                              const CheckSubHashRequest& req) {
   CheckSubHashResponse response;
   xmlrpc_c::paramList param_list;
   param_list.add(value_string(token));
 
   vector<value> sub_hashes;
-  for (const auto& hash : req->sub_hashes_) {
+  for (const auto& hash : req.sub_hashes_) {
     sub_hashes.push_back(value_string(hash));
   }
   param_list.add(value_array(sub_hashes));
 
   value result;
-  client_.call(server_endpoint_, "CheckSubHash", param_list, &result);
-  StructDict values = v(result);
-  response.SetStatus(s(values, "status"), d(values, "seconds"));
+  Call("CheckSubHash", param_list, &result);
+  StructView values(result);
+  response.SetStatus(values.String("status"), values.Double("seconds"));
 
-  StructDict data_field = v(values["data"]);
-  for (StructDict::const_iterator iter = data_field.begin();
+  StructView data_field = values.Struct("data");
+  for (StructView::const_iterator iter = data_field.begin();
        iter != data_field.end(); ++iter) {
     // work around crap in the API that returns int(0) when sub is not present
     // and string(<sub_id>) when it is. Gotta love fucking php.
@@ -404,51 +588,45 @@ CheckSubHashResponse XmlRpcImpl::CheckSubHash(const string& token,
 }
 
 GetSubLanguagesResponse XmlRpcImpl::GetSubLanguages(
-    GetSubLanguagesRequest* req) {
+    const GetSubLanguagesRequest& req) {
   GetSubLanguagesResponse response;
   value result;
-  client_.call(server_endpoint_, "GetSubLanguages", "s", &result,
-               req->lang_.c_str());
-  StructDict values = v(result);
+  Call("GetSubLanguages", StringParams({req.lang_}), &result);
+  StructView values(result);
   // seems like this method does not return status... consistent.
-  response.SetStatus("200 OK", d(values, "seconds"));
-  value data_field = values["data"];
-
+  response.SetStatus("200 OK", values.Double("seconds"));
   // parse results
-  vector<value> const data(
-      value_array(data_field).vectorValueValue());
+  vector<value> const data(values.Array("data"));
 
   for (vector<value>::const_iterator it =  data.begin();
         it != data.end(); ++it) {
-    StructDict info_field = v(*it);
-
-    response.lang_infos_.push_back(LangInfo(
-        s(info_field, "SubLanguageID"), s(info_field, "LanguageName"),
-        s(info_field, "ISO639")));
+    LangInfo info;
+    Decode(StructView(*it), TableOf<LangInfo, 7>(kLangInfoSchema), &info);
+    response.lang_infos_.push_back(info);
   }
 
   return response;
 }
 
-DetectLanguageResponse XmlRpcImpl::DetectLanguage(const string& token,
-                                                  DetectLanguageRequest* req) {
+DetectLanguageResponse XmlRpcImpl::DetectLanguage(
+    const string& token, const DetectLanguageRequest& req) {
   DetectLanguageResponse response;
   xmlrpc_c::paramList param_list;
   param_list.add(value_string(token));
 
   vector<value> movie_hashes;
-  for (const auto& hash : req->texts_) {
+  for (const auto& hash : req.texts_) {
     movie_hashes.push_back(value_string(hash));
   }
   param_list.add(value_array(movie_hashes));
 
   value result;
-  client_.call(server_endpoint_, "DetectLanguage", param_list, &result);
-  StructDict values = v(result);
-  response.SetStatus(s(values, "status"), d(values, "seconds"));
+  Call("DetectLanguage", param_list, &result);
+  StructView values(result);
+  response.SetStatus(values.String("status"), values.Double("seconds"));
 
-  StructDict data_field = v(values["data"]);
-  for (StructDict::const_iterator iter = data_field.begin();
+  StructView data_field = values.Struct("data");
+  for (StructView::const_iterator iter = data_field.begin();
        iter != data_field.end(); ++iter) {
     response.detected_langs_.insert(make_pair(value_string(iter->first),
                                               value_string(iter->second)));
@@ -458,132 +636,103 @@ DetectLanguageResponse XmlRpcImpl::DetectLanguage(const string& token,
 }
 
 GetAvailableTranslationsResponse XmlRpcImpl::GetAvailableTranslations(
-    const string& token, GetAvailableTranslationsRequest* req) {
+    const string& token, const GetAvailableTranslationsRequest& req) {
   GetAvailableTranslationsResponse response;
   value result;
-  client_.call(server_endpoint_, "GetAvailableTranslations", "ss", &result,
-               token.c_str(), req->program_.c_str());
-  StructDict values = v(result);
+  Call("GetAvailableTranslations", StringParams({token, req.program_}),
+       &result);
+  StructView values(result);
   // seems like this method does not return status... consistent.
-  response.SetStatus("200 OK", d(values, "seconds"));
-  StructDict data = v(values["data"]);
+  response.SetStatus("200 OK", values.Double("seconds"));
+  StructView data = values.Struct("data");
 
   for (const auto& trans : data) {
-    StructDict info_field = v(trans.second);
-
-    response.translation_infos_.insert(make_pair(
-        static_cast<string>(trans.first),
-        TranslationInfo(s(info_field, "LastCreated"),
-                        s(info_field, "StringsNo"))));
+    TranslationInfo info;
+    Decode(StructView(trans.second),
+           TableOf<TranslationInfo, 2>(kTranslationInfoSchema), &info);
+    response.translation_infos_.insert(make_pair(trans.first, info));
   }
 
   return response;
 }
 
-GetTranslationResponse XmlRpcImpl::GetTranslation(const string& token,
-                                                  GetTranslationRequest* req) {
+GetTranslationResponse XmlRpcImpl::GetTranslation(
+    const string& token, const GetTranslationRequest& req) {
   GetTranslationResponse response;
   value result;
-  client_.call(server_endpoint_, "GetTranslation", "ssss", &result,
-               token.c_str(), req->iso639_.c_str(), req->format_.c_str(),
-               req->program_.c_str());
-  StructDict values = v(result);
-  response.SetStatus(s(values, "status"), d(values, "seconds"));
-  if (!CheckResponse(values)) {
+  Call("GetTranslation",
+       StringParams({token, req.iso639_, req.format_, req.program_}),
+       &result);
+  StructView values(result);
+  response.SetStatus(values.String("status"), values.Double("seconds"));
+  if (!values.Ok()) {
     throw SubtleException(response.StatusMessage());
   }
-  response.translation_ = s(values, "data");
+  response.translation_ = values.String("data");
 
   return response;
 }
 
-AutoUpdateResponse XmlRpcImpl::AutoUpdate(AutoUpdateRequest* req) {
+AutoUpdateResponse XmlRpcImpl::AutoUpdate(const AutoUpdateRequest& req) {
   value result;
-  client_.call(server_endpoint_, "AutoUpdate", "s", &result,
-               req->program_.c_str());
-  StructDict values = v(result);
-
-  // only one OS linx might be present
-  string windows, linux, comments;
-  if (values.find("url_windows") != values.end()) {
-    windows = s(values, "url_windows");
-  }
-  if (values.find("url_linux") != values.end()) {
-    linux = s(values, "url_linux");
-  }
-  if (values.find("comments") != values.end()) {
-    comments = s(values, "comments");
-  }
+  Call("AutoUpdate", StringParams({req.program_}), &result);
+  StructView values(result);
+
+  // only one OS linx might be present, the others stay empty
   AutoUpdateResponse response;
-  response.version_ = s(values, "version");
-  response.url_windows_ = windows;
-  response.url_linux_ = linux;
-  response.comments_ = comments;
-  response.SetStatus(s(values, "status"), d(values, "seconds"));
+  Decode(values, TableOf<AutoUpdateResponse, 14>(kAutoUpdateSchema),
+         &response);
+  response.SetStatus(values.String("status"), values.Double("seconds"));
 
   return response;
 }
 
 SearchMoviesOnImdbResponse XmlRpcImpl::SearchMoviesOnImdb(const string& token,
-    SearchMoviesOnImdbRequest* req) {
+    const SearchMoviesOnImdbRequest& req) {
   SearchMoviesOnImdbResponse response;
   value result;
-  client_.call(server_endpoint_, "SearchMoviesOnIMDB", "ss", &result,
-               token.c_str(), req->query_.c_str());
-  StructDict values = v(result);
-  response.SetStatus(s(values, "status"), d(values, "seconds"));
-
-  value data_field = values["data"];
+  Call("SearchMoviesOnIMDB", StringParams({token, req.query_}), &result);
+  StructView values(result);
+  response.SetStatus(values.String("status"), values.Double("seconds"));
 
   // parse results
-  vector<value> const data(
-      value_array(data_field).vectorValueValue());
+  vector<value> const data(values.Array("data"));
 
   for (vector<value>::const_iterator it =  data.begin();
         it != data.end(); ++it) {
-    StructDict info_field = v(*it);
-
-    response.imdb_results_.push_back(ImdbEntry {
-        s(info_field, "id"), s(info_field, "title")});
+    ImdbEntry entry;
+    Decode(StructView(*it), TableOf<ImdbEntry, 2>(kImdbEntrySchema), &entry);
+    response.imdb_results_.push_back(entry);
   }
 
   return response;
 }
 
 GetImdbMovieDetailsResponse XmlRpcImpl::GetImdbMovieDetails(const string& token,
-        GetImdbMovieDetailsRequest* req) {
+        const GetImdbMovieDetailsRequest& req) {
   GetImdbMovieDetailsResponse response;
   value result;
-  client_.call(server_endpoint_, "GetIMDBMovieDetails", "ss", &result,
-               token.c_str(), req->imdb_id_.c_str());
-  StructDict values = v(result);
-  response.SetStatus(s(values, "status"), d(values, "seconds"));
+  Call("GetIMDBMovieDetails", StringParams({token, req.imdb_id_}), &result);
+  StructView values(result);
+  response.SetStatus(values.String("status"), values.Double("seconds"));
 
-  StructDict data_field = v(values["data"]);
+  StructView data_field = values.Struct("data");
 
   // simple fields
   try {
-    response.id_ = s(data_field, "id");
-    response.title_ = s(data_field, "title");
-    response.year_ = s(data_field, "year");
-    response.cover_ = s(data_field, "cover");
-    response.awards_ = s(data_field, "awards");
-    response.duration_ = s(data_field, "duration");
-    response.tagline_ = s(data_field, "tagline");
-    response.plot_ = s(data_field, "plot");
-    response.goofs_ = s(data_field, "goofs");
-    response.trivia_ = s(data_field, "trivia");
-    response.request_from_ = s(data_field, "request_from");
+    Decode(data_field,
+           TableOf<GetImdbMovieDetailsResponse, 35>(kImdbDetailsSchema),
+           &response);
 
     // maps
-    ToStrMap(data_field, "cast", &response.cast_);
-    ToStrMap(data_field, "directors", &response.directors_);
-    ToStrMap(data_field, "writers", &response.writers_);
+    data_field.StringMap("cast", &response.cast_);
+    data_field.StringMap("directors", &response.directors_);
+    data_field.StringMap("writers", &response.writers_);
 
     // arrays
-    ToStrVector(data_field, "genres", &response.genres_);
-    ToStrVector(data_field, "countries", &response.countries_);
-    ToStrVector(data_field, "languages", &response.languages_);
+    data_field.StringVector("genres", &response.genres_);
+    data_field.StringVector("countries", &response.countries_);
+    data_field.StringVector("languages", &response.languages_);
   } catch(...) {
       // kitten dies, but this php api just randomly returns crap from scraping
       // IMDb (e.g. javascript code), as the site changes.
@@ -593,23 +742,23 @@ GetImdbMovieDetailsResponse XmlRpcImpl::GetImdbMovieDetails(const string& token,
 }
 
 InsertMovieResponse XmlRpcImpl::InsertMovie(const string& token,
-                                            InsertMovieRequest* req) {
+                                            const InsertMovieRequest& req) {
   InsertMovieResponse response;
   xmlrpc_c::paramList param_list;
   param_list.add(value_string(token));
   map<string, value> req_map;
 
-  req_map.insert(make_pair("moviename", value_string(req->movie_name_)));
-  req_map.insert(make_pair("movieyear", value_string(req->movie_year_)));
+  req_map.insert(make_pair("moviename", value_string(req.movie_name_)));
+  req_map.insert(make_pair("movieyear", value_string(req.movie_year_)));
 
   value_struct const request_value(req_map);
   param_list.add(request_value);
 
   value result;
-  client_.call(server_endpoint_, "InsertMovie", param_list, &result);
-  StructDict values = v(result);
-  response.SetStatus(s(values, "status"), d(values, "seconds"));
-  response.id_ = s(values, "id");
+  Call("InsertMovie", param_list, &result);
+  StructView values(result);
+  response.SetStatus(values.String("status"), values.Double("seconds"));
+  response.id_ = values.String("id");
 
   return response;
 }
@@ -2,66 +2,135 @@
 #define SRC_RPC_IMPL_H_
 
 #include <xmlrpc-c/base.hpp>
-#include <xmlrpc-c/client_simple.hpp>
 
+#include <memory>
 #include <string>
 
+#include "src/byte_sink.h"
+#include "src/transport.h"
 #include "src/xml_rpc_client.h"
+#include "src/xmlrpc_stream.h"
 
 using std::string;
 
 namespace libsubtle {
 
+/// \return parameters of a SearchSubtitles call.
+xmlrpc_c::paramList SearchSubtitlesParams(const string& token,
+                                          const SearchRequest& req);
+
+/// \return parameters of a DownloadSubtitles call.
+xmlrpc_c::paramList DownloadSubtitlesParams(const string& token,
+                                            const DownloadRequest& req);
+
+/// Client of the service over XML-RPC.
+///
+/// Safe to call from several threads at once once Init has been called:
+/// calls share the configuration but not connections, each one borrowing a
+/// connection of its own from the transport. Session tokens are passed in,
+/// so one token, typically from a SessionManager, serves all threads.
 class XmlRpcImpl : public XmlRpcClient {
  public:
+  /// Calls go over a CurlTransport owned by the client.
+  XmlRpcImpl();
+  /// \param transport carries the calls; not owned.
+  explicit XmlRpcImpl(Transport* transport);
   ~XmlRpcImpl();
 
+  // the calls taking requests by pointer forward to the ones below
+  SUBTLE_POINTER_CALLS
+
   // Session handling
-  LoginResponse LogIn(LoginRequest* req);
+  LoginResponse LogIn(const LoginRequest& req);
   LogOutResponse LogOut(const string& token);
   NoOperationResponse NoOperation(const string& token);
 
   // Search and download
-  SearchResponse SearchSubtitles(const string& token, SearchRequest* req);
+  SearchResponse SearchSubtitles(const string& token,
+                                 const SearchRequest& req);
+  /// Find subtitles, decoding the response as it is parsed.
+  /// \param token Service authentication token.
+  /// \param req specification of action.
+  /// \param callback receives each subtitle as soon as it is decoded; the
+  ///        returned response carries the status only.
+  /// \return response with the status of the call.
+  SearchResponse SearchSubtitles(
+      const string& token, const SearchRequest& req,
+      const SearchResponseDecoder::Callback& callback);
+  /// Find subtitles, decoding the response straight into a compact set.
+  /// Reusing the set across calls, after a Clear, saves allocating per
+  /// result.
+  /// \param results receives the subtitles found.
+  /// \return response with the status of the call.
+  SearchResponse SearchSubtitles(const string& token,
+                                 const SearchRequest& req,
+                                 CompactSubFiles* results);
   SearchMailResponse SearchMailSubtitles(const string& token,
-                                         SearchMailRequest* req);
-  DownloadResponse DownloadSubtitles(const string& token, DownloadRequest* req);
+                                         const SearchMailRequest& req);
+  DownloadResponse DownloadSubtitles(const string& token,
+                                     const DownloadRequest& req);
+  /// Download subtitles, streaming the data of each one into a sink while the
+  /// response arrives, so memory use does not grow with the payload.
+  /// \param token Service authentication token.
+  /// \param req specification of action.
+  /// \param open chooses the sink for the base64 data of each subtitle.
+  /// \return response with the status of the call, and the ids of the
+  ///         subtitles received paired with empty data.
+  DownloadResponse DownloadSubtitles(const string& token,
+                                     const DownloadRequest& req,
+                                     const DownloadResponseDecoder::Open& open);
 
   // Reporting and rating
   ServerInfoResponse ServerInfo();
   ReportWrongMovieHashResponse ReportWrongMovieHash(
-    const string& token, ReportWrongMovieHashRequest* req);
+    const string& token, const ReportWrongMovieHashRequest& req);
   SubtitlesVoteResponse SubtitlesVote(const string& token,
-                                      SubtitlesVoteRequest* req);
+                                      const SubtitlesVoteRequest& req);
   AddCommentResponse AddComment(const string& token,
-                                AddCommentRequest* req);
+                                const AddCommentRequest& req);
 
 
   // User interface
-  GetSubLanguagesResponse GetSubLanguages(GetSubLanguagesRequest* req);
+  GetSubLanguagesResponse GetSubLanguages(const GetSubLanguagesRequest& req);
   DetectLanguageResponse DetectLanguage(const string& token,
-                                        DetectLanguageRequest* req);
+                                        const DetectLanguageRequest& req);
   GetAvailableTranslationsResponse GetAvailableTranslations(const string& token,
-        GetAvailableTranslationsRequest* req);
+        const GetAvailableTranslationsRequest& req);
   GetTranslationResponse GetTranslation(const string& token,
-                                        GetTranslationRequest* req);
-  AutoUpdateResponse AutoUpdate(AutoUpdateRequest* req);
+                                        const GetTranslationRequest& req);
+  AutoUpdateResponse AutoUpdate(const AutoUpdateRequest& req);
 
   // Checking
   CheckMovieHashResponse CheckMovieHash(const string& token,
-                                        CheckMovieHashRequest* req);
+                                        const CheckMovieHashRequest& req);
   CheckSubHashResponse CheckSubHash(const string& token,
-                                    CheckSubHashRequest* req);
+                                    const CheckSubHashRequest& req);
 
   // Movies
   SearchMoviesOnImdbResponse SearchMoviesOnImdb(const string& token,
-                                                SearchMoviesOnImdbRequest* req);
+        const SearchMoviesOnImdbRequest& req);
   GetImdbMovieDetailsResponse GetImdbMovieDetails(const string& token,
-        GetImdbMovieDetailsRequest* req);
-  InsertMovieResponse InsertMovie(const string& token, InsertMovieRequest* req);
+        const GetImdbMovieDetailsRequest& req);
+  InsertMovieResponse InsertMovie(const string& token,
+                                  const InsertMovieRequest& req);
 
  private:
-  xmlrpc_c::clientSimple client_;
+  XmlRpcImpl(const XmlRpcImpl&);
+  void operator=(const XmlRpcImpl&);
+
+  /// Call a method and decode the whole response into a value tree.
+  /// Throws SubtleException when the service answers with a fault.
+  /// \param method a literal, as it also names the span traced for the call.
+  void Call(const char* method, const xmlrpc_c::paramList& params,
+            xmlrpc_c::value* result);
+
+  /// Call a method and feed the response XML to the handler as it arrives,
+  /// without holding the whole response or building a value tree.
+  void CallStreaming(const char* method, const xmlrpc_c::paramList& params,
+                     XmlRpcHandler* handler);
+
+  std::unique_ptr<Transport> own_transport_;
+  Transport* transport_;
 };
 
 }  // namespace libsubtle
@@ -0,0 +1,120 @@
+#include <xmlrpc-c/xml.hpp>
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/mock_server.h"
+#include "src/rpc_impl.h"
+#include "src/rpc_stats.h"
+#include "src/session.h"
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+// Stands in for the service: hands out one token and accepts only it.
+class FakeService {
+ public:
+  FakeService() : logins_(0) {}
+
+  string Respond(const string& request) {
+    string method;
+    xmlrpc_c::paramList params;
+    xmlrpc_c::xml::parseCall(request, &method, &params);
+    map<string, xmlrpc_c::value> result;
+    bool ok = true;
+    if (method == "LogIn") {
+      ++logins_;
+      result["token"] = xmlrpc_c::value_string("token");
+    } else if (params.size() > 0) {
+      ok = xmlrpc_c::value_string(params[0]) == string("token");
+    }
+    result["status"] = xmlrpc_c::value_string(ok ? "200 OK"
+                                                 : "406 No session");
+    result["seconds"] = xmlrpc_c::value_double(0.001);
+    string xml;
+    xmlrpc_c::xml::generateResponse(
+        xmlrpc_c::rpcOutcome(xmlrpc_c::value_struct(result)), &xml);
+    return xml;
+  }
+
+  std::atomic<int> logins_;
+};
+
+TEST(XmlRpcImpl, ManyThreads) {
+  const int kThreads = 16;
+  const int kCalls = 100;
+  FakeService service;
+  MockServer server([&service](const string& request) {
+    return service.Respond(request);
+  });
+  CurlTransport transport;
+  XmlRpcImpl client(&transport);
+  client.Init("libsubtle test", server.url());
+  SessionOptions options;
+  options.cache_path = "-";
+  options.keepalive = false;
+  SessionManager session(&client, options);
+
+  std::atomic<int> failures(0);
+  vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.push_back(std::thread([&] {
+      for (int i = 0; i < kCalls; ++i) {
+        NoOperationResponse res = session.Run([&](const string& token) {
+          return client.NoOperation(token);
+        });
+        failures += res.GetStatus() != OK;
+      }
+    }));
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(0, failures.load());
+  // the token is shared by all threads, connections are reused
+  ASSERT_EQ(1, service.logins_.load());
+  ASSERT_EQ(kThreads * kCalls + 1, server.requests());
+  ASSERT_LE(server.connections(), kThreads);
+}
+
+TEST(XmlRpcImpl, Observer) {
+  FakeService service;
+  MockServer server([&service](const string& request) {
+    return service.Respond(request);
+  });
+  CurlTransport transport;
+  XmlRpcImpl client(&transport);
+  client.Init("libsubtle test", server.url());
+  RpcStats stats;
+  client.SetObserver(&stats);
+
+  client.NoOperation("token");
+  client.NoOperation("expired");
+  client.SearchSubtitles("token", SearchRequest("eng", "7d9cd5def91c9432",
+                                                735934464));
+
+  std::map<string, RpcStats::Method> methods = stats.Snapshot();
+  const RpcStats::Method& noop = methods["NoOperation"];
+  ASSERT_EQ(2u, noop.calls);
+  ASSERT_EQ(0u, noop.failures);
+  ASSERT_EQ(1u, noop.statuses.at(OK));
+  ASSERT_EQ(1u, noop.statuses.at(NO_SESSION));
+  ASSERT_GT(noop.request_bytes, 0u);
+  ASSERT_GT(noop.response_bytes, 0u);
+  ASSERT_EQ(2u, noop.latency.count());
+  // decoded as it streams in
+  ASSERT_EQ(1u, methods["SearchSubtitles"].statuses.at(OK));
+
+  client.SetObserver(NULL);
+  client.NoOperation("token");
+  ASSERT_EQ(2u, stats.Snapshot()["NoOperation"].calls);
+}
+
+}  // namespace libsubtle
@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+#include "src/rpc_stats.h"
+
+using std::string;
+
+namespace libsubtle {
+
+namespace {
+
+// Each power of two above kSubBuckets is split into kSubBuckets / 2 linear
+// buckets, which keeps values to within 1 / 128.
+const int kSubBucketBits = 8;
+const uint64_t kSubBuckets = 1 << kSubBucketBits;
+const uint64_t kHalf = kSubBuckets / 2;
+// about 19 hours; longer values count as this
+const uint64_t kMaxMicros = (1ull << 36) - 1;
+
+int HighestBit(uint64_t value) {
+  return 63 - __builtin_clzll(value);
+}
+
+}  // namespace
+
+LatencyHistogram::LatencyHistogram()
+    : counts_(Bucket(kMaxMicros) + 1),
+      count_(0),
+      sum_(0),
+      min_(0),
+      max_(0) {}
+
+size_t LatencyHistogram::Bucket(uint64_t micros) {
+  if (micros < kSubBuckets) {
+    return micros;
+  }
+  int shift = HighestBit(micros) - kSubBucketBits + 1;
+  return kSubBuckets + (shift - 1) * kHalf + ((micros >> shift) - kHalf);
+}
+
+uint64_t LatencyHistogram::Highest(size_t bucket) {
+  if (bucket < kSubBuckets) {
+    return bucket;
+  }
+  int shift = (bucket - kSubBuckets) / kHalf + 1;
+  uint64_t top = (bucket - kSubBuckets) % kHalf + kHalf;
+  return ((top + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t micros) {
+  micros = std::min(micros, kMaxMicros);
+  ++counts_[Bucket(micros)];
+  min_ = count_ ? std::min(min_, micros) : micros;
+  max_ = std::max(max_, micros);
+  sum_ += micros;
+  ++count_;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+  if (other.count_ == 0) {
+    return;
+  }
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    counts_[i] += other.counts_[i];
+  }
+  min_ = count_ ? std::min(min_, other.min_) : other.min_;
+  max_ = std::max(max_, other.max_);
+  sum_ += other.sum_;
+  count_ += other.count_;
+}
+
+uint64_t LatencyHistogram::Percentile(double percentile) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  uint64_t rank = static_cast<uint64_t>(
+      std::ceil(std::min(percentile, 100.0) / 100 * count_));
+  rank = std::max<uint64_t>(rank, 1);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    seen += counts_[i];
+    if (seen >= rank) {
+      return std::min(Highest(i), max_);
+    }
+  }
+  return max_;
+}
+
+RpcStats::Method::Method()
+    : calls(0),
+      failures(0),
+      request_bytes(0),
+      response_bytes(0),
+      phases(TransferStats()),
+      parse(0) {}
+
+void RpcStats::OnCall(const RpcCallStats& call) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Method& method = methods_[call.method];
+  ++method.calls;
+  method.failures += call.failed;
+  if (call.status != 0) {
+    ++method.statuses[call.status];
+  }
+  method.request_bytes += call.transfer.request_bytes;
+  method.response_bytes += call.transfer.response_bytes;
+  method.phases.name_lookup += call.transfer.name_lookup;
+  method.phases.connect += call.transfer.connect;
+  method.phases.tls += call.transfer.tls;
+  method.phases.wait += call.transfer.wait;
+  method.phases.transfer += call.transfer.transfer;
+  method.parse += call.parse;
+  method.latency.Record(static_cast<uint64_t>(call.total * 1e6));
+}
+
+std::map<string, RpcStats::Method> RpcStats::Snapshot() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return methods_;
+}
+
+void RpcStats::Print(std::ostream& out) const {
+  std::map<string, Method> methods = Snapshot();
+  char line[256];
+  snprintf(line, sizeof(line),
+           "%-26s %7s %6s %9s %9s %9s %9s | mean ms: %6s %6s %6s %6s %6s "
+           "%6s | %10s %10s\n",
+           "method", "calls", "failed", "p50 ms", "p90 ms", "p99 ms",
+           "max ms", "dns", "conn", "tls", "wait", "xfer", "parse", "sent",
+           "received");
+  out << line;
+  for (const auto& entry : methods) {
+    const Method& m = entry.second;
+    double calls = static_cast<double>(m.calls);
+    snprintf(line, sizeof(line),
+             "%-26s %7llu %6llu %9.2f %9.2f %9.2f %9.2f | %15.2f %6.2f %6.2f "
+             "%6.2f %6.2f %6.2f | %10llu %10llu\n",
+             entry.first.c_str(), static_cast<unsigned long long>(m.calls),
+             static_cast<unsigned long long>(m.failures),
+             m.latency.Percentile(50) / 1e3, m.latency.Percentile(90) / 1e3,
+             m.latency.Percentile(99) / 1e3, m.latency.max() / 1e3,
+             m.phases.name_lookup * 1e3 / calls,
+             m.phases.connect * 1e3 / calls, m.phases.tls * 1e3 / calls,
+             m.phases.wait * 1e3 / calls, m.phases.transfer * 1e3 / calls,
+             m.parse * 1e3 / calls,
+             static_cast<unsigned long long>(m.request_bytes),
+             static_cast<unsigned long long>(m.response_bytes));
+    out << line;
+  }
+}
+
+void RpcMetrics::OnCall(const RpcCallStats& call) {
+  string method = metrics::Labels({{"method", call.method}});
+  // calls that failed before the service answered have no status
+  string status = call.status ? std::to_string(call.status) : "error";
+  registry_->GetCounter(
+      "subtle_rpc_calls_total", "XML-RPC calls made, by status answered.",
+      metrics::Labels({{"method", call.method}, {"status", status}}))->Add();
+  registry_->GetHistogram(
+      "subtle_rpc_duration_seconds", "Latency of XML-RPC calls.",
+      metrics::LatencyBounds(), method)->Observe(call.total);
+  registry_->GetCounter(
+      "subtle_rpc_request_bytes_total", "Bytes of XML-RPC requests sent.",
+      method)->Add(call.transfer.request_bytes);
+  registry_->GetCounter(
+      "subtle_rpc_response_bytes_total",
+      "Bytes of XML-RPC responses received.",
+      method)->Add(call.transfer.response_bytes);
+  if (next_) {
+    next_->OnCall(call);
+  }
+}
+
+}  // namespace libsubtle
@@ -0,0 +1,152 @@
+#ifndef SRC_RPC_STATS_H_
+#define SRC_RPC_STATS_H_
+
+#include <cinttypes>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "src/metrics.h"
+#include "src/transport.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+/// What one call to the service cost, as seen by the client.
+struct RpcCallStats {
+  /// XML-RPC method called, e.g. "SearchSubtitles".
+  string method;
+  /// Status the service answered with, as in Status; 0 when the call failed
+  /// before one was decoded.
+  int status;
+  /// Whether the call threw: the transport failed, or the service answered
+  /// with a fault.
+  bool failed;
+  /// Phases of the transfer, and bytes on the wire.
+  TransferStats transfer;
+  /// Seconds spent decoding the response. Streamed responses are decoded
+  /// as they arrive, so this overlaps the transfer.
+  double parse;
+  /// Seconds from building the call to decoding the whole response.
+  double total;
+};
+
+/// Notified of every call a client makes, e.g. to keep statistics.
+class RpcObserver {
+ public:
+  virtual ~RpcObserver() {}
+
+  /// Called once a call is over, on the thread that made it. Calls may
+  /// come from several threads at once; this must not throw, and should
+  /// return quickly.
+  virtual void OnCall(const RpcCallStats& call) = 0;
+};
+
+/// Histogram of latencies in the manner of HdrHistogram: buckets are linear
+/// within each power of two, so values are kept to within 1% up to hours
+/// with a few thousand counters.
+class LatencyHistogram {
+ public:
+  LatencyHistogram();
+
+  /// Count one value, in microseconds.
+  void Record(uint64_t micros);
+  /// Add the counts of another histogram.
+  void Merge(const LatencyHistogram& other);
+
+  uint64_t count() const { return count_; }
+  uint64_t min() const { return count_ ? min_ : 0; }
+  uint64_t max() const { return max_; }
+  double mean() const { return count_ ? static_cast<double>(sum_) / count_
+                                      : 0; }
+
+  /// \param percentile between 0 and 100.
+  /// \return highest value, in microseconds, equivalent to the one below
+  ///         which that percentile of the values fall; 0 when empty.
+  uint64_t Percentile(double percentile) const;
+
+ private:
+  static size_t Bucket(uint64_t micros);
+  static uint64_t Highest(size_t bucket);
+
+  vector<uint64_t> counts_;
+  uint64_t count_;
+  uint64_t sum_;
+  uint64_t min_;
+  uint64_t max_;
+};
+
+/// Collects statistics per method from the calls of a client: counts by
+/// status, bytes, time per phase, and a histogram of call latency.
+///
+///   RpcStats stats;
+///   client.SetObserver(&stats);
+///   ...
+///   stats.Print(std::cerr);
+class RpcStats : public RpcObserver {
+ public:
+  /// Statistics of one method.
+  struct Method {
+    Method();
+
+    uint64_t calls;
+    uint64_t failures;
+    /// Calls by status answered.
+    std::map<int, uint64_t> statuses;
+    uint64_t request_bytes;
+    uint64_t response_bytes;
+    /// Seconds spent in each phase, summed over the calls.
+    TransferStats phases;
+    double parse;
+    /// Latency of whole calls.
+    LatencyHistogram latency;
+  };
+
+  RpcStats() {}
+
+  void OnCall(const RpcCallStats& call);
+
+  /// \return statistics so far, by method.
+  std::map<string, Method> Snapshot() const;
+
+  /// Print a table of the statistics so far, one line per method.
+  void Print(std::ostream& out) const;
+
+ private:
+  RpcStats(const RpcStats&);
+  void operator=(const RpcStats&);
+
+  mutable std::mutex mutex_;
+  std::map<string, Method> methods_;
+};
+
+/// Keeps the calls of a client in a metrics registry: calls by method and
+/// status, their latency, and bytes on the wire.
+///
+///   RpcMetrics rpc_metrics(metrics::Registry::Default());
+///   client.SetObserver(&rpc_metrics);
+class RpcMetrics : public RpcObserver {
+ public:
+  /// \param registry the metrics go to; not owned.
+  /// \param next observer also told of every call, e.g. an RpcStats; not
+  ///        owned, NULL for none.
+  explicit RpcMetrics(metrics::Registry* registry, RpcObserver* next = NULL)
+      : registry_(registry), next_(next) {}
+
+  void OnCall(const RpcCallStats& call);
+
+ private:
+  RpcMetrics(const RpcMetrics&);
+  void operator=(const RpcMetrics&);
+
+  metrics::Registry* registry_;
+  RpcObserver* next_;
+};
+
+}  // namespace libsubtle
+
+#endif  // SRC_RPC_STATS_H_
@@ -0,0 +1,95 @@
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "src/mock_server.h"
+#include "src/rpc_stats.h"
+#include "src/transport.h"
+
+using std::string;
+
+namespace libsubtle {
+
+TEST(LatencyHistogram, Percentiles) {
+  LatencyHistogram histogram;
+  ASSERT_EQ(0u, histogram.Percentile(50));
+  for (uint64_t micros = 1; micros <= 100000; ++micros) {
+    histogram.Record(micros);
+  }
+  ASSERT_EQ(100000u, histogram.count());
+  ASSERT_EQ(1u, histogram.min());
+  ASSERT_EQ(100000u, histogram.max());
+  ASSERT_DOUBLE_EQ(50000.5, histogram.mean());
+  // within 1% of the exact values
+  ASSERT_NEAR(50000, histogram.Percentile(50), 500);
+  ASSERT_NEAR(99000, histogram.Percentile(99), 990);
+  ASSERT_EQ(100000u, histogram.Percentile(100));
+  ASSERT_EQ(1u, histogram.Percentile(0));
+
+  LatencyHistogram other;
+  other.Record(3600ull * 1000000);
+  histogram.Merge(other);
+  ASSERT_EQ(100001u, histogram.count());
+  ASSERT_EQ(3600ull * 1000000, histogram.max());
+  ASSERT_NEAR(3600.0 * 1000000, histogram.Percentile(100), 3600.0 * 10000);
+}
+
+TEST(RpcStats, Collect) {
+  RpcStats stats;
+  RpcCallStats call;
+  call.method = "SearchSubtitles";
+  call.status = 200;
+  call.failed = false;
+  call.transfer = TransferStats();
+  call.transfer.wait = 0.1;
+  call.transfer.response_bytes = 1000;
+  call.parse = 0.01;
+  call.total = 0.2;
+  stats.OnCall(call);
+  stats.OnCall(call);
+  call.status = 0;
+  call.failed = true;
+  call.total = 1;
+  stats.OnCall(call);
+  call.method = "LogIn";
+  stats.OnCall(call);
+
+  std::map<string, RpcStats::Method> methods = stats.Snapshot();
+  ASSERT_EQ(2u, methods.size());
+  const RpcStats::Method& search = methods["SearchSubtitles"];
+  ASSERT_EQ(3u, search.calls);
+  ASSERT_EQ(1u, search.failures);
+  ASSERT_EQ(2u, search.statuses.at(200));
+  ASSERT_EQ(1u, search.statuses.size());
+  ASSERT_EQ(3000u, search.response_bytes);
+  ASSERT_NEAR(0.3, search.phases.wait, 1e-9);
+  ASSERT_NEAR(200000, search.latency.Percentile(50), 2000);
+  ASSERT_EQ(1000000u, search.latency.max());
+
+  std::ostringstream out;
+  stats.Print(out);
+  ASSERT_NE(string::npos, out.str().find("SearchSubtitles"));
+  ASSERT_NE(string::npos, out.str().find("LogIn"));
+}
+
+TEST(CurlTransport, Stats) {
+  MockServer server([](const string& request) {
+    return string(10000, 'x');
+  });
+  CurlTransport transport;
+  class NullSink : public ByteSink {
+   public:
+    void Write(const char* data, size_t size) {}
+  } response;
+  TransferStats stats;
+  transport.Post(server.url(), "test", "call", &response, &stats);
+  ASSERT_EQ(4u, stats.request_bytes);
+  ASSERT_EQ(10000u, stats.response_bytes);
+  ASSERT_GE(stats.name_lookup, 0);
+  ASSERT_GE(stats.connect, 0);
+  ASSERT_EQ(0, stats.tls);
+  ASSERT_GE(stats.wait, 0);
+  ASSERT_GE(stats.transfer, 0);
+}
+
+}  // namespace libsubtle
@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "src/scheduler.h"
+
+namespace libsubtle {
+
+namespace {
+
+// worker the current thread is, for routing posts to its own queue
+thread_local const Scheduler* current_scheduler = NULL;
+thread_local size_t current_worker = 0;
+
+}  // namespace
+
+Scheduler::Scheduler(size_t threads)
+    : timer_sequence_(0),
+      queued_(0),
+      pending_(0),
+      next_queue_(0),
+      steals_(0),
+      stop_(false) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (size_t i = 0; i < threads; ++i) {
+    queues_.push_back(std::unique_ptr<Queue>(new Queue()));
+  }
+  for (size_t i = 0; i < threads; ++i) {
+    threads_.push_back(std::thread(&Scheduler::Work, this, i));
+  }
+}
+
+Scheduler::~Scheduler() {
+  Wait();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+bool Scheduler::OnWorker() const {
+  return current_scheduler == this;
+}
+
+void Scheduler::Post(Task task) {
+  ++pending_;
+  Enqueue(std::move(task));
+}
+
+void Scheduler::PostAfter(std::chrono::milliseconds delay, Task task) {
+  ++pending_;
+  Timer timer;
+  timer.due = std::chrono::steady_clock::now() + delay;
+  timer.task = std::make_shared<Task>(std::move(task));
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    timer.sequence = timer_sequence_++;
+    timers_.push(timer);
+  }
+  // a sleeper may need to wake up earlier than it planned
+  wake_.notify_one();
+}
+
+void Scheduler::Enqueue(Task task) {
+  size_t index = OnWorker() ? current_worker
+                            : next_queue_++ % queues_.size();
+  {
+    std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+    queues_[index]->tasks.push_back(std::move(task));
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++queued_;
+  }
+  wake_.notify_one();
+}
+
+void Scheduler::Wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_.wait(lock, [this] { return pending_ == 0; });
+}
+
+bool Scheduler::Take(size_t self, Task* task) {
+  {
+    // own tasks newest first, while their data is still in cache
+    Queue& own = *queues_[self];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      *task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      --queued_;
+      return true;
+    }
+  }
+  for (size_t i = 1; i < queues_.size(); ++i) {
+    // others' tasks oldest first, the ones their owner would run last
+    Queue& victim = *queues_[(self + i) % queues_.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      *task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      --queued_;
+      ++steals_;
+      return true;
+    }
+  }
+  return false;
+}
+
+void Scheduler::FireTimers() {
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  while (!timers_.empty() && timers_.top().due <= now) {
+    std::shared_ptr<Task> task = timers_.top().task;
+    timers_.pop();
+    size_t index = next_queue_++ % queues_.size();
+    std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+    queues_[index]->tasks.push_back(std::move(*task));
+    ++queued_;
+    wake_.notify_one();
+  }
+}
+
+void Scheduler::Done() {
+  if (--pending_ == 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_.notify_all();
+  }
+}
+
+void Scheduler::Work(size_t self) {
+  current_scheduler = this;
+  current_worker = self;
+  for (;;) {
+    Task task;
+    if (Take(self, &task)) {
+      task();
+      Done();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    FireTimers();
+    if (queued_ > 0) {
+      continue;
+    }
+    if (stop_) {
+      return;
+    }
+    if (timers_.empty()) {
+      wake_.wait(lock);
+    } else {
+      wake_.wait_until(lock, timers_.top().due);
+    }
+  }
+}
+
+}  // namespace libsubtle
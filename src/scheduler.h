@@ -0,0 +1,100 @@
+#ifndef SRC_SCHEDULER_H_
+#define SRC_SCHEDULER_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+using std::vector;
+
+namespace libsubtle {
+
+/// Pool of worker threads running short tasks, with work stealing.
+///
+/// Every worker has its own queue. Tasks posted from a worker go to its own
+/// queue and are run newest first, which keeps related work on one thread;
+/// tasks posted from outside are spread over the queues. A worker whose
+/// queue is empty steals the oldest task of another before going to sleep,
+/// so no worker idles while any has a backlog.
+class Scheduler {
+ public:
+  typedef std::function<void()> Task;
+
+  /// \param threads number of workers; 0 picks one per core.
+  explicit Scheduler(size_t threads = 0);
+  /// Waits for all tasks, then stops the workers.
+  ~Scheduler();
+
+  /// Queue a task.
+  void Post(Task task);
+
+  /// Queue a task once a delay has passed.
+  void PostAfter(std::chrono::milliseconds delay, Task task);
+
+  /// Block until no task is queued, running or delayed.
+  void Wait();
+
+  /// \return whether the calling thread is one of the workers.
+  bool OnWorker() const;
+
+  size_t threads() const { return threads_.size(); }
+
+  /// \return number of tasks taken from the queue of another worker.
+  uint64_t steals() const { return steals_; }
+
+ private:
+  Scheduler(const Scheduler&);
+  void operator=(const Scheduler&);
+
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  struct Timer {
+    std::chrono::steady_clock::time_point due;
+    uint64_t sequence;
+    // shared so the heap can copy timers around cheaply
+    std::shared_ptr<Task> task;
+
+    bool operator>(const Timer& other) const {
+      return due > other.due || (due == other.due && sequence > other.sequence);
+    }
+  };
+
+  void Enqueue(Task task);
+  bool Take(size_t self, Task* task);
+  // Moves due timers to the queues, mutex_ held.
+  void FireTimers();
+  void Work(size_t self);
+  void Done();
+
+  vector<std::unique_ptr<Queue>> queues_;
+  vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable idle_;
+  std::priority_queue<Timer, vector<Timer>, std::greater<Timer>> timers_;
+  uint64_t timer_sequence_;
+  // tasks in the queues; changed with mutex_ held so sleepers see it
+  std::atomic<size_t> queued_;
+  // tasks queued, running or delayed
+  std::atomic<size_t> pending_;
+  std::atomic<size_t> next_queue_;
+  std::atomic<uint64_t> steals_;
+  bool stop_;
+};
+
+}  // namespace libsubtle
+
+#endif  // SRC_SCHEDULER_H_
@@ -0,0 +1,61 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "src/scheduler.h"
+
+namespace libsubtle {
+
+TEST(Scheduler, RunsEverything) {
+  std::atomic<int> runs(0);
+  Scheduler scheduler(4);
+  // tasks posting tasks, as pipeline stages do
+  for (int i = 0; i < 100; ++i) {
+    scheduler.Post([&] {
+      ASSERT_TRUE(scheduler.OnWorker());
+      for (int j = 0; j < 10; ++j) {
+        scheduler.Post([&] { ++runs; });
+      }
+    });
+  }
+  scheduler.Wait();
+  ASSERT_EQ(1000, runs.load());
+  ASSERT_FALSE(scheduler.OnWorker());
+}
+
+TEST(Scheduler, Steals) {
+  Scheduler scheduler(4);
+  std::atomic<int> runs(0);
+  // all the work lands in the queue of the worker running the first task
+  scheduler.Post([&] {
+    for (int i = 0; i < 64; ++i) {
+      scheduler.Post([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        ++runs;
+      });
+    }
+  });
+  scheduler.Wait();
+  ASSERT_EQ(64, runs.load());
+  ASSERT_GT(scheduler.steals(), 0u);
+}
+
+TEST(Scheduler, PostAfter) {
+  Scheduler scheduler(2);
+  std::atomic<int> order(0);
+  int first = 0, second = 0;
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  scheduler.PostAfter(std::chrono::milliseconds(60),
+                      [&] { second = ++order; });
+  scheduler.PostAfter(std::chrono::milliseconds(20),
+                      [&] { first = ++order; });
+  scheduler.Wait();
+  ASSERT_EQ(1, first);
+  ASSERT_EQ(2, second);
+  ASSERT_GE(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(60));
+}
+
+}  // namespace libsubtle
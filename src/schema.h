@@ -0,0 +1,133 @@
+#ifndef SRC_SCHEMA_H_
+#define SRC_SCHEMA_H_
+
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#include "src/string_pool.h"
+
+using std::string;
+
+namespace libsubtle {
+namespace schema {
+
+/// FNV-1a hash of a field name, usable in constant expressions.
+constexpr uint32_t Hash(const char* name, uint32_t hash = 2166136261u) {
+  return *name ? Hash(name + 1, (hash ^ static_cast<unsigned char>(*name)) *
+                                16777619u)
+               : hash;
+}
+
+/// FNV-1a hash of a field name of known length.
+inline uint32_t Hash(const char* name, size_t size) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ static_cast<unsigned char>(name[i])) * 16777619u;
+  }
+  return hash;
+}
+
+/// Describes one field of a decoded type: the name the service uses for it,
+/// and the parser that stores its text into the right member.
+template <typename T>
+struct Field {
+  const char* name;
+  uint32_t hash;
+  void (*parse)(T* target, const string& text);
+};
+
+/// Parser storing the text as is.
+template <typename T, string T::*member>
+void AssignString(T* target, const string& text) {
+  target->*member = text;
+}
+
+/// Parser interning the text into the shared StringPool.
+template <typename T, InternedString T::*member>
+void AssignInterned(T* target, const string& text) {
+  target->*member = StringPool::Shared()->Intern(text);
+}
+
+/// Schema entry for a string member.
+#define SUBTLE_FIELD(type, name, member) \
+  { name, ::libsubtle::schema::Hash(name), \
+    &::libsubtle::schema::AssignString<type, &type::member> }
+
+/// Schema entry for an interned string member.
+#define SUBTLE_FIELD_INTERNED(type, name, member) \
+  { name, ::libsubtle::schema::Hash(name), \
+    &::libsubtle::schema::AssignInterned<type, &type::member> }
+
+/// Schema entry with a custom parser.
+#define SUBTLE_FIELD_PARSER(type, name, parser) \
+  { name, ::libsubtle::schema::Hash(name), parser }
+
+/// Whether no two fields share a slot in a table of the given size.
+template <typename T>
+constexpr bool IsPerfect(const Field<T>* fields, size_t size, size_t slots,
+                         size_t i = 0, size_t j = 1) {
+  return i >= size ? true
+       : j >= size ? IsPerfect(fields, size, slots, i + 1, i + 2)
+       : fields[i].hash % slots == fields[j].hash % slots ? false
+       : IsPerfect(fields, size, slots, i, j + 1);
+}
+
+/// Number of fields in a schema.
+template <typename T, size_t N>
+constexpr size_t Size(const Field<T> (&)[N]) {
+  return N;
+}
+
+/// Fail compilation unless the schema hashes perfectly into the table size.
+#define SUBTLE_CHECK_SCHEMA(fields, slots) \
+  static_assert(::libsubtle::schema::IsPerfect( \
+                    fields, ::libsubtle::schema::Size(fields), slots), \
+                #fields " collides in " #slots " slots")
+
+/// Perfect hash table over a schema, dispatching field names to parsers with
+/// one hash and one comparison.
+template <typename T, size_t Slots>
+class Table {
+ public:
+  template <size_t N>
+  explicit Table(const Field<T> (&fields)[N]) {
+    for (size_t slot = 0; slot < Slots; ++slot) {
+      slots_[slot] = NULL;
+    }
+    for (size_t i = 0; i < N; ++i) {
+      slots_[fields[i].hash % Slots] = &fields[i];
+    }
+  }
+
+  /// \return the field with the given name, or NULL if it is not known.
+  const Field<T>* Find(const char* name, size_t size) const {
+    uint32_t hash = Hash(name, size);
+    const Field<T>* field = slots_[hash % Slots];
+    if (field == NULL || field->hash != hash ||
+        strncmp(field->name, name, size) || field->name[size] != '\0') {
+      return NULL;
+    }
+    return field;
+  }
+
+  /// Parse text into the member for the named field.
+  /// \return false if the field is not known.
+  bool Decode(T* target, const string& name, const string& text) const {
+    const Field<T>* field = Find(name.data(), name.size());
+    if (field == NULL) {
+      return false;
+    }
+    field->parse(target, text);
+    return true;
+  }
+
+ private:
+  const Field<T>* slots_[Slots];
+};
+
+}  // namespace schema
+}  // namespace libsubtle
+
+#endif  // SRC_SCHEMA_H_
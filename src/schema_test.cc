@@ -0,0 +1,57 @@
+#include <map>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "src/schema.h"
+#include "src/subfile.h"
+
+using std::map;
+using std::string;
+
+namespace libsubtle {
+
+struct Point {
+  string x_;
+  string y_;
+};
+
+constexpr schema::Field<Point> kPointSchema[] = {
+  SUBTLE_FIELD(Point, "x", x_),
+  SUBTLE_FIELD(Point, "y", y_)
+};
+SUBTLE_CHECK_SCHEMA(kPointSchema, 2);
+
+TEST(Schema, Hash) {
+  string name = "IDSubtitleFile";
+  ASSERT_EQ(schema::Hash("IDSubtitleFile"),
+            schema::Hash(name.data(), name.size()));
+  ASSERT_NE(schema::Hash("x"), schema::Hash("y"));
+}
+
+TEST(Schema, Table) {
+  schema::Table<Point, 2> table(kPointSchema);
+  Point p;
+
+  ASSERT_TRUE(table.Decode(&p, "x", "1"));
+  ASSERT_TRUE(table.Decode(&p, "y", "2"));
+  ASSERT_FALSE(table.Decode(&p, "z", "3"));
+  ASSERT_FALSE(table.Decode(&p, "xx", "4"));
+  ASSERT_EQ("1", p.x_);
+  ASSERT_EQ("2", p.y_);
+}
+
+TEST(Schema, SubFile) {
+  map<string, string> data;
+  data["IDSubtitleFile"] = "1951894257";
+  data["SubFileName"] = "Hobbit.srt";
+  data["QueryNumber"] = "0";
+  SubFile sub(data);
+
+  ASSERT_EQ("1951894257", sub.IDSubtitleFile_);
+  ASSERT_EQ("Hobbit.srt", sub.SubFileName_);
+  ASSERT_TRUE(sub.Set("SubRating", "8.0"));
+  ASSERT_FALSE(sub.Set("QueryNumber", "1"));
+  ASSERT_EQ("8.0", sub.SubRating_);
+}
+
+}  // namespace libsubtle
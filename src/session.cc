@@ -0,0 +1,326 @@
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <sstream>
+#include <string>
+
+#include "src/session.h"
+
+using std::string;
+
+namespace libsubtle {
+
+namespace {
+
+string DefaultCachePath() {
+  const char* cache_home = getenv("XDG_CACHE_HOME");
+  if (cache_home && *cache_home) {
+    return string(cache_home) + "/libsubtle/session";
+  }
+  const char* home = getenv("HOME");
+  if (home && *home) {
+    return string(home) + "/.cache/libsubtle/session";
+  }
+  return "";
+}
+
+// Create all directories leading to path.
+void MakeParentDirs(const string& path) {
+  for (size_t slash = path.find('/', 1); slash != string::npos;
+       slash = path.find('/', slash + 1)) {
+    mkdir(path.substr(0, slash).c_str(), 0700);
+  }
+}
+
+}  // namespace
+
+SessionManager::SessionManager(XmlRpcClient* client,
+                               const SessionOptions& options)
+    : client_(client),
+      options_(options),
+      expiry_(0),
+      in_flight_(0),
+      stop_(false) {
+  if (options_.cache_path.empty()) {
+    options_.cache_path = DefaultCachePath();
+  } else if (options_.cache_path == "-") {
+    options_.cache_path.clear();
+  }
+  // refreshing any closer to the expiry than this would never rest
+  options_.keepalive_margin_seconds =
+      std::min(options_.keepalive_margin_seconds, options_.ttl_seconds / 2);
+}
+
+SessionManager::~SessionManager() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  stop_cv_.notify_all();
+  if (keepalive_.joinable()) {
+    keepalive_.join();
+  }
+}
+
+string SessionManager::Token() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!token_.empty() && time(NULL) < expiry_) {
+      return token_;
+    }
+  }
+  std::lock_guard<std::mutex> login(login_mutex_);
+  {
+    // another thread may have logged in while this one waited
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!token_.empty() && time(NULL) < expiry_) {
+      return token_;
+    }
+  }
+
+  // only one process logs in, the others pick the token from the cache
+  time_t now = time(NULL);
+  int fd = LockCache();
+  string token;
+  time_t expiry;
+  try {
+    bool cached = false;
+    if (ReadCache(fd, &token, &expiry)) {
+      if (now < expiry) {
+        cached = true;
+      } else if (client_->NoOperation(token).GetStatus() == OK) {
+        // expiry is only an estimate, the session may well be alive
+        expiry = now + options_.ttl_seconds;
+        WriteCache(fd, token, expiry);
+        cached = true;
+      }
+    }
+    if (!cached) {
+      LoginRequest req(options_.username, options_.password, options_.lang);
+      LoginResponse res = client_->LogIn(req);
+      token = res.token_;
+      expiry = now + options_.ttl_seconds;
+      if (!token.empty()) {
+        WriteCache(fd, token, expiry);
+      }
+    }
+  } catch (...) {
+    UnlockCache(fd);
+    throw;
+  }
+  UnlockCache(fd);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    token_ = token;
+    expiry_ = expiry;
+    StartKeepalive();
+  }
+  stop_cv_.notify_all();
+  return token;
+}
+
+void SessionManager::Invalidate(const string& token) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (token == token_) {
+      token_.clear();
+      expiry_ = 0;
+    }
+  }
+  int fd = LockCache();
+  string cached;
+  time_t expiry;
+  if (ReadCache(fd, &cached, &expiry) && cached == token) {
+    WriteCache(fd, "", 0);
+  }
+  UnlockCache(fd);
+}
+
+void SessionManager::LogOut() {
+  string token;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    token.swap(token_);
+    expiry_ = 0;
+  }
+  int fd = LockCache();
+  WriteCache(fd, "", 0);
+  UnlockCache(fd);
+  if (!token.empty()) {
+    client_->LogOut(token);
+  }
+}
+
+SessionManager::InFlight::InFlight(SessionManager* session)
+    : session_(session) {
+  std::lock_guard<std::mutex> lock(session_->mutex_);
+  ++session_->in_flight_;
+}
+
+SessionManager::InFlight::~InFlight() {
+  {
+    std::lock_guard<std::mutex> lock(session_->mutex_);
+    --session_->in_flight_;
+    session_->expiry_ = time(NULL) + session_->options_.ttl_seconds;
+  }
+  session_->stop_cv_.notify_all();
+}
+
+int SessionManager::LockCache() const {
+  if (options_.cache_path.empty()) {
+    return -1;
+  }
+  MakeParentDirs(options_.cache_path);
+  int fd = open(options_.cache_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC,
+                0600);
+  if (fd < 0) {
+    return -1;
+  }
+  while (flock(fd, LOCK_EX) < 0) {
+    if (errno != EINTR) {
+      close(fd);
+      return -1;
+    }
+  }
+  return fd;
+}
+
+void SessionManager::UnlockCache(int fd) const {
+  if (fd >= 0) {
+    flock(fd, LOCK_UN);
+    close(fd);
+  }
+}
+
+bool SessionManager::ReadCache(int fd, string* token, time_t* expiry) const {
+  if (fd < 0) {
+    return false;
+  }
+  char buffer[2048];
+  ssize_t size = pread(fd, buffer, sizeof(buffer) - 1, 0);
+  if (size <= 0) {
+    return false;
+  }
+  buffer[size] = '\0';
+
+  // token, expiry, then the endpoint and user the session belongs to
+  std::istringstream in(buffer);
+  string key;
+  long long when = 0;
+  if (!(in >> *token >> when) || in.get() != ' ' || !getline(in, key)) {
+    return false;
+  }
+  *expiry = static_cast<time_t>(when);
+  return key == CacheKey() && !token->empty();
+}
+
+void SessionManager::WriteCache(int fd, const string& token,
+                                time_t expiry) const {
+  if (fd < 0) {
+    return;
+  }
+  string line = token.empty() ? string() :
+      token + " " + std::to_string(static_cast<long long>(expiry)) + " " +
+      CacheKey() + "\n";
+  if (ftruncate(fd, 0) == 0) {
+    ssize_t written = pwrite(fd, line.data(), line.size(), 0);
+    (void) written;
+  }
+}
+
+string SessionManager::CacheKey() const {
+  return client_->server_endpoint() + " " + options_.username;
+}
+
+void SessionManager::StartKeepalive() {
+  if (options_.keepalive && !keepalive_.joinable()) {
+    keepalive_ = std::thread(&SessionManager::Keepalive, this);
+  }
+}
+
+void SessionManager::Keepalive() {
+  // while the service cannot be reached, retries back off up to the interval
+  // of keepalives, so the processes sharing a session do not poll it
+  const int max_retry_seconds = std::max(
+      1, options_.ttl_seconds - options_.keepalive_margin_seconds);
+  int retry_seconds = 1;
+  std::chrono::steady_clock::time_point retry_at;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stop_) {
+    if (token_.empty()) {
+      stop_cv_.wait(lock);
+      continue;
+    }
+    std::chrono::system_clock::time_point due =
+        std::chrono::system_clock::from_time_t(
+            expiry_ - options_.keepalive_margin_seconds);
+    if (std::chrono::system_clock::now() < due) {
+      stop_cv_.wait_until(lock, due);
+      continue;
+    }
+    if (in_flight_ > 0) {
+      // the calls in flight keep the session alive
+      stop_cv_.wait_for(lock, std::chrono::seconds(1));
+      continue;
+    }
+    if (std::chrono::steady_clock::now() < retry_at) {
+      stop_cv_.wait_until(lock, retry_at);
+      continue;
+    }
+
+    // calls go on with the token while it is refreshed
+    string token = token_;
+    time_t known_expiry = expiry_;
+    lock.unlock();
+    time_t expiry = 0;
+    bool alive = false;
+    bool failed = false;
+    // another process may have refreshed the session already
+    int fd = LockCache();
+    string cached;
+    time_t cached_expiry;
+    try {
+      if (ReadCache(fd, &cached, &cached_expiry) && cached == token &&
+          cached_expiry > known_expiry + options_.keepalive_margin_seconds) {
+        expiry = cached_expiry;
+        alive = true;
+      } else if (client_->NoOperation(token).GetStatus() == OK) {
+        expiry = time(NULL) + options_.ttl_seconds;
+        WriteCache(fd, token, expiry);
+        alive = true;
+      }
+    } catch (const std::exception&) {
+      // the service could not be reached, the session may still be alive
+      failed = true;
+    }
+    UnlockCache(fd);
+    lock.lock();
+
+    if (failed) {
+      retry_at = std::chrono::steady_clock::now() +
+          std::chrono::seconds(retry_seconds);
+      retry_seconds = std::min(2 * retry_seconds, max_retry_seconds);
+    } else {
+      retry_seconds = 1;
+      if (token_ == token) {
+        if (alive) {
+          expiry_ = std::max(expiry_, expiry);
+        } else {
+          // log in again on the next call
+          token_.clear();
+        }
+      }
+    }
+  }
+}
+
+}  // namespace libsubtle
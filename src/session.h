@@ -0,0 +1,132 @@
+#ifndef SRC_SESSION_H_
+#define SRC_SESSION_H_
+
+#include <condition_variable>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "src/xml_rpc_client.h"
+
+using std::string;
+
+namespace libsubtle {
+
+/// Configuration of a SessionManager.
+struct SessionOptions {
+  /// Account to log in with; empty for anonymous sessions.
+  string username;
+  string password;
+  /// Language of the session; empty for en_US.
+  string lang;
+  /// File the token is cached in and shared through between processes. A
+  /// cached token is only used for the same endpoint and username. Empty
+  /// picks $XDG_CACHE_HOME/libsubtle/session, or ~/.cache/...; "-" disables
+  /// the cache.
+  string cache_path;
+  /// Seconds of inactivity after which the service drops a session.
+  int ttl_seconds;
+  /// Refresh the session when it is this close to expiring.
+  int keepalive_margin_seconds;
+  /// Keep the session alive from a background thread.
+  bool keepalive;
+
+  SessionOptions()
+      : ttl_seconds(15 * 60),
+        keepalive_margin_seconds(60),
+        keepalive(true) {}
+};
+
+/// Owns the session token used for calls to the service.
+///
+/// Logs in lazily on the first call, caches the token on disk with its expiry
+/// so concurrent and later processes reuse it, keeps it alive with
+/// NoOperation before it expires, and logs in again when the service reports
+/// the session gone. The session is left open on destruction so others can
+/// keep using it. Logging in and keepalives are done without holding up
+/// calls that already have a token.
+class SessionManager {
+ public:
+  SessionManager(XmlRpcClient* client, const SessionOptions& options);
+  ~SessionManager();
+
+  /// \return a valid token, logging in if there is none.
+  string Token();
+
+  /// Run a call with the session token, logging in again and retrying once
+  /// if the service no longer accepts the token.
+  /// \param call functor taking the token and returning a Response.
+  /// \return response of the call.
+  template <typename Call>
+  auto Run(Call call) -> decltype(call(string())) {
+    string token = Token();
+    decltype(call(token)) response;
+    {
+      InFlight in_flight(this);
+      response = call(token);
+    }
+    if (IsSessionError(response.GetStatus())) {
+      Invalidate(token);
+      token = Token();
+      InFlight in_flight(this);
+      response = call(token);
+    }
+    return response;
+  }
+
+  /// Forget a token the service rejected, unless it was already replaced.
+  void Invalidate(const string& token);
+
+  /// Close the session on the service and drop it from the cache.
+  void LogOut();
+
+  /// \return whether a call failed because the token is no longer valid.
+  static bool IsSessionError(Status status) {
+    return status == NO_SESSION || status == UNAUTHORIZED;
+  }
+
+ private:
+
+  // Marks a call in flight for its lifetime; calls refresh the session on
+  // the service, so the keepalive is not needed while there are any.
+  class InFlight {
+   public:
+    explicit InFlight(SessionManager* session);
+    ~InFlight();
+
+   private:
+    SessionManager* session_;
+  };
+
+  // -1 if the cache is disabled or cannot be opened
+  int LockCache() const;
+  void UnlockCache(int fd) const;
+  bool ReadCache(int fd, string* token, time_t* expiry) const;
+  void WriteCache(int fd, const string& token, time_t expiry) const;
+
+  void StartKeepalive();
+  void Keepalive();
+
+  // what a cached token must have been made for
+  string CacheKey() const;
+
+  XmlRpcClient* client_;
+  SessionOptions options_;
+
+  // held across logging in, so only one thread does it
+  std::mutex login_mutex_;
+  // guards the members below; never held across a call to the service
+  std::mutex mutex_;
+  string token_;
+  time_t expiry_;
+  int in_flight_;
+
+  std::condition_variable stop_cv_;
+  bool stop_;
+  std::thread keepalive_;
+};
+
+}  // namespace libsubtle
+
+#endif  // SRC_SESSION_H_
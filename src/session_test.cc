@@ -0,0 +1,248 @@
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "src/session.h"
+
+using std::string;
+
+namespace libsubtle {
+
+// Hands out numbered tokens and accepts only the latest one.
+class FakeSessionClient : public XmlRpcClient {
+ public:
+  FakeSessionClient() : logins_(0), no_operations_(0) {}
+
+  LoginResponse LogIn(const LoginRequest& req) {
+    LoginResponse res;
+    res.token_ = "token" + std::to_string(++logins_);
+    res.SetStatus("200 OK", 0);
+    valid_ = res.token_;
+    return res;
+  }
+  LogOutResponse LogOut(const string& token) {
+    valid_.clear();
+    return Respond<LogOutResponse>(token);
+  }
+  NoOperationResponse NoOperation(const string& token) {
+    ++no_operations_;
+    return Respond<NoOperationResponse>(token);
+  }
+  SearchResponse SearchSubtitles(const string& token,
+                                 const SearchRequest& req) {
+    return Respond<SearchResponse>(token);
+  }
+  SearchMailResponse SearchMailSubtitles(const string& token,
+                                         const SearchMailRequest& req) {
+    return Respond<SearchMailResponse>(token);
+  }
+  DownloadResponse DownloadSubtitles(const string& token,
+                                     const DownloadRequest& req) {
+    return Respond<DownloadResponse>(token);
+  }
+  ServerInfoResponse ServerInfo() {
+    return Respond<ServerInfoResponse>(valid_);
+  }
+  ReportWrongMovieHashResponse ReportWrongMovieHash(
+      const string& token, const ReportWrongMovieHashRequest& req) {
+    return Respond<ReportWrongMovieHashResponse>(token);
+  }
+  SubtitlesVoteResponse SubtitlesVote(const string& token,
+                                      const SubtitlesVoteRequest& req) {
+    return Respond<SubtitlesVoteResponse>(token);
+  }
+  AddCommentResponse AddComment(const string& token,
+                                const AddCommentRequest& req) {
+    return Respond<AddCommentResponse>(token);
+  }
+  CheckMovieHashResponse CheckMovieHash(const string& token,
+                                        const CheckMovieHashRequest& req) {
+    return Respond<CheckMovieHashResponse>(token);
+  }
+  CheckSubHashResponse CheckSubHash(const string& token,
+                                    const CheckSubHashRequest& req) {
+    return Respond<CheckSubHashResponse>(token);
+  }
+  GetSubLanguagesResponse GetSubLanguages(const GetSubLanguagesRequest& req) {
+    return Respond<GetSubLanguagesResponse>(valid_);
+  }
+  DetectLanguageResponse DetectLanguage(const string& token,
+                                        const DetectLanguageRequest& req) {
+    return Respond<DetectLanguageResponse>(token);
+  }
+  GetAvailableTranslationsResponse GetAvailableTranslations(
+      const string& token, const GetAvailableTranslationsRequest& req) {
+    return Respond<GetAvailableTranslationsResponse>(token);
+  }
+  GetTranslationResponse GetTranslation(const string& token,
+                                        const GetTranslationRequest& req) {
+    return Respond<GetTranslationResponse>(token);
+  }
+  AutoUpdateResponse AutoUpdate(const AutoUpdateRequest& req) {
+    return Respond<AutoUpdateResponse>(valid_);
+  }
+  SearchMoviesOnImdbResponse SearchMoviesOnImdb(
+      const string& token, const SearchMoviesOnImdbRequest& req) {
+    return Respond<SearchMoviesOnImdbResponse>(token);
+  }
+  GetImdbMovieDetailsResponse GetImdbMovieDetails(
+      const string& token, const GetImdbMovieDetailsRequest& req) {
+    return Respond<GetImdbMovieDetailsResponse>(token);
+  }
+  InsertMovieResponse InsertMovie(const string& token,
+                                  const InsertMovieRequest& req) {
+    return Respond<InsertMovieResponse>(token);
+  }
+
+  std::atomic<int> logins_;
+  std::atomic<int> no_operations_;
+  string valid_;
+
+ private:
+  template <typename T>
+  T Respond(const string& token) {
+    T res;
+    res.SetStatus(token == valid_ ? "200 OK" : "406 No session", 0);
+    return res;
+  }
+};
+
+class SessionTest : public ::testing::Test {
+ protected:
+  void SetUp() {
+    char path[] = "/tmp/subtle_session_XXXXXX";
+    close(mkstemp(path));
+    options_.cache_path = path;
+    options_.keepalive = false;
+  }
+  void TearDown() {
+    remove(options_.cache_path.c_str());
+  }
+
+  SessionOptions options_;
+};
+
+TEST_F(SessionTest, LogsInLazily) {
+  FakeSessionClient client;
+  SessionManager session(&client, options_);
+  ASSERT_EQ(0, client.logins_);
+
+  SearchRequest req("eng", "7d9cd5def91c9432", 735934464);
+  auto search = [&](const string& token) {
+    return client.SearchSubtitles(token, req);
+  };
+  ASSERT_EQ(OK, session.Run(search).GetStatus());
+  ASSERT_EQ(OK, session.Run(search).GetStatus());
+  ASSERT_EQ(1, client.logins_);
+}
+
+TEST_F(SessionTest, SharesCachedToken) {
+  FakeSessionClient client;
+  {
+    SessionManager first(&client, options_);
+    ASSERT_EQ("token1", first.Token());
+  }
+  SessionManager second(&client, options_);
+  ASSERT_EQ("token1", second.Token());
+  ASSERT_EQ(1, client.logins_);
+
+  options_.username = "someone else";
+  SessionManager other_user(&client, options_);
+  ASSERT_EQ("token2", other_user.Token());
+
+  FakeSessionClient other_client;
+  other_client.Init("test", "http://localhost/xml-rpc");
+  SessionManager other_endpoint(&other_client, options_);
+  ASSERT_EQ("token1", other_endpoint.Token());
+  ASSERT_EQ(1, other_client.logins_);
+}
+
+TEST_F(SessionTest, ExpiredCacheIsRevived) {
+  options_.ttl_seconds = -1;
+  FakeSessionClient client;
+  SessionManager first(&client, options_);
+  ASSERT_EQ("token1", first.Token());
+
+  SessionManager second(&client, options_);
+  ASSERT_EQ("token1", second.Token());
+  ASSERT_EQ(1, client.no_operations_);
+  ASSERT_EQ(1, client.logins_);
+}
+
+TEST_F(SessionTest, ReauthenticatesOnNoSession) {
+  FakeSessionClient client;
+  SessionManager session(&client, options_);
+  ASSERT_EQ("token1", session.Token());
+
+  // the service dropped the session
+  client.valid_.clear();
+  NoOperationResponse res = session.Run([&](const string& token) {
+    return client.NoOperation(token);
+  });
+  ASSERT_EQ(OK, res.GetStatus());
+  ASSERT_EQ(2, client.logins_);
+  ASSERT_EQ("token2", session.Token());
+}
+
+TEST_F(SessionTest, KeepsSessionAlive) {
+  options_.keepalive = true;
+  options_.ttl_seconds = 2;
+  FakeSessionClient client;
+  SessionManager session(&client, options_);
+  ASSERT_EQ("token1", session.Token());
+
+  for (int i = 0; i < 30 && client.no_operations_ == 0; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+  ASSERT_LT(0, client.no_operations_);
+  ASSERT_EQ("token1", session.Token());
+  ASSERT_EQ(1, client.logins_);
+}
+
+// Fails keepalives as when the service cannot be reached.
+class UnreachableSessionClient : public FakeSessionClient {
+ public:
+  NoOperationResponse NoOperation(const string& token) {
+    ++no_operations_;
+    throw SubtleException("Cannot reach the service");
+  }
+};
+
+TEST_F(SessionTest, KeepaliveBacksOff) {
+  UnreachableSessionClient client;
+  // a session that is close to expiring is in the cache
+  options_.ttl_seconds = 1;
+  SessionManager first(&client, options_);
+  ASSERT_EQ("token1", first.Token());
+
+  options_.keepalive = true;
+  options_.ttl_seconds = 20;
+  SessionManager session(&client, options_);
+  ASSERT_EQ("token1", session.Token());
+  // tried at once, then after 1 and 2 more seconds, then not for 4
+  std::this_thread::sleep_for(std::chrono::milliseconds(4500));
+  ASSERT_EQ(3, client.no_operations_);
+}
+
+TEST_F(SessionTest, LogOut) {
+  options_.keepalive = true;
+  FakeSessionClient client;
+  SessionManager session(&client, options_);
+  ASSERT_EQ("token1", session.Token());
+  session.LogOut();
+  ASSERT_EQ("", client.valid_);
+
+  // neither this manager nor the cache hold on to the closed session
+  SessionManager other(&client, options_);
+  ASSERT_EQ("token2", other.Token());
+  // and picks up the new one from the cache
+  ASSERT_EQ("token2", session.Token());
+  ASSERT_EQ(2, client.logins_);
+}
+
+}  // namespace libsubtle
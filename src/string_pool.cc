@@ -0,0 +1,64 @@
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "src/string_pool.h"
+
+using std::string;
+
+namespace libsubtle {
+
+namespace {
+
+// shared by all default constructed handles, belongs to no pool
+const std::pair<const string, const StringPool*> kEmpty("", NULL);
+
+}  // namespace
+
+InternedString::InternedString() : entry_(&kEmpty) {}
+
+InternedString::InternedString(const string& text)
+    : entry_(StringPool::Shared()->Intern(text).entry_) {}
+
+InternedString::InternedString(const char* text)
+    : entry_(StringPool::Shared()->Intern(text, strlen(text)).entry_) {}
+
+InternedString StringPool::Intern(const string& text) {
+  static StringPool* const shared = Shared();
+  if (this != shared) {
+    return InternLocked(text);
+  }
+  // the shared pool is never freed, so each thread can keep its entries and
+  // find them again without taking the lock decoding threads share
+  thread_local std::unordered_map<string, const InternedString::Entry*> seen;
+  auto it = seen.find(text);
+  if (it != seen.end()) {
+    return InternedString(it->second);
+  }
+  InternedString interned = InternLocked(text);
+  seen.insert(std::make_pair(text, interned.entry_));
+  return interned;
+}
+
+InternedString StringPool::InternLocked(const string& text) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // hits, the common case, neither copy the text nor allocate
+  auto it = strings_.find(text);
+  if (it == strings_.end()) {
+    it = strings_.insert(std::make_pair(text, this)).first;
+  }
+  return InternedString(&*it);
+}
+
+size_t StringPool::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return strings_.size();
+}
+
+StringPool* StringPool::Shared() {
+  static StringPool* pool = new StringPool();
+  return pool;
+}
+
+}  // namespace libsubtle
@@ -0,0 +1,117 @@
+#ifndef SRC_STRING_POOL_H_
+#define SRC_STRING_POOL_H_
+
+#include <cstring>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+using std::string;
+
+namespace libsubtle {
+
+class StringPool;
+
+/// Handle to a string stored in a StringPool.
+///
+/// Equal strings interned in one pool share a single allocation, so handles
+/// from the same pool compare by pointer. Handles stay valid as long as the
+/// pool they came from.
+class InternedString {
+ public:
+  InternedString();
+  /// Intern into StringPool::Shared().
+  InternedString(const string& text);  // NOLINT(runtime/explicit)
+  InternedString(const char* text);  // NOLINT(runtime/explicit)
+
+  const string& str() const { return entry_->first; }
+  operator const string&() const { return entry_->first; }
+  const char* c_str() const { return entry_->first.c_str(); }
+  size_t size() const { return entry_->first.size(); }
+  bool empty() const { return entry_->first.empty(); }
+
+  bool operator==(const InternedString& other) const {
+    // within a pool equal text means equal pointers
+    return entry_ == other.entry_ ||
+        (entry_->second != other.entry_->second &&
+         entry_->first == other.entry_->first);
+  }
+  bool operator!=(const InternedString& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  friend class StringPool;
+  typedef std::pair<const string, const StringPool*> Entry;
+
+  explicit InternedString(const Entry* entry) : entry_(entry) {}
+
+  const Entry* entry_;
+};
+
+inline bool operator==(const InternedString& a, const string& b) {
+  return a.str() == b;
+}
+inline bool operator==(const string& a, const InternedString& b) {
+  return a == b.str();
+}
+inline bool operator==(const InternedString& a, const char* b) {
+  return a.str() == b;
+}
+inline bool operator==(const char* a, const InternedString& b) {
+  return a == b.str();
+}
+inline bool operator!=(const InternedString& a, const string& b) {
+  return !(a == b);
+}
+inline bool operator!=(const InternedString& a, const char* b) {
+  return !(a == b);
+}
+
+inline std::ostream& operator<<(std::ostream& out, const InternedString& s) {
+  return out << s.str();
+}
+
+/// Stores one copy of each distinct string given to it.
+///
+/// Meant for low-cardinality fields repeated across many records, such as
+/// language names. Decoded records intern into the process-wide pool, which
+/// lives as long as the process and is never freed, so handles into it stay
+/// valid wherever records are kept; only fields from small fixed sets
+/// (languages and formats, a few hundred strings) are interned into it, and
+/// each costs one allocation for the life of the process. Other pools free
+/// their strings with them. Pools are thread-safe.
+class StringPool {
+ public:
+  StringPool() {}
+
+  /// \return handle to the pooled copy of text. Text the shared pool holds
+  ///         already is found without a lock, in a copy of its entries each
+  ///         thread keeps; other pools lock for every call.
+  InternedString Intern(const string& text);
+  InternedString Intern(const char* text, size_t size) {
+    return Intern(string(text, size));
+  }
+
+  /// \return number of distinct strings in the pool.
+  size_t size() const;
+
+  /// \return the process-wide pool.
+  static StringPool* Shared();
+
+ private:
+  StringPool(const StringPool&);
+  void operator=(const StringPool&);
+
+  InternedString InternLocked(const string& text);
+
+  mutable std::mutex mutex_;
+  // node based, entries never move once inserted
+  std::unordered_map<string, const StringPool*> strings_;
+};
+
+}  // namespace libsubtle
+
+#endif  // SRC_STRING_POOL_H_
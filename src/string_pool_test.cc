@@ -0,0 +1,53 @@
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "src/string_pool.h"
+#include "src/subfile.h"
+
+using std::string;
+
+namespace libsubtle {
+
+TEST(StringPool, Intern) {
+  StringPool pool;
+  InternedString a = pool.Intern("English");
+  InternedString b = pool.Intern(string("English"));
+  InternedString c = pool.Intern("Croatian", 8);
+
+  ASSERT_EQ(&a.str(), &b.str());
+  ASSERT_TRUE(a == b);
+  ASSERT_TRUE(a != c);
+  ASSERT_EQ("Croatian", c);
+  ASSERT_EQ(2, pool.size());
+}
+
+TEST(StringPool, AcrossPools) {
+  StringPool first, second;
+  InternedString a = first.Intern("eng");
+  InternedString b = second.Intern("eng");
+
+  ASSERT_NE(&a.str(), &b.str());
+  ASSERT_TRUE(a == b);
+  ASSERT_TRUE(a != second.Intern("hrv"));
+  ASSERT_TRUE(InternedString().empty());
+  ASSERT_TRUE(InternedString() == InternedString());
+}
+
+TEST(StringPool, Shared) {
+  SubFile first, second;
+  first.Set("LanguageName", "English");
+  second.Set("LanguageName", "English");
+  second.Set("SubFileName", "English.srt");
+  ASSERT_EQ(&first.LanguageName_.str(), &second.LanguageName_.str());
+
+  // other threads find the same copy, through their own cache
+  const string* other = NULL;
+  std::thread([&other] {
+    other = &StringPool::Shared()->Intern("English").str();
+    other = &StringPool::Shared()->Intern("English").str();
+  }).join();
+  ASSERT_EQ(&first.LanguageName_.str(), other);
+}
+
+}  // namespace libsubtle
@@ -0,0 +1,102 @@
+#include "src/struct_view.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+using std::map;
+using std::string;
+using std::vector;
+
+using xmlrpc_c::value;
+using xmlrpc_c::value_array;
+using xmlrpc_c::value_boolean;
+using xmlrpc_c::value_double;
+using xmlrpc_c::value_int;
+using xmlrpc_c::value_string;
+using xmlrpc_c::value_struct;
+
+namespace libsubtle {
+
+string AsString(const value& v) {
+  return static_cast<string>(value_string(v));
+}
+
+bool ScalarText(const value& v, string* text) {
+  switch (v.type()) {
+    case value::TYPE_STRING:
+      *text = AsString(v);
+      return true;
+    case value::TYPE_INT:
+      *text = std::to_string(static_cast<int>(value_int(v)));
+      return true;
+    case value::TYPE_DOUBLE:
+      *text = std::to_string(static_cast<double>(value_double(v)));
+      return true;
+    case value::TYPE_BOOLEAN:
+      *text = static_cast<bool>(value_boolean(v)) ? "1" : "0";
+      return true;
+    default:
+      return false;
+  }
+}
+
+StructView::StructView(const value& v)
+    : members_(static_cast<Members>(value_struct(v))) {}
+
+const value* StructView::Find(const string& key) const {
+  const_iterator it = members_.find(key);
+  return it == members_.end() ? NULL : &it->second;
+}
+
+string StructView::String(const string& key) const {
+  const value* member = Find(key);
+  return member ? AsString(*member) : string();
+}
+
+int64_t StructView::Int(const string& key) const {
+  const value* member = Find(key);
+  return member ? static_cast<int64_t>(value_int(*member)) : 0;
+}
+
+double StructView::Double(const string& key) const {
+  const value* member = Find(key);
+  return member ? static_cast<double>(value_double(*member)) : 0;
+}
+
+bool StructView::Ok() const {
+  return String("status").compare("200 OK") == 0;
+}
+
+StructView StructView::Struct(const string& key) const {
+  const value* member = Find(key);
+  return member ? StructView(*member) : StructView();
+}
+
+vector<value> StructView::Array(const string& key) const {
+  const value* member = Find(key);
+  return member ? value_array(*member).vectorValueValue() : vector<value>();
+}
+
+void StructView::StringMap(const string& key,
+                           map<string, string>* target) const {
+  const value* member = Find(key);
+  if (member) {
+    StructView dict(*member);
+    for (const auto& entry : dict) {
+      (*target)[entry.first] = AsString(entry.second);
+    }
+  }
+}
+
+void StructView::StringVector(const string& key,
+                              vector<string>* target) const {
+  const value* member = Find(key);
+  if (member) {
+    for (const auto& entry : value_array(*member).vectorValueValue()) {
+      target->push_back(AsString(entry));
+    }
+  }
+}
+
+}  // namespace libsubtle
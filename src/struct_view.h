@@ -0,0 +1,87 @@
+#ifndef SRC_STRUCT_VIEW_H_
+#define SRC_STRUCT_VIEW_H_
+
+#include <xmlrpc-c/base.hpp>
+
+#include <cinttypes>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "src/schema.h"
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+/// Read-only typed access to a decoded XML-RPC struct.
+///
+/// The struct is unpacked once when the view is made, into a map of its
+/// members; xmlrpc-c values are reference counted, so this copies handles
+/// rather than their contents. Every accessor then does a single lookup.
+/// Find returns a pointer into the view; String and Array return copies of
+/// the member.
+class StructView {
+ public:
+  typedef map<string, xmlrpc_c::value> Members;
+  typedef Members::const_iterator const_iterator;
+
+  explicit StructView(const xmlrpc_c::value& value);
+
+  /// \return the member named key, or NULL if it is not present.
+  const xmlrpc_c::value* Find(const string& key) const;
+  bool Has(const string& key) const { return Find(key) != NULL; }
+
+  /// \return string member, or "" if it is not present.
+  string String(const string& key) const;
+  /// \return int member, or 0 if it is not present.
+  int64_t Int(const string& key) const;
+  /// \return double member, or 0 if it is not present.
+  double Double(const string& key) const;
+  /// \return whether the "status" member reports success.
+  bool Ok() const;
+
+  /// \return nested struct member; empty view if it is not present.
+  StructView Struct(const string& key) const;
+  /// \return elements of an array member; empty if it is not present.
+  vector<xmlrpc_c::value> Array(const string& key) const;
+
+  /// Copy a struct member of strings into target.
+  void StringMap(const string& key, map<string, string>* target) const;
+  /// Append an array member of strings to target.
+  void StringVector(const string& key, vector<string>* target) const;
+
+  const_iterator begin() const { return members_.begin(); }
+  const_iterator end() const { return members_.end(); }
+
+ private:
+  StructView() {}
+
+  Members members_;
+};
+
+/// \return value as a string.
+string AsString(const xmlrpc_c::value& value);
+
+/// Format a scalar value as text.
+/// \return false if the value is not a scalar.
+bool ScalarText(const xmlrpc_c::value& value, string* text);
+
+/// Decode the scalar members of a struct in one pass, dispatching each through
+/// the schema table. Members the schema does not know are skipped.
+template <typename T, size_t Slots>
+void Decode(const StructView& view, const schema::Table<T, Slots>& table,
+            T* target) {
+  string text;
+  for (const auto& member : view) {
+    if (ScalarText(member.second, &text)) {
+      table.Decode(target, member.first, text);
+    }
+  }
+}
+
+}  // namespace libsubtle
+
+#endif  // SRC_STRUCT_VIEW_H_
@@ -1,5 +1,6 @@
 #include <iostream>
 
+#include "src/schema.h"
 #include "src/subfile.h"
 
 using std::map;
@@ -7,38 +8,58 @@ using std::string;
 
 namespace libsubtle {
 
+namespace {
+
+constexpr schema::Field<SubFile> kSchema[] = {
+  SUBTLE_FIELD(SubFile, "IDSubMovieFile", IDSubMovieFile_),
+  SUBTLE_FIELD(SubFile, "MovieHash", MovieHash_),
+  SUBTLE_FIELD(SubFile, "MovieByteSize", MovieByteSize_),
+  SUBTLE_FIELD(SubFile, "MovieTimeMS", MovieTimeMS_),
+  SUBTLE_FIELD(SubFile, "IDSubtitleFile", IDSubtitleFile_),
+  SUBTLE_FIELD(SubFile, "SubFileName", SubFileName_),
+  SUBTLE_FIELD(SubFile, "SubActualCD", SubActualCD_),
+  SUBTLE_FIELD(SubFile, "SubSize", SubSize_),
+  SUBTLE_FIELD(SubFile, "SubHash", SubHash_),
+  SUBTLE_FIELD(SubFile, "IDSubtitle", IDSubtitle_),
+  SUBTLE_FIELD(SubFile, "UserID", UserID_),
+  SUBTLE_FIELD_INTERNED(SubFile, "SubLanguageID", SubLanguageID_),
+  SUBTLE_FIELD_INTERNED(SubFile, "SubFormat", SubFormat_),
+  SUBTLE_FIELD(SubFile, "SubSumCD", SubSumCD_),
+  SUBTLE_FIELD(SubFile, "SubAuthorComment", SubAuthorComment_),
+  SUBTLE_FIELD(SubFile, "SubAddDate", SubAddDate_),
+  SUBTLE_FIELD(SubFile, "SubBad", SubBad_),
+  SUBTLE_FIELD(SubFile, "SubRating", SubRating_),
+  SUBTLE_FIELD(SubFile, "SubDownloadsCnt", SubDownloadsCnt_),
+  SUBTLE_FIELD(SubFile, "MovieReleaseName", MovieReleaseName_),
+  SUBTLE_FIELD(SubFile, "IDMovie", IDMovie_),
+  SUBTLE_FIELD(SubFile, "IDMovieImdb", IDMovieImdb_),
+  SUBTLE_FIELD(SubFile, "MovieName", MovieName_),
+  SUBTLE_FIELD(SubFile, "MovieNameEng", MovieNameEng_),
+  SUBTLE_FIELD(SubFile, "MovieYear", MovieYear_),
+  SUBTLE_FIELD(SubFile, "MovieImdbRating", MovieImdbRating_),
+  SUBTLE_FIELD(SubFile, "UserNickName", UserNickName_),
+  SUBTLE_FIELD_INTERNED(SubFile, "ISO639", ISO639_),
+  SUBTLE_FIELD_INTERNED(SubFile, "LanguageName", LanguageName_),
+  SUBTLE_FIELD(SubFile, "SubDownloadLink", SubDownloadLink_),
+  SUBTLE_FIELD(SubFile, "ZipDownloadLink", ZipDownloadLink_)
+};
+SUBTLE_CHECK_SCHEMA(kSchema, 127);
+
+const schema::Table<SubFile, 127>& FieldTable() {
+  static const schema::Table<SubFile, 127> table(kSchema);
+  return table;
+}
+
+}  // namespace
+
 SubFile::SubFile(const map<string, string>& data) {
-  IDSubMovieFile_ = data.at("IDSubMovieFile");
-  MovieHash_ = data.at("MovieHash");
-  MovieByteSize_ = data.at("MovieByteSize");
-  MovieTimeMS_ = data.at("MovieTimeMS");
-  IDSubtitleFile_ = data.at("IDSubtitleFile");
-  SubFileName_ = data.at("SubFileName");
-  SubActualCD_ = data.at("SubActualCD");
-  SubSize_ = data.at("SubSize");
-  SubHash_ = data.at("SubHash");
-  IDSubtitle_ = data.at("IDSubtitle");
-  UserID_ = data.at("UserID");
-  SubLanguageID_ = data.at("SubLanguageID");
-  SubFormat_ = data.at("SubFormat");
-  SubSumCD_ = data.at("SubSumCD");
-  SubAuthorComment_ = data.at("SubAuthorComment");
-  SubAddDate_ = data.at("SubAddDate");
-  SubBad_ = data.at("SubBad");
-  SubRating_ = data.at("SubRating");
-  SubDownloadsCnt_ = data.at("SubDownloadsCnt");
-  MovieReleaseName_ = data.at("MovieReleaseName");
-  IDMovie_ = data.at("IDMovie");
-  IDMovieImdb_ = data.at("IDMovieImdb");
-  MovieName_ = data.at("MovieName");
-  MovieNameEng_ = data.at("MovieNameEng");
-  MovieYear_ = data.at("MovieYear");
-  MovieImdbRating_ = data.at("MovieImdbRating");
-  UserNickName_ = data.at("UserNickName");
-  ISO639_ = data.at("ISO639");
-  LanguageName_ = data.at("LanguageName");
-  SubDownloadLink_ = data.at("SubDownloadLink");
-  ZipDownloadLink_ = data.at("ZipDownloadLink");
+  for (const auto& field : data) {
+    FieldTable().Decode(this, field.first, field.second);
+  }
+}
+
+bool SubFile::Set(const string& field, const string& value) {
+  return FieldTable().Decode(this, field, value);
 }
 
 void SubFile::PrintTitle() {
@@ -4,11 +4,19 @@
 #include <map>
 #include <string>
 
+#include "src/string_pool.h"
+
 using std::map;
 using std::string;
 
 namespace libsubtle {
 
+/// A subtitle found by a search.
+///
+/// Fields from small fixed sets, repeated across many results, are interned
+/// into StringPool::Shared(), so a large result set keeps one copy of each
+/// language and format. Movie names and uploaders are not: there is no bound
+/// on how many a long-running process sees.
 class SubFile {
  public:
   string IDSubMovieFile_;
@@ -22,8 +30,8 @@ class SubFile {
   string SubHash_;
   string IDSubtitle_;
   string UserID_;
-  string SubLanguageID_;
-  string SubFormat_;
+  InternedString SubLanguageID_;
+  InternedString SubFormat_;
   string SubSumCD_;
   string SubAuthorComment_;
   string SubAddDate_;
@@ -38,13 +46,20 @@ class SubFile {
   string MovieYear_;
   string MovieImdbRating_;
   string UserNickName_;
-  string ISO639_;
-  string LanguageName_;
+  InternedString ISO639_;
+  InternedString LanguageName_;
   string SubDownloadLink_;
   string ZipDownloadLink_;
 
+  SubFile() {}
   SubFile(const map<string, string>& data);
 
+  /// Set a field by the name the service uses for it.
+  /// \param field name of the field, e.g. "SubFileName".
+  /// \param value new value of the field.
+  /// \return false if the field is not known.
+  bool Set(const string& field, const string& value);
+
   void PrintTitle();
   void Print();
 };
@@ -0,0 +1,233 @@
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "src/subtitle_store.h"
+#include "src/types.h"
+
+using std::string;
+
+namespace libsubtle {
+
+namespace {
+
+// Create all directories leading to path.
+void MakeParentDirs(const string& path) {
+  for (size_t slash = path.find('/', 1); slash != string::npos;
+       slash = path.find('/', slash + 1)) {
+    mkdir(path.substr(0, slash).c_str(), 0755);
+  }
+}
+
+bool Clone(int from, int to) {
+#ifdef FICLONE
+  return ioctl(to, FICLONE, from) == 0;
+#else
+  return false;
+#endif
+}
+
+bool Copy(int from, int to) {
+  char buffer[64 * 1024];
+  for (;;) {
+    ssize_t size = read(from, buffer, sizeof(buffer));
+    if (size < 0 && errno == EINTR) {
+      continue;
+    }
+    if (size <= 0) {
+      return size == 0;
+    }
+    for (char* data = buffer; size > 0;) {
+      ssize_t written = write(to, data, size);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      data += written;
+      size -= written;
+    }
+  }
+}
+
+}  // namespace
+
+SubtitleStore::SubtitleStore(const string& root) : root_(root) {
+  while (root_.size() > 1 && root_[root_.size() - 1] == '/') {
+    root_.erase(root_.size() - 1);
+  }
+}
+
+string SubtitleStore::DefaultRoot() {
+  const char* store = getenv("SUBTLE_STORE");
+  if (store && *store) {
+    return strcmp(store, "-") ? store : "";
+  }
+  const char* cache_home = getenv("XDG_CACHE_HOME");
+  if (cache_home && *cache_home) {
+    return string(cache_home) + "/libsubtle/store";
+  }
+  const char* home = getenv("HOME");
+  if (home && *home) {
+    return string(home) + "/.cache/libsubtle/store";
+  }
+  return "";
+}
+
+string SubtitleStore::Key(uint32_t id, const string& sub_hash) {
+  string key = std::to_string(id) + "-";
+  for (char c : sub_hash) {
+    // the hash ends up in a path, so only hex digits are kept
+    if (isxdigit(static_cast<unsigned char>(c))) {
+      key += static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    }
+  }
+  return key;
+}
+
+string SubtitleStore::Key(uint32_t id, const uint8_t* sub_hash) {
+  static const char kHex[] = "0123456789abcdef";
+  string hex;
+  for (int i = 0; i < 16; ++i) {
+    hex += kHex[sub_hash[i] >> 4];
+    hex += kHex[sub_hash[i] & 0xf];
+  }
+  return Key(id, hex);
+}
+
+string SubtitleStore::Path(const string& key) const {
+  // spread objects over 256 directories by the low byte of the id
+  char shard[3];
+  snprintf(shard, sizeof(shard), "%02x",
+           static_cast<unsigned>(strtoul(key.c_str(), NULL, 10) & 0xff));
+  return root_ + "/" + shard + "/" + key;
+}
+
+string SubtitleStore::TempPath(const string& key) const {
+  static std::atomic<unsigned> counter(0);
+  string temp = Path(key) + ".tmp." + std::to_string(getpid()) + "." +
+      std::to_string(counter++);
+  MakeParentDirs(temp);
+  return temp;
+}
+
+SubtitleStore::Lock::Lock(const SubtitleStore& store, const string& key)
+    : fd_(-1) {
+  if (!store.enabled()) {
+    return;
+  }
+  string path = store.Path(key) + ".lock";
+  MakeParentDirs(path);
+  fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  while (fd_ >= 0 && flock(fd_, LOCK_EX) < 0) {
+    if (errno != EINTR) {
+      close(fd_);
+      fd_ = -1;
+    }
+  }
+}
+
+SubtitleStore::Lock::~Lock() {
+  if (fd_ >= 0) {
+    flock(fd_, LOCK_UN);
+    close(fd_);
+  }
+}
+
+SubtitleStore::TempFiles::~TempFiles() {
+  for (const string& temp : temps_) {
+    remove(temp.c_str());
+  }
+}
+
+void SubtitleStore::Commit(const string& key, const string& temp) const {
+  // objects may be hard linked into destinations, where they should not be
+  // edited in place
+  chmod(temp.c_str(), 0444);
+  // the data reaches the disk before the name does, or a crash could leave
+  // an empty object that is trusted from then on
+  int fd = open(temp.c_str(), O_RDONLY | O_CLOEXEC);
+#ifdef __linux__
+  int result = fd < 0 ? -1 : fdatasync(fd);
+#else
+  int result = fd < 0 ? -1 : fsync(fd);
+#endif
+  int error = errno;
+  if (fd >= 0) {
+    close(fd);
+  }
+  if (result == 0 && rename(temp.c_str(), Path(key).c_str()) != 0) {
+    result = -1;
+    error = errno;
+  }
+  if (result != 0) {
+    remove(temp.c_str());
+    throw SubtleException("Cannot store " + key + ": " + strerror(error));
+  }
+}
+
+bool SubtitleStore::Contains(const string& key) const {
+  return enabled() && access(Path(key).c_str(), F_OK) == 0;
+}
+
+bool SubtitleStore::Materialize(const string& key, const string& dest) const {
+  if (!Contains(key)) {
+    return false;
+  }
+  // objects are read-only, so sharing their inode is safe
+  Place(Path(key), dest, true);
+  return true;
+}
+
+void SubtitleStore::Place(const string& from, const string& to,
+                          bool hard_link) {
+  int source = open(from.c_str(), O_RDONLY | O_CLOEXEC);
+  if (source < 0) {
+    throw SubtleException("Cannot read " + from + ": " + strerror(errno));
+  }
+  remove(to.c_str());
+
+  // a reflink shares blocks but not edits; a hard link shares both
+  int target = open(to.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                    0644);
+  bool done = target >= 0 && Clone(source, target);
+  if (!done && target >= 0 && hard_link) {
+    close(target);
+    remove(to.c_str());
+    target = -1;
+    done = link(from.c_str(), to.c_str()) == 0;
+    if (!done) {
+      target = open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                    0644);
+    }
+  }
+  if (!done && target >= 0) {
+    done = Copy(source, target);
+  }
+  int error = errno;
+  if (target >= 0 && close(target) != 0 && done) {
+    error = errno;
+    done = false;
+  }
+  close(source);
+  if (!done) {
+    remove(to.c_str());
+    throw SubtleException("Cannot write " + to + ": " + strerror(error));
+  }
+}
+
+}  // namespace libsubtle
@@ -0,0 +1,104 @@
+#ifndef SRC_SUBTITLE_STORE_H_
+#define SRC_SUBTITLE_STORE_H_
+
+#include <cinttypes>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+/// Local content-addressed store of downloaded subtitle files, keyed by
+/// subtitle file id and MD5, so each file is fetched and stored once however
+/// many destinations want it.
+///
+/// The store may live on a filesystem shared between machines. Fetches of a
+/// key are serialized across processes with a lock file, and objects become
+/// visible by rename only once complete. Destinations are materialized as
+/// reflinks where the filesystem supports them, hard links to the read-only
+/// object otherwise, and copies as a last resort.
+class SubtitleStore {
+ public:
+  /// \param root directory of the store; empty disables it.
+  explicit SubtitleStore(const string& root);
+
+  /// \return $SUBTLE_STORE, or $XDG_CACHE_HOME/libsubtle/store, or
+  ///         ~/.cache/libsubtle/store. "-" in $SUBTLE_STORE disables the
+  ///         store.
+  static string DefaultRoot();
+
+  /// \param id IDSubtitleFile of the file.
+  /// \param sub_hash SubHash of the file, as hex.
+  /// \return key of the file in the store.
+  static string Key(uint32_t id, const string& sub_hash);
+  /// \param sub_hash SubHash of the file, as 16 bytes.
+  static string Key(uint32_t id, const uint8_t* sub_hash);
+
+  bool enabled() const { return !root_.empty(); }
+
+  /// \return path the object for key is stored at.
+  string Path(const string& key) const;
+
+  /// \return a new path to write the object for key to before Commit,
+  ///         unique to the call, so writers that do not hold the Lock on key
+  ///         never share one. Creates the directories it is in.
+  string TempPath(const string& key) const;
+
+  /// Holds the lock on a key for its lifetime, blocking until no other
+  /// process is fetching it. Does nothing if locking is not possible.
+  class Lock {
+   public:
+    Lock(const SubtitleStore& store, const string& key);
+    ~Lock();
+
+   private:
+    Lock(const Lock&);
+    void operator=(const Lock&);
+
+    int fd_;
+  };
+
+  /// Removes the temporary files added to it when it goes out of scope, so a
+  /// fetch that fails or is not answered leaves nothing in the store; those
+  /// that were committed are gone already.
+  class TempFiles {
+   public:
+    TempFiles() {}
+    ~TempFiles();
+
+    void Add(const string& temp) { temps_.push_back(temp); }
+
+   private:
+    TempFiles(const TempFiles&);
+    void operator=(const TempFiles&);
+
+    vector<string> temps_;
+  };
+
+  /// \return whether the store holds key.
+  bool Contains(const string& key) const;
+
+  /// Move the object written to temp, a TempPath(key), into the store once
+  /// its data is on disk, replacing any copy another writer committed.
+  /// Throws SubtleException if it cannot be synced or moved.
+  void Commit(const string& key, const string& temp) const;
+
+  /// Make dest hold the object for key, replacing any file there.
+  /// Throws SubtleException if dest cannot be written.
+  /// \return false if the store does not hold key.
+  bool Materialize(const string& key, const string& dest) const;
+
+  /// Make to a copy of from, replacing any file there: a reflink if the
+  /// filesystem supports them, else a hard link if allowed, else a copy.
+  /// Throws SubtleException on failure.
+  static void Place(const string& from, const string& to, bool hard_link);
+
+ private:
+  string root_;
+};
+
+}  // namespace libsubtle
+
+#endif  // SRC_SUBTITLE_STORE_H_
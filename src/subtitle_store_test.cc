@@ -0,0 +1,129 @@
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "src/subtitle_store.h"
+#include "src/types.h"
+
+using std::string;
+
+namespace libsubtle {
+
+class SubtitleStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() {
+    char dir[] = "/tmp/subtitle_store_XXXXXX";
+    ASSERT_TRUE(mkdtemp(dir) != NULL);
+    dir_ = dir;
+  }
+
+  void TearDown() {
+    ASSERT_EQ(0, system(("chmod -R u+w " + dir_ + " && rm -rf " + dir_)
+                        .c_str()));
+  }
+
+  static string Read(const string& path) {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    std::ostringstream text;
+    text << in.rdbuf();
+    return text.str();
+  }
+
+  static void Write(const string& path, const string& text) {
+    std::ofstream out(path.c_str(), std::ios::binary);
+    out << text;
+  }
+
+  string dir_;
+};
+
+TEST_F(SubtitleStoreTest, Key) {
+  const uint8_t hash[16] = {0xd4, 0xf3, 0xb0, 0xe0, 0xdb, 0xa2, 0xed, 0x84,
+                            0xfd, 0x5d, 0xa2, 0xf5, 0xa6, 0xe2, 0xf6, 0xd1};
+  ASSERT_EQ("1951894257-d4f3b0e0dba2ed84fd5da2f5a6e2f6d1",
+            SubtitleStore::Key(1951894257, hash));
+  ASSERT_EQ(SubtitleStore::Key(1951894257, hash),
+            SubtitleStore::Key(1951894257,
+                               "D4F3B0E0DBA2ED84FD5DA2F5A6E2F6D1"));
+  ASSERT_EQ("7-ab", SubtitleStore::Key(7, "../ab"));
+}
+
+TEST_F(SubtitleStoreTest, CommitAndMaterialize) {
+  SubtitleStore store(dir_ + "/store/");
+  string key = SubtitleStore::Key(1951894257, "d4f3");
+  ASSERT_FALSE(store.Materialize(key, dir_ + "/a.srt"));
+  string temp = store.TempPath(key);
+  {
+    SubtitleStore::Lock lock(store, key);
+    Write(temp, "1\n00:00:01,000 --> 00:00:02,000\nHi\n");
+    store.Commit(key, temp);
+  }
+  ASSERT_EQ(dir_ + "/store/f1/" + key, store.Path(key));
+  ASSERT_NE(0, access(temp.c_str(), F_OK));
+
+  Write(dir_ + "/b.srt", "stale");
+  ASSERT_TRUE(store.Materialize(key, dir_ + "/a.srt"));
+  ASSERT_TRUE(store.Materialize(key, dir_ + "/b.srt"));
+  ASSERT_EQ(Read(store.Path(key)), Read(dir_ + "/a.srt"));
+  ASSERT_EQ(Read(store.Path(key)), Read(dir_ + "/b.srt"));
+
+  struct stat object;
+  ASSERT_EQ(0, stat(store.Path(key).c_str(), &object));
+  ASSERT_EQ(0444u, object.st_mode & 0777);
+}
+
+TEST_F(SubtitleStoreTest, WritersWithoutLock) {
+  SubtitleStore store(dir_ + "/store");
+  string key = SubtitleStore::Key(7, "ab");
+  // writers that do not hold the lock never share a temporary file
+  string first = store.TempPath(key);
+  string second = store.TempPath(key);
+  ASSERT_NE(first, second);
+  Write(first, "same");
+  Write(second, "same");
+  store.Commit(key, second);
+  store.Commit(key, first);
+  ASSERT_EQ("same", Read(store.Path(key)));
+  ASSERT_NE(0, access(first.c_str(), F_OK));
+  ASSERT_NE(0, access(second.c_str(), F_OK));
+}
+
+TEST_F(SubtitleStoreTest, TempFiles) {
+  SubtitleStore store(dir_ + "/store");
+  string key = SubtitleStore::Key(7, "ab");
+  string committed = store.TempPath(key);
+  string failed = store.TempPath(key);
+  {
+    SubtitleStore::TempFiles leftovers;
+    leftovers.Add(committed);
+    leftovers.Add(failed);
+    Write(committed, "whole");
+    Write(failed, "half");
+    store.Commit(key, committed);
+  }
+  ASSERT_EQ("whole", Read(store.Path(key)));
+  ASSERT_NE(0, access(failed.c_str(), F_OK));
+}
+
+TEST_F(SubtitleStoreTest, PlaceWithoutLink) {
+  Write(dir_ + "/from", "original");
+  SubtitleStore::Place(dir_ + "/from", dir_ + "/to", false);
+  Write(dir_ + "/to", "edited");
+  ASSERT_EQ("original", Read(dir_ + "/from"));
+  ASSERT_THROW(SubtitleStore::Place(dir_ + "/missing", dir_ + "/to", true),
+               SubtleException);
+}
+
+TEST_F(SubtitleStoreTest, Disabled) {
+  SubtitleStore store("");
+  ASSERT_FALSE(store.enabled());
+  ASSERT_FALSE(store.Materialize("1-ab", dir_ + "/a.srt"));
+  SubtitleStore::Lock lock(store, "1-ab");
+}
+
+}  // namespace libsubtle
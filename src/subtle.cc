@@ -1,23 +1,27 @@
 #include <inttypes.h>
 #include <sys/stat.h>
 
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <cstring>
 
 #include <fstream>
 #include <iostream>
+#include <memory>
 
-#include "src/base64.h"
+#include "src/base64_codec.h"
+#include "src/byte_sink.h"
+#include "src/compact_subfile.h"
+#include "src/decode_pool.h"
+#include "src/inflater.h"
+#include "src/md5.h"
+#include "src/metrics.h"
+#include "src/output_batch.h"
+#include "src/pipeline.h"
 #include "src/subtle.h"
+#include "src/trace.h"
 #include "src/types.h"
-#include "src/gzstream.h"
-
-const char kPathSeparator =
-#ifdef _WIN32
-    '\\';
-#else
-    '/';
-#endif
 
 using std::cout;
 using std::endl;
@@ -33,63 +37,384 @@ namespace libsubtle {
 const string Subtle::kServerUrl = "http://api.opensubtitles.org/xml-rpc";
 const string Subtle::kUserAgent = "libsubtle";
 
-Subtle::~Subtle() {
-  if (!token_.empty()) {
-    client_->LogOut(token_);
-  }
+const size_t Subtle::kCheckSubHashBatch;
+const size_t Subtle::kDetectLanguageBatch;
+const size_t Subtle::kLanguageSample;
+const size_t Subtle::kSearchParallelism;
+const size_t Subtle::kDownloadBatch;
+
+Subtle::~Subtle() {}
+
+extern "C" Subtle::Subtle(XmlRpcClient* client)
+    : client_(client),
+      session_(client, SessionOptions()),
+      store_(SubtitleStore::DefaultRoot()) {
+  client_->Init(kUserAgent, kServerUrl);
 }
 
-extern "C" Subtle::Subtle(XmlRpcClient* client) : client_(client) {
-  LoginRequest* req = new LoginRequest();
+extern "C" Subtle::Subtle(XmlRpcClient* client, const SessionOptions& options)
+    : client_(client),
+      session_(client, options),
+      store_(SubtitleStore::DefaultRoot()) {
   client_->Init(kUserAgent, kServerUrl);
-  LoginResponse res = client_->LogIn(req);
-  token_ = res.token_;
-  delete req;
 }
 
 extern "C" vector<SubFile> Subtle::SearchSubtitles(const string& lng,
                                                    const string& hash,
                                                    double size) const {
-  SearchRequest* req = new SearchRequest(lng, hash, size);
-  SearchResponse res = client_->SearchSubtitles(token_, req);
-
-  delete req;
+  SearchRequest req(lng, hash, size);
+  SearchResponse res = session_.Run([&](const string& token) {
+    return client_->SearchSubtitles(token, req);
+  });
 
-  return res.data_;
+  return std::move(res.data_);
 }
 
 extern "C" void Subtle::DownloadSubtitles(const string& lng, const string& hash,
                                           double size, const string& dest)
                                           const {
-  auto search = SearchSubtitles(lng, hash, size);
+  SearchRequest search_req(lng, hash, size);
+  CompactSubFiles search;
+  session_.Run([&](const string& token) {
+    search.Clear();
+    return client_->SearchSubtitles(token, search_req, &search);
+  });
   DownloadResponse res;
 
   if (!search.empty()) {
-    vector<int> ids;
-    int best_match = std::stoi(search[0].IDSubtitleFile_);
-    ids.push_back(best_match);
-    DownloadRequest* req = new DownloadRequest(ids);
-    res = client_->DownloadSubtitles(token_, req);
-
-    if (!res.subtitles_.empty()) {
-      char temp_file[L_tmpnam];
-      tmpnam(temp_file);
-      ofstream f(temp_file, ios::out | ios::binary);
-      f << base64_decode(res.subtitles_[0].second);
-      igzstream in(temp_file);
-      std::ofstream out(dest + kPathSeparator + search[0].SubFileName_);
-      char c;
-      while ( in.get(c)) {
-        out << c;
+    SUBTLE_TRACE_SPAN("download", "DownloadSubtitles");
+    const CompactSubFile& best_match = search[0];
+    string file_name = search.Text(best_match.sub_file_name);
+    string path = dest + kPathSeparator + file_name;
+    string key = SubtitleStore::Key(best_match.id_subtitle_file,
+                                    best_match.sub_hash);
+    // the file only replaces path once it is complete and durable
+    OutputBatch output;
+    string temp = output.Add(path);
+    // whoever fetches the file first stores it, the others wait and reuse it
+    SubtitleStore::Lock lock(store_, key);
+    bool stored = store_.Materialize(key, temp);
+    if (store_.enabled()) {
+      (stored ? metrics::Library().store_hits
+              : metrics::Library().store_misses)->Add();
+    }
+    if (stored) {
+      output.Commit();
+      cout << "Reused stored subtitle for " << file_name << endl;
+      return;
+    }
+    DownloadRequest req(vector<int>(1, best_match.id_subtitle_file));
+
+    // base64 text streams through the decoder and inflater into the file
+    string id = std::to_string(best_match.id_subtitle_file);
+    string fetched = temp;
+    SubtitleStore::TempFiles leftover;
+    if (store_.enabled()) {
+      fetched = store_.TempPath(key);
+      leftover.Add(fetched);
+    }
+    FileSink file(fetched);
+    std::unique_ptr<ByteSink> inflate = DefaultInflater()->NewSink(&file);
+    Base64DecodeSink base64(inflate.get());
+    res = session_.Run([&](const string& token) {
+      return client_->DownloadSubtitles(token, req,
+                                        [&](const string& sub_id) {
+        return sub_id == id ? static_cast<ByteSink*>(&base64) : NULL;
+      });
+    });
+
+    // the service may answer without the file, leaving it empty
+    bool received = false;
+    for (const auto& subtitle : res.subtitles_) {
+      received = received || subtitle.first == id;
+    }
+    if (received) {
+      if (store_.enabled()) {
+        store_.Commit(key, fetched);
+        store_.Materialize(key, temp);
+      }
+      output.Commit();
+      cout << "Downloaded subtitle to " << file_name << endl;
+    }
+  }
+}
+
+size_t Subtle::DownloadSubtitleFiles(const vector<SubtitleDownload>& files)
+    const {
+  SUBTLE_TRACE_SPAN("download", "DownloadSubtitleFiles");
+  // destinations by key, in key order so that concurrent batches take the
+  // locks in the same order
+  map<string, vector<const SubtitleDownload*>> wanted;
+  for (const SubtitleDownload& file : files) {
+    wanted[SubtitleStore::Key(file.id, file.sub_hash)].push_back(&file);
+  }
+
+  // files are written under temporary names and moved into place together,
+  // with one round of syncs for the whole batch
+  OutputBatch output;
+  vector<std::unique_ptr<SubtitleStore::Lock>> locks;
+  map<int, pair<string, const vector<const SubtitleDownload*>*>> fetch;
+  for (const auto& key : wanted) {
+    locks.emplace_back(new SubtitleStore::Lock(store_, key.first));
+    if (store_.Contains(key.first)) {
+      metrics::Library().store_hits->Add();
+      for (const SubtitleDownload* file : key.second) {
+        store_.Materialize(key.first, output.Add(file->path));
+      }
+    } else {
+      if (store_.enabled()) {
+        metrics::Library().store_misses->Add();
+      }
+      fetch[key.second[0]->id] = std::make_pair(key.first, &key.second);
+    }
+  }
+  if (fetch.empty()) {
+    return output.Commit();
+  }
+  vector<int> ids;
+  for (const auto& file : fetch) {
+    ids.push_back(file.first);
+  }
+  DownloadRequest req(std::move(ids));
+
+  // files in the store that were not committed are removed once the pool
+  // has stopped
+  SubtitleStore::TempFiles leftovers;
+  // the receiving thread only collects each payload; the pool blocks it when
+  // decoding falls behind
+  DecodePool pool;
+  vector<std::unique_ptr<ByteSink>> sinks;
+  session_.Run([&](const string& token) {
+    return client_->DownloadSubtitles(token, req,
+                                      [&](const string& sub_id) {
+      auto file = fetch.find(atoi(sub_id.c_str()));
+      if (file == fetch.end()) {
+        return static_cast<ByteSink*>(NULL);
+      }
+      const string& key = file->second.first;
+      const vector<const SubtitleDownload*>& dests = *file->second.second;
+      // without a store the first destination holds the fetched file, and
+      // the others are copied from it
+      string first = store_.enabled() ? store_.TempPath(key)
+                                      : output.Add(dests[0]->path);
+      if (store_.enabled()) {
+        leftovers.Add(first);
+      }
+      sinks.push_back(pool.NewJobSink(first,
+                                      [this, key, first, &dests, &output] {
+        if (store_.enabled()) {
+          store_.Commit(key, first);
+        }
+        string from = store_.enabled() ? store_.Path(key) : first;
+        for (size_t i = store_.enabled() ? 0 : 1; i < dests.size(); ++i) {
+          SubtitleStore::Place(from, output.Add(dests[i]->path),
+                               store_.enabled());
+        }
+      }));
+      return sinks.back().get();
+    });
+  });
+  try {
+    pool.Wait();
+  } catch (const SubtleException&) {
+    // the files that were written are still worth keeping
+    output.Commit();
+    throw;
+  }
+  return output.Commit();
+}
+
+namespace {
+
+struct Video {
+  string path;
+  string hash;
+  double size;
+};
+
+string Hex(const uint8_t* md5) {
+  static const char kHex[] = "0123456789abcdef";
+  string hex;
+  for (int i = 0; i < 16; ++i) {
+    hex += kHex[md5[i] >> 4];
+    hex += kHex[md5[i] & 0xf];
+  }
+  return hex;
+}
+
+string Folder(const string& path) {
+  size_t separator = path.rfind(kPathSeparator);
+  return separator == string::npos ? "." : path.substr(0, separator);
+}
+
+}  // namespace
+
+size_t Subtle::DownloadForVideos(const string& lng,
+                                 const vector<string>& videos) const {
+  const size_t kHashParallelism = 2;
+  const size_t kDownloadParallelism = 2;
+  Scheduler scheduler(kHashParallelism + kSearchParallelism +
+                      kDownloadParallelism);
+  std::atomic<size_t> written(0);
+
+  // each stage bounds its own resource: the disk, the number of searches
+  // in flight, and downloads batched into few calls
+  StageOptions download_options;
+  download_options.parallelism = kDownloadParallelism;
+  download_options.batch_size = kDownloadBatch;
+  download_options.linger = std::chrono::milliseconds(100);
+  download_options.depth = metrics::Library().download_queue;
+  Stage<SubtitleDownload, int> download(&scheduler,
+      [&](vector<SubtitleDownload>* files, PipeInput<int>*) {
+        written += DownloadSubtitleFiles(*files);
+      }, NULL, download_options);
+
+  StageOptions search_options;
+  search_options.parallelism = kSearchParallelism;
+  search_options.depth = metrics::Library().search_queue;
+  Stage<Video, SubtitleDownload> search(&scheduler,
+      [&](vector<Video>* batch, PipeInput<SubtitleDownload>* next) {
+        // only the best match of each is kept, the set is reused
+        CompactSubFiles found;
+        for (const Video& video : *batch) {
+          SearchRequest req(lng, video.hash, video.size);
+          session_.Run([&](const string& token) {
+            found.Clear();
+            return client_->SearchSubtitles(token, req, &found);
+          });
+          if (!found.empty()) {
+            SubtitleDownload file;
+            file.id = found[0].id_subtitle_file;
+            file.sub_hash = Hex(found[0].sub_hash);
+            file.path = Folder(video.path) + kPathSeparator +
+                found.Text(found[0].sub_file_name);
+            next->Push(file);
+          }
+        }
+      }, &download, search_options);
+
+  StageOptions hash_options;
+  hash_options.parallelism = kHashParallelism;
+  hash_options.depth = metrics::Library().hash_queue;
+  Stage<string, Video> hash(&scheduler,
+      [](vector<string>* paths, PipeInput<Video>* next) {
+        for (const string& path : *paths) {
+          ifstream f(path.c_str());
+          struct stat filestatus;
+          if (!f.is_open() || stat(path.c_str(), &filestatus) != 0) {
+            continue;
+          }
+          Hasher hasher;
+          Video video = {path, hasher.ComputeHashAsString(f),
+                         static_cast<double>(filestatus.st_size)};
+          next->Push(video);
+        }
+      }, &search, hash_options);
+
+  metrics::Library().files_scanned->Add(videos.size());
+  for (const string& video : videos) {
+    hash.Push(video);
+  }
+  hash.Close();
+  download.Wait();
+  hash.Wait();
+  search.Wait();
+  return written;
+}
+
+map<string, int> Subtle::CheckLocalSubtitles(const vector<string>& paths)
+    const {
+  // copies of one file share a lookup
+  map<string, vector<const string*>> by_hash;
+  metrics::Library().files_scanned->Add(paths.size());
+  for (const string& path : paths) {
+    string hash;
+    if (Md5File(path, &hash)) {
+      by_hash[hash].push_back(&path);
+    }
+  }
+
+  map<string, int> known;
+  vector<string> hashes;
+  for (auto iter = by_hash.begin(); iter != by_hash.end();) {
+    hashes.push_back(iter->first);
+    if (++iter != by_hash.end() && hashes.size() < kCheckSubHashBatch) {
+      continue;
+    }
+    // emptied again below for the next batch
+    CheckSubHashRequest req(std::move(hashes));
+    CheckSubHashResponse res = session_.Run([&](const string& token) {
+      return client_->CheckSubHash(token, req);
+    });
+    for (const auto& sub : res.sub_ids_) {
+      // unknown hashes map to 0
+      int id = atoi(sub.second.c_str());
+      if (id > 0 && by_hash.count(sub.first)) {
+        for (const string* path : by_hash[sub.first]) {
+          known[*path] = id;
+        }
       }
-      in.close();
-      out.close();
-      cout << "Downloaded subtitle to " << search[0].SubFileName_ << endl;
-      remove(temp_file);
     }
+    hashes.clear();
+  }
+  return known;
+}
 
-    delete req;
+map<string, string> Subtle::DetectLocalLanguages(
+    const vector<string>& paths) const {
+  // the service answers by the MD5 of each text; copies share an answer
+  map<string, vector<const string*>> by_hash;
+  vector<string> texts;
+  map<string, string> detected;  // by hash
+  for (size_t i = 0; i < paths.size(); ++i) {
+    ifstream file(paths[i].c_str(), std::ios::binary);
+    string text(kLanguageSample, '\0');
+    file.read(&text[0], text.size());
+    text.resize(file.gcount());
+    // a sample ending mid line ends at the last whole one
+    size_t end = text.rfind('\n');
+    if (file && end != string::npos) {
+      text.resize(end + 1);
+    }
+    if (!text.empty()) {
+      vector<const string*>& same = by_hash[Md5Hex(text)];
+      if (same.empty()) {
+        texts.push_back(std::move(text));
+      }
+      same.push_back(&paths[i]);
+    }
+    if (texts.empty() ||
+        (texts.size() < kDetectLanguageBatch && i + 1 < paths.size())) {
+      continue;
+    }
+    // emptied again below for the next batch
+    DetectLanguageRequest req(std::move(texts));
+    DetectLanguageResponse res = session_.Run([&](const string& token) {
+      return client_->DetectLanguage(token, req);
+    });
+    detected.insert(res.detected_langs_.begin(), res.detected_langs_.end());
+    texts.clear();
   }
+
+  map<string, string> languages;
+  for (const auto& same : by_hash) {
+    auto language = detected.find(same.first);
+    if (language != detected.end()) {
+      for (const string* path : same.second) {
+        languages[*path] = language->second;
+      }
+    }
+  }
+  return languages;
+}
+
+bool Subtle::HasSubtitleNamedAfter(const std::set<string>& subtitles,
+                                   const string& video) {
+  // names starting with the stem and a '.' sort together from here, apart
+  // from ep1 - 2.srt before them and ep10.srt after
+  string stem = video.substr(0, video.rfind('.')) + ".";
+  auto name = subtitles.lower_bound(stem);
+  return name != subtitles.end() && name->compare(0, stem.size(), stem) == 0;
 }
 
 extern "C" void Subtle::DownloadSubtitles(const string& lng,
@@ -2,12 +2,15 @@
 #define SRC_SUBTLE_H_
 
 #include <map>
+#include <set>
 #include <vector>
 #include <cstdlib>
 #include <string>
 
 #include "src/hash.h"
+#include "src/session.h"
 #include "src/subfile.h"
+#include "src/subtitle_store.h"
 #include "src/xml_rpc_client.h"
 
 using std::string;
@@ -18,9 +21,29 @@ using std::vector;
 
 namespace libsubtle {
 
+/// Separates the folders of a path.
+const char kPathSeparator =
+#ifdef _WIN32
+    '\\';
+#else
+    '/';
+#endif
+
+/// A subtitle file to download, and where to put it.
+struct SubtitleDownload {
+  /// IDSubtitleFile of the file.
+  int id;
+  /// SubHash of the file, keying it in the local store with the id.
+  string sub_hash;
+  /// File to write the subtitle to.
+  string path;
+};
+
 class Subtle {
  public:
   explicit Subtle(XmlRpcClient* client);
+  /// \param options account and token cache to use for the session.
+  Subtle(XmlRpcClient* client, const SessionOptions& options);
   virtual ~Subtle();
 
   virtual vector<SubFile> SearchSubtitles(const string& lng, const string& hash,
@@ -30,15 +53,66 @@ class Subtle {
   virtual void DownloadSubtitles(const string& lng,
                                  const string& file_path,
                                  const string& dest) const;
+  /// Download several subtitle files in one call. Each file is decoded,
+  /// inflated and written on a DecodePool while the rest of the response is
+  /// still arriving. Files already in the local store are not fetched, and a
+  /// file wanted in several places is fetched once.
+  /// \param files subtitle files to download.
+  /// \return number of files written.
+  virtual size_t DownloadSubtitleFiles(const vector<SubtitleDownload>& files)
+      const;
+  /// Download the best subtitle for each of many videos, into the folder of
+  /// each video. Videos are hashed, searched for and downloaded by a
+  /// pipeline, so disk, network and CPU work overlap; searches run
+  /// kSearchParallelism at a time, and downloads are batched by
+  /// kDownloadBatch.
+  /// \param lng language of the subtitles.
+  /// \param videos paths of the videos.
+  /// \return number of subtitle files written.
+  virtual size_t DownloadForVideos(const string& lng,
+                                   const vector<string>& videos) const;
 
- private:
-  FRIEND_TEST(Subtle, Login);
-  bool Login();
+  /// Find which local subtitle files the service knows, so they need not be
+  /// searched for and downloaded again. Files are hashed locally and looked
+  /// up with CheckSubHash, kCheckSubHashBatch hashes per call.
+  /// \param paths subtitle files to check.
+  /// \return IDSubtitleFile of each known file, by path.
+  virtual std::map<string, int> CheckLocalSubtitles(
+      const vector<string>& paths) const;
+
+  /// Find the language of local subtitle files, as the service detects it
+  /// from the first kLanguageSample bytes of each. Files are sent with
+  /// DetectLanguage, kDetectLanguageBatch per call.
+  /// \param paths subtitle files to check.
+  /// \return ISO 639-2 code of the language of each readable file, by path.
+  virtual std::map<string, string> DetectLocalLanguages(
+      const vector<string>& paths) const;
 
+  /// \param subtitles names of subtitle files in the folder of the video.
+  /// \param video name of the video file.
+  /// \return whether one of subtitles is named after the video: its name up
+  ///         to the extension followed by a '.', as ep1.srt or ep1.en.srt
+  ///         for ep1.mkv, but not ep10.srt.
+  static bool HasSubtitleNamedAfter(const std::set<string>& subtitles,
+                                    const string& video);
+
+  static const size_t kCheckSubHashBatch = 200;
+  static const size_t kDetectLanguageBatch = 50;
+  static const size_t kLanguageSample = 4096;
+  static const size_t kSearchParallelism = 4;
+  static const size_t kDownloadBatch = 20;
+
+  /// Endpoint of the service, and the user agent it knows the library by.
   static const string kServerUrl;
   static const string kUserAgent;
-  string token_;
+
+ private:
   XmlRpcClient* client_;
+  // logs in on the first call and is shared with other processes, so it is
+  // left open on destruction
+  mutable SessionManager session_;
+  // every download goes through it, so each file is fetched once
+  SubtitleStore store_;
 };
 
 
@@ -1,6 +1,15 @@
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
 #include <iostream>
+#include <set>
+#include <sstream>
 
 #include "gtest/gtest.h"
+#include "src/md5.h"
+#include "src/mock_server.h"
+#include "src/mock_service_fixture.h"
 #include "src/subtle.h"
 #include "src/rpc_impl.h"
 
@@ -9,31 +18,138 @@ using std::ifstream;
 
 namespace libsubtle {
 
-TEST(Subtle, Search) {
+// Subtle talking to the mock service, without a session or subtitle cache
+class SubtleTest : public MockServiceFixture {
+ protected:
+  SubtleTest() {
+    setenv("SUBTLE_STORE", "-", 1);
+    options_.cache_path = "-";
+    options_.keepalive = false;
+  }
+
+  // Subtle points its client at the live service, so it is pointed back
+  void Connect(XmlRpcImpl* client) {
+    client->Init("OS Test User Agent", url());
+  }
+
+  SessionOptions options_;
+};
+
+TEST_F(SubtleTest, Search) {
   XmlRpcImpl client;
-  Subtle s(&client);
-  vector<SubFile> result;
+  Subtle s(&client, options_);
+  Connect(&client);
   vector<SubFile> res = s.SearchSubtitles("eng", "7d9cd5def91c9432", 735934464);
 
+  ASSERT_EQ(3u, res.size());
   for (auto r : res) {
     r.Print();
   }
 }
 
-TEST(Subtle, Download) {
+TEST_F(SubtleTest, Download) {
+  XmlRpcImpl client;
+  Subtle s(&client, options_);
+  Connect(&client);
+  vector<SubFile> res = s.SearchSubtitles("eng", "7d9cd5def91c9432", 735934464);
+  ASSERT_FALSE(res.empty());
+
+  char dir[] = "/tmp/subtle_test.XXXXXX";
+  ASSERT_TRUE(mkdtemp(dir) != NULL);
+  s.DownloadSubtitles("eng", "7d9cd5def91c9432", 735934464.0f, dir);
+
+  string path = string(dir) + "/" + res[0].SubFileName_;
+  ifstream file(path.c_str(), ios::binary);
+  std::stringstream text;
+  text << file.rdbuf();
+  ASSERT_EQ(service_.SubtitleText(atoi(res[0].IDSubtitleFile_.c_str())),
+            text.str());
+  ASSERT_EQ(res[0].SubHash_, Md5Hex(text.str()));
+  remove(path.c_str());
+  rmdir(dir);
+}
+
+TEST_F(SubtleTest, DownloadOtherFile) {
+  // the service answers with a file that was not asked for
+  MockServer server([this](const string& request, int* status) {
+    if (request.find("<methodName>DownloadSubtitles<") == string::npos) {
+      return service_.Respond(request, status);
+    }
+    return string(
+        "<?xml version=\"1.0\"?><methodResponse><params><param><value>"
+        "<struct><member><name>status</name><value><string>200 OK</string>"
+        "</value></member><member><name>data</name><value><array><data>"
+        "<value><struct><member><name>idsubtitlefile</name><value><string>1"
+        "</string></value></member><member><name>data</name><value><string>"
+        "AAAA</string></value></member></struct></value></data></array>"
+        "</value></member><member><name>seconds</name><value><double>0.1"
+        "</double></value></member></struct></value></param></params>"
+        "</methodResponse>");
+  }, 0);
+  char dir[] = "/tmp/subtle_test.XXXXXX";
+  ASSERT_TRUE(mkdtemp(dir) != NULL);
+  string store = string(dir) + "/store";
+  setenv("SUBTLE_STORE", store.c_str(), 1);
   XmlRpcImpl client;
-  Subtle s(&client);
-  vector<SubFile> result;
-  s.DownloadSubtitles("eng", "7d9cd5def91c9432", 735934464.0f, ".");
+  Subtle s(&client, options_);
+  setenv("SUBTLE_STORE", "-", 1);
+  client.Init("OS Test User Agent", server.url());
+  vector<SubFile> res = s.SearchSubtitles("eng", "7d9cd5def91c9432", 735934464);
+  ASSERT_FALSE(res.empty());
+
+  s.DownloadSubtitles("eng", "7d9cd5def91c9432", 735934464.0f, dir);
+  string path = string(dir) + "/" + res[0].SubFileName_;
+  ASSERT_NE(0, access(path.c_str(), F_OK));
+  // nor is a temporary file left in the store
+  ASSERT_NE(0, system(("find " + store + " -name '*.tmp.*' | grep -q .")
+                      .c_str()));
+  ASSERT_EQ(0, system(("rm -rf " + string(dir)).c_str()));
+}
+
+TEST_F(SubtleTest, DetectLocalLanguages) {
+  XmlRpcImpl client;
+  Subtle s(&client, options_);
+  Connect(&client);
+  char dir[] = "/tmp/subtle_test.XXXXXX";
+  ASSERT_TRUE(mkdtemp(dir) != NULL);
+  vector<string> paths;
+  for (const char* name : {"a.srt", "copy of a.srt", "b.srt"}) {
+    paths.push_back(string(dir) + "/" + name);
+    std::ofstream file(paths.back().c_str());
+    file << "1\n00:00:01,000 --> 00:00:02,000\n"
+         << (name[0] == 'b' ? "Goodbye" : "Hello") << "\n";
+  }
+  paths.push_back(string(dir) + "/missing.srt");
+
+  map<string, string> languages = s.DetectLocalLanguages(paths);
+  ASSERT_EQ(3u, languages.size());
+  ASSERT_EQ("eng", languages[paths[1]]);
+  ASSERT_EQ(0u, languages.count(paths[3]));
+  ASSERT_EQ(1, service_.calls("DetectLanguage"));
+  for (size_t i = 0; i < 3; ++i) {
+    remove(paths[i].c_str());
+  }
+  rmdir(dir);
+}
+
+TEST_F(SubtleTest, HasSubtitleNamedAfter) {
+  std::set<string> ep10 = {"ep10.srt"};
+  ASSERT_FALSE(Subtle::HasSubtitleNamedAfter(ep10, "ep1.mkv"));
+  ASSERT_TRUE(Subtle::HasSubtitleNamedAfter(ep10, "ep10.mkv"));
+
+  std::set<string> names = {"ep1 - 2.srt", "ep1.en.srt", "ep10.srt"};
+  ASSERT_TRUE(Subtle::HasSubtitleNamedAfter(names, "ep1.mkv"));
+  ASSERT_TRUE(Subtle::HasSubtitleNamedAfter(names, "ep1 - 2.mkv"));
+  ASSERT_FALSE(Subtle::HasSubtitleNamedAfter(names, "ep2.mkv"));
 }
 
-TEST(Subtle, SearchFail) {
+TEST_F(SubtleTest, SearchFail) {
   XmlRpcImpl client;
-  Subtle s(&client);
-  vector<SubFile> result;
+  Subtle s(&client, options_);
+  Connect(&client);
   vector<SubFile> res = s.SearchSubtitles("wrong lang", "7d9cd5def91c9432",
                                          735934464);
-  ASSERT_NE(OK, res.size());
+  ASSERT_EQ(0u, res.size());
 }
 
 }  // namespace libsubtle
@@ -0,0 +1,244 @@
+#ifndef SRC_TASK_H_
+#define SRC_TASK_H_
+
+#if !defined(__cpp_impl_coroutine)
+#error "src/task.h needs C++20 coroutines, see SUBTLE_WITH_COROUTINES"
+#endif
+
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "src/async_transport.h"
+#include "src/byte_sink.h"
+#include "src/scheduler.h"
+
+using std::string;
+
+namespace libsubtle {
+
+template <typename T>
+class Task;
+
+namespace task_detail {
+
+// Resumes whoever awaited the task once it is over.
+struct FinalAwaiter {
+  bool await_ready() noexcept { return false; }
+  template <typename Promise>
+  std::coroutine_handle<> await_suspend(
+      std::coroutine_handle<Promise> handle) noexcept {
+    std::coroutine_handle<> continuation = handle.promise().continuation;
+    return continuation ? continuation : std::noop_coroutine();
+  }
+  void await_resume() noexcept {}
+};
+
+struct PromiseBase {
+  std::suspend_always initial_suspend() noexcept { return {}; }
+  FinalAwaiter final_suspend() noexcept { return {}; }
+  void unhandled_exception() { error = std::current_exception(); }
+
+  std::coroutine_handle<> continuation;
+  std::exception_ptr error;
+};
+
+template <typename T>
+struct Promise : PromiseBase {
+  Task<T> get_return_object();
+  void return_value(T result) { value.emplace(std::move(result)); }
+  T Result() {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+    return std::move(*value);
+  }
+
+  std::optional<T> value;
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+  Task<void> get_return_object();
+  void return_void() {}
+  void Result() {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+};
+
+}  // namespace task_detail
+
+/// Result of a coroutine, produced once it is awaited.
+///
+/// The coroutine starts when the task is awaited, runs until it has to wait
+/// itself, and resumes its awaiter when it returns; exceptions it lets out
+/// are rethrown to the awaiter. Arguments should be taken by value, since
+/// the coroutine may outlive the expression that called it.
+template <typename T>
+class Task {
+ public:
+  typedef task_detail::Promise<T> promise_type;
+
+  Task(Task&& other) : handle_(std::exchange(other.handle_, nullptr)) {}
+  ~Task() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  bool await_ready() const { return !handle_ || handle_.done(); }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) {
+    handle_.promise().continuation = awaiter;
+    return handle_;
+  }
+  T await_resume() { return handle_.promise().Result(); }
+
+ private:
+  friend promise_type;
+
+  explicit Task(std::coroutine_handle<promise_type> handle)
+      : handle_(handle) {}
+  Task(const Task&);
+  void operator=(const Task&);
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+namespace task_detail {
+
+template <typename T>
+Task<T> Promise<T>::get_return_object() {
+  return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() {
+  return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+// Coroutine that starts at once and frees itself when over; used to run a
+// task from code that is not a coroutine.
+struct Detached {
+  struct promise_type {
+    Detached get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+}  // namespace task_detail
+
+/// Start a task without awaiting it, from code that is not a coroutine; this
+/// is how many tasks are kept running at once.
+/// \param done runs once the task is over, with the exception it let out,
+///        if any; it must not throw.
+template <typename T>
+void Spawn(Task<T> task, const std::function<void(std::exception_ptr)>& done) {
+  [](Task<T> task, std::function<void(std::exception_ptr)> done)
+      -> task_detail::Detached {
+    std::exception_ptr error;
+    try {
+      co_await task;
+    } catch (...) {
+      error = std::current_exception();
+    }
+    done(error);
+  }(std::move(task), done);
+}
+
+/// Run a task, blocking the calling thread until it is over. Meant for
+/// tests and for the edges of a program; the thread should not be the one
+/// the task resumes on.
+/// \return result of the task; its exception is rethrown.
+template <typename T>
+T SyncWait(Task<T> task) {
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool done = false;
+  std::optional<Task<T>> owned(std::move(task));
+  [](Task<T>* task, std::mutex* mutex, std::condition_variable* cv,
+     bool* done) -> task_detail::Detached {
+    try {
+      co_await *task;
+    } catch (...) {
+      // kept in the task, and rethrown below
+    }
+    std::lock_guard<std::mutex> lock(*mutex);
+    *done = true;
+    cv->notify_all();
+  }(&*owned, &mutex, &cv, &done);
+  std::unique_lock<std::mutex> lock(mutex);
+  cv.wait(lock, [&done] { return done; });
+  return owned->await_resume();
+}
+
+/// Awaitable posting a call on an AsyncTransport, resuming the awaiting
+/// coroutine on the thread that completes the call. Throws as
+/// Transport::Post.
+class PostAwaiter {
+ public:
+  PostAwaiter(AsyncTransport* transport, const string& url,
+              const string& user_agent, const string& body,
+              ByteSink* response)
+      : transport_(transport), url_(url), user_agent_(user_agent),
+        body_(body), response_(response) {}
+
+  bool await_ready() const { return false; }
+  void await_suspend(std::coroutine_handle<> awaiter) {
+    // the handler may resume the coroutine before PostAsync returns, so
+    // nothing here may be touched after the call
+    transport_->PostAsync(url_, user_agent_, body_, response_,
+                          [this, awaiter](std::exception_ptr error) {
+      error_ = error;
+      awaiter.resume();
+    });
+  }
+  void await_resume() {
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+  }
+
+ private:
+  AsyncTransport* transport_;
+  const string& url_;
+  const string& user_agent_;
+  const string& body_;
+  ByteSink* response_;
+  std::exception_ptr error_;
+};
+
+/// co_await Post(...) posts a call and resumes once the response is in.
+inline PostAwaiter Post(AsyncTransport* transport, const string& url,
+                        const string& user_agent, const string& body,
+                        ByteSink* response) {
+  return PostAwaiter(transport, url, user_agent, body, response);
+}
+
+/// Awaitable moving the awaiting coroutine onto a worker of a Scheduler,
+/// to do blocking work off the thread of the transport.
+class ResumeOn {
+ public:
+  explicit ResumeOn(Scheduler* scheduler) : scheduler_(scheduler) {}
+
+  bool await_ready() const { return scheduler_ == NULL; }
+  void await_suspend(std::coroutine_handle<> awaiter) {
+    scheduler_->Post([awaiter] { awaiter.resume(); });
+  }
+  void await_resume() {}
+
+ private:
+  Scheduler* scheduler_;
+};
+
+}  // namespace libsubtle
+
+#endif  // SRC_TASK_H_
@@ -0,0 +1,138 @@
+// The coroutine API is only built with SUBTLE_WITH_COROUTINES.
+#if defined(__cpp_impl_coroutine)
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/async_transport.h"
+#include "src/co_subtle.h"
+#include "src/mock_server.h"
+#include "src/scheduler.h"
+#include "src/task.h"
+#include "src/types.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+Task<int> Add(int a, int b) {
+  co_return a + b;
+}
+
+Task<int> Sum(vector<int> values) {
+  int sum = 0;
+  for (int value : values) {
+    sum = co_await Add(sum, value);
+  }
+  co_return sum;
+}
+
+Task<void> Fail() {
+  throw SubtleException("failed");
+  co_return;
+}
+
+Task<string> Echo(AsyncTransport* transport, string url, string body) {
+  class TextSink : public ByteSink {
+   public:
+    void Write(const char* data, size_t size) { text.append(data, size); }
+    string text;
+  } response;
+  co_await Post(transport, url, "test", body, &response);
+  co_return response.text;
+}
+
+// Counts down spawned tasks and keeps the first error.
+class TaskLatch {
+ public:
+  explicit TaskLatch(int count) : count_(count) {}
+
+  void Done(std::exception_ptr error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (error && !error_) {
+      error_ = error;
+    }
+    if (--count_ == 0) {
+      done_.notify_all();
+    }
+  }
+
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return count_ == 0; });
+    if (error_) {
+      std::rethrow_exception(error_);
+    }
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable done_;
+  int count_;
+  std::exception_ptr error_;
+};
+
+TEST(Task, Await) {
+  ASSERT_EQ(10, SyncWait(Sum({1, 2, 3, 4})));
+  ASSERT_THROW(SyncWait(Fail()), SubtleException);
+}
+
+TEST(Task, ManyCallsInFlight) {
+  const int kTasks = 300;
+  MockServer server([](const string& request) { return "<" + request + ">"; });
+  CurlMultiTransport transport;
+  vector<string> responses(kTasks);
+  TaskLatch latch(kTasks);
+  for (int i = 0; i < kTasks; ++i) {
+    Spawn([](CurlMultiTransport* transport, string url, int i,
+             string* response) -> Task<void> {
+      *response = co_await Echo(transport, url, std::to_string(i));
+    }(&transport, server.url(), i, &responses[i]),
+          [&latch](std::exception_ptr error) { latch.Done(error); });
+  }
+  latch.Wait();
+  for (int i = 0; i < kTasks; ++i) {
+    ASSERT_EQ("<" + std::to_string(i) + ">", responses[i]);
+  }
+  // every call was made from the one thread of the transport
+  ASSERT_GT(transport.handles(), 1u);
+}
+
+TEST(Task, ResumeOn) {
+  Scheduler scheduler(2);
+  bool on_worker = SyncWait([](Scheduler* scheduler) -> Task<bool> {
+    co_await ResumeOn(scheduler);
+    co_return scheduler->OnWorker();
+  }(&scheduler));
+  ASSERT_TRUE(on_worker);
+}
+
+TEST(CoXmlRpcClient, Search) {
+  MockServer server([](const string& request) {
+    return string(
+        "<methodResponse><params><param><value><struct>"
+        "<member><name>status</name><value><string>200 OK</string></value>"
+        "</member><member><name>data</name><value><array><data>"
+        "<value><struct><member><name>IDSubtitleFile</name>"
+        "<value><string>1951894257</string></value></member></struct>"
+        "</value></data></array></value></member>"
+        "</struct></value></param></params></methodResponse>");
+  });
+  CurlMultiTransport transport;
+  CoXmlRpcClient client(&transport);
+  client.Init("libsubtle test", server.url());
+  SearchResponse res = SyncWait(client.SearchSubtitles(
+      "token", SearchRequest("eng", "7d9cd5def91c9432", 735934464)));
+  ASSERT_EQ(OK, res.GetStatus());
+  ASSERT_EQ(1u, res.data_.size());
+  ASSERT_EQ("1951894257", res.data_[0].IDSubtitleFile_);
+}
+
+}  // namespace libsubtle
+
+#endif  // __cpp_impl_coroutine
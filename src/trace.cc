@@ -0,0 +1,201 @@
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "src/trace.h"
+
+using std::vector;
+
+namespace libsubtle {
+namespace trace {
+
+std::atomic<bool> g_enabled(false);
+
+namespace {
+
+// Fields are atomics since the export reads them while the thread records.
+struct Event {
+  std::atomic<const char*> category;
+  std::atomic<const char*> name;
+  std::atomic<uint64_t> start;
+  std::atomic<uint64_t> end;
+};
+
+// Spans of one thread. Only that thread records into it, so recording takes
+// no lock; the export reads it concurrently, as a seqlock: writing tells it
+// which spans may have been overwritten while it copied them.
+struct Ring {
+  explicit Ring(uint32_t tid)
+      : tid(tid), head(0), writing(0), cleared(0), owned(true) {}
+
+  // identifies the ring in the trace; a thread exiting hands its ring over
+  // to the next thread started, which then shows as the same thread
+  const uint32_t tid;
+  // number of spans ever recorded
+  std::atomic<uint64_t> head;
+  // number of spans ever started to be written, ahead of head while the
+  // thread writes one
+  std::atomic<uint64_t> writing;
+  // spans before this one were dropped by Clear
+  std::atomic<uint64_t> cleared;
+  // whether a running thread records into it; guarded by the registry
+  bool owned;
+  Event events[kRingSize];
+};
+
+struct Registry {
+  std::mutex mutex;
+  vector<Ring*> rings;
+};
+
+// Never destroyed, as threads may exit after static destructors ran.
+Registry* GetRegistry() {
+  static Registry* registry = new Registry;
+  return registry;
+}
+
+// Hands the ring of a thread back when the thread exits.
+struct RingOwner {
+  RingOwner() : ring(NULL) {}
+  ~RingOwner() {
+    if (ring) {
+      std::lock_guard<std::mutex> lock(GetRegistry()->mutex);
+      ring->owned = false;
+    }
+  }
+
+  Ring* ring;
+};
+
+thread_local RingOwner t_owner;
+
+Ring* ThreadRing() {
+  if (t_owner.ring) {
+    return t_owner.ring;
+  }
+  Registry* registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry->mutex);
+  for (Ring* ring : registry->rings) {
+    if (!ring->owned) {
+      ring->owned = true;
+      t_owner.ring = ring;
+      return ring;
+    }
+  }
+  Ring* ring = new Ring(registry->rings.size() + 1);
+  registry->rings.push_back(ring);
+  t_owner.ring = ring;
+  return ring;
+}
+
+void WriteEscaped(std::ostream& out, const char* text) {
+  for (; *text; ++text) {
+    unsigned char c = *text;
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (c < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out << escaped;
+    } else {
+      out << c;
+    }
+  }
+}
+
+struct Copied {
+  const char* category;
+  const char* name;
+  uint64_t start;
+  uint64_t end;
+};
+
+}  // namespace
+
+void Start() {
+  g_enabled.store(true, std::memory_order_relaxed);
+}
+
+void Stop() {
+  g_enabled.store(false, std::memory_order_relaxed);
+}
+
+void Clear() {
+  Registry* registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry->mutex);
+  for (Ring* ring : registry->rings) {
+    ring->cleared.store(ring->head.load(std::memory_order_acquire),
+                        std::memory_order_relaxed);
+  }
+}
+
+uint64_t Now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Record(const char* category, const char* name, uint64_t start,
+            uint64_t end) {
+  Ring* ring = ThreadRing();
+  uint64_t head = ring->head.load(std::memory_order_relaxed);
+  ring->writing.store(head + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  Event& event = ring->events[head % kRingSize];
+  event.category.store(category, std::memory_order_relaxed);
+  event.name.store(name, std::memory_order_relaxed);
+  event.start.store(start, std::memory_order_relaxed);
+  event.end.store(end, std::memory_order_relaxed);
+  ring->head.store(head + 1, std::memory_order_release);
+}
+
+void WriteChromeTrace(std::ostream& out) {
+  Registry* registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry->mutex);
+  out << "{\"traceEvents\":[";
+  bool first = true;
+  char numbers[128];
+  for (const Ring* ring : registry->rings) {
+    uint64_t head = ring->head.load(std::memory_order_acquire);
+    uint64_t from = std::max(ring->cleared.load(std::memory_order_relaxed),
+                             head > kRingSize ? head - kRingSize : 0);
+    vector<Copied> spans;
+    spans.reserve(head - from);
+    for (uint64_t i = from; i < head; ++i) {
+      const Event& event = ring->events[i % kRingSize];
+      Copied span = {event.category.load(std::memory_order_relaxed),
+                     event.name.load(std::memory_order_relaxed),
+                     event.start.load(std::memory_order_relaxed),
+                     event.end.load(std::memory_order_relaxed)};
+      spans.push_back(span);
+    }
+    // leave out the spans the thread started overwriting while they were
+    // copied
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t writing = ring->writing.load(std::memory_order_relaxed);
+    uint64_t valid = writing > kRingSize ? writing - kRingSize : 0;
+    for (uint64_t i = std::max(from, valid); i < head; ++i) {
+      const Copied& span = spans[i - from];
+      out << (first ? "\n" : ",\n") << "{\"name\":\"";
+      WriteEscaped(out, span.name);
+      out << "\",\"cat\":\"";
+      WriteEscaped(out, span.category);
+      snprintf(numbers, sizeof(numbers),
+               "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,"
+               "\"tid\":%u}",
+               span.start / 1e3, (span.end - span.start) / 1e3,
+               static_cast<int>(getpid()), ring->tid);
+      out << numbers;
+      first = false;
+    }
+  }
+  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+}  // namespace trace
+}  // namespace libsubtle
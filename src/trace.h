@@ -0,0 +1,75 @@
+#ifndef SRC_TRACE_H_
+#define SRC_TRACE_H_
+
+#include <atomic>
+#include <cinttypes>
+#include <ostream>
+
+namespace libsubtle {
+namespace trace {
+
+/// Spans kept per thread; the ring buffer of each holds this many.
+const uint64_t kRingSize = 1 << 13;
+
+/// Whether spans are being recorded. Read with one relaxed load by every
+/// span, which is all tracing costs while it is off.
+extern std::atomic<bool> g_enabled;
+
+/// Start recording spans, from every thread.
+void Start();
+/// Stop recording spans; those recorded so far are kept for export.
+void Stop();
+/// Drop the spans recorded so far.
+void Clear();
+
+/// \return nanoseconds on the clock spans are timed with.
+uint64_t Now();
+
+/// Record a finished span into the ring buffer of the calling thread. Once
+/// a ring holds kRingSize spans, its oldest ones are overwritten.
+/// \param category and name must outlive the export, e.g. be literals.
+void Record(const char* category, const char* name, uint64_t start,
+            uint64_t end);
+
+/// Write the spans recorded so far as Chrome trace JSON, for
+/// chrome://tracing or ui.perfetto.dev. Spans may be recorded meanwhile;
+/// those of rings that wrap during the export are left out.
+void WriteChromeTrace(std::ostream& out);
+
+/// Times the scope it lives in, as a span of the calling thread.
+class Span {
+ public:
+  /// \param category groups spans, e.g. "rpc".
+  /// \param name names the span; both must outlive the export, e.g. be
+  ///        literals.
+  Span(const char* category, const char* name)
+      : category_(category),
+        name_(g_enabled.load(std::memory_order_relaxed) ? name : NULL),
+        start_(name_ ? Now() : 0) {}
+  ~Span() {
+    if (name_) {
+      Record(category_, name_, start_, Now());
+    }
+  }
+
+ private:
+  Span(const Span&);
+  void operator=(const Span&);
+
+  const char* category_;
+  const char* name_;
+  uint64_t start_;
+};
+
+}  // namespace trace
+}  // namespace libsubtle
+
+#define SUBTLE_TRACE_CONCAT_(a, b) a##b
+#define SUBTLE_TRACE_CONCAT(a, b) SUBTLE_TRACE_CONCAT_(a, b)
+
+/// Trace the rest of the enclosing scope as a span.
+#define SUBTLE_TRACE_SPAN(category, name) \
+  ::libsubtle::trace::Span SUBTLE_TRACE_CONCAT(subtle_span_, __LINE__)( \
+      category, name)
+
+#endif  // SRC_TRACE_H_
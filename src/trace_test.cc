@@ -0,0 +1,95 @@
+#include <atomic>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/trace.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+size_t CountOf(const string& text, const string& part) {
+  size_t count = 0;
+  for (size_t pos = text.find(part); pos != string::npos;
+       pos = text.find(part, pos + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+string ExportTrace() {
+  std::ostringstream out;
+  trace::WriteChromeTrace(out);
+  return out.str();
+}
+
+TEST(Trace, Disabled) {
+  trace::Stop();
+  trace::Clear();
+  {
+    SUBTLE_TRACE_SPAN("test", "Disabled");
+  }
+  ASSERT_EQ(0u, CountOf(ExportTrace(), "\"Disabled\""));
+}
+
+TEST(Trace, Threads) {
+  trace::Clear();
+  trace::Start();
+  vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.push_back(std::thread([] {
+      SUBTLE_TRACE_SPAN("test", "Outer");
+      for (int i = 0; i < 100; ++i) {
+        SUBTLE_TRACE_SPAN("test", "Inner \"quoted\"");
+      }
+    }));
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  trace::Stop();
+
+  string json = ExportTrace();
+  ASSERT_EQ(0u, json.find("{\"traceEvents\":["));
+  ASSERT_EQ(4u, CountOf(json, "\"name\":\"Outer\",\"cat\":\"test\""));
+  ASSERT_EQ(400u, CountOf(json, "\"name\":\"Inner \\\"quoted\\\"\""));
+  ASSERT_EQ(404u, CountOf(json, "\"ph\":\"X\""));
+
+  trace::Clear();
+  ASSERT_EQ(0u, CountOf(ExportTrace(), "\"ph\":\"X\""));
+}
+
+TEST(Trace, ExportWhileRecording) {
+  trace::Clear();
+  trace::Start();
+  std::atomic<bool> done(false);
+  std::atomic<uint64_t> spans(0);
+  std::thread recorder([&done, &spans] {
+    while (!done) {
+      {
+        SUBTLE_TRACE_SPAN("test", "Busy");
+      }
+      ++spans;
+    }
+  });
+  // once the ring is full, every span recorded overwrites one, and it wraps
+  // many times over while it is exported
+  while (spans < trace::kRingSize) {
+    std::this_thread::yield();
+  }
+  bool blank = false;
+  for (int i = 0; i < 20; ++i) {
+    blank = blank || ExportTrace().find("\"name\":\"\"") != string::npos;
+  }
+  done = true;
+  recorder.join();
+  trace::Stop();
+  ASSERT_FALSE(blank);
+  ASSERT_GT(CountOf(ExportTrace(), "\"Busy\""), 0u);
+}
+
+}  // namespace libsubtle
@@ -0,0 +1,194 @@
+#include <curl/curl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <string>
+
+#include "src/transport.h"
+#include "src/types.h"
+
+using std::string;
+
+namespace libsubtle {
+
+namespace {
+
+struct PostCall {
+  ByteSink* response;
+  // exceptions cannot cross curl, they are rethrown once it returns
+  std::exception_ptr error;
+};
+
+size_t WriteResponse(char* data, size_t size, size_t count, void* user) {
+  PostCall* call = static_cast<PostCall*>(user);
+  try {
+    call->response->Write(data, size * count);
+  } catch (...) {
+    call->error = std::current_exception();
+    return 0;
+  }
+  return size * count;
+}
+
+std::once_flag curl_initialized;
+
+// Counts the bytes passed on to another sink.
+class CountingSink : public ByteSink {
+ public:
+  CountingSink(ByteSink* sink, uint64_t* count) : sink_(sink), count_(count) {}
+  void Write(const char* data, size_t size) {
+    *count_ += size;
+    sink_->Write(data, size);
+  }
+
+ private:
+  ByteSink* sink_;
+  uint64_t* count_;
+};
+
+}  // namespace
+
+void Transport::Post(const string& url, const string& user_agent,
+                     const string& body, ByteSink* response,
+                     TransferStats* stats) {
+  TransferStats cost = TransferStats();
+  cost.request_bytes = body.size();
+  CountingSink counted(response, &cost.response_bytes);
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  try {
+    Post(url, user_agent, body, &counted);
+  } catch (...) {
+    cost.transfer = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    *stats = cost;
+    throw;
+  }
+  cost.transfer = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  *stats = cost;
+}
+
+CurlTransport::CurlTransport(const CurlOptions& options)
+    : options_(options), handles_(0) {
+  // not thread safe in itself, and needed before handles are created
+  std::call_once(curl_initialized, [] { curl_global_init(CURL_GLOBAL_ALL); });
+}
+
+CurlTransport::~CurlTransport() {
+  for (CURL* curl : idle_) {
+    curl_easy_cleanup(curl);
+  }
+}
+
+size_t CurlTransport::handles() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return handles_;
+}
+
+CURL* CurlTransport::Acquire() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!idle_.empty()) {
+      CURL* curl = idle_.back();
+      idle_.pop_back();
+      return curl;
+    }
+  }
+  CURL* curl = curl_easy_init();
+  if (!curl) {
+    throw SubtleException("Cannot initialize curl.");
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++handles_;
+  return curl;
+}
+
+void CurlTransport::Release(CURL* curl) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  idle_.push_back(curl);
+}
+
+void CurlTransport::Post(const string& url, const string& user_agent,
+                         const string& body, ByteSink* response) {
+  TransferStats stats;
+  Post(url, user_agent, body, response, &stats);
+}
+
+void CurlTransport::Post(const string& url, const string& user_agent,
+                         const string& body, ByteSink* response,
+                         TransferStats* stats) {
+  CURL* curl = Acquire();
+  PostCall call = {response, std::exception_ptr()};
+  curl_slist* headers = curl_slist_append(NULL, "Content-Type: text/xml");
+  curl_easy_reset(curl);
+  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl, CURLOPT_USERAGENT, user_agent.c_str());
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.data());
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE,
+                   static_cast<long>(body.size()));
+  // let the server compress the response, it is inflated as it streams in
+  curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+  // the reset above cleared them
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT,
+                   static_cast<long>(options_.connect_timeout_seconds));
+  curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT,
+                   static_cast<long>(options_.low_speed_limit));
+  curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME,
+                   static_cast<long>(options_.low_speed_time_seconds));
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteResponse);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &call);
+  CURLcode code = curl_easy_perform(curl);
+  long http_status = 0;
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_status);
+  FillStats(curl, stats);
+  curl_slist_free_all(headers);
+  Release(curl);
+
+  if (call.error) {
+    std::rethrow_exception(call.error);
+  }
+  if (code != CURLE_OK) {
+    throw SubtleException(string("XML-RPC call failed: ") +
+                          curl_easy_strerror(code));
+  }
+  if (http_status != 200) {
+    throw SubtleException("XML-RPC call failed: HTTP status " +
+                          std::to_string(http_status));
+  }
+}
+
+void CurlTransport::FillStats(CURL* curl, TransferStats* stats) {
+  // libcurl reports when each phase ended, in microseconds from the start
+  // of the call
+  curl_off_t name_lookup = 0, connect = 0, tls = 0, pretransfer = 0;
+  curl_off_t start_transfer = 0, total = 0, uploaded = 0, downloaded = 0;
+  curl_easy_getinfo(curl, CURLINFO_NAMELOOKUP_TIME_T, &name_lookup);
+  curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect);
+  curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &tls);
+  curl_easy_getinfo(curl, CURLINFO_PRETRANSFER_TIME_T, &pretransfer);
+  curl_easy_getinfo(curl, CURLINFO_STARTTRANSFER_TIME_T, &start_transfer);
+  curl_easy_getinfo(curl, CURLINFO_TOTAL_TIME_T, &total);
+  curl_easy_getinfo(curl, CURLINFO_SIZE_UPLOAD_T, &uploaded);
+  curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &downloaded);
+  // phases that did not happen, such as TLS over plain HTTP, end at 0, and
+  // a call failing early has not started transferring
+  connect = std::max(connect, name_lookup);
+  tls = std::max(tls, connect);
+  pretransfer = std::max(pretransfer, tls);
+  start_transfer = std::max(start_transfer, pretransfer);
+  total = std::max(total, start_transfer);
+  stats->name_lookup = name_lookup / 1e6;
+  stats->connect = (connect - name_lookup) / 1e6;
+  stats->tls = (tls - connect) / 1e6;
+  stats->wait = (start_transfer - tls) / 1e6;
+  stats->transfer = (total - start_transfer) / 1e6;
+  stats->request_bytes = uploaded;
+  stats->response_bytes = downloaded;
+}
+
+}  // namespace libsubtle
@@ -0,0 +1,112 @@
+#ifndef SRC_TRANSPORT_H_
+#define SRC_TRANSPORT_H_
+
+#include <curl/curl.h>
+
+#include <cinttypes>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "src/byte_sink.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+/// What carrying one call cost: seconds spent in each phase, and bytes on
+/// the wire. A transport that cannot tell phases apart leaves them at 0 and
+/// counts their time in the next one.
+struct TransferStats {
+  /// Resolving the host name.
+  double name_lookup;
+  /// Opening the TCP connection; 0 when one was kept alive.
+  double connect;
+  /// TLS handshake.
+  double tls;
+  /// Sending the call and waiting for the first byte of the response.
+  double wait;
+  /// Receiving the response, including the time the sink takes.
+  double transfer;
+  uint64_t request_bytes;
+  uint64_t response_bytes;
+};
+
+/// Carries XML-RPC calls to the service over HTTP. Implementations are safe
+/// to use from several threads at once.
+class Transport {
+ public:
+  virtual ~Transport() {}
+
+  /// Post a call and stream the response body into a sink as it arrives.
+  /// Throws SubtleException on connection errors and HTTP statuses other
+  /// than 200, and lets exceptions from the sink through.
+  /// \param url endpoint of the service.
+  /// \param user_agent identifies the application to the service.
+  /// \param body XML of the call.
+  /// \param response receives the XML of the response; it is not finished.
+  virtual void Post(const string& url, const string& user_agent,
+                    const string& body, ByteSink* response) = 0;
+
+  /// Post a call as above, and report what it cost. By default the whole
+  /// call counts as transfer, and bytes are counted before any encoding.
+  /// \param stats receives the cost of the call, also when it throws.
+  virtual void Post(const string& url, const string& user_agent,
+                    const string& body, ByteSink* response,
+                    TransferStats* stats);
+};
+
+/// Limits on how long libcurl waits for the service, so a call to a server
+/// that stopped answering fails instead of hanging.
+struct CurlOptions {
+  /// Seconds to wait for the connection to open; 0 for libcurl's default.
+  int connect_timeout_seconds;
+  /// A call slower than low_speed_limit bytes per second for
+  /// low_speed_time_seconds, including while waiting for the response, is
+  /// failed; 0 for either waits without limit.
+  int low_speed_limit;
+  int low_speed_time_seconds;
+
+  CurlOptions()
+      : connect_timeout_seconds(10),
+        low_speed_limit(1),
+        low_speed_time_seconds(60) {}
+};
+
+/// Transport over libcurl. Each call borrows an easy handle from a pool and
+/// returns it afterwards, so concurrent calls run on separate connections,
+/// and every thread gets a kept-alive connection back on its next call.
+class CurlTransport : public Transport {
+ public:
+  explicit CurlTransport(const CurlOptions& options = CurlOptions());
+  ~CurlTransport();
+
+  void Post(const string& url, const string& user_agent, const string& body,
+            ByteSink* response);
+  /// Phases are those libcurl reports, and bytes are counted as sent and
+  /// received, compressed.
+  void Post(const string& url, const string& user_agent, const string& body,
+            ByteSink* response, TransferStats* stats);
+
+  /// \return number of easy handles created, the most calls ever in flight.
+  size_t handles() const;
+
+ private:
+  CurlTransport(const CurlTransport&);
+  void operator=(const CurlTransport&);
+
+  CURL* Acquire();
+  void Release(CURL* curl);
+  /// Read the cost of the call a handle has just made.
+  static void FillStats(CURL* curl, TransferStats* stats);
+
+  const CurlOptions options_;
+  mutable std::mutex mutex_;
+  vector<CURL*> idle_;
+  size_t handles_;
+};
+
+}  // namespace libsubtle
+
+#endif  // SRC_TRANSPORT_H_
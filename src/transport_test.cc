@@ -0,0 +1,95 @@
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/mock_server.h"
+#include "src/transport.h"
+#include "src/types.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+class ResponseSink : public ByteSink {
+ public:
+  void Write(const char* data, size_t size) { text_.append(data, size); }
+  string text_;
+};
+
+TEST(CurlTransport, Post) {
+  MockServer server([](const string& request) { return "<" + request + ">"; });
+  CurlTransport transport;
+  ResponseSink response;
+  transport.Post(server.url(), "test", "call", &response);
+  ASSERT_EQ("<call>", response.text_);
+
+  ResponseSink large;
+  string body(1 << 20, 'x');
+  transport.Post(server.url(), "test", body, &large);
+  ASSERT_EQ("<" + body + ">", large.text_);
+  ASSERT_EQ(1u, transport.handles());
+  ASSERT_EQ(1, server.connections());
+}
+
+TEST(CurlTransport, Unreachable) {
+  string url;
+  {
+    MockServer server([](const string& request) { return request; });
+    url = server.url();
+  }
+  CurlTransport transport;
+  ResponseSink response;
+  ASSERT_THROW(transport.Post(url, "test", "call", &response),
+               SubtleException);
+}
+
+TEST(CurlTransport, Stalled) {
+  MockServer server([](const string& request) {
+    std::this_thread::sleep_for(std::chrono::seconds(3));
+    return request;
+  });
+  CurlOptions options;
+  options.low_speed_limit = 1000;
+  options.low_speed_time_seconds = 1;
+  CurlTransport transport(options);
+  ResponseSink response;
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  ASSERT_THROW(transport.Post(server.url(), "test", "call", &response),
+               SubtleException);
+  ASSERT_LT(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(2900));
+}
+
+TEST(CurlTransport, ManyThreads) {
+  const int kThreads = 16;
+  const int kCalls = 200;
+  MockServer server([](const string& request) { return request; });
+  CurlTransport transport;
+  std::atomic<int> mismatches(0);
+  vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.push_back(std::thread([&, t] {
+      for (int i = 0; i < kCalls; ++i) {
+        string body = std::to_string(t) + ":" + std::to_string(i);
+        ResponseSink response;
+        transport.Post(server.url(), "test", body, &response);
+        mismatches += response.text_ != body;
+      }
+    }));
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  ASSERT_EQ(0, mismatches.load());
+  ASSERT_EQ(kThreads * kCalls, server.requests());
+  // connections are kept alive and shared out, not opened per call
+  ASSERT_LE(transport.handles(), static_cast<size_t>(kThreads));
+  ASSERT_LE(server.connections(), kThreads);
+}
+
+}  // namespace libsubtle
@@ -50,6 +50,7 @@ typedef struct _MovieInfo {
   string MovieName;
   string MovieYear;
 
+  _MovieInfo() {}
   _MovieInfo(string movie_hash, string movie_imdb_id, string movie_name,
              string movie_year) : MovieHash(movie_hash),
                                   MovieImdbID(movie_imdb_id),
@@ -68,6 +69,7 @@ typedef struct _LangInfo {
   string LanguageName;
   string ISO639;
 
+  _LangInfo() {}
   _LangInfo(string sub_language_id, string language_name, string iso639)
       : SubLanguageID(sub_language_id),
         LanguageName(language_name),
@@ -83,6 +85,7 @@ typedef struct _TranslationInfo {
   string LastCreated;
   string StringsNo;
 
+  _TranslationInfo() {}
   _TranslationInfo(string last_created, string strings_no)
         : LastCreated(last_created),
           StringsNo(strings_no) {}
@@ -127,13 +130,13 @@ class SearchRequest {
 
   SearchRequest(string sub_language_id, string movie_hash,
       double movie_byte_size)
-    : sub_language_id_(sub_language_id),
-      movie_hash_(movie_hash),
+    : sub_language_id_(std::move(sub_language_id)),
+      movie_hash_(std::move(movie_hash)),
       movie_byte_size_(movie_byte_size) {}
 
   SearchRequest(string sub_language_id, string imdb_id)
-    : sub_language_id_(sub_language_id),
-      imdb_id_(imdb_id) {}
+    : sub_language_id_(std::move(sub_language_id)),
+      imdb_id_(std::move(imdb_id)) {}
 };
 
 class SearchResponse : public Response {
@@ -148,8 +151,8 @@ class SearchMailRequest {
 
   SearchMailRequest(vector<string> languages,
       vector<pair<string, double> > movies)
-    : languages_(languages),
-      movies_(movies) {}
+    : languages_(std::move(languages)),
+      movies_(std::move(movies)) {}
 };
 
 class SearchMailResponse : public Response {
@@ -160,7 +163,8 @@ class DownloadRequest {
  public:
   vector<int> movies_;
 
-  explicit DownloadRequest(vector<int> movies) : movies_(movies) {}
+  explicit DownloadRequest(vector<int> movies)
+    : movies_(std::move(movies)) {}
 };
 
 class DownloadResponse : public Response {
@@ -255,7 +259,7 @@ class CheckMovieHashRequest {
   vector<string> movie_hashes_;
 
   explicit CheckMovieHashRequest(vector<string> movie_hashes)
-    : movie_hashes_(movie_hashes) {}
+    : movie_hashes_(std::move(movie_hashes)) {}
 
   explicit CheckMovieHashRequest(const string& movie_hash) {
     movie_hashes_.push_back(movie_hash);
@@ -272,10 +276,10 @@ class CheckSubHashRequest {
   vector<string> sub_hashes_;
 
   explicit CheckSubHashRequest(vector<string> sub_hashes)
-    : sub_hashes_(sub_hashes) {}
+    : sub_hashes_(std::move(sub_hashes)) {}
 
   explicit CheckSubHashRequest(string sub_hash) {
-    sub_hashes_.push_back(sub_hash);
+    sub_hashes_.push_back(std::move(sub_hash));
   }
 };
 
@@ -289,7 +293,7 @@ class GetSubLanguagesRequest {
   string lang_;
 
   GetSubLanguagesRequest() : lang_("en") {}
-  explicit GetSubLanguagesRequest(string lang) : lang_(lang) {}
+  explicit GetSubLanguagesRequest(string lang) : lang_(std::move(lang)) {}
 };
 
 class GetSubLanguagesResponse : public Response {
@@ -301,7 +305,8 @@ class DetectLanguageRequest {
  public:
   vector<string> texts_;
 
-  explicit DetectLanguageRequest(vector<string> texts) : texts_(texts) {}
+  explicit DetectLanguageRequest(vector<string> texts)
+    : texts_(std::move(texts)) {}
 };
 
 class DetectLanguageResponse : public Response {
@@ -344,7 +349,8 @@ class AutoUpdateRequest {
  public:
   string program_;
 
-  explicit AutoUpdateRequest(string program) : program_(program) {}
+  explicit AutoUpdateRequest(string program)
+    : program_(std::move(program)) {}
 };
 
 class AutoUpdateResponse : public Response {
@@ -358,7 +364,8 @@ class AutoUpdateResponse : public Response {
 class SearchMoviesOnImdbRequest {
  public:
   string query_;
-  explicit SearchMoviesOnImdbRequest(string query) : query_(query) {}
+  explicit SearchMoviesOnImdbRequest(string query)
+    : query_(std::move(query)) {}
 };
 
 class SearchMoviesOnImdbResponse : public Response {
@@ -369,7 +376,8 @@ class SearchMoviesOnImdbResponse : public Response {
 class GetImdbMovieDetailsRequest {
  public:
   string imdb_id_;
-  explicit GetImdbMovieDetailsRequest(string imdb_id) : imdb_id_(imdb_id) {}
+  explicit GetImdbMovieDetailsRequest(string imdb_id)
+    : imdb_id_(std::move(imdb_id)) {}
 };
 
 class GetImdbMovieDetailsResponse : public Response {
@@ -456,8 +464,8 @@ class InsertMovieRequest {
   string movie_year_;
 
   InsertMovieRequest(string movie_name, string movie_year)
-      : movie_name_(movie_name),
-        movie_year_(movie_year) {}
+      : movie_name_(std::move(movie_name)),
+        movie_year_(std::move(movie_year)) {}
 };
 
 class InsertMovieResponse : public Response {
@@ -0,0 +1,64 @@
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/bench.h"
+#include "src/types.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+// Allocations made by operator new since the counter was created.
+class AllocationCounter {
+ public:
+  AllocationCounter() : start_(bench::g_allocations) {}
+  uint64_t count() const { return bench::g_allocations - start_; }
+
+ private:
+  uint64_t start_;
+};
+
+vector<string> LongHashes(size_t count) {
+  // longer than fits into a string without a buffer of its own
+  return vector<string>(count, string(40, 'f'));
+}
+
+TEST(Requests, MovedNotCopied) {
+  vector<string> hashes = LongHashes(1000);
+  AllocationCounter copied;
+  CheckSubHashRequest copy(hashes);
+  ASSERT_EQ(1001u, copied.count());
+
+  vector<string> texts = LongHashes(1000);
+  vector<int> ids(1000);
+  string hash(40, 'f');
+  AllocationCounter moved;
+  CheckSubHashRequest check(std::move(hashes));
+  DetectLanguageRequest detect(std::move(texts));
+  DownloadRequest download(std::move(ids));
+  SearchRequest search("eng", std::move(hash), 1);
+  ASSERT_EQ(0u, moved.count());
+  ASSERT_EQ(1000u, check.sub_hashes_.size());
+  ASSERT_EQ(1000u, download.movies_.size());
+}
+
+TEST(Requests, ResponsesMove) {
+  SearchResponse search;
+  search.data_.resize(100);
+  CheckSubHashResponse check;
+  for (const string& hash : LongHashes(100)) {
+    check.sub_ids_[hash + std::to_string(check.sub_ids_.size())] = "1";
+  }
+
+  AllocationCounter moved;
+  SearchResponse search_moved(std::move(search));
+  CheckSubHashResponse check_moved(std::move(check));
+  ASSERT_EQ(0u, moved.count());
+  ASSERT_EQ(100u, search_moved.data_.size());
+  ASSERT_EQ(100u, check_moved.sub_ids_.size());
+}
+
+}  // namespace libsubtle
@@ -2,17 +2,41 @@
 #define SRC_XML_RPC_CLIENT_H_
 
 #include <src/types.h>
+#include <src/xmlrpc_stream.h>
 
 #include <string>
 
 using std::string;
 
 namespace libsubtle {
+class RpcObserver;
 class SearchRequest;
 class SearchResponse;
 
+/// Brings the calls taking requests by pointer into a class overriding the
+/// calls of XmlRpcClient, which would hide them otherwise.
+#define SUBTLE_POINTER_CALLS \
+  using XmlRpcClient::LogIn; \
+  using XmlRpcClient::SearchSubtitles; \
+  using XmlRpcClient::SearchMailSubtitles; \
+  using XmlRpcClient::DownloadSubtitles; \
+  using XmlRpcClient::ReportWrongMovieHash; \
+  using XmlRpcClient::SubtitlesVote; \
+  using XmlRpcClient::AddComment; \
+  using XmlRpcClient::CheckMovieHash; \
+  using XmlRpcClient::CheckSubHash; \
+  using XmlRpcClient::GetSubLanguages; \
+  using XmlRpcClient::DetectLanguage; \
+  using XmlRpcClient::GetAvailableTranslations; \
+  using XmlRpcClient::GetTranslation; \
+  using XmlRpcClient::AutoUpdate; \
+  using XmlRpcClient::SearchMoviesOnImdb; \
+  using XmlRpcClient::GetImdbMovieDetails; \
+  using XmlRpcClient::InsertMovie;
+
 class XmlRpcClient {
  public:
+  XmlRpcClient() : observer_(NULL) {}
   virtual ~XmlRpcClient() {}
   /// Construct XmlRpcClient
   /// \param user_agent user agent for Service identification.
@@ -22,11 +46,19 @@ class XmlRpcClient {
     server_endpoint_ = server_endpoint;
   }
 
+  /// \return entry point for the Service given to Init.
+  const string& server_endpoint() const { return server_endpoint_; }
+
+  /// Report every call made from now on, with its cost, to an observer.
+  /// Set it before the client is shared between threads.
+  /// \param observer not owned; NULL stops reporting.
+  void SetObserver(RpcObserver* observer) { observer_ = observer; }
+
   /// Log in to the service.
   /// \param lang language to use for the session; empty for en_US.
   /// \param req specification of action.
   /// \return response with results.
-  virtual LoginResponse LogIn(LoginRequest* req) = 0;
+  virtual LoginResponse LogIn(const LoginRequest& req) = 0;
 
   /// Log out of the service.
   /// \param token of the session to close.
@@ -43,20 +75,57 @@ class XmlRpcClient {
   /// \param req specification of action.
   /// \return response with results.
   virtual SearchResponse SearchSubtitles(const string& token,
-                                         SearchRequest* req) = 0;
+                                         const SearchRequest& req) = 0;
+  /// Find subtitles, appending them to a compact set rather than returning
+  /// them. Clients that cannot decode into the set add each result whole.
+  /// \param token Service authentication token.
+  /// \param req specification of action.
+  /// \param results receives the subtitles found.
+  /// \return response with the status of the call.
+  virtual SearchResponse SearchSubtitles(const string& token,
+                                         const SearchRequest& req,
+                                         CompactSubFiles* results) {
+    SearchResponse response = SearchSubtitles(token, req);
+    for (const SubFile& file : response.data_) {
+      results->Add(file);
+    }
+    response.data_.clear();
+    return response;
+  }
   /// Search and mail subtitles.
   /// \param token Service authentication token.
   /// \param req specification of action.
   /// \return response with results.
-  virtual SearchMailResponse SearchMailSubtitles(const string& token,
-                                                 SearchMailRequest* req) = 0;
+  virtual SearchMailResponse SearchMailSubtitles(
+        const string& token, const SearchMailRequest& req) = 0;
   /// Download subtitles
   /// \param token Service authentication token.
   /// \param req specification of action.
   /// \param response out parameter with results.
   /// \return whether the action succeeded.
   virtual DownloadResponse DownloadSubtitles(const string& token,
-                                             DownloadRequest* req) = 0;
+                                             const DownloadRequest& req) = 0;
+  /// Download subtitles into sinks rather than into the response.
+  /// Clients that cannot stream the response write each subtitle whole.
+  /// \param token Service authentication token.
+  /// \param req specification of action.
+  /// \param open chooses the sink for the base64 data of each subtitle.
+  /// \return response with the status of the call, and the ids of the
+  ///         subtitles received paired with empty data.
+  virtual DownloadResponse DownloadSubtitles(
+        const string& token, const DownloadRequest& req,
+        const DownloadResponseDecoder::Open& open) {
+    DownloadResponse response = DownloadSubtitles(token, req);
+    for (auto& subtitle : response.subtitles_) {
+      ByteSink* sink = open(subtitle.first);
+      if (sink) {
+        sink->Write(subtitle.second.data(), subtitle.second.size());
+        sink->Finish();
+      }
+      subtitle.second.clear();
+    }
+    return response;
+  }
   /// Get server info
   /// \return response with results.
   virtual ServerInfoResponse ServerInfo() = 0;
@@ -66,95 +135,171 @@ class XmlRpcClient {
   /// \param req specification of action.
   /// \return response with results.
   virtual ReportWrongMovieHashResponse ReportWrongMovieHash(
-        const string& token, ReportWrongMovieHashRequest* req) = 0;
+        const string& token, const ReportWrongMovieHashRequest& req) = 0;
 
   /// Vote on a subtitle (1 - 10)
   /// \param token Service authentication token.
   /// \param req specification of action.
   /// \return response with results.
-  virtual SubtitlesVoteResponse SubtitlesVote(const string& token,
-                                              SubtitlesVoteRequest* req) = 0;
+  virtual SubtitlesVoteResponse SubtitlesVote(
+        const string& token, const SubtitlesVoteRequest& req) = 0;
 
   /// Add comment to the subtitle.
   /// \param token Service authentication token.
   /// \param req specification of action.
   /// \return response with results.
   virtual AddCommentResponse AddComment(const string& token,
-                                        AddCommentRequest* req) = 0;
+                                        const AddCommentRequest& req) = 0;
 
   /// Check movie hash.
   /// \param token Service authentication token.
   /// \param req specification of action.
   /// \return response with results.
-  virtual CheckMovieHashResponse CheckMovieHash(const string& token,
-                                                CheckMovieHashRequest* req) = 0;
+  virtual CheckMovieHashResponse CheckMovieHash(
+        const string& token, const CheckMovieHashRequest& req) = 0;
 
   /// Check subtitle hash.
   /// \param token Service authentication token.
   /// \param req specification of action.
   /// \return response with results.
-  virtual CheckSubHashResponse CheckSubHash(const string& token,
-                                                CheckSubHashRequest* req) = 0;
+  virtual CheckSubHashResponse CheckSubHash(
+        const string& token, const CheckSubHashRequest& req) = 0;
 
   /// Get languages.
   /// \param token Service authentication token.
   /// \param req specification of action.
   /// \return response with results.
   virtual GetSubLanguagesResponse GetSubLanguages(
-        GetSubLanguagesRequest* req) = 0;
+        const GetSubLanguagesRequest& req) = 0;
 
   /// Detect language.
   /// \param token Service authentication token.
   /// \param req specification of action.
   /// \return response with results.
-  virtual DetectLanguageResponse DetectLanguage(const string& token,
-                                                DetectLanguageRequest* req) = 0;
+  virtual DetectLanguageResponse DetectLanguage(
+        const string& token, const DetectLanguageRequest& req) = 0;
 
   /// Get available translations.
   /// \param token Service authentication token.
   /// \param req specification of action.
   /// \return response with results.
   virtual GetAvailableTranslationsResponse GetAvailableTranslations(
-        const string& token, GetAvailableTranslationsRequest* req) = 0;
+        const string& token, const GetAvailableTranslationsRequest& req) = 0;
 
   /// Get translation.
   /// \param token Service authentication token.
   /// \param req specification of action.
   /// \return response with results.
-  virtual GetTranslationResponse GetTranslation(const string& token,
-                                                GetTranslationRequest* req) = 0;
+  virtual GetTranslationResponse GetTranslation(
+        const string& token, const GetTranslationRequest& req) = 0;
 
   /// Auto update.
   /// \param req specification of action.
   /// \return response with results.
-  virtual AutoUpdateResponse AutoUpdate(AutoUpdateRequest* req) = 0;
+  virtual AutoUpdateResponse AutoUpdate(const AutoUpdateRequest& req) = 0;
 
   /// Search for movies on IMDB.com.
   /// \param token Service authentication token.
   /// \param req specification of action.
   /// \return response with results.
   virtual SearchMoviesOnImdbResponse SearchMoviesOnImdb(const string& token,
-       SearchMoviesOnImdbRequest* req) = 0;
+       const SearchMoviesOnImdbRequest& req) = 0;
 
   /// Get details about a movie from IMDB.
   /// \param token Service authentication token.
   /// \param req specification of action.
   /// \return response with results.
   virtual GetImdbMovieDetailsResponse GetImdbMovieDetails(const string& token,
-        GetImdbMovieDetailsRequest* req) = 0;
+        const GetImdbMovieDetailsRequest& req) = 0;
 
   /// Insert movie into the database.
   /// \param token Service authentication token.
   /// \param req specification of action.
   /// \return response with results.
   virtual InsertMovieResponse InsertMovie(const string& token,
-        InsertMovieRequest* req) = 0;
+        const InsertMovieRequest& req) = 0;
+
+  // Calls taking requests by pointer, as they used to; requests on the
+  // stack or temporaries passed by reference do the same without new and
+  // delete. Classes overriding the calls bring these in with
+  // SUBTLE_POINTER_CALLS.
+  LoginResponse LogIn(LoginRequest* req) {
+    return LogIn(*req);
+  }
+  SearchResponse SearchSubtitles(const string& token, SearchRequest* req) {
+    return SearchSubtitles(token, *req);
+  }
+  SearchMailResponse SearchMailSubtitles(const string& token,
+                                         SearchMailRequest* req) {
+    return SearchMailSubtitles(token, *req);
+  }
+  DownloadResponse DownloadSubtitles(const string& token,
+                                     DownloadRequest* req) {
+    return DownloadSubtitles(token, *req);
+  }
+  DownloadResponse DownloadSubtitles(
+      const string& token, DownloadRequest* req,
+      const DownloadResponseDecoder::Open& open) {
+    return DownloadSubtitles(token, *req, open);
+  }
+  ReportWrongMovieHashResponse ReportWrongMovieHash(
+      const string& token, ReportWrongMovieHashRequest* req) {
+    return ReportWrongMovieHash(token, *req);
+  }
+  SubtitlesVoteResponse SubtitlesVote(const string& token,
+                                      SubtitlesVoteRequest* req) {
+    return SubtitlesVote(token, *req);
+  }
+  AddCommentResponse AddComment(const string& token, AddCommentRequest* req) {
+    return AddComment(token, *req);
+  }
+  CheckMovieHashResponse CheckMovieHash(const string& token,
+                                        CheckMovieHashRequest* req) {
+    return CheckMovieHash(token, *req);
+  }
+  CheckSubHashResponse CheckSubHash(const string& token,
+                                    CheckSubHashRequest* req) {
+    return CheckSubHash(token, *req);
+  }
+  GetSubLanguagesResponse GetSubLanguages(GetSubLanguagesRequest* req) {
+    return GetSubLanguages(*req);
+  }
+  DetectLanguageResponse DetectLanguage(const string& token,
+                                        DetectLanguageRequest* req) {
+    return DetectLanguage(token, *req);
+  }
+  GetAvailableTranslationsResponse GetAvailableTranslations(
+      const string& token, GetAvailableTranslationsRequest* req) {
+    return GetAvailableTranslations(token, *req);
+  }
+  GetTranslationResponse GetTranslation(const string& token,
+                                        GetTranslationRequest* req) {
+    return GetTranslation(token, *req);
+  }
+  AutoUpdateResponse AutoUpdate(AutoUpdateRequest* req) {
+    return AutoUpdate(*req);
+  }
+  SearchMoviesOnImdbResponse SearchMoviesOnImdb(
+      const string& token, SearchMoviesOnImdbRequest* req) {
+    return SearchMoviesOnImdb(token, *req);
+  }
+  GetImdbMovieDetailsResponse GetImdbMovieDetails(
+      const string& token, GetImdbMovieDetailsRequest* req) {
+    return GetImdbMovieDetails(token, *req);
+  }
+  InsertMovieResponse InsertMovie(const string& token,
+                                  InsertMovieRequest* req) {
+    return InsertMovie(token, *req);
+  }
 
  protected:
   /// Agent send with Login req to identify service.
   string user_agent_;
   /// Entry point for the service, a HTTP URI.
   string server_endpoint_;
+  /// Told about every call, if set; implementations that cannot measure
+  /// calls may ignore it.
+  RpcObserver* observer_;
 };
 
 }  // namespace libsubtle
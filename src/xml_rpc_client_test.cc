@@ -2,6 +2,7 @@
 #include <utility>
 
 #include "gtest/gtest.h"
+#include "src/mock_service_fixture.h"
 #include "src/rpc_impl.h"
 
 using std::ios;
@@ -11,12 +12,13 @@ using std::make_pair;
 
 namespace libsubtle {
 
-const string kServerUrl = "http://api.opensubtitles.org/xml-rpc";
 const string kUserAgent = "OS Test User Agent";
 
-TEST(XmlRpc, LogIn) {
+class XmlRpc : public MockServiceFixture {};
+
+TEST_F(XmlRpc, LogIn) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   // login
   LoginRequest* lr = new LoginRequest();
@@ -25,9 +27,9 @@ TEST(XmlRpc, LogIn) {
   ASSERT_NE("", token);
 }
 
-TEST(XmlRpc, LogOut) {
+TEST_F(XmlRpc, LogOut) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   // login
   LoginRequest* lr = new LoginRequest();
@@ -36,9 +38,9 @@ TEST(XmlRpc, LogOut) {
   ASSERT_EQ(OK, client.LogOut(token).GetStatus());
 }
 
-TEST(XmlRpc, NoOperation) {
+TEST_F(XmlRpc, NoOperation) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   // login
   LoginRequest* lr = new LoginRequest();
@@ -47,9 +49,9 @@ TEST(XmlRpc, NoOperation) {
   ASSERT_EQ(OK, client.NoOperation(token).GetStatus());
 }
 
-TEST(XmlRpc, Search) {
+TEST_F(XmlRpc, Search) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   // login
   LoginRequest* lr = new LoginRequest();
@@ -66,9 +68,9 @@ TEST(XmlRpc, Search) {
   res.data_[0].Print();
 }
 
-TEST(XmlRpc, SearchImdb) {
+TEST_F(XmlRpc, SearchImdb) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   // login
   LoginRequest* lr = new LoginRequest();
@@ -83,9 +85,9 @@ TEST(XmlRpc, SearchImdb) {
   ASSERT_EQ(OK, res.GetStatus());
 }
 
-TEST(XmlRpc, SearchEmpty) {
+TEST_F(XmlRpc, SearchEmpty) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   // login
   LoginRequest* lr = new LoginRequest();
@@ -101,9 +103,9 @@ TEST(XmlRpc, SearchEmpty) {
   ASSERT_EQ(OK, res.GetStatus());
 }
 
-TEST(XmlRpc, SearchMailNoAuth) {
+TEST_F(XmlRpc, SearchMailNoAuth) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   // login
   LoginRequest* lr = new LoginRequest();
@@ -122,9 +124,9 @@ TEST(XmlRpc, SearchMailNoAuth) {
   ASSERT_EQ(UNAUTHORIZED, res.GetStatus());
 }
 
-TEST(XmlRpc, Download) {
+TEST_F(XmlRpc, Download) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   // login
   LoginRequest* lr = new LoginRequest();
@@ -140,9 +142,9 @@ TEST(XmlRpc, Download) {
   ASSERT_EQ(OK, res.GetStatus());
 }
 
-TEST(XmlRpc, ServerInfo) {
+TEST_F(XmlRpc, ServerInfo) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
   ServerInfoResponse res = client.ServerInfo();
 
   for (map<string, string>::const_iterator it = res.last_update_strings_.begin()
@@ -152,9 +154,9 @@ TEST(XmlRpc, ServerInfo) {
   std::cout << "xml rpc version " << res.xmlrpc_version_ << std::endl;
 }
 
-TEST(XmlRpc, ReportWrongMovieHash) {
+TEST_F(XmlRpc, ReportWrongMovieHash) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   // login
   LoginRequest* lr = new LoginRequest();
@@ -168,9 +170,9 @@ TEST(XmlRpc, ReportWrongMovieHash) {
   ASSERT_EQ(OK, res.GetStatus());
 }
 
-TEST(XmlRpc, SubtitlesVoteAnonymous) {
+TEST_F(XmlRpc, SubtitlesVoteAnonymous) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   // login
   LoginRequest* lr = new LoginRequest();
@@ -184,9 +186,9 @@ TEST(XmlRpc, SubtitlesVoteAnonymous) {
   ASSERT_EQ(UNAUTHORIZED, res.GetStatus());
 }
 
-TEST(XmlRpc, SubtitlesVoteLoggedIn) {
+TEST_F(XmlRpc, SubtitlesVoteLoggedIn) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   // login
   LoginRequest* lr = new LoginRequest("stgpetrovic", "john2222", "eng");
@@ -200,9 +202,9 @@ TEST(XmlRpc, SubtitlesVoteLoggedIn) {
   ASSERT_EQ(OK, res.GetStatus());
 }
 
-TEST(XmlRpc, SubtitlesVoteMovieNotExist) {
+TEST_F(XmlRpc, SubtitlesVoteMovieNotExist) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   // login
   LoginRequest* lr = new LoginRequest("stgpetrovic", "john2222", "eng");
@@ -216,9 +218,9 @@ TEST(XmlRpc, SubtitlesVoteMovieNotExist) {
   ASSERT_EQ(INVALID_PARAMS, res.GetStatus());
 }
 
-TEST(XmlRpc, AddCommentAnonymous) {
+TEST_F(XmlRpc, AddCommentAnonymous) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   // login
   LoginRequest* lr = new LoginRequest();
@@ -232,9 +234,9 @@ TEST(XmlRpc, AddCommentAnonymous) {
   ASSERT_EQ(UNAUTHORIZED, res.GetStatus());
 }
 
-TEST(XmlRpc, AddCommentLoggedIn) {
+TEST_F(XmlRpc, AddCommentLoggedIn) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   // login
   LoginRequest* lr = new LoginRequest("stgpetrovic", "john2222", "eng");
@@ -248,9 +250,9 @@ TEST(XmlRpc, AddCommentLoggedIn) {
   ASSERT_EQ(OK, res.GetStatus());
 }
 
-TEST(XmlRpc, CheckMovieHash) {
+TEST_F(XmlRpc, CheckMovieHash) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   // login
   LoginRequest* lr = new LoginRequest("", "", "");
@@ -269,16 +271,21 @@ TEST(XmlRpc, CheckMovieHash) {
   ASSERT_EQ(OK, res.GetStatus());
 }
 
-TEST(XmlRpc, CheckSubHash) {
+TEST_F(XmlRpc, CheckSubHash) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   // login
   LoginRequest* lr = new LoginRequest("", "", "");
   string token = client.LogIn(lr).token_;
   delete lr;
 
-  vector<string> hashes = {"579aa0689606dd1ecbcaadc8d447b9a9", "wrong"};
+  SearchResponse found = client.SearchSubtitles(
+      token, SearchRequest("eng", "7d9cd5def91c9432", 735934464));
+  ASSERT_NE(0, found.data_.size());
+  const SubFile& file = found.data_[0];
+
+  vector<string> hashes = {file.SubHash_, "wrong"};
   CheckSubHashRequest* req = new CheckSubHashRequest(hashes);
   CheckSubHashResponse res = client.CheckSubHash(token, req);
   delete req;
@@ -290,12 +297,12 @@ TEST(XmlRpc, CheckSubHash) {
 
   ASSERT_EQ(OK, res.GetStatus());
   ASSERT_EQ("0", res.sub_ids_["wrong"]);
-  ASSERT_EQ("1953638724", res.sub_ids_["579aa0689606dd1ecbcaadc8d447b9a9"]);
+  ASSERT_EQ(file.IDSubtitleFile_, res.sub_ids_[file.SubHash_]);
 }
 
-TEST(XmlRpc, GetSubLanguages) {
+TEST_F(XmlRpc, GetSubLanguages) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   GetSubLanguagesRequest* req = new GetSubLanguagesRequest("en");
 
@@ -310,9 +317,9 @@ TEST(XmlRpc, GetSubLanguages) {
   ASSERT_GT(res.lang_infos_.size(), 10);
 }
 
-TEST(XmlRpc, DetectLanguage) {
+TEST_F(XmlRpc, DetectLanguage) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   // login
   LoginRequest* lr = new LoginRequest("", "", "");
@@ -333,9 +340,9 @@ TEST(XmlRpc, DetectLanguage) {
   ASSERT_EQ(OK, res.GetStatus());
 }
 
-TEST(XmlRpc, GetAvailableTranslations) {
+TEST_F(XmlRpc, GetAvailableTranslations) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   // login
   LoginRequest* lr = new LoginRequest("", "", "");
@@ -359,32 +366,30 @@ TEST(XmlRpc, GetAvailableTranslations) {
   ASSERT_GT(res.translation_infos_.size(), 0);
 }
 
-TEST(XmlRpc, GetTranslation) {
+TEST_F(XmlRpc, GetTranslation) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   // login
   LoginRequest* lr = new LoginRequest("", "", "");
   string token = client.LogIn(lr).token_;
   delete lr;
 
-  // This does not work (server-side)...
-  // GetTranslationRequest* req = new GetTranslationRequest("en", "po",
-  //                                                        "oscar");
+  GetTranslationRequest* req = new GetTranslationRequest("en", "mo", "oscar");
 
-  // GetTranslationResponse res = client.GetTranslation(token, req);
-  // delete req;
+  GetTranslationResponse res = client.GetTranslation(token, req);
+  delete req;
 
-  // // I don't care what it returns, just that the request works.
-  // std::cout << res.translation_;
+  // I don't care what it returns, just that the request works.
+  std::cout << res.translation_;
 
-  // ASSERT_EQ(OK, res.GetStatus());
-  // ASSERT_GT(res.translation_.length(), 0);
+  ASSERT_EQ(OK, res.GetStatus());
+  ASSERT_GT(res.translation_.length(), 0);
 }
 
-TEST(XmlRpc, GetTranslationWrongParams) {
+TEST_F(XmlRpc, GetTranslationWrongParams) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   // login
   LoginRequest* lr = new LoginRequest("", "", "");
@@ -405,9 +410,9 @@ TEST(XmlRpc, GetTranslationWrongParams) {
   if (!threw) FAIL();
 }
 
-TEST(XmlRpc, AutoUpdate) {
+TEST_F(XmlRpc, AutoUpdate) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   AutoUpdateRequest* req = new AutoUpdateRequest("oscar");
 
@@ -421,9 +426,9 @@ TEST(XmlRpc, AutoUpdate) {
   ASSERT_GT(res.url_windows_.length() + res.url_linux_.length(), 0);
 }
 
-TEST(XmlRpc, SearchMoviesOnImdb) {
+TEST_F(XmlRpc, SearchMoviesOnImdb) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   // login
   LoginRequest* lr = new LoginRequest("", "", "");
@@ -443,9 +448,9 @@ TEST(XmlRpc, SearchMoviesOnImdb) {
   ASSERT_GT(res.imdb_results_.size(), 0);
 }
 
-TEST(XmlRpc, GetImdbMovieDetails) {
+TEST_F(XmlRpc, GetImdbMovieDetails) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   // login
   LoginRequest* lr = new LoginRequest("", "", "");
@@ -460,9 +465,9 @@ TEST(XmlRpc, GetImdbMovieDetails) {
   ASSERT_EQ(OK, res.GetStatus());
 }
 
-TEST(XmlRpc, InsertMovie) {
+TEST_F(XmlRpc, InsertMovie) {
   XmlRpcImpl client;
-  client.Init(kUserAgent, kServerUrl);
+  client.Init(kUserAgent, url());
 
   // login
   LoginRequest* lr = new LoginRequest("stgpetrovic", "john2222", "eng");
@@ -0,0 +1,500 @@
+#include <cstdlib>
+#include <string>
+#include <utility>
+
+#include "src/metrics.h"
+#include "src/xmlrpc_stream.h"
+
+using std::string;
+
+namespace libsubtle {
+
+namespace {
+
+bool ScalarTypeOf(const string& name, ScalarType* type) {
+  if (name == "string") {
+    *type = SCALAR_STRING;
+  } else if (name == "int" || name == "i4" || name == "i8") {
+    *type = SCALAR_INT;
+  } else if (name == "boolean") {
+    *type = SCALAR_BOOLEAN;
+  } else if (name == "double") {
+    *type = SCALAR_DOUBLE;
+  } else if (name == "dateTime.iso8601") {
+    *type = SCALAR_DATETIME;
+  } else if (name == "base64") {
+    *type = SCALAR_BASE64;
+  } else if (name == "nil") {
+    *type = SCALAR_NIL;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void AppendUtf8(unsigned long code, string* target) {
+  if (code < 0x80) {
+    *target += static_cast<char>(code);
+  } else if (code < 0x800) {
+    *target += static_cast<char>(0xc0 | (code >> 6));
+    *target += static_cast<char>(0x80 | (code & 0x3f));
+  } else if (code < 0x10000) {
+    *target += static_cast<char>(0xe0 | (code >> 12));
+    *target += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+    *target += static_cast<char>(0x80 | (code & 0x3f));
+  } else {
+    *target += static_cast<char>(0xf0 | (code >> 18));
+    *target += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+    *target += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+    *target += static_cast<char>(0x80 | (code & 0x3f));
+  }
+}
+
+}  // namespace
+
+const size_t XmlRpcStreamParser::kScalarChunkSize;
+
+XmlRpcStreamParser::XmlRpcStreamParser(XmlRpcHandler* handler)
+    : handler_(handler),
+      state_(TEXT),
+      cdata_end_(0),
+      collecting_(false),
+      streaming_(false),
+      depth_(0) {}
+
+void XmlRpcStreamParser::Feed(const char* data, size_t size) {
+  const char* end = data + size;
+  while (data != end) {
+    switch (state_) {
+      case TEXT: {
+        // copy runs of plain text at once
+        const char* run = data;
+        while (data != end && *data != '<' && *data != '&') {
+          ++data;
+        }
+        AppendText(run, data - run);
+        if (data == end) {
+          break;
+        }
+        state_ = *data == '<' ? TAG : ENTITY;
+        ++data;
+        break;
+      }
+      case TAG: {
+        // "<![CDATA[" opens literal text, which is not held in tag_
+        static const string kCdata = "![CDATA[";
+        while (data != end && tag_.size() < kCdata.size() &&
+               kCdata.compare(0, tag_.size(), tag_) == 0 &&
+               *data == kCdata[tag_.size()]) {
+          tag_ += *data++;
+        }
+        if (tag_ == kCdata) {
+          tag_.clear();
+          state_ = CDATA;
+          break;
+        }
+        const char* run = data;
+        while (data != end && *data != '>') {
+          ++data;
+        }
+        tag_.append(run, data - run);
+        if (data == end) {
+          break;
+        }
+        ++data;
+        // comments may contain '>', keep reading until "-->"
+        if (tag_.compare(0, 3, "!--") == 0 &&
+            (tag_.size() < 5 || tag_.compare(tag_.size() - 2, 2, "--"))) {
+          tag_ += '>';
+          break;
+        }
+        HandleTag();
+        tag_.clear();
+        state_ = TEXT;
+        break;
+      }
+      case ENTITY: {
+        const char* run = data;
+        while (data != end && *data != ';') {
+          ++data;
+        }
+        entity_.append(run, data - run);
+        if (entity_.size() > 16) {
+          throw SubtleException("Malformed XML-RPC response: bad entity");
+        }
+        if (data == end) {
+          break;
+        }
+        ++data;
+        AppendEntity();
+        entity_.clear();
+        state_ = TEXT;
+        break;
+      }
+      case CDATA: {
+        while (data != end && state_ == CDATA) {
+          if (cdata_end_ == 0) {
+            const char* run = data;
+            while (data != end && *data != ']') {
+              ++data;
+            }
+            AppendText(run, data - run);
+            if (data == end) {
+              break;
+            }
+          }
+          char c = *data++;
+          if (c == ']') {
+            // of "]]]>" only the last two end the section
+            if (cdata_end_ == 2) {
+              AppendText("]", 1);
+            } else {
+              ++cdata_end_;
+            }
+          } else if (c == '>' && cdata_end_ == 2) {
+            cdata_end_ = 0;
+            state_ = TEXT;
+          } else {
+            AppendText("]]", cdata_end_);
+            cdata_end_ = 0;
+            AppendText(&c, 1);
+          }
+        }
+        break;
+      }
+    }
+  }
+}
+
+void XmlRpcStreamParser::AppendText(const char* data, size_t size) {
+  if (collecting_) {
+    text_.append(data, size);
+    if (streaming_ && text_.size() >= kScalarChunkSize) {
+      FlushChunk();
+    }
+  }
+}
+
+void XmlRpcStreamParser::Finish() {
+  if (state_ != TEXT || depth_ != 0) {
+    throw SubtleException("Malformed XML-RPC response: truncated document");
+  }
+}
+
+void XmlRpcStreamParser::AppendEntity() {
+  if (!collecting_) {
+    return;
+  }
+  if (entity_ == "amp") {
+    text_ += '&';
+  } else if (entity_ == "lt") {
+    text_ += '<';
+  } else if (entity_ == "gt") {
+    text_ += '>';
+  } else if (entity_ == "quot") {
+    text_ += '"';
+  } else if (entity_ == "apos") {
+    text_ += '\'';
+  } else if (entity_.size() > 1 && entity_[0] == '#') {
+    bool hex = entity_[1] == 'x' || entity_[1] == 'X';
+    const char* digits = entity_.c_str() + (hex ? 2 : 1);
+    char* parsed_end;
+    unsigned long code = strtoul(digits, &parsed_end, hex ? 16 : 10);
+    if (*parsed_end != '\0' || parsed_end == digits || code > 0x10ffff) {
+      throw SubtleException("Malformed XML-RPC response: bad entity");
+    }
+    AppendUtf8(code, &text_);
+  } else {
+    throw SubtleException("Malformed XML-RPC response: unknown entity &" +
+                          entity_ + ";");
+  }
+}
+
+void XmlRpcStreamParser::HandleTag() {
+  if (tag_.empty()) {
+    throw SubtleException("Malformed XML-RPC response: empty tag");
+  }
+  // declarations, processing instructions and comments
+  if (tag_[0] == '?' || tag_[0] == '!') {
+    return;
+  }
+
+  bool closing = tag_[0] == '/';
+  bool self_closing = tag_[tag_.size() - 1] == '/';
+  size_t begin = closing ? 1 : 0;
+  size_t end = tag_.find_first_of(" \t\r\n/", begin);
+  if (end == string::npos) {
+    end = tag_.size();
+  }
+  string name = tag_.substr(begin, end - begin);
+
+  if (closing) {
+    CloseElement(name);
+  } else {
+    OpenElement(name);
+    if (self_closing) {
+      CloseElement(name);
+    }
+  }
+}
+
+void XmlRpcStreamParser::BeginTypedValue() {
+  if (values_.empty()) {
+    throw SubtleException("Malformed XML-RPC response: data outside <value>");
+  }
+  values_.back() = true;
+  collecting_ = false;
+  text_.clear();
+}
+
+void XmlRpcStreamParser::FlushChunk() {
+  if (!text_.empty()) {
+    handler_->OnScalarChunk(text_.data(), text_.size());
+    text_.clear();
+  }
+}
+
+void XmlRpcStreamParser::EndScalar(ScalarType type) {
+  if (streaming_) {
+    FlushChunk();
+    handler_->OnScalarEnd(type);
+    streaming_ = false;
+  } else {
+    handler_->OnScalar(type, text_);
+  }
+}
+
+void XmlRpcStreamParser::OpenElement(const string& name) {
+  ++depth_;
+  ScalarType type;
+  if (name == "value") {
+    values_.push_back(false);
+    // untyped values are strings
+    collecting_ = true;
+    streaming_ = handler_->StreamScalar();
+    text_.clear();
+  } else if (ScalarTypeOf(name, &type)) {
+    BeginTypedValue();
+    collecting_ = true;
+  } else if (name == "struct") {
+    BeginTypedValue();
+    streaming_ = false;
+    handler_->OnStructBegin();
+  } else if (name == "array") {
+    BeginTypedValue();
+    streaming_ = false;
+    handler_->OnArrayBegin();
+  } else if (name == "name" || name == "methodName") {
+    collecting_ = true;
+    text_.clear();
+  } else if (name == "fault") {
+    handler_->OnFault();
+  }
+}
+
+void XmlRpcStreamParser::CloseElement(const string& name) {
+  if (--depth_ < 0) {
+    throw SubtleException("Malformed XML-RPC response: unbalanced </" +
+                          name + ">");
+  }
+  ScalarType type;
+  if (name == "value") {
+    if (values_.empty()) {
+      throw SubtleException("Malformed XML-RPC response: unbalanced </value>");
+    }
+    if (!values_.back()) {
+      EndScalar(SCALAR_STRING);
+    }
+    values_.pop_back();
+    collecting_ = false;
+    text_.clear();
+  } else if (ScalarTypeOf(name, &type)) {
+    EndScalar(type);
+    collecting_ = false;
+    text_.clear();
+  } else if (name == "struct") {
+    handler_->OnStructEnd();
+  } else if (name == "array") {
+    handler_->OnArrayEnd();
+  } else if (name == "name") {
+    handler_->OnMemberName(text_);
+    collecting_ = false;
+    text_.clear();
+  } else if (name == "methodName") {
+    handler_->OnMethodName(text_);
+    collecting_ = false;
+    text_.clear();
+  }
+}
+
+SearchResponseDecoder::SearchResponseDecoder(SearchResponse* response,
+                                             const Callback& callback)
+    : response_(response),
+      callback_(callback),
+      results_(NULL),
+      struct_depth_(0),
+      array_depth_(0),
+      seconds_(0),
+      fault_(false) {}
+
+SearchResponseDecoder::SearchResponseDecoder(SearchResponse* response,
+                                             CompactSubFiles* results)
+    : response_(response),
+      results_(results),
+      struct_depth_(0),
+      array_depth_(0),
+      seconds_(0),
+      fault_(false) {}
+
+void SearchResponseDecoder::OnStructBegin() {
+  ++struct_depth_;
+  if (struct_depth_ == 2 && array_depth_ == 1 && member_ == "data") {
+    if (results_) {
+      results_->Begin();
+    } else {
+      current_ = SubFile();
+    }
+  }
+}
+
+void SearchResponseDecoder::OnStructEnd() {
+  if (struct_depth_ == 2 && array_depth_ == 1 && member_ == "data" &&
+      !results_) {
+    callback_(std::move(current_));
+  }
+  --struct_depth_;
+}
+
+void SearchResponseDecoder::OnArrayBegin() {
+  ++array_depth_;
+}
+
+void SearchResponseDecoder::OnArrayEnd() {
+  --array_depth_;
+}
+
+void SearchResponseDecoder::OnMemberName(const string& name) {
+  if (struct_depth_ == 1) {
+    member_ = name;
+  } else if (struct_depth_ == 2 && array_depth_ == 1) {
+    field_ = name;
+  }
+}
+
+void SearchResponseDecoder::OnScalar(ScalarType type, const string& text) {
+  if (struct_depth_ == 1 && array_depth_ == 0) {
+    if (member_ == "status" || member_ == "faultString") {
+      status_ = text;
+    } else if (member_ == "seconds") {
+      seconds_ = strtod(text.c_str(), NULL);
+    }
+  } else if (struct_depth_ == 2 && array_depth_ == 1 && member_ == "data") {
+    // the service sends a few non-string members, keep the strings only
+    if (type == SCALAR_STRING && results_) {
+      results_->Set(field_, text);
+    } else if (type == SCALAR_STRING) {
+      current_.Set(field_, text);
+    }
+  }
+}
+
+void SearchResponseDecoder::OnFault() {
+  fault_ = true;
+}
+
+void SearchResponseDecoder::Finish() {
+  if (fault_) {
+    throw SubtleException("XML-RPC fault: " + status_);
+  }
+  response_->SetStatus(status_, seconds_);
+}
+
+DownloadResponseDecoder::DownloadResponseDecoder(DownloadResponse* response,
+                                                 const Open& open)
+    : response_(response),
+      open_(open),
+      struct_depth_(0),
+      array_depth_(0),
+      seconds_(0),
+      fault_(false),
+      sink_(NULL) {}
+
+bool DownloadResponseDecoder::InSubtitle() const {
+  return struct_depth_ == 2 && array_depth_ == 1 && member_ == "data";
+}
+
+void DownloadResponseDecoder::OnStructBegin() {
+  ++struct_depth_;
+  if (InSubtitle()) {
+    id_.clear();
+  }
+}
+
+void DownloadResponseDecoder::OnStructEnd() {
+  --struct_depth_;
+}
+
+void DownloadResponseDecoder::OnArrayBegin() {
+  ++array_depth_;
+}
+
+void DownloadResponseDecoder::OnArrayEnd() {
+  --array_depth_;
+}
+
+void DownloadResponseDecoder::OnMemberName(const string& name) {
+  if (struct_depth_ == 1) {
+    member_ = name;
+  } else if (InSubtitle()) {
+    field_ = name;
+  }
+}
+
+void DownloadResponseDecoder::OnScalar(ScalarType type, const string& text) {
+  if (struct_depth_ == 1 && array_depth_ == 0) {
+    if (member_ == "status" || member_ == "faultString") {
+      status_ = text;
+    } else if (member_ == "seconds") {
+      seconds_ = strtod(text.c_str(), NULL);
+    }
+  } else if (InSubtitle() && field_ == "idsubtitlefile") {
+    id_ = text;
+  }
+}
+
+void DownloadResponseDecoder::OnFault() {
+  fault_ = true;
+}
+
+bool DownloadResponseDecoder::StreamScalar() {
+  if (!InSubtitle() || field_ != "data") {
+    return false;
+  }
+  sink_ = open_(id_);
+  response_->subtitles_.push_back(make_pair(id_, string()));
+  // skipped data is streamed too, and dropped
+  return true;
+}
+
+void DownloadResponseDecoder::OnScalarChunk(const char* data, size_t size) {
+  if (sink_) {
+    metrics::Library().download_bytes->Add(size);
+    sink_->Write(data, size);
+  }
+}
+
+void DownloadResponseDecoder::OnScalarEnd(ScalarType type) {
+  if (sink_) {
+    sink_->Finish();
+    sink_ = NULL;
+  }
+}
+
+void DownloadResponseDecoder::Finish() {
+  if (fault_) {
+    throw SubtleException("XML-RPC fault: " + status_);
+  }
+  response_->SetStatus(status_, seconds_);
+}
+
+}  // namespace libsubtle
@@ -0,0 +1,218 @@
+#ifndef SRC_XMLRPC_STREAM_H_
+#define SRC_XMLRPC_STREAM_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "src/byte_sink.h"
+#include "src/compact_subfile.h"
+#include "src/types.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+/// Types of XML-RPC scalar values.
+enum ScalarType {
+  SCALAR_STRING,
+  SCALAR_INT,
+  SCALAR_BOOLEAN,
+  SCALAR_DOUBLE,
+  SCALAR_DATETIME,
+  SCALAR_BASE64,
+  SCALAR_NIL
+};
+
+/// Receives events from XmlRpcStreamParser, in document order.
+class XmlRpcHandler {
+ public:
+  virtual ~XmlRpcHandler() {}
+
+  /// A <struct> was opened.
+  virtual void OnStructBegin() {}
+  /// The innermost open <struct> was closed.
+  virtual void OnStructEnd() {}
+  /// An <array> was opened.
+  virtual void OnArrayBegin() {}
+  /// The innermost open <array> was closed.
+  virtual void OnArrayEnd() {}
+  /// Name of the struct member whose value follows.
+  virtual void OnMemberName(const string& name) {}
+  /// A complete scalar value.
+  /// \param type type of the value.
+  /// \param text value as it appeared in the document, entities decoded.
+  virtual void OnScalar(ScalarType type, const string& text) {}
+  /// The response is a <fault> rather than <params>.
+  virtual void OnFault() {}
+  /// Name of the method a call invokes, for parsing calls rather than
+  /// responses.
+  virtual void OnMethodName(const string& name) {}
+
+  /// Asked as each <value> opens: whether its scalar should be delivered in
+  /// pieces through OnScalarChunk and OnScalarEnd rather than whole through
+  /// OnScalar, for values too large to hold in memory.
+  virtual bool StreamScalar() { return false; }
+  /// Next piece of a streamed scalar, entities decoded.
+  virtual void OnScalarChunk(const char* data, size_t size) {}
+  /// A streamed scalar is complete.
+  virtual void OnScalarEnd(ScalarType type) {}
+
+  /// \return status the response reported, once it is parsed, such as
+  ///         "200 OK"; "" when the handler does not keep one.
+  virtual string StatusText() const { return ""; }
+};
+
+/// Incremental parser for XML-RPC method responses, and calls.
+///
+/// The document can be fed in arbitrary chunks; events are raised as soon as
+/// the corresponding element is complete, so memory use is bounded by the
+/// largest single scalar rather than by the size of the response, or by
+/// kScalarChunkSize for scalars the handler streams.
+class XmlRpcStreamParser {
+ public:
+  /// Largest piece of a streamed scalar held before it is passed on.
+  static const size_t kScalarChunkSize = 64 * 1024;
+
+  explicit XmlRpcStreamParser(XmlRpcHandler* handler);
+
+  /// Parse the next chunk of the document.
+  /// Throws SubtleException on malformed input.
+  void Feed(const char* data, size_t size);
+
+  /// Signal the end of the document.
+  /// Throws SubtleException when the document is incomplete.
+  void Finish();
+
+ private:
+  enum State { TEXT, TAG, ENTITY, CDATA };
+
+  void AppendText(const char* data, size_t size);
+  void HandleTag();
+  void OpenElement(const string& name);
+  void CloseElement(const string& name);
+  void AppendEntity();
+  void BeginTypedValue();
+  void FlushChunk();
+  void EndScalar(ScalarType type);
+
+  XmlRpcHandler* handler_;
+  State state_;
+  string tag_;
+  string entity_;
+  string text_;
+  // ']' read in a CDATA section, held back while they may start its "]]>"
+  size_t cdata_end_;
+  bool collecting_;
+  // text_ of the open value goes to OnScalarChunk
+  bool streaming_;
+  // one entry per open <value>; true once it got a typed child element
+  vector<bool> values_;
+  int depth_;
+};
+
+/// Feeds a response to a parser as the transport receives it.
+class XmlRpcParserSink : public ByteSink {
+ public:
+  explicit XmlRpcParserSink(XmlRpcStreamParser* parser) : parser_(parser) {}
+  void Write(const char* data, size_t size) { parser_->Feed(data, size); }
+
+ private:
+  XmlRpcStreamParser* parser_;
+};
+
+/// Decodes a SearchSubtitles response from its XML, handing out each SubFile
+/// as soon as its struct is closed.
+class SearchResponseDecoder : public XmlRpcHandler {
+ public:
+  typedef std::function<void(SubFile&&)> Callback;
+
+  /// \param response receives the status of the call.
+  /// \param callback receives every subtitle found.
+  SearchResponseDecoder(SearchResponse* response, const Callback& callback);
+  /// Decode every subtitle found straight into a compact set, with no
+  /// SubFile or string per field in between.
+  /// \param response receives the status of the call.
+  /// \param results receives every subtitle found; not owned.
+  SearchResponseDecoder(SearchResponse* response, CompactSubFiles* results);
+
+  void OnStructBegin();
+  void OnStructEnd();
+  void OnArrayBegin();
+  void OnArrayEnd();
+  void OnMemberName(const string& name);
+  void OnScalar(ScalarType type, const string& text);
+  void OnFault();
+  string StatusText() const { return fault_ ? "" : status_; }
+
+  /// Apply the collected status to the response.
+  /// Throws SubtleException when the server answered with a fault.
+  void Finish();
+
+ private:
+  SearchResponse* response_;
+  Callback callback_;
+  CompactSubFiles* results_;
+  int struct_depth_;
+  int array_depth_;
+  // member of the top-level struct being decoded
+  string member_;
+  // member of the subtitle struct being decoded
+  string field_;
+  string status_;
+  double seconds_;
+  bool fault_;
+  SubFile current_;
+};
+
+/// Decodes a DownloadSubtitles response from its XML, streaming the base64
+/// data of each subtitle into a sink as it arrives instead of collecting it.
+class DownloadResponseDecoder : public XmlRpcHandler {
+ public:
+  /// Returns the sink for the base64 data of the subtitle file with the given
+  /// id, or NULL to skip it. The service sends the id before the data.
+  typedef std::function<ByteSink*(const string& id)> Open;
+
+  /// \param response receives the status of the call, and the ids of the
+  ///        subtitle files received paired with empty data.
+  /// \param open chooses where the data of each subtitle goes.
+  DownloadResponseDecoder(DownloadResponse* response, const Open& open);
+
+  void OnStructBegin();
+  void OnStructEnd();
+  void OnArrayBegin();
+  void OnArrayEnd();
+  void OnMemberName(const string& name);
+  void OnScalar(ScalarType type, const string& text);
+  void OnFault();
+  bool StreamScalar();
+  void OnScalarChunk(const char* data, size_t size);
+  void OnScalarEnd(ScalarType type);
+  string StatusText() const { return fault_ ? "" : status_; }
+
+  /// Apply the collected status to the response.
+  /// Throws SubtleException when the server answered with a fault.
+  void Finish();
+
+ private:
+  bool InSubtitle() const;
+
+  DownloadResponse* response_;
+  Open open_;
+  int struct_depth_;
+  int array_depth_;
+  string member_;
+  string field_;
+  string status_;
+  double seconds_;
+  bool fault_;
+  string id_;
+  // sink of the data being streamed, NULL when it is skipped
+  ByteSink* sink_;
+};
+
+}  // namespace libsubtle
+
+#endif  // SRC_XMLRPC_STREAM_H_
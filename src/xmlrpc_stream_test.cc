@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "src/xmlrpc_stream.h"
+
+using std::string;
+using std::vector;
+
+namespace libsubtle {
+
+const char kSearchXml[] =
+  "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+  "<methodResponse><params><param><value><struct>"
+  "<member><name>status</name><value><string>200 OK</string></value></member>"
+  "<member><name>data</name><value><array><data>"
+  "<value><struct>"
+  "<member><name>IDSubtitleFile</name><value><string>1951894257</string>"
+  "</value></member>"
+  "<member><name>SubFileName</name><value><string>Tom &amp; Jerry.srt"
+  "</string></value></member>"
+  "<member><name>SubRating</name><value>7.5</value></member>"
+  "<member><name>QueryNumber</name><value><int>0</int></value></member>"
+  "</struct></value>"
+  "<value><struct>"
+  "<member><name>IDSubtitleFile</name><value><string>42</string></value>"
+  "</member>"
+  "<!-- a <comment> -->"
+  "<member><name>MovieName</name><value><string>&quot;Amelie&quot; &#233;"
+  "</string></value></member>"
+  "</struct></value>"
+  "</data></array></value></member>"
+  "<member><name>seconds</name><value><double>0.25</double></value></member>"
+  "</struct></value></param></params></methodResponse>";
+
+const char kEmptyXml[] =
+  "<methodResponse><params><param><value><struct>"
+  "<member><name>status</name><value><string>200 OK</string></value></member>"
+  "<member><name>data</name><value><boolean>0</boolean></value></member>"
+  "<member><name>seconds</name><value><double>0.01</double></value></member>"
+  "</struct></value></param></params></methodResponse>";
+
+const char kFaultXml[] =
+  "<methodResponse><fault><value><struct>"
+  "<member><name>faultCode</name><value><int>4</int></value></member>"
+  "<member><name>faultString</name><value><string>Too many parameters"
+  "</string></value></member>"
+  "</struct></value></fault></methodResponse>";
+
+vector<SubFile> Decode(const string& xml, size_t chunk,
+                       SearchResponse* response) {
+  vector<SubFile> subs;
+  SearchResponseDecoder decoder(response, [&subs](SubFile&& sub) {
+    subs.push_back(sub);
+  });
+  XmlRpcStreamParser parser(&decoder);
+  for (size_t pos = 0; pos < xml.size(); pos += chunk) {
+    parser.Feed(xml.data() + pos, std::min(chunk, xml.size() - pos));
+  }
+  parser.Finish();
+  decoder.Finish();
+  return subs;
+}
+
+TEST(XmlRpcStream, Search) {
+  SearchResponse response;
+  vector<SubFile> subs = Decode(kSearchXml, sizeof(kSearchXml), &response);
+
+  ASSERT_EQ(OK, response.GetStatus());
+  ASSERT_EQ(0.25, response.Duration());
+  ASSERT_EQ(2, subs.size());
+  ASSERT_EQ("1951894257", subs[0].IDSubtitleFile_);
+  ASSERT_EQ("Tom & Jerry.srt", subs[0].SubFileName_);
+  ASSERT_EQ("7.5", subs[0].SubRating_);
+  ASSERT_EQ("42", subs[1].IDSubtitleFile_);
+  ASSERT_EQ("\"Amelie\" \xc3\xa9", subs[1].MovieName_);
+}
+
+TEST(XmlRpcStream, SearchByteByByte) {
+  SearchResponse response;
+  vector<SubFile> subs = Decode(kSearchXml, 1, &response);
+
+  ASSERT_EQ(OK, response.GetStatus());
+  ASSERT_EQ(2, subs.size());
+  ASSERT_EQ("Tom & Jerry.srt", subs[0].SubFileName_);
+  ASSERT_EQ("\"Amelie\" \xc3\xa9", subs[1].MovieName_);
+}
+
+TEST(XmlRpcStream, SearchCompact) {
+  CompactSubFiles results;
+  size_t memory = 0;
+  for (int round = 0; round < 2; ++round) {
+    results.Clear();
+    SearchResponse response;
+    SearchResponseDecoder decoder(&response, &results);
+    XmlRpcStreamParser parser(&decoder);
+    for (size_t pos = 0; pos < sizeof(kSearchXml) - 1; ++pos) {
+      parser.Feed(kSearchXml + pos, 1);
+    }
+    parser.Finish();
+    decoder.Finish();
+
+    ASSERT_EQ(OK, response.GetStatus());
+    ASSERT_EQ(2, results.size());
+    ASSERT_EQ(1951894257u, results[0].id_subtitle_file);
+    ASSERT_EQ("Tom & Jerry.srt", results.Text(results[0].sub_file_name));
+    ASSERT_FLOAT_EQ(7.5, results[0].sub_rating);
+    ASSERT_EQ(42u, results[1].id_subtitle_file);
+    ASSERT_EQ("\"Amelie\" \xc3\xa9", results.Text(results[1].movie_name));
+    ASSERT_EQ("", results.Text(results[1].sub_file_name));
+    // the second response fits in the memory of the first
+    if (round == 0) {
+      memory = results.MemoryUsage();
+    }
+    ASSERT_EQ(memory, results.MemoryUsage());
+  }
+}
+
+TEST(XmlRpcStream, SearchEmpty) {
+  SearchResponse response;
+  vector<SubFile> subs = Decode(kEmptyXml, 7, &response);
+
+  ASSERT_EQ(OK, response.GetStatus());
+  ASSERT_EQ(0, subs.size());
+}
+
+TEST(XmlRpcStream, Fault) {
+  SearchResponse response;
+  ASSERT_THROW(Decode(kFaultXml, 16, &response), SubtleException);
+}
+
+TEST(XmlRpcStream, Truncated) {
+  SearchResponse response;
+  string xml(kSearchXml);
+  ASSERT_THROW(Decode(xml.substr(0, xml.size() / 2), 64, &response),
+               SubtleException);
+}
+
+TEST(XmlRpcStream, Cdata) {
+  string xml =
+      "<methodResponse><params><param><value><struct>"
+      "<member><name>status</name><value><![CDATA[200 OK]]></value></member>"
+      "<member><name>data</name><value><array><data><value><struct>"
+      "<member><name>SubFileName</name><value><string>Tom <![CDATA[& <b>"
+      "]] ]> ]]]]>.srt</string></value></member>"
+      "</struct></value></data></array></value></member>"
+      "</struct></value></param></params></methodResponse>";
+  for (size_t chunk : {size_t(1), size_t(7), xml.size()}) {
+    SearchResponse response;
+    vector<SubFile> subs = Decode(xml, chunk, &response);
+    ASSERT_EQ(OK, response.GetStatus());
+    ASSERT_EQ(1, subs.size());
+    ASSERT_EQ("Tom & <b>]] ]> ]].srt", subs[0].SubFileName_) << chunk;
+  }
+
+  SearchResponse response;
+  ASSERT_THROW(Decode(xml.substr(0, xml.find("]]]]>")), 16, &response),
+               SubtleException);
+}
+
+// Collects a stream, remembering the largest piece written.
+class PieceSink : public ByteSink {
+ public:
+  PieceSink() : largest_(0), finished_(false) {}
+  void Write(const char* data, size_t size) {
+    text_.append(data, size);
+    largest_ = std::max(largest_, size);
+  }
+  void Finish() { finished_ = true; }
+
+  string text_;
+  size_t largest_;
+  bool finished_;
+};
+
+TEST(XmlRpcStream, DownloadStreamsData) {
+  string payload;
+  while (payload.size() < 3 * XmlRpcStreamParser::kScalarChunkSize) {
+    payload += "H4sIAAAAAAAAA+3OMQ0AAAgDsJ8/";
+  }
+  string xml =
+      "<methodResponse><params><param><value><struct>"
+      "<member><name>status</name><value><string>200 OK</string></value>"
+      "</member><member><name>data</name><value><array><data>"
+      "<value><struct>"
+      "<member><name>idsubtitlefile</name><value><string>1</string></value>"
+      "</member><member><name>data</name><value><string>skipped"
+      "</string></value></member></struct></value>"
+      "<value><struct>"
+      "<member><name>idsubtitlefile</name><value><string>2</string></value>"
+      "</member><member><name>data</name><value><string>" + payload +
+      "</string></value></member></struct></value>"
+      "</data></array></value></member>"
+      "<member><name>seconds</name><value><double>0.5</double></value>"
+      "</member></struct></value></param></params></methodResponse>";
+
+  PieceSink sink;
+  DownloadResponse response;
+  DownloadResponseDecoder decoder(&response, [&sink](const string& id) {
+    return id == "2" ? static_cast<ByteSink*>(&sink) : NULL;
+  });
+  XmlRpcStreamParser parser(&decoder);
+  for (size_t pos = 0; pos < xml.size(); pos += 1000) {
+    parser.Feed(xml.data() + pos, std::min<size_t>(1000, xml.size() - pos));
+  }
+  parser.Finish();
+  decoder.Finish();
+
+  ASSERT_EQ(OK, response.GetStatus());
+  ASSERT_EQ(2u, response.subtitles_.size());
+  ASSERT_EQ("1", response.subtitles_[0].first);
+  ASSERT_EQ("2", response.subtitles_[1].first);
+  ASSERT_EQ("", response.subtitles_[1].second);
+  ASSERT_TRUE(sink.finished_);
+  ASSERT_EQ(payload, sink.text_);
+  ASSERT_GE(XmlRpcStreamParser::kScalarChunkSize + 1000, sink.largest_);
+}
+
+}  // namespace libsubtle